@@ -0,0 +1,42 @@
+local util = require "core:tests_util"
+
+-- Create world and prepare settings
+util.create_demo_world("core:default")
+app.set_setting("chunks.load-distance", 3)
+app.set_setting("chunks.load-speed", 1)
+
+local base_util = require "base:util"
+
+-- Create player
+local pid = player.create("Xerxes")
+player.set_spawnpoint(pid, 0, 100, 0)
+player.set_pos(pid, 0, 100, 0)
+
+-- Wait for chunk to load
+app.sleep_until(function () return block.get(0, 0, 0) ~= -1 end)
+
+local drop = base_util.drop({0, 100, 0}, item.index("base:bazalt_breaker"), 1)
+assert(drop ~= nil)
+local uid = drop:get_uid()
+
+local function contains(list, value)
+    for _, v in ipairs(list) do
+        if v == value then
+            return true
+        end
+    end
+    return false
+end
+
+assert(contains(entities.get_all_in_radius({0, 100, 0}, 2), uid))
+
+-- Moved entity is found at the new position without physics steps
+drop.transform:set_pos({40, 120, -30})
+assert(contains(entities.get_all_in_radius({40, 120, -30}, 2), uid))
+assert(not contains(entities.get_all_in_radius({0, 100, 0}, 2), uid))
+assert(contains(entities.get_all_in_box({38, 118, -32}, {4, 4, 4}), uid))
+
+-- Spatial index is still valid after the physics step
+app.tick()
+local pos = drop.transform:get_pos()
+assert(contains(entities.get_all_in_radius(pos, 2), uid))
@@ -0,0 +1,71 @@
+-- Loopback echo throughput: copying recv versus recv_into reused arrays
+local PORT = 47300
+local CHUNK = 64 * 1024
+local TOTAL = 32 * 1024 * 1024
+local WINDOW = 1024 * 1024
+
+local server_socket
+local server = network.tcp_open(PORT, function (socket)
+    server_socket = socket
+end)
+local client = network.tcp_connect("127.0.0.1", PORT, function () end)
+app.sleep_until(function ()
+    return server_socket ~= nil and client:is_connected()
+end, 1000)
+assert(server_socket, "connection timeout")
+
+local chunk = Bytearray(CHUNK)
+for i=1,CHUNK do
+    chunk[i] = i % 256
+end
+
+local function run(zerocopy)
+    local echo_buffer = Bytearray()
+    local recv_buffer = Bytearray()
+    local sent = 0
+    local received = 0
+    local start = time.uptime()
+    while received < TOTAL do
+        while sent < TOTAL and sent - received < WINDOW do
+            client:send(chunk)
+            sent = sent + CHUNK
+        end
+        if zerocopy then
+            while server_socket:recv_into(echo_buffer) > 0 do
+                server_socket:send(echo_buffer)
+            end
+            while client:recv_into(recv_buffer) > 0 do
+                assert(recv_buffer[1] == (received + 1) % 256)
+                received = received + #recv_buffer
+            end
+        else
+            local bytes = server_socket:recv(server_socket:available())
+            while #bytes > 0 do
+                server_socket:send(bytes)
+                bytes = server_socket:recv(server_socket:available())
+            end
+            bytes = client:recv(client:available())
+            while #bytes > 0 do
+                assert(bytes[1] == (received + 1) % 256)
+                received = received + #bytes
+                bytes = client:recv(client:available())
+            end
+        end
+        if time.uptime() - start > 60 then
+            error("echo timeout")
+        end
+        app.tick()
+    end
+    return TOTAL / 1024 / 1024 / (time.uptime() - start)
+end
+
+local copying = run(false)
+local zerocopy = run(true)
+print(string.format(
+    "loopback echo of %d MiB: recv %.1f MiB/s, recv_into %.1f MiB/s",
+    TOTAL / 1024 / 1024, copying, zerocopy
+))
+
+client:close()
+server_socket:close()
+server:close()
@@ -0,0 +1,49 @@
+local util = require "core:tests_util"
+util.create_demo_world()
+
+app.set_setting("chunks.load-distance", 12)
+app.set_setting("chunks.load-speed", 15)
+
+local pid = player.create("Xerxes")
+player.set_pos(pid, 0, 100, 0)
+app.sleep_until(function () return block.get(0, 0, 0) ~= -1 end)
+
+-- grass blocks receive random updates in batches
+local updates = 0
+local batches = 0
+events.on("base:grass_block.blocksrandupdate", function(coords)
+    assert(#coords % 3 == 0)
+    updates = updates + #coords / 3
+    batches = batches + 1
+end)
+events.on("base:grass_block.randupdate", function(x, y, z)
+    updates = updates + 1
+end)
+
+local ticks = 200
+
+local function measure(name)
+    updates = 0
+    batches = 0
+    local start = time.uptime()
+    for i=1,ticks do
+        app.tick()
+    end
+    local elapsed = time.uptime() - start
+    print(string.format(
+        "%s: %d grass updates in %d batches, %.1f updates/ms",
+        name, updates, batches, updates / math.max(elapsed * 1000, 1e-3)
+    ))
+end
+
+print("chunks loaded", world.count_chunks())
+measure("batched")
+assert(batches <= ticks)
+
+-- per position baseline
+app.set_setting("debug.batch-random-updates", false)
+measure("per position")
+assert(batches == 0)
+
+app.close_world(true)
+app.delete_world("demo")
@@ -71,46 +71,38 @@ function place_structures_wide(x, z, w, d, chunk_height)
 end
 
 function generate_heightmap(x, y, w, h, s, inputs)
-    local umap = Heightmap(w, h)
-    local vmap = Heightmap(w, h)
-    umap.noiseSeed = SEED
+    local umap = HeightmapExpr()
+    local vmap = HeightmapExpr()
     vmap.noiseSeed = SEED
-    vmap:noise({x+521, y+70}, 0.1*s, 3, 25.8)
-    vmap:noise({x+95, y+246}, 0.15*s, 3, 25.8)
+    vmap = vmap:noise({x+521, y+70}, 0.1*s, 3, 25.8)
+    vmap = vmap:noise({x+95, y+246}, 0.15*s, 3, 25.8)
 
-    local map = Heightmap(w, h)
+    local map = HeightmapExpr()
     map.noiseSeed = SEED
-    map:noise({x, y}, 0.8*s, 4, 0.02)
-    map:cellnoise({x, y}, 0.1*s, 3, 0.3, umap, vmap)
-    map:add(0.7)
+    map = map:noise({x, y}, 0.8*s, 4, 0.02)
+    map = map:cellnoise({x, y}, 0.1*s, 3, 0.3, umap, vmap)
+    map = map:add(0.7)
 
-    local rivermap = Heightmap(w, h)
+    local rivermap = HeightmapExpr()
     rivermap.noiseSeed = SEED
-    rivermap:noise({x+21, y+12}, 0.1*s, 4)
-    rivermap:abs()
-    rivermap:mul(2.0)
-    rivermap:pow(0.15)
-    rivermap:max(0.5)
-    map:mul(rivermap)
-
-    local desertmap = Heightmap(w, h)
+    rivermap = rivermap:noise({x+21, y+12}, 0.1*s, 4)
+    rivermap = rivermap:abs():mul(2.0):pow(0.15):max(0.5)
+    map = map:mul(rivermap)
+
+    local desertmap = HeightmapExpr()
     desertmap.noiseSeed = SEED
-    desertmap:cellnoise({x+52, y+326}, 0.3*s, 2, 0.2)
-    desertmap:add(0.5)
-    map:mixin(desertmap, inputs[1])
-    return map
+    desertmap = desertmap:cellnoise({x+52, y+326}, 0.3*s, 2, 0.2)
+    desertmap = desertmap:add(0.5)
+    return map:mixin(desertmap, inputs[1]):eval(w, h)
 end
 
 function generate_biome_parameters(x, y, w, h, s)
-    local tempmap = Heightmap(w, h)
+    local tempmap = HeightmapExpr()
     tempmap.noiseSeed = SEED + 5324
-    tempmap:noise({x, y}, 0.08*s, 6)
-    tempmap:mul(0.5)
-    tempmap:add(0.5)
-    local hummap = Heightmap(w, h)
+    tempmap = tempmap:noise({x, y}, 0.08*s, 6)
+    tempmap = tempmap:mul(0.5):add(0.5):pow(3)
+    local hummap = HeightmapExpr()
     hummap.noiseSeed = SEED + 953
-    hummap:noise({x, y}, 0.08*s, 6)
-    tempmap:pow(3)
-    hummap:pow(3)
-    return tempmap, hummap
+    hummap = hummap:noise({x, y}, 0.08*s, 6):pow(3)
+    return tempmap:eval(w, h), hummap:eval(w, h)
 end
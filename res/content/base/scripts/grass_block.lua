@@ -1,9 +1,11 @@
-function on_random_update(x, y, z)
-    local dirtid = block.index('base:dirt');
+local function random_update(x, y, z, dirtid, grassblockid)
+    -- block may be replaced by previous updates of the batch
+    if block.get(x, y, z) ~= grassblockid then
+        return
+    end
     if block.is_solid_at(x, y+1, z) then
         block.set(x, y, z, dirtid, 0)
     else
-        local grassblockid = block.index('base:grass_block')
         for lx=-1,1 do
             for ly=-1,1 do
                 for lz=-1,1 do
@@ -18,3 +20,17 @@ function on_random_update(x, y, z)
         end
     end
 end
+
+function on_random_update(x, y, z)
+    random_update(
+        x, y, z, block.index('base:dirt'), block.index('base:grass_block')
+    )
+end
+
+function on_blocks_random_update(coords)
+    local dirtid = block.index('base:dirt')
+    local grassblockid = block.index('base:grass_block')
+    for i=1,#coords,3 do
+        random_update(coords[i], coords[i+1], coords[i+2], dirtid, grassblockid)
+    end
+end
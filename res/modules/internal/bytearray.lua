@@ -209,7 +209,12 @@ local function FFIBytearray_as_string(bytes)
     end
 end
 
+local function FFIBytearray_is(value)
+    return FFI.istype(bytearray_type, value)
+end
+
 return {
     FFIBytearray = setmetatable(FFIBytearray, FFIBytearray),
-    FFIBytearray_as_string = FFIBytearray_as_string
+    FFIBytearray_as_string = FFIBytearray_as_string,
+    FFIBytearray_is = FFIBytearray_is
 }
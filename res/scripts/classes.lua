@@ -39,6 +39,11 @@ end
 local Socket = {__index={
     send=function(self, ...) return network.__send(self.id, ...) end,
     recv=function(self, ...) return network.__recv(self.id, ...) end,
+    recv_into=function(self, bytes, length)
+        length = length or network.__available(self.id) or 0
+        bytes:reserve(length)
+        return network.__recv_into(self.id, bytes, length)
+    end,
     close=function(self) return network.__close(self.id) end,
     available=function(self) return network.__available(self.id) or 0 end,
     is_alive=function(self) return network.__is_alive(self.id) end,
@@ -31,6 +31,7 @@ local function complete_app_lib(app)
     app.close_world = core.close_world
     app.reopen_world = core.reopen_world
     app.delete_world = core.delete_world
+    app.recompress_world = core.recompress_world
     app.reconfig_packs = core.reconfig_packs
     app.get_setting = core.get_setting
     app.set_setting = core.set_setting
@@ -142,11 +143,25 @@ function events.on(event, func)
     table.insert(events.handlers[event], func)
 end
 
+-- handlers lists are cleared in place as the engine keeps references to them
+-- (see lua::get_event_handle)
+local function clear_handlers(handlers)
+    for i = #handlers, 1, -1 do
+        handlers[i] = nil
+    end
+end
+
 function events.reset(event, func)
-    if func == nil then
-        events.handlers[event] = nil
-    else
-        events.handlers[event] = {func}
+    local handlers = events.handlers[event]
+    if handlers == nil then
+        if func ~= nil then
+            events.handlers[event] = {func}
+        end
+        return
+    end
+    clear_handlers(handlers)
+    if func ~= nil then
+        handlers[1] = func
     end
 end
 
@@ -157,7 +172,7 @@ function events.remove_by_prefix(prefix)
             actualname = name[1]
         end
         if actualname:sub(1, #prefix+1) == prefix..':' then
-            events.handlers[actualname] = nil
+            clear_handlers(handlers)
         end
     end
 end
@@ -272,6 +287,7 @@ local bytearray = require "core:internal/bytearray"
 Bytearray = bytearray.FFIBytearray
 Bytearray_as_string = bytearray.FFIBytearray_as_string
 Bytearray_construct = Bytearray.__call
+Bytearray_is = bytearray.FFIBytearray_is
 ffi = nil
 
 math.randomseed(time.uptime() * 1536227939)
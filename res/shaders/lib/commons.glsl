@@ -13,6 +13,21 @@ vec4 decompress_light(float compressed_light) {
     return result;
 }
 
+float half_to_float(uint bits) {
+    uint exponent = (bits >> 10) & 0x1Fu;
+    if (exponent == 0u) {
+        return 0.0;
+    }
+    return (1.0 + float(bits & 0x3FFu) / 1024.0) * exp2(float(exponent) - 15.0);
+}
+
+// repeated texture region size packed as two half precision floats
+vec2 decompress_tile_size(float compressed_size) {
+    uint compressed = floatBitsToUint(compressed_size);
+    return vec2(half_to_float(compressed & 0xFFFFu),
+                half_to_float(compressed >> 16));
+}
+
 vec3 pick_sky_color(samplerCube cubemap) {
     vec3 skyLightColor = texture(cubemap, vec3(0.4f, 0.0f, 0.4f)).rgb;
     skyLightColor *= SKY_LIGHT_TINT;
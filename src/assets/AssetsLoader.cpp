@@ -167,6 +167,19 @@ void AssetsLoader::processPreload(
             add(tag, path, name, std::make_shared<AtlasCfg>(type));
             break;
         }
+        case AssetType::SHADER: {
+            std::vector<std::string> defines;
+            if (map.has("defines")) {
+                for (const auto& define : map["defines"]) {
+                    defines.push_back(define.asString());
+                }
+            }
+            add(tag,
+                path,
+                name,
+                std::make_shared<ShaderCfg>(std::move(defines)));
+            break;
+        }
         default:
             add(tag, path, name);
             break;
@@ -55,6 +55,15 @@ struct AtlasCfg : AssetCfg {
     }
 };
 
+struct ShaderCfg : AssetCfg {
+    /// @brief Names defined for the shader program sources
+    std::vector<std::string> defines;
+
+    ShaderCfg(std::vector<std::string> defines)
+        : defines(std::move(defines)) {
+    }
+};
+
 using aloader_func = std::function<
     assetload::
         postfunc(AssetsLoader*, const ResPaths&, const std::string&, const std::string&, std::shared_ptr<AssetCfg>)>;
@@ -60,7 +60,11 @@ assetload::postfunc assetload::texture(
     }
 }
 
-static auto process_program(const ResPaths& paths, const std::string& filename) {
+static auto process_program(
+    const ResPaths& paths,
+    const std::string& filename,
+    const std::vector<std::string>& defines = {}
+) {
     io::path vertexFile = paths.find(filename + ".glslv");
     io::path fragmentFile = paths.find(filename + ".glslf");
 
@@ -69,8 +73,10 @@ static auto process_program(const ResPaths& paths, const std::string& filename)
 
     auto& preprocessor = *Shader::preprocessor;
 
-    auto vertex = preprocessor.process(vertexFile, vertexSource);
-    auto fragment = preprocessor.process(fragmentFile, fragmentSource);
+    auto vertex =
+        preprocessor.process(vertexFile, vertexSource, false, defines);
+    auto fragment =
+        preprocessor.process(fragmentFile, fragmentSource, false, defines);
     return std::make_pair(vertex, fragment);
 }
 
@@ -79,9 +85,12 @@ assetload::postfunc assetload::shader(
     const ResPaths& paths,
     const std::string& filename,
     const std::string& name,
-    const std::shared_ptr<AssetCfg>&
+    const std::shared_ptr<AssetCfg>& config
 ) {
-    auto [vertex, fragment] = process_program(paths, filename);
+    auto cfg = std::dynamic_pointer_cast<ShaderCfg>(config);
+    auto [vertex, fragment] = process_program(
+        paths, filename, cfg ? cfg->defines : std::vector<std::string> {}
+    );
 
     io::path vertexFile = paths.find(filename + ".glslv");
     io::path fragmentFile = paths.find(filename + ".glslf");
@@ -113,7 +113,13 @@ static Value default_value_for(Type type) {
 
 class GLSLParser : public BasicParser<char> {
 public:
-    GLSLParser(GLSLExtension& glsl, std::string_view file, std::string_view source, bool header)
+    GLSLParser(
+        GLSLExtension& glsl,
+        std::string_view file,
+        std::string_view source,
+        bool header,
+        const std::vector<std::string>& defines
+    )
         : BasicParser(file, source), glsl(glsl) {
         if (!header) {
             ss << "#version " << GLSLExtension::VERSION << '\n';
@@ -121,6 +127,9 @@ public:
         for (auto& entry : glsl.getDefines()) {
             ss << "#define " << entry.first << " " << entry.second << '\n';
         }
+        for (const auto& name : defines) {
+            ss << "#define " << name << '\n';
+        }
         uint linenum = 1;
         source_line(ss, linenum);
 
@@ -265,9 +274,12 @@ private:
 };
 
 GLSLExtension::ProcessingResult GLSLExtension::process(
-    const io::path& file, const std::string& source, bool header
+    const io::path& file,
+    const std::string& source,
+    bool header,
+    const std::vector<std::string>& defines
 ) {
     std::string filename = file.string();
-    GLSLParser parser(*this, filename, source, header);
+    GLSLParser parser(*this, filename, source, header, defines);
     return parser.process();
 }
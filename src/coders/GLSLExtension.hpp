@@ -33,10 +33,12 @@ public:
     bool hasDefine(const std::string& name) const;
     void loadHeader(const std::string& name);
     
+    /// @param defines names defined for this source only
     ProcessingResult process(
         const io::path& file,
         const std::string& source,
-        bool header = false
+        bool header = false,
+        const std::vector<std::string>& defines = {}
     );
 
     static inline std::string VERSION = "330 core";
@@ -2,10 +2,12 @@
 
 #include <string>
 #include <cstring>
+#include <iterator>
 #include <stdexcept>
 
 #include "rle.hpp"
 #include "gzip.hpp"
+#include "lz4.hpp"
 #include "util/BufferPool.hpp"
 
 using namespace compression;
@@ -55,6 +57,32 @@ static auto compress_rle(
     return data;
 }
 
+static const char* METHOD_NAMES[] {
+    "none", "extrle8", "extrle16", "gzip", "lz4"
+};
+
+std::string compression::to_string(Method method) {
+    return METHOD_NAMES[static_cast<int>(method)];
+}
+
+Method compression::parse_method(const std::string& name) {
+    for (size_t i = 0; i < std::size(METHOD_NAMES); i++) {
+        if (name == METHOD_NAMES[i]) {
+            return static_cast<Method>(i);
+        }
+    }
+    throw std::invalid_argument("unknown compression method '" + name + "'");
+}
+
+Method compression::method_from_byte(ubyte value) {
+    if (value >= std::size(METHOD_NAMES)) {
+        throw std::invalid_argument(
+            "unknown compression method " + std::to_string(value)
+        );
+    }
+    return static_cast<Method>(value);
+}
+
 std::unique_ptr<ubyte[]> compression::compress(
     const ubyte* src, size_t srclen, size_t& len, Method method
 ) {
@@ -72,6 +100,17 @@ std::unique_ptr<ubyte[]> compression::compress(
             len = buffer.size();
             return data;
         }
+        case Method::LZ4: {
+            size_t bufferSize = lz4::compress_bound(srclen);
+            auto buffer = std::make_unique<ubyte[]>(bufferSize);
+            len = lz4::encode(src, srclen, buffer.get());
+            if (len < bufferSize * BUFFER_NOCROP_THRESOLD) {
+                auto cropped = std::make_unique<ubyte[]>(len);
+                std::memcpy(cropped.get(), buffer.get(), len);
+                return cropped;
+            }
+            return buffer;
+        }
         default:
             throw std::runtime_error("not implemented");
     }
@@ -109,6 +148,17 @@ std::unique_ptr<ubyte[]> compression::decompress(
             std::memcpy(decompressed.get(), buffer.data(), buffer.size());
             return decompressed;
         }
+        case Method::LZ4: {
+            auto decompressed = std::make_unique<ubyte[]>(dstlen);
+            size_t decoded =
+                lz4::decode(src, srclen, decompressed.get(), dstlen);
+            if (decoded != dstlen) {
+                throw std::runtime_error(
+                    "expected decompressed size " + std::to_string(dstlen) +
+                    " got " + std::to_string(decoded));
+            }
+            return decompressed;
+        }
         default:
             throw std::runtime_error("not implemented");
     }
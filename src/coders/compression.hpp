@@ -1,14 +1,27 @@
 #pragma once
 
 #include <memory>
+#include <string>
 
 #include "typedefs.hpp"
 
 namespace compression {
+    /// @brief Compression method. Values are stored in region files
     enum class Method {
-        NONE, EXTRLE8, EXTRLE16, GZIP
+        NONE, EXTRLE8, EXTRLE16, GZIP, LZ4
     };
 
+    /// @return compression method name
+    std::string to_string(Method method);
+
+    /// @brief Get compression method by name
+    /// @throws std::invalid_argument if name is unknown
+    Method parse_method(const std::string& name);
+
+    /// @brief Get compression method by value stored in a file
+    /// @throws std::invalid_argument if value is unknown
+    Method method_from_byte(ubyte value);
+
     /// @brief Compress buffer
     /// @param src source buffer
     /// @param srclen length of the source buffer
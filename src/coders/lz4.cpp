@@ -0,0 +1,171 @@
+#include "lz4.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+inline constexpr size_t MIN_MATCH = 4;
+/// @brief Number of bytes at the end of block always encoded as literals
+inline constexpr size_t LAST_LITERALS = 5;
+/// @brief Min distance between the last match start and the block end
+inline constexpr size_t MF_LIMIT = 12;
+inline constexpr size_t MAX_OFFSET = 0xFFFF;
+inline constexpr uint HASH_BITS = 12;
+/// @brief Skip strength for incompressible data: step is incremented
+/// every 2^SKIP_TRIGGER bytes without matches
+inline constexpr uint SKIP_TRIGGER = 6;
+
+static inline uint32_t read32(const ubyte* src) {
+    uint32_t value;
+    std::memcpy(&value, src, sizeof(value));
+    return value;
+}
+
+static inline uint hash(uint32_t sequence) {
+    return (sequence * 2654435761U) >> (32 - HASH_BITS);
+}
+
+static inline ubyte* write_length(ubyte* dst, size_t length) {
+    while (length >= 255) {
+        *dst++ = 255;
+        length -= 255;
+    }
+    *dst++ = length;
+    return dst;
+}
+
+static inline ubyte* write_literals(
+    ubyte* dst, ubyte* token, const ubyte* src, size_t length
+) {
+    *token = std::min<size_t>(length, 15) << 4;
+    if (length >= 15) {
+        dst = write_length(dst, length - 15);
+    }
+    std::memcpy(dst, src, length);
+    return dst + length;
+}
+
+size_t lz4::encode(const ubyte* src, size_t length, ubyte* dst) {
+    const ubyte* const end = src + length;
+    const ubyte* anchor = src;
+    ubyte* op = dst;
+
+    if (length > MF_LIMIT) {
+        uint32_t table[1 << HASH_BITS] {};
+        const ubyte* const matchStartLimit = end - MF_LIMIT;
+        const ubyte* const matchEndLimit = end - LAST_LITERALS;
+        const ubyte* ip = src + 1;
+
+        while (ip < matchStartLimit) {
+            uint32_t sequence = read32(ip);
+            uint h = hash(sequence);
+            const ubyte* ref = src + table[h];
+            table[h] = ip - src;
+            if (ref >= ip || static_cast<size_t>(ip - ref) > MAX_OFFSET ||
+                read32(ref) != sequence) {
+                ip += 1 + ((ip - anchor) >> SKIP_TRIGGER);
+                continue;
+            }
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const ubyte* matchEnd = ip + MIN_MATCH;
+            const ubyte* refEnd = ref + MIN_MATCH;
+            while (matchEnd < matchEndLimit && *matchEnd == *refEnd) {
+                matchEnd++;
+                refEnd++;
+            }
+            ubyte* token = op++;
+            op = write_literals(op, token, anchor, ip - anchor);
+
+            size_t offset = ip - ref;
+            *op++ = offset & 0xFF;
+            *op++ = offset >> 8;
+
+            size_t matchLength = matchEnd - ip - MIN_MATCH;
+            *token |= std::min<size_t>(matchLength, 15);
+            if (matchLength >= 15) {
+                op = write_length(op, matchLength - 15);
+            }
+            ip = anchor = matchEnd;
+            if (ip < matchStartLimit) {
+                table[hash(read32(ip - 2))] = ip - 2 - src;
+            }
+        }
+    }
+    ubyte* token = op++;
+    op = write_literals(op, token, anchor, end - anchor);
+    return op - dst;
+}
+
+static inline size_t read_length(const ubyte*& src, const ubyte* end) {
+    size_t length = 0;
+    ubyte value;
+    do {
+        if (src >= end) {
+            throw std::runtime_error("lz4: unexpected end of data");
+        }
+        value = *src++;
+        length += value;
+    } while (value == 255);
+    return length;
+}
+
+size_t lz4::decode(
+    const ubyte* src, size_t length, ubyte* dst, size_t dstlength
+) {
+    const ubyte* ip = src;
+    const ubyte* const end = src + length;
+    ubyte* op = dst;
+    ubyte* const dstEnd = dst + dstlength;
+
+    while (ip < end) {
+        uint token = *ip++;
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            literals += read_length(ip, end);
+        }
+        if (literals > static_cast<size_t>(end - ip) ||
+            literals > static_cast<size_t>(dstEnd - op)) {
+            throw std::runtime_error("lz4: literals out of bounds");
+        }
+        std::memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == end) {
+            break;
+        }
+        if (end - ip < 2) {
+            throw std::runtime_error("lz4: unexpected end of data");
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst)) {
+            throw std::runtime_error("lz4: invalid match offset");
+        }
+        size_t matchLength = token & 0xF;
+        if (matchLength == 15) {
+            matchLength += read_length(ip, end);
+        }
+        matchLength += MIN_MATCH;
+        if (matchLength > static_cast<size_t>(dstEnd - op)) {
+            throw std::runtime_error("lz4: match out of bounds");
+        }
+        const ubyte* ref = op - offset;
+        if (offset >= matchLength) {
+            std::memcpy(op, ref, matchLength);
+            op += matchLength;
+            continue;
+        }
+        // overlapping match repeats the last offset bytes, copied span
+        // doubles on each step staying a multiple of the offset
+        ubyte* matchEnd = op + matchLength;
+        while (op < matchEnd) {
+            size_t count = std::min<size_t>(op - ref, matchEnd - op);
+            std::memcpy(op, ref, count);
+            op += count;
+        }
+    }
+    return op - dst;
+}
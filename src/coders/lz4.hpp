@@ -0,0 +1,31 @@
+#pragma once
+
+#include "typedefs.hpp"
+
+/// @brief LZ4 block format codec (without frame format headers)
+namespace lz4 {
+    /// @brief Get max length of compressed data
+    /// @param length source data length
+    constexpr size_t compress_bound(size_t length) {
+        return length + length / 255 + 16;
+    }
+
+    /// @brief Compress bytes array to LZ4 block
+    /// @param src source bytes array
+    /// @param length length of source bytes array
+    /// @param dst destination buffer of at least compress_bound(length) bytes
+    /// @return compressed data length
+    size_t encode(const ubyte* src, size_t length, ubyte* dst);
+
+    /// @brief Decompress LZ4 block
+    /// @param src compressed data
+    /// @param length compressed data length
+    /// @param dst destination buffer
+    /// @param dstlength destination buffer length
+    /// @return decompressed data length
+    /// @throws std::runtime_error if data is malformed or does not fit
+    /// the destination buffer
+    size_t decode(
+        const ubyte* src, size_t length, ubyte* dst, size_t dstlength
+    );
+}
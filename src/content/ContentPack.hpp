@@ -97,6 +97,16 @@ struct ContentPackStats {
     }
 };
 
+/// @brief Handles of world script block events to emit them without
+/// building event names, 0 if the event is not defined by the script
+struct WorldBlockEventHandles {
+    int placed = 0;
+    int replaced = 0;
+    int breaking = 0;
+    int broken = 0;
+    int interact = 0;
+};
+
 struct WorldFuncsSet {
     bool onblockplaced;
     bool onblockreplaced;
@@ -108,6 +118,7 @@ struct WorldFuncsSet {
     bool onchunkremove;
     bool oninventoryopen;
     bool oninventoryclosed;
+    WorldBlockEventHandles blockevents {};
 };
 
 class ContentPackRuntime {
@@ -10,6 +10,7 @@
 #include "PostRunnables.hpp"
 #include "Time.hpp"
 
+#include <array>
 #include <memory>
 #include <string>
 
@@ -48,6 +49,10 @@ struct CoreParameters {
     std::filesystem::path resFolder = "res";
     std::filesystem::path userFolder = ".";
     std::filesystem::path scriptFile;
+    /// @brief Name of the world to pre-generate in headless mode
+    std::string pregenWorld;
+    /// @brief Pre-generated chunks area: min x, min z, max x, max z
+    std::array<int, 4> pregenArea {};
 };
 
 using OnWorldOpen = std::function<void(std::unique_ptr<Level>, int64_t)>;
@@ -2,12 +2,15 @@
 
 #include "Engine.hpp"
 #include "logic/scripting/scripting.hpp"
+#include "logic/EngineController.hpp"
 #include "logic/LevelController.hpp"
+#include "logic/WorldPregenerator.hpp"
 #include "interfaces/Process.hpp"
 #include "debug/Logger.hpp"
 #include "world/Level.hpp"
 #include "world/World.hpp"
 #include "util/platform.hpp"
+#include "util/timeutil.hpp"
 
 #include <chrono>
 
@@ -26,6 +29,10 @@ void ServerMainloop::run() {
     const auto& coreParams = engine.getCoreParameters();
     auto& time = engine.getTime();
 
+    if (!coreParams.pregenWorld.empty()) {
+        pregenerate();
+        return;
+    }
     if (coreParams.scriptFile.empty()) {
         logger.info() << "nothing to do";
         return;
@@ -78,6 +85,54 @@ void ServerMainloop::run() {
     logger.info() << "script finished";
 }
 
+void ServerMainloop::pregenerate() {
+    const auto& coreParams = engine.getCoreParameters();
+    const auto& name = coreParams.pregenWorld;
+    const auto& area = coreParams.pregenArea;
+
+    std::unique_ptr<Level> level;
+    engine.setLevelConsumer([&level](auto newLevel, auto) {
+        level = std::move(newLevel);
+    });
+    engine.getController()->openWorld(name, false);
+    if (level == nullptr) {
+        logger.error() << "could not open world " << name;
+        return;
+    }
+    WorldPregenerator pregenerator(
+        *level, {area[0], area[1]}, {area[2], area[3]}, 0
+    );
+    uint64_t total = pregenerator.getChunksTotal();
+    logger.info() << "pre-generating " << total << " chunks of world "
+                  << name << " using " << pregenerator.getWorkersCount()
+                  << " workers";
+
+    timeutil::Timer timer;
+    auto report = [&pregenerator, &timer, total]() {
+        double seconds = timer.stop() / 1e6;
+        uint64_t generated = pregenerator.getChunksGenerated();
+        uint64_t done = generated + pregenerator.getChunksSkipped();
+        double speed = seconds > 0.0 ? done / seconds : 0.0;
+        int64_t eta = speed > 0.0 ? (total - done) / speed : 0;
+        int64_t generationSpeed = seconds > 0.0 ? generated / seconds : 0;
+        logger.info() << done << "/" << total << " chunks ("
+                      << (total ? done * 100 / total : 100) << "%), "
+                      << generationSpeed << " chunks/s, peak RSS "
+                      << platform::get_peak_memory_usage() / (1024 * 1024)
+                      << " MB, ETA " << eta << " s";
+    };
+    while (pregenerator.update()) {
+        report();
+        if (engine.isQuitSignal()) {
+            logger.info() << "pre-generation has been interrupted";
+            break;
+        }
+    }
+    pregenerator.finish();
+    report();
+    engine.getPaths().setCurrentWorldFolder("");
+}
+
 void ServerMainloop::setLevel(std::unique_ptr<Level> level) {
     if (level == nullptr) {
         controller->onWorldQuit();
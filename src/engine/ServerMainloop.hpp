@@ -9,6 +9,9 @@ class Engine;
 class ServerMainloop {
     Engine& engine;
     std::unique_ptr<LevelController> controller;
+
+    /// @brief Pre-generate chunks of the world specified in core parameters
+    void pregenerate();
 public:
     ServerMainloop(Engine& engine);
     ~ServerMainloop();
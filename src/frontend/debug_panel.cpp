@@ -127,6 +127,12 @@ std::shared_ptr<UINode> create_debug_panel(
         return L"entities: "+std::to_wstring(level.entities->size())+L" next: "+
                std::to_wstring(level.entities->peekNextID());
     }));
+    panel->add(create_label(gui, [&]() {
+        const auto& entities = *level.entities;
+        return L"bodies: "+std::to_wstring(entities.getAwakeBodiesCount())+
+               L" sleeping: "+
+               std::to_wstring(entities.getSleepingBodiesCount());
+    }));
     panel->add(create_label(gui, [&]() {
         return L"players: "+std::to_wstring(level.players->size())+L" local: "+
                std::to_wstring(player.getId());
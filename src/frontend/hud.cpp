@@ -334,7 +334,7 @@ void Hud::update(bool visible) {
     }
 
     if (blockUI) {
-        voxel* vox = chunks.get(blockPos.x, blockPos.y, blockPos.z);
+        const voxel* vox = chunks.get(blockPos.x, blockPos.y, blockPos.z);
         if (vox == nullptr || vox->id != currentblockid) {
             closeInventory();
         }
@@ -84,6 +84,9 @@ LevelScreen::LevelScreen(
         renderer->clear();
         frontend->getContentGfxCache().refresh();
     }));
+    keepAlive(settings.graphics.greedyMeshing.observe([=](bool) {
+        renderer->clear();
+    }));
     keepAlive(settings.camera.fov.observe([=](double value) {
         player->fpCamera->setFov(glm::radians(value));
     }));
@@ -17,7 +17,9 @@ BlocksRenderer::BlocksRenderer(
     const ContentGfxCache& cache,
     const EngineSettings& settings
 ) : content(content),
-    vertexBuffer(std::make_unique<float[]>(capacity * CHUNK_VERTEX_SIZE)),
+    vertexBuffer(
+        std::make_unique<float[]>(capacity * GREEDY_CHUNK_VERTEX_SIZE)
+    ),
     indexBuffer(std::make_unique<int[]>(capacity)),
     vertexOffset(0),
     indexOffset(0),
@@ -30,15 +32,54 @@ BlocksRenderer::BlocksRenderer(
         CHUNK_W + voxelBufferPadding*2, 
         CHUNK_H, 
         CHUNK_D + voxelBufferPadding*2);
+    chunkVoxels = std::make_unique<voxel[]>(CHUNK_VOL);
+    greedyFaces = std::make_unique<GreedyFace[]>(CHUNK_W * CHUNK_H);
     blockDefsCache = content.getIndices()->blocks.getDefs();
 }
 
 BlocksRenderer::~BlocksRenderer() {
 }
 
+static inline uint32_t compress_light(const glm::vec4& light) {
+    uint32_t compressed = (static_cast<uint32_t>(light.r * 255) & 0xff) << 24;
+    compressed |= (static_cast<uint32_t>(light.g * 255) & 0xff) << 16;
+    compressed |= (static_cast<uint32_t>(light.b * 255) & 0xff) << 8;
+    compressed |= (static_cast<uint32_t>(light.a * 255) & 0xff);
+    return compressed;
+}
+
+/// @brief Convert positive float to IEEE 754 half precision bits
+static inline uint16_t float_to_half(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    int exponent = static_cast<int>((bits >> 23) & 0xFF) - 127 + 15;
+    if (exponent <= 0) {
+        return 0;
+    } else if (exponent >= 31) {
+        return 0x7BFF;
+    }
+    // rounding carry goes to exponent
+    return (exponent << 10) + (((bits & 0x7FFFFF) + 0x1000) >> 13);
+}
+
+/// @brief Pack texture region size as two half precision floats
+/// (see decompress_tile_size in res/shaders/lib/commons.glsl)
+static inline uint32_t pack_tile_size(const UVRegion& region) {
+    return float_to_half(region.u2 - region.u1) |
+           (static_cast<uint32_t>(float_to_half(region.v2 - region.v1)) << 16);
+}
+
 /// Basic vertex add method
 void BlocksRenderer::vertex(
     const glm::vec3& coord, float u, float v, const glm::vec4& light
+) {
+    vertex(coord, u, v, compress_light(light), 0);
+}
+
+/// @brief Add vertex with compressed light
+/// @param tileSize packed repeated texture region size or 0
+void BlocksRenderer::vertex(
+    const glm::vec3& coord, float u, float v, uint32_t light, uint32_t tileSize
 ) {
     vertexBuffer[vertexOffset++] = coord.x;
     vertexBuffer[vertexOffset++] = coord.y;
@@ -52,12 +93,13 @@ void BlocksRenderer::vertex(
         uint32_t integer;
     } compressed;
 
-    compressed.integer = (static_cast<uint32_t>(light.r * 255) & 0xff) << 24;
-    compressed.integer |= (static_cast<uint32_t>(light.g * 255) & 0xff) << 16;
-    compressed.integer |= (static_cast<uint32_t>(light.b * 255) & 0xff) << 8;
-    compressed.integer |= (static_cast<uint32_t>(light.a * 255) & 0xff);
-
+    compressed.integer = light;
     vertexBuffer[vertexOffset++] = compressed.floating;
+
+    if (vertexSize == GREEDY_CHUNK_VERTEX_SIZE) {
+        compressed.integer = tileSize;
+        vertexBuffer[vertexOffset++] = compressed.floating;
+    }
 }
 
 void BlocksRenderer::index(int a, int b, int c, int d, int e, int f) {
@@ -81,7 +123,7 @@ void BlocksRenderer::face(
     const glm::vec4(&lights)[4],
     const glm::vec4& tint
 ) {
-    if (vertexOffset + CHUNK_VERTEX_SIZE * 4 > capacity) {
+    if (vertexOffset + vertexSize * 4 > capacity) {
         overflow = true;
         return;
     }
@@ -121,7 +163,7 @@ void BlocksRenderer::faceAO(
     const UVRegion& region,
     bool lights
 ) {
-    if (vertexOffset + CHUNK_VERTEX_SIZE * 4 > capacity) {
+    if (vertexOffset + vertexSize * 4 > capacity) {
         overflow = true;
         return;
     }
@@ -159,7 +201,7 @@ void BlocksRenderer::face(
     glm::vec4 tint,
     bool lights
 ) {
-    if (vertexOffset + CHUNK_VERTEX_SIZE * 4 > capacity) {
+    if (vertexOffset + vertexSize * 4 > capacity) {
         overflow = true;
         return;
     }
@@ -289,7 +331,7 @@ void BlocksRenderer::blockCustomModel(
 
     const auto& model = cache.getModel(block->rt.id);
     for (const auto& mesh : model.meshes) {
-        if (vertexOffset + CHUNK_VERTEX_SIZE * mesh.vertices.size() > capacity) {
+        if (vertexOffset + vertexSize * mesh.vertices.size() > capacity) {
             overflow = true;
             return;
         }
@@ -382,6 +424,246 @@ void BlocksRenderer::blockCube(
     }
 }
 
+bool BlocksRenderer::isGreedy(const Block& def, blockstate state) const {
+    if (!greedyMeshing || def.model != BlockModel::block || def.translucent ||
+        state.segment) {
+        return false;
+    }
+    if (def.rotatable) {
+        // texture orientation is the same for not rotated blocks only
+        const auto& axes = def.rotations.variants[state.rotation].axes;
+        return axes[0] == glm::ivec3(1, 0, 0) &&
+               axes[1] == glm::ivec3(0, 1, 0) &&
+               axes[2] == glm::ivec3(0, 0, 1);
+    }
+    return true;
+}
+
+void BlocksRenderer::faceLights(
+    const glm::vec3& coord,
+    const glm::vec3& X,
+    const glm::vec3& Y,
+    const glm::vec3& Z,
+    bool lights,
+    bool ao,
+    uint32_t (&dst)[4]
+) const {
+    glm::vec4 tint(1.0f);
+    if (lights) {
+        float d = glm::dot(glm::normalize(Z), SUN_VECTOR);
+        d = 0.7f + d * 0.3f;
+        tint = glm::vec4(d);
+    }
+    if (!ao) {
+        uint32_t light =
+            compress_light(pickLight(glm::ivec3(coord + Z)) * tint);
+        std::fill(std::begin(dst), std::end(dst), light);
+        return;
+    }
+    if (!lights) {
+        std::fill(std::begin(dst), std::end(dst), compress_light(tint));
+        return;
+    }
+    float s = 0.5f;
+    const glm::vec3 corners[4] {
+        coord + (-X - Y + Z) * s,
+        coord + ( X - Y + Z) * s,
+        coord + ( X + Y + Z) * s,
+        coord + (-X + Y + Z) * s,
+    };
+    for (int i = 0; i < 4; i++) {
+        // see vertexAO
+        auto pos = corners[i] + Z * 0.5f + (X + Y) * 0.5f;
+        auto light = pickSoftLight(
+            glm::ivec3(std::round(pos.x), std::round(pos.y), std::round(pos.z)),
+            glm::ivec3(X),
+            glm::ivec3(Y)
+        );
+        dst[i] = compress_light(light * tint);
+    }
+}
+
+void BlocksRenderer::greedyQuad(
+    const glm::vec3& coord,
+    const glm::vec3& X,
+    const glm::vec3& Y,
+    const glm::vec3& Z,
+    int width,
+    int height,
+    const UVRegion& region,
+    const uint32_t (&lights)[4]
+) {
+    if (vertexOffset + vertexSize * 4 > capacity) {
+        overflow = true;
+        return;
+    }
+    uint32_t tileSize = 0;
+    float u2 = region.u2;
+    float v2 = region.v2;
+    if (width > 1 || height > 1) {
+        tileSize = pack_tile_size(region);
+        u2 = region.u1 + (region.u2 - region.u1) * width;
+        v2 = region.v1 + (region.v2 - region.v1) * height;
+    }
+    auto origin = coord + (-X - Y + Z) * 0.5f;
+    auto right = X * static_cast<float>(width);
+    auto up = Y * static_cast<float>(height);
+    vertex(origin, region.u1, region.v1, lights[0], tileSize);
+    vertex(origin + right, u2, region.v1, lights[1], tileSize);
+    vertex(origin + right + up, u2, v2, lights[2], tileSize);
+    vertex(origin + up, region.u1, v2, lights[3], tileSize);
+    // the first vertex is the last one in both triangles as it provides
+    // the repeated region origin to the shader
+    index(1, 2, 0, 2, 3, 0);
+}
+
+/// @brief Cube face axes and texture face index as used in blockCube
+struct CubeFace {
+    glm::ivec3 X, Y, Z;
+    int texface;
+};
+
+static const CubeFace CUBE_FACES[6] {
+    {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}, 5},
+    {{-1, 0, 0}, {0, 1, 0}, {0, 0, -1}, 4},
+    {{1, 0, 0}, {0, 0, -1}, {0, 1, 0}, 3},
+    {{1, 0, 0}, {0, 0, 1}, {0, -1, 0}, 2},
+    {{0, 0, -1}, {0, 1, 0}, {1, 0, 0}, 1},
+    {{0, 0, 1}, {0, 1, 0}, {-1, 0, 0}, 0},
+};
+
+static inline int axis_of(const glm::ivec3& vec) {
+    return vec.x ? 0 : (vec.y ? 1 : 2);
+}
+
+void BlocksRenderer::renderGreedy(
+    const voxel* voxels, ubyte drawGroup, int begin, int end
+) {
+    constexpr int LAYER_VOL = CHUNK_W * CHUNK_D;
+    const glm::ivec3 areaMin(0, begin / LAYER_VOL, 0);
+    const glm::ivec3 areaMax(CHUNK_W, end / LAYER_VOL + 1, CHUNK_D);
+
+    for (const auto& face : CUBE_FACES) {
+        int normalAxis = axis_of(face.Z);
+        int axisA = axis_of(face.X);
+        int axisB = axis_of(face.Y);
+        int sizeA = areaMax[axisA] - areaMin[axisA];
+        int sizeB = areaMax[axisB] - areaMin[axisB];
+
+        for (int slice = areaMin[normalAxis]; slice < areaMax[normalAxis];
+             slice++) {
+            // collect faces of the slice
+            bool empty = true;
+            for (int b = 0; b < sizeB; b++) {
+                for (int a = 0; a < sizeA; a++) {
+                    auto& cell = greedyFaces[b * sizeA + a];
+                    cell = {};
+
+                    glm::ivec3 pos;
+                    pos[normalAxis] = slice;
+                    pos[axisA] = areaMin[axisA] + a;
+                    pos[axisB] = areaMin[axisB] + b;
+                    LayerVisit visit = layerVisits[pos.y];
+                    if (visit == LayerVisit::NONE ||
+                        (visit == LayerVisit::BORDER && pos.x > 0 &&
+                         pos.x < CHUNK_W - 1 && pos.z > 0 &&
+                         pos.z < CHUNK_D - 1)) {
+                        continue;
+                    }
+                    const voxel& vox = voxels[vox_index(pos.x, pos.y, pos.z)];
+                    const auto& def = *blockDefsCache[vox.id];
+                    if (vox.id == 0 || def.drawGroup != drawGroup ||
+                        !isGreedy(def, vox.state) ||
+                        !isOpen(pos + face.Z, def)) {
+                        continue;
+                    }
+                    uint32_t lights[4];
+                    faceLights(
+                        pos,
+                        face.X,
+                        face.Y,
+                        face.Z,
+                        !def.shadeless,
+                        def.ambientOcclusion,
+                        lights
+                    );
+                    if (lights[0] == lights[1] && lights[0] == lights[2] &&
+                        lights[0] == lights[3]) {
+                        cell = {vox.id + 1U, lights[0]};
+                        empty = false;
+                        continue;
+                    }
+                    // face with smooth lighting can't be merged
+                    greedyQuad(
+                        pos,
+                        face.X,
+                        face.Y,
+                        face.Z,
+                        1,
+                        1,
+                        cache.getRegion(vox.id, face.texface),
+                        lights
+                    );
+                }
+            }
+            if (empty) {
+                continue;
+            }
+            // merge faces into rectangles
+            for (int b = 0; b < sizeB; b++) {
+                for (int a = 0; a < sizeA; a++) {
+                    const GreedyFace cell = greedyFaces[b * sizeA + a];
+                    if (cell.key == 0) {
+                        continue;
+                    }
+                    int width = 1;
+                    while (a + width < sizeA &&
+                           greedyFaces[b * sizeA + a + width] == cell) {
+                        width++;
+                    }
+                    int height = 1;
+                    for (; b + height < sizeB; height++) {
+                        const auto* row = &greedyFaces[(b + height) * sizeA + a];
+                        if (!std::all_of(row, row + width, [&cell](const auto& other) {
+                                return other == cell;
+                            })) {
+                            break;
+                        }
+                    }
+                    for (int j = 0; j < height; j++) {
+                        std::fill_n(
+                            &greedyFaces[(b + j) * sizeA + a], width, GreedyFace {}
+                        );
+                    }
+                    // corner block of the first face vertex
+                    glm::ivec3 pos;
+                    pos[normalAxis] = slice;
+                    pos[axisA] =
+                        areaMin[axisA] + (face.X[axisA] > 0 ? a : a + width - 1);
+                    pos[axisB] =
+                        areaMin[axisB] + (face.Y[axisB] > 0 ? b : b + height - 1);
+                    const uint32_t lights[4] {
+                        cell.light, cell.light, cell.light, cell.light};
+                    greedyQuad(
+                        pos,
+                        face.X,
+                        face.Y,
+                        face.Z,
+                        width,
+                        height,
+                        cache.getRegion(cell.key - 1, face.texface),
+                        lights
+                    );
+                    a += width - 1;
+                }
+            }
+            if (overflow) {
+                return;
+            }
+        }
+    }
+}
+
 bool BlocksRenderer::isOpenForLight(int x, int y, int z) const {
     blockid_t id = voxelsBuffer->pickBlockId(chunk->x * CHUNK_W + x, 
                                              y, 
@@ -432,6 +714,58 @@ glm::vec4 BlocksRenderer::pickSoftLight(
         right, up);
 }
 
+void BlocksRenderer::updateLayerVisits() {
+    const auto& occupancy = chunk->occupancy;
+    auto isSolid = [&occupancy](int y) {
+        // chunk bottom and top faces are never visible
+        return y < 0 || y >= CHUNK_H ||
+               occupancy[y / CHUNK_SECTION_H] == SectionOccupancy::SOLID;
+    };
+    for (int y = 0; y < CHUNK_H; y++) {
+        switch (occupancy[y / CHUNK_SECTION_H]) {
+            case SectionOccupancy::EMPTY:
+                layerVisits[y] = LayerVisit::NONE;
+                break;
+            case SectionOccupancy::SOLID:
+                // faces inside the chunk are hidden by neighbour solid blocks
+                layerVisits[y] = isSolid(y - 1) && isSolid(y + 1)
+                                     ? LayerVisit::BORDER
+                                     : LayerVisit::ALL;
+                break;
+            default:
+                layerVisits[y] = LayerVisit::ALL;
+                break;
+        }
+    }
+}
+
+template <typename Func>
+void BlocksRenderer::forEachVoxel(int begin, int end, const Func& func) const {
+    constexpr int LAYER_VOL = CHUNK_W * CHUNK_D;
+    for (int y = begin / LAYER_VOL; y <= end / LAYER_VOL; y++) {
+        LayerVisit visit = layerVisits[y];
+        if (visit == LayerVisit::NONE) {
+            continue;
+        }
+        int layerBegin = std::max(begin, y * LAYER_VOL);
+        int layerEnd = std::min(end, y * LAYER_VOL + LAYER_VOL - 1);
+        for (int i = layerBegin; i <= layerEnd; i++) {
+            if (visit == LayerVisit::BORDER) {
+                int x = i % CHUNK_W;
+                int z = (i / CHUNK_W) % CHUNK_D;
+                if (x == 1 && z > 0 && z < CHUNK_D - 1) {
+                    // jump to the last voxel of the row
+                    i += CHUNK_W - 3;
+                    continue;
+                }
+            }
+            if (!func(i)) {
+                return;
+            }
+        }
+    }
+}
+
 void BlocksRenderer::render(
     const voxel* voxels, int beginEnds[256][2]
 ) {
@@ -441,16 +775,22 @@ void BlocksRenderer::render(
             continue;
         }
         int end = beginEnds[drawGroup][1];
-        for (int i = begin-1; i <= end; i++) {
+        if (greedyMeshing) {
+            renderGreedy(voxels, drawGroup, begin-1, end);
+            if (overflow) {
+                return;
+            }
+        }
+        forEachVoxel(begin-1, end, [&](int i) {
             const voxel& vox = voxels[i];
             blockid_t id = vox.id;
             blockstate state = vox.state;
             const auto& def = *blockDefsCache[id];
             if (id == 0 || def.drawGroup != drawGroup || state.segment) {
-                continue;
+                return true;
             }
-            if (def.translucent) {
-                continue;
+            if (def.translucent || isGreedy(def, state)) {
+                return true;
             }
             const UVRegion texfaces[6] {
                 cache.getRegion(id, 0), cache.getRegion(id, 1),
@@ -483,9 +823,10 @@ void BlocksRenderer::render(
                 default:
                     break;
             }
-            if (overflow) {
-                return;
-            }
+            return !overflow;
+        });
+        if (overflow) {
+            return;
         }
     }
 }
@@ -504,16 +845,16 @@ SortingMeshData BlocksRenderer::renderTranslucent(
             continue;
         }
         int end = beginEnds[drawGroup][1];
-        for (int i = begin-1; i <= end; i++) {
+        forEachVoxel(begin-1, end, [&](int i) {
             const voxel& vox = voxels[i];
             blockid_t id = vox.id;
             blockstate state = vox.state;
             const auto& def = *blockDefsCache[id];
             if (id == 0 || def.drawGroup != drawGroup || state.segment) {
-                continue;
+                return true;
             }
             if (!def.translucent) {
-                continue;
+                return true;
             }
             const UVRegion texfaces[6] {
                 cache.getRegion(id, 0), cache.getRegion(id, 1),
@@ -547,7 +888,7 @@ SortingMeshData BlocksRenderer::renderTranslucent(
                     break;
             }
             if (vertexOffset == 0) {
-                continue;
+                return true;
             }
             SortingMeshEntry entry {
                 glm::vec3(
@@ -555,19 +896,19 @@ SortingMeshData BlocksRenderer::renderTranslucent(
                     y + 0.5f,
                     z + chunk->z * CHUNK_D + 0.5f
                 ),
-                util::Buffer<float>(indexSize * CHUNK_VERTEX_SIZE), 0};
+                util::Buffer<float>(indexSize * vertexSize), 0};
 
             totalSize += entry.vertexData.size();
 
             for (int j = 0; j < indexSize; j++) {
                 std::memcpy(
-                    entry.vertexData.data() + j * CHUNK_VERTEX_SIZE,
-                    vertexBuffer.get() + indexBuffer[j] * CHUNK_VERTEX_SIZE,
-                    sizeof(float) * CHUNK_VERTEX_SIZE
+                    entry.vertexData.data() + j * vertexSize,
+                    vertexBuffer.get() + indexBuffer[j] * vertexSize,
+                    sizeof(float) * vertexSize
                 );
-                float& vx = entry.vertexData[j * CHUNK_VERTEX_SIZE + 0];
-                float& vy = entry.vertexData[j * CHUNK_VERTEX_SIZE + 1];
-                float& vz = entry.vertexData[j * CHUNK_VERTEX_SIZE + 2];
+                float& vx = entry.vertexData[j * vertexSize + 0];
+                float& vy = entry.vertexData[j * vertexSize + 1];
+                float& vz = entry.vertexData[j * vertexSize + 2];
 
                 if (!aabbInit) {
                     aabbInit = true;
@@ -582,7 +923,8 @@ SortingMeshData BlocksRenderer::renderTranslucent(
             sortingMesh.entries.push_back(std::move(entry));
             vertexOffset = 0;
             indexOffset = indexSize = 0;
-        }
+            return true;
+        });
     }
 
     // additional powerful optimization
@@ -620,13 +962,17 @@ void BlocksRenderer::build(const Chunk* chunk, const Chunks* chunks) {
         cancelled = true;
         return;
     }
-    const voxel* voxels = chunk->voxels;
+    chunk->voxels.copyTo(chunkVoxels.get());
+    const voxel* voxels = chunkVoxels.get();
+
+    updateLayerVisits();
+    greedyMeshing = settings.graphics.greedyMeshing.get();
 
     int totalBegin = chunk->bottom * (CHUNK_W * CHUNK_D);
     int totalEnd = chunk->top * (CHUNK_W * CHUNK_D);
 
     int beginEnds[256][2] {};
-    for (int i = totalBegin; i < totalEnd; i++) {
+    forEachVoxel(totalBegin, totalEnd - 1, [&](int i) {
         const voxel& vox = voxels[i];
         blockid_t id = vox.id;
         const auto& def = *blockDefsCache[id];
@@ -635,19 +981,23 @@ void BlocksRenderer::build(const Chunk* chunk, const Chunks* chunks) {
             beginEnds[def.drawGroup][0] = i+1;
         }
         beginEnds[def.drawGroup][1] = i;
-    }
+        return true;
+    });
     cancelled = false;
 
     overflow = false;
     vertexOffset = 0;
     indexOffset = indexSize = 0;
     
+    // translucent blocks are not merged
+    vertexSize = CHUNK_VERTEX_SIZE;
     sortingMesh = renderTranslucent(voxels, beginEnds);
     
     overflow = false;
     vertexOffset = 0;
     indexOffset = indexSize = 0;
     
+    vertexSize = greedyMeshing ? GREEDY_CHUNK_VERTEX_SIZE : CHUNK_VERTEX_SIZE;
     render(voxels, beginEnds);
 }
 
@@ -656,9 +1006,15 @@ ChunkMeshData BlocksRenderer::createMesh() {
         MeshData(
             util::Buffer<float>(vertexBuffer.get(), vertexOffset),
             util::Buffer<int>(indexBuffer.get(), indexSize),
-            util::Buffer<VertexAttribute>(
-                CHUNK_VATTRS, sizeof(CHUNK_VATTRS) / sizeof(VertexAttribute)
-            )
+            greedyMeshing
+                ? util::Buffer<VertexAttribute>(
+                      GREEDY_CHUNK_VATTRS,
+                      sizeof(GREEDY_CHUNK_VATTRS) / sizeof(VertexAttribute)
+                  )
+                : util::Buffer<VertexAttribute>(
+                      CHUNK_VATTRS,
+                      sizeof(CHUNK_VATTRS) / sizeof(VertexAttribute)
+                  )
         ),
         std::move(sortingMesh)};
 }
@@ -666,9 +1022,10 @@ ChunkMeshData BlocksRenderer::createMesh() {
 ChunkMesh BlocksRenderer::render(const Chunk* chunk, const Chunks* chunks) {
     build(chunk, chunks);
 
-    size_t vcount = vertexOffset / CHUNK_VERTEX_SIZE;
+    size_t vcount = vertexOffset / vertexSize;
     return ChunkMesh{std::make_unique<Mesh>(
-        vertexBuffer.get(), vcount, indexBuffer.get(), indexSize, CHUNK_VATTRS
+        vertexBuffer.get(), vcount, indexBuffer.get(), indexSize,
+        greedyMeshing ? GREEDY_CHUNK_VATTRS : CHUNK_VATTRS
     ), std::move(sortingMesh)};
 }
 
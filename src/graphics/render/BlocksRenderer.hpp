@@ -38,6 +38,39 @@ class BlocksRenderer {
     bool cancelled = false;
     const Chunk* chunk = nullptr;
     std::unique_ptr<VoxelsVolume> voxelsBuffer;
+    /// @brief Expanded voxels of the chunk being built
+    std::unique_ptr<voxel[]> chunkVoxels;
+
+    /// @brief How voxels of a chunk layer are visited on mesh building
+    enum class LayerVisit : ubyte {
+        /// @brief Layer has no voxels to draw
+        NONE,
+        /// @brief Only voxels on chunk sides may have visible faces
+        BORDER,
+        /// @brief All voxels are visited
+        ALL,
+    };
+    /// @brief Layers visiting modes of the chunk being built
+    LayerVisit layerVisits[CHUNK_H] {};
+
+    /// @brief Full cube block face collected for greedy meshing
+    struct GreedyFace {
+        /// @brief Block id + 1 or 0 if there is no face to merge
+        uint32_t key;
+        /// @brief Compressed light of all face vertices
+        uint32_t light;
+
+        bool operator==(const GreedyFace& other) const {
+            return key == other.key && light == other.light;
+        }
+    };
+    /// @brief Greedy meshing slice faces
+    std::unique_ptr<GreedyFace[]> greedyFaces;
+    /// @brief Greedy meshing is enabled for the chunk being built
+    bool greedyMeshing = false;
+    /// @brief Vertex size of the mesh being built divided by sizeof(float).
+    /// Meshes built with greedy meshing use GREEDY_CHUNK_VATTRS
+    int vertexSize = CHUNK_VERTEX_SIZE;
 
     const Block* const* blockDefsCache;
     const ContentGfxCache& cache;
@@ -48,6 +81,13 @@ class BlocksRenderer {
     SortingMeshData sortingMesh;
 
     void vertex(const glm::vec3& coord, float u, float v, const glm::vec4& light);
+    void vertex(
+        const glm::vec3& coord,
+        float u,
+        float v,
+        uint32_t light,
+        uint32_t tileSize
+    );
     void index(int a, int b, int c, int d, int e, int f);
 
     void vertexAO(
@@ -115,6 +155,39 @@ class BlocksRenderer {
         bool ao
     );
 
+    /// @brief Check if voxel faces are built by the greedy meshing pass
+    bool isGreedy(const Block& def, blockstate state) const;
+
+    /// @brief Calculate compressed lights of cube face vertices the same
+    /// way as face and faceAO do
+    void faceLights(
+        const glm::vec3& coord,
+        const glm::vec3& X,
+        const glm::vec3& Y,
+        const glm::vec3& Z,
+        bool lights,
+        bool ao,
+        uint32_t (&dst)[4]
+    ) const;
+
+    /// @brief Add cube face stretched to width x height faces, texture
+    /// region is repeated
+    /// @param coord position of the face corner block
+    void greedyQuad(
+        const glm::vec3& coord,
+        const glm::vec3& X,
+        const glm::vec3& Y,
+        const glm::vec3& Z,
+        int width,
+        int height,
+        const UVRegion& region,
+        const uint32_t (&lights)[4]
+    );
+
+    /// @brief Merge coplanar full cube faces of the draw group having equal
+    /// texture and lights into larger quads
+    void renderGreedy(const voxel* voxels, ubyte drawGroup, int begin, int end);
+
     bool isOpenForLight(int x, int y, int z) const;
 
     // Does block allow to see other blocks sides (is it transparent)
@@ -143,6 +216,14 @@ class BlocksRenderer {
     glm::vec4 pickSoftLight(const glm::ivec3& coord, const glm::ivec3& right, const glm::ivec3& up) const;
     glm::vec4 pickSoftLight(float x, float y, float z, const glm::ivec3& right, const glm::ivec3& up) const;
     
+    /// @brief Calculate layers visiting modes using chunk sections occupancy
+    void updateLayerVisits();
+
+    /// @brief Call func for voxel indices in [begin, end] range skipping
+    /// voxels which faces are hidden for sure. Stops if func returns false
+    template <typename Func>
+    void forEachVoxel(int begin, int end, const Func& func) const;
+
     void render(const voxel* voxels, int beginEnds[256][2]);
     SortingMeshData renderTranslucent(const voxel* voxels, int beginEnds[256][2]);
 public:
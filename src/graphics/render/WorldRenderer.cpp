@@ -180,10 +180,17 @@ void WorldRenderer::renderLevel(
 
     auto& shader = assets.require<Shader>("main");
     auto& linesShader = assets.require<Shader>("lines");
+    // only opaque meshes built with greedy meshing have repeated textures
+    auto& chunksShader = settings.graphics.greedyMeshing.get()
+                             ? assets.require<Shader>("main_greedy")
+                             : shader;
 
     setupWorldShader(shader, camera, settings, fogFactor);
+    if (&chunksShader != &shader) {
+        setupWorldShader(chunksShader, camera, settings, fogFactor);
+    }
 
-    chunks->drawChunks(camera, shader);
+    chunks->drawChunks(camera, chunksShader);
     blockWraps->draw(ctx, player);
 
     if (hudVisible) {
@@ -12,6 +12,12 @@ inline const VertexAttribute CHUNK_VATTRS[]{ {3}, {2}, {1}, {0} };
 /// @brief Chunk mesh vertex size divided by sizeof(float)
 inline constexpr int CHUNK_VERTEX_SIZE = 6;
 
+/// @brief Greedy meshing chunk mesh vertex attributes: chunk mesh vertex
+/// attributes and packed repeated texture region size
+inline const VertexAttribute GREEDY_CHUNK_VATTRS[]{ {3}, {2}, {1}, {1}, {0} };
+/// @brief Greedy meshing chunk mesh vertex size divided by sizeof(float)
+inline constexpr int GREEDY_CHUNK_VERTEX_SIZE = 7;
+
 class Mesh;
 
 struct SortingMeshEntry {
@@ -0,0 +1,92 @@
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+
+#include "io.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+
+io::mapped_file::mapped_file(const io::path& filename) {
+    HANDLE file = CreateFileW(
+        io::resolve(filename).wstring().c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("could not open file " + filename.string());
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        throw std::runtime_error("could not open file " + filename.string());
+    }
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length == 0) {
+        CloseHandle(file);
+        return;
+    }
+    mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        throw std::runtime_error("could not map file " + filename.string());
+    }
+    bytes = static_cast<const ubyte*>(
+        MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)
+    );
+    if (bytes == nullptr) {
+        CloseHandle(mapping);
+        throw std::runtime_error("could not map file " + filename.string());
+    }
+}
+
+io::mapped_file::~mapped_file() {
+    if (bytes) {
+        UnmapViewOfFile(bytes);
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+}
+
+#else // _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+io::mapped_file::mapped_file(const io::path& filename) {
+    int fd = open(io::resolve(filename).u8string().c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("could not open file " + filename.string());
+    }
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+        close(fd);
+        throw std::runtime_error("could not open file " + filename.string());
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length == 0) {
+        close(fd);
+        return;
+    }
+    void* address = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    // mapping stays valid after closing the descriptor
+    close(fd);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("could not map file " + filename.string());
+    }
+    bytes = static_cast<const ubyte*>(address);
+}
+
+io::mapped_file::~mapped_file() {
+    if (bytes) {
+        munmap(const_cast<ubyte*>(bytes), length);
+    }
+}
+
+#endif // _WIN32
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "typedefs.hpp"
+#include "path.hpp"
+
+namespace io {
+    /// @brief Read-only memory mapped file. Mapped data may be read
+    /// concurrently without synchronization
+    class mapped_file {
+        const ubyte* bytes = nullptr;
+        size_t length = 0;
+#ifdef _WIN32
+        void* mapping = nullptr;
+#endif
+    public:
+        /// @throws std::runtime_error if file could not be mapped
+        mapped_file(const path& filename);
+        mapped_file(const mapped_file&) = delete;
+        ~mapped_file();
+
+        const ubyte* data() const {
+            return bytes;
+        }
+
+        size_t size() const {
+            return length;
+        }
+    };
+}
@@ -63,6 +63,10 @@ SettingsHandler::SettingsHandler(EngineSettings& settings) {
     builder.add("load-distance", &settings.chunks.loadDistance);
     builder.add("load-speed", &settings.chunks.loadSpeed);
     builder.add("padding", &settings.chunks.padding);
+    builder.add("load-workers", &settings.chunks.loadWorkers);
+    builder.add("lighting-workers", &settings.chunks.lightingWorkers);
+    builder.add("generator-workers", &settings.chunks.generatorWorkers);
+    builder.add("compact-storage", &settings.chunks.compactStorage);
 
     builder.section("graphics");
     builder.add("fog-curve", &settings.graphics.fogCurve);
@@ -70,11 +74,15 @@ SettingsHandler::SettingsHandler(EngineSettings& settings) {
     builder.add("dense-render", &settings.graphics.denseRender);
     builder.add("gamma", &settings.graphics.gamma);
     builder.add("frustum-culling", &settings.graphics.frustumCulling);
+    builder.add("greedy-meshing", &settings.graphics.greedyMeshing);
     builder.add("skybox-resolution", &settings.graphics.skyboxResolution);
     builder.add("chunk-max-vertices", &settings.graphics.chunkMaxVertices);
     builder.add("chunk-max-vertices-dense", &settings.graphics.chunkMaxVerticesDense);
     builder.add("chunk-max-renderers", &settings.graphics.chunkMaxRenderers);
 
+    builder.section("physics");
+    builder.add("workers", &settings.physics.workers);
+
     builder.section("ui");
     builder.add("language", &settings.ui.language);
     builder.add("world-preview-size", &settings.ui.worldPreviewSize);
@@ -82,6 +90,10 @@ SettingsHandler::SettingsHandler(EngineSettings& settings) {
     builder.section("debug");
     builder.add("generator-test-mode", &settings.debug.generatorTestMode);
     builder.add("do-write-lights", &settings.debug.doWriteLights);
+    builder.add("voxels-compression", &settings.debug.voxelsCompression);
+    builder.add("lights-compression", &settings.debug.lightsCompression);
+    builder.add("async-save", &settings.debug.asyncSave);
+    builder.add("batch-random-updates", &settings.debug.batchRandomUpdates);
 }
 
 dv::value SettingsHandler::getValue(const std::string& name) const {
@@ -0,0 +1,294 @@
+#include "LightArea.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Lightmap.hpp"
+#include "content/Content.hpp"
+#include "voxels/Block.hpp"
+#include "voxels/Chunk.hpp"
+#include "voxels/Chunks.hpp"
+#include "voxels/voxel.hpp"
+
+/// @brief Initial queue capacity, must be power of two
+inline constexpr size_t QUEUE_CAPACITY = 1 << 14;
+
+LightArea::Queue::Queue() : buffer(QUEUE_CAPACITY) {
+}
+
+void LightArea::Queue::grow() {
+    std::vector<uint32_t> extended(buffer.size() * 2);
+    size_t count = tail - head;
+    for (size_t i = 0; i < count; i++) {
+        extended[i] = buffer[(head + i) & (buffer.size() - 1)];
+    }
+    buffer = std::move(extended);
+    head = 0;
+    tail = count;
+}
+
+LightArea::LightArea(const ContentIndices& indices)
+    : blockDefs(indices.blocks.getDefs()),
+      passingDefs(indices.blocks.count()),
+      columnChunks(std::make_unique<ubyte[]>(LAYER)),
+      passing(std::make_unique<ubyte[]>(VOLUME)) {
+    for (size_t id = 0; id < passingDefs.size(); id++) {
+        passingDefs[id] = blockDefs[id]->lightPassing;
+    }
+    for (int z = 0; z < DEPTH; z++) {
+        for (int x = 0; x < WIDTH; x++) {
+            columnChunks[z * WIDTH + x] = (z / CHUNK_D) * 3 + x / CHUNK_W;
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        lights[i] = std::make_unique<ubyte[]>(VOLUME);
+    }
+}
+
+LightArea::~LightArea() = default;
+
+void LightArea::read(const Chunks& chunks, int cx, int cz) {
+    this->cx = cx;
+    this->cz = cz;
+    int maxTop = 0;
+    for (int oz = 0; oz < 3; oz++) {
+        for (int ox = 0; ox < 3; ox++) {
+            Chunk* chunk = chunks.getChunk(cx + ox - 1, cz + oz - 1);
+            this->chunks[oz * 3 + ox] = chunk;
+            if (chunk) {
+                maxTop = std::max(maxTop, chunk->top);
+            }
+        }
+    }
+    // voxels above the top are air having max sky light and no other
+    // lights, so lights may change only within MAX_LIGHT blocks above
+    height = std::min(CHUNK_H, maxTop + MAX_LIGHT + 1);
+    std::memset(dirty, 0, sizeof(dirty));
+
+    // raw pointers as byte stores may alias members
+    ubyte* passing = this->passing.get();
+    ubyte* lightsR = lights[0].get();
+    ubyte* lightsG = lights[1].get();
+    ubyte* lightsB = lights[2].get();
+    ubyte* lightsS = lights[3].get();
+    const ubyte* passingDefs = this->passingDefs.data();
+    for (int oz = 0; oz < 3; oz++) {
+        for (int ox = 0; ox < 3; ox++) {
+            const Chunk* chunk = this->chunks[oz * 3 + ox];
+            for (int y = 0; y < height; y++) {
+                for (int lz = 0; lz < CHUNK_D; lz++) {
+                    int dst = index(ox * CHUNK_W, y, oz * CHUNK_D + lz);
+                    if (chunk == nullptr) {
+                        std::memset(passing + dst, 0, CHUNK_W);
+                        std::memset(lightsR + dst, 0, CHUNK_W);
+                        std::memset(lightsG + dst, 0, CHUNK_W);
+                        std::memset(lightsB + dst, 0, CHUNK_W);
+                        std::memset(lightsS + dst, 0, CHUNK_W);
+                        continue;
+                    }
+                    uint src = vox_index(0, y, lz);
+                    voxel voxels[CHUNK_W];
+                    light_t srcLights[CHUNK_W];
+                    chunk->voxels.copyRange(src, CHUNK_W, voxels);
+                    chunk->lightmap.copyRange(src, CHUNK_W, srcLights);
+                    for (int lx = 0; lx < CHUNK_W; lx++) {
+                        passing[dst + lx] = passingDefs[voxels[lx].id];
+                    }
+                    for (int lx = 0; lx < CHUNK_W; lx++) {
+                        light_t light = srcLights[lx];
+                        lightsR[dst + lx] = Lightmap::extract(light, 0);
+                        lightsG[dst + lx] = Lightmap::extract(light, 1);
+                        lightsB[dst + lx] = Lightmap::extract(light, 2);
+                        lightsS[dst + lx] = Lightmap::extract(light, 3);
+                    }
+                }
+            }
+        }
+    }
+    // padding: lights of the outer columns can not be changed as they are
+    // out of lights reach, so propagation may skip bounds checks
+    std::memset(passing + index(0, -1, 0), 0, LAYER);
+    std::memset(passing + index(0, height, 0), 0, LAYER);
+    for (int y = 0; y < height; y++) {
+        std::memset(passing + index(0, y, 0), 0, WIDTH);
+        std::memset(passing + index(0, y, DEPTH - 1), 0, WIDTH);
+        for (int z = 1; z < DEPTH - 1; z++) {
+            passing[index(0, y, z)] = 0;
+            passing[index(WIDTH - 1, y, z)] = 0;
+        }
+    }
+}
+
+void LightArea::add(int channel, int x, int y, int z, int emission) {
+    if (emission <= 1) {
+        return;
+    }
+    if (x < 0 || y < 0 || z < 0 || x >= WIDTH || y >= height ||
+        z >= DEPTH) {
+        return;
+    }
+    int chunkIndex = columnChunks[z * WIDTH + x];
+    if (chunks[chunkIndex] == nullptr) {
+        return;
+    }
+    int i = index(x, y, z);
+    ubyte& light = lights[channel][i];
+    if (emission < light) {
+        return;
+    }
+    queues[channel].push(i, emission);
+    if (light != emission) {
+        light = emission;
+        dirty[channel][chunkIndex] = true;
+    }
+}
+
+void LightArea::add(int channel, int x, int y, int z) {
+    if (x < 0 || y < 0 || z < 0 || x >= WIDTH || y >= height ||
+        z >= DEPTH) {
+        return;
+    }
+    add(channel, x, y, z, lights[channel][index(x, y, z)]);
+}
+
+void LightArea::addEmission(int channel) {
+    const Chunk& chunk = *chunks[4];
+    for (int y = 0; y < chunk.top; y++) {
+        for (int z = 0; z < CHUNK_D; z++) {
+            for (int x = 0; x < CHUNK_W; x++) {
+                const voxel& vox = chunk.voxels[vox_index(x, y, z)];
+                const Block* block = blockDefs[vox.id];
+                if (block->rt.emissive) {
+                    add(channel,
+                        x + CHUNK_W,
+                        y,
+                        z + CHUNK_D,
+                        block->emission[channel]);
+                }
+            }
+        }
+    }
+}
+
+void LightArea::addSkyLight() {
+    const Chunk& chunk = *chunks[4];
+    const ubyte* skyLights = lights[3].get();
+    for (int z = 0; z < CHUNK_D; z++) {
+        for (int x = 0; x < CHUNK_W; x++) {
+            int gx = x + CHUNK_W;
+            int gz = z + CHUNK_D;
+            for (int y = chunk.lightmap.highestPoint; y >= 0; y--) {
+                while (y > 0 &&
+                       !passingDefs[chunk.voxels[vox_index(x, y, z)].id]) {
+                    y--;
+                }
+                if (skyLights[index(gx, y, gz)] != 15) {
+                    add(3, gx, y + 1, gz);
+                    for (; y >= 0; y--) {
+                        add(3, gx + 1, y, gz);
+                        add(3, gx - 1, y, gz);
+                        add(3, gx, y, gz + 1);
+                        add(3, gx, y, gz - 1);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void LightArea::addBorders(int channel) {
+    const ubyte* channelLights = lights[channel].get();
+    for (int x = 0; x < CHUNK_W; x += CHUNK_W - 1) {
+        for (int y = 0; y < height; y++) {
+            for (int z = 0; z < CHUNK_D; z++) {
+                int gx = x + CHUNK_W;
+                int gz = z + CHUNK_D;
+                add(channel, gx, y, gz, channelLights[index(gx, y, gz)]);
+            }
+        }
+    }
+    for (int z = 0; z < CHUNK_D; z += CHUNK_D - 1) {
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < CHUNK_W; x++) {
+                int gx = x + CHUNK_W;
+                int gz = z + CHUNK_D;
+                add(channel, gx, y, gz, channelLights[index(gx, y, gz)]);
+            }
+        }
+    }
+}
+
+void LightArea::solve(int channel) {
+    const int offsets[] = {WIDTH, -WIDTH, LAYER, -LAYER, 1, -1};
+    auto& queue = queues[channel];
+    ubyte* channelLights = lights[channel].get();
+    const ubyte* passing = this->passing.get();
+    const ubyte* columnChunks = this->columnChunks.get();
+    bool* dirty = this->dirty[channel];
+
+    while (!queue.empty()) {
+        uint32_t entry = queue.pop();
+        int entryIndex = entry >> 4;
+        int light = (entry & 0xF) - 1;
+        if (light <= 0) {
+            continue;
+        }
+        for (int i = 0; i < 6; i++) {
+            int index = entryIndex + offsets[i];
+            if (passing[index] && channelLights[index] < light) {
+                channelLights[index] = light;
+                queue.push(index, light);
+                dirty[columnChunks[index % LAYER]] = true;
+            }
+        }
+    }
+}
+
+void LightArea::build(int channel, bool expand) {
+    if (chunks[4] == nullptr) {
+        return;
+    }
+    if (channel < 3) {
+        addEmission(channel);
+    } else if (expand) {
+        addSkyLight();
+    }
+    if (expand) {
+        addBorders(channel);
+    }
+    solve(channel);
+}
+
+void LightArea::write() {
+    const ubyte* lightsR = lights[0].get();
+    const ubyte* lightsG = lights[1].get();
+    const ubyte* lightsB = lights[2].get();
+    const ubyte* lightsS = lights[3].get();
+    for (int oz = 0; oz < 3; oz++) {
+        for (int ox = 0; ox < 3; ox++) {
+            int chunkIndex = oz * 3 + ox;
+            Chunk* chunk = chunks[chunkIndex];
+            if (chunk == nullptr ||
+                !(dirty[0][chunkIndex] || dirty[1][chunkIndex] ||
+                  dirty[2][chunkIndex] || dirty[3][chunkIndex])) {
+                continue;
+            }
+            for (int y = 0; y < height; y++) {
+                for (int lz = 0; lz < CHUNK_D; lz++) {
+                    int src = index(ox * CHUNK_W, y, oz * CHUNK_D + lz);
+                    light_t row[CHUNK_W];
+                    for (int lx = 0; lx < CHUNK_W; lx++) {
+                        row[lx] = Lightmap::combine(
+                            lightsR[src + lx],
+                            lightsG[src + lx],
+                            lightsB[src + lx],
+                            lightsS[src + lx]
+                        );
+                    }
+                    chunk->lightmap.setRange(vox_index(0, y, lz), CHUNK_W, row);
+                }
+            }
+            chunk->flags.modified = true;
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "constants.hpp"
+#include "typedefs.hpp"
+
+class Chunk;
+class Chunks;
+class ContentIndices;
+class Block;
+
+/// @brief Private copy of 3x3 chunks neighbourhood lights used to build
+/// lights of the central chunk without access to the chunks matrix.
+/// Each channel has its own buffer and queue, so channels may be solved
+/// in parallel. Areas with non-overlapping neighbourhoods may be
+/// read, solved and written in parallel too.
+class LightArea {
+public:
+    static constexpr int WIDTH = CHUNK_W * 3;
+    static constexpr int DEPTH = CHUNK_D * 3;
+    static constexpr int LAYER = WIDTH * DEPTH;
+    /// @brief Volume including one layer padding at the bottom and the top
+    static constexpr int VOLUME = LAYER * (CHUNK_H + 2);
+    static constexpr int MAX_LIGHT = 15;
+private:
+    /// @brief Flat ring buffer of packed (index, light) entries
+    class Queue {
+        std::vector<uint32_t> buffer;
+        size_t head = 0;
+        size_t tail = 0;
+
+        void grow();
+    public:
+        Queue();
+
+        inline void push(int index, int light) {
+            if (tail - head == buffer.size()) {
+                grow();
+            }
+            buffer[tail++ & (buffer.size() - 1)] = (index << 4) | light;
+        }
+
+        inline uint32_t pop() {
+            return buffer[head++ & (buffer.size() - 1)];
+        }
+
+        inline bool empty() const {
+            return head == tail;
+        }
+    };
+
+    const Block* const* blockDefs;
+    /// @brief Light passing flags by block id
+    std::vector<ubyte> passingDefs;
+    /// @brief Neighbourhood chunk index by column index
+    std::unique_ptr<ubyte[]> columnChunks;
+    /// @brief Central chunk position
+    int cx = 0;
+    int cz = 0;
+    /// @brief Neighbourhood chunks, nullptr if missing
+    Chunk* chunks[9] {};
+    /// @brief Height of the area part where lights may be changed
+    int height = CHUNK_H;
+    /// @brief Light passing flags. False for voxels of missing chunks and
+    /// for padding: outer columns (out of lights reach) and layers below
+    /// and above the area
+    std::unique_ptr<ubyte[]> passing;
+    std::unique_ptr<ubyte[]> lights[4];
+    Queue queues[4];
+    /// @brief Chunks with changed lights by channel
+    bool dirty[4][9] {};
+
+    static constexpr int index(int x, int y, int z) {
+        return ((y + 1) * DEPTH + z) * WIDTH + x;
+    }
+
+    void add(int channel, int x, int y, int z, int emission);
+    void add(int channel, int x, int y, int z);
+    void addEmission(int channel);
+    void addSkyLight();
+    void addBorders(int channel);
+    void solve(int channel);
+public:
+    LightArea(const ContentIndices& indices);
+    ~LightArea();
+
+    /// @brief Copy voxels light passing and lights of the chunk
+    /// neighbourhood
+    void read(const Chunks& chunks, int cx, int cz);
+
+    /// @brief Build channel lights of the central chunk
+    /// (see Lighting::buildSkyLight and Lighting::onChunkLoaded)
+    /// @param expand propagate lights of chunk borders and build sky lights
+    void build(int channel, bool expand);
+
+    /// @brief Write lights back to the neighbourhood chunks having changed
+    /// lights and mark them as modified
+    void write();
+};
@@ -75,7 +75,7 @@ void LightSolver::solve(){
 
                 ubyte light = chunk->lightmap.get(lx,y,lz, channel);
                 if (light != 0 && light == entry.light-1){
-                    voxel* vox = chunks.get(x, y, z);
+                    const voxel* vox = chunks.get(x, y, z);
                     if (vox && vox->id != 0) {
                         const Block* block = blockDefs[vox->id];
                         if (uint8_t emission = block->emission[channel]) {
@@ -111,7 +111,7 @@ void LightSolver::solve(){
                 chunk->flags.modified = true;
 
                 ubyte light = chunk->lightmap.get(lx, y, lz, channel);
-                voxel& v = chunk->voxels[vox_index(lx, y, lz)];
+                const voxel& v = chunk->voxels[vox_index(lx, y, lz)];
                 const Block* block = blockDefs[v.id];
                 if (block->lightPassing && light+2 <= entry.light){
                     chunk->lightmap.set(
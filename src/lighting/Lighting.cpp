@@ -1,4 +1,5 @@
 #include "Lighting.hpp"
+#include "LightArea.hpp"
 #include "LightSolver.hpp"
 #include "Lightmap.hpp"
 #include "content/Content.hpp"
@@ -7,6 +8,8 @@
 #include "voxels/voxel.hpp"
 #include "voxels/Block.hpp"
 #include "constants.hpp"
+#include "maths/voxmaths.hpp"
+#include "util/ForkJoinPool.hpp"
 #include "util/timeutil.hpp"
 #include "debug/Logger.hpp"
 
@@ -14,8 +17,10 @@
 
 static debug::Logger logger("lighting");
 
-Lighting::Lighting(const Content& content, Chunks& chunks) 
-  : content(content), chunks(chunks) {
+Lighting::Lighting(const Content& content, Chunks& chunks, uint workers) 
+  : content(content),
+    chunks(chunks),
+    pool(std::make_unique<util::ForkJoinPool>(workers)) {
     auto& indices = *content.getIndices();
     solverR = std::make_unique<LightSolver>(indices, chunks, 0);
     solverG = std::make_unique<LightSolver>(indices, chunks, 1);
@@ -31,10 +36,7 @@ void Lighting::clear(){
         auto chunk = chunks[index];
         if (chunk == nullptr)
             continue;
-        Lightmap& lightmap = chunk->lightmap;
-        for (int i = 0; i < CHUNK_VOL; i++){
-            lightmap.map[i] = 0;
-        }
+        chunk->lightmap.clear();
     }
 }
 
@@ -46,7 +48,7 @@ void Lighting::prebuildSkyLight(Chunk& chunk, const ContentIndices& indices){
         for (int x = 0; x < CHUNK_W; x++){
             for (int y = CHUNK_H-1; y >= 0; y--){
                 int index = (y * CHUNK_D + z) * CHUNK_W + x;
-                voxel& vox = chunk.voxels[index];
+                const voxel& vox = chunk.voxels[index];
                 const Block* block = blockDefs[vox.id];
                 if (!block->skyLightPassing) {
                     if (highestPoint < y)
@@ -160,6 +162,57 @@ void Lighting::onChunkLoaded(int cx, int cz, bool expand) {
     solverS.solve();
 }
 
+void Lighting::onChunksLoaded(const std::vector<Chunk*>& chunks) {
+    // chunks with equal positions modulo 3 have non-overlapping
+    // neighbourhoods; lights written by a phase are read by the next ones
+    std::vector<Chunk*> phases[9];
+    for (Chunk* chunk : chunks) {
+        int px = chunk->x - floordiv<3>(chunk->x) * 3;
+        int pz = chunk->z - floordiv<3>(chunk->z) * 3;
+        phases[pz * 3 + px].push_back(chunk);
+    }
+    size_t maxAreas = pool->getThreadsCount();
+    std::vector<runnable> tasks;
+    for (const auto& phase : phases) {
+        for (size_t offset = 0; offset < phase.size(); offset += maxAreas) {
+            size_t count = std::min(phase.size() - offset, maxAreas);
+            while (areas.size() < count) {
+                areas.push_back(
+                    std::make_unique<LightArea>(*content.getIndices())
+                );
+            }
+            tasks.clear();
+            for (size_t i = 0; i < count; i++) {
+                LightArea& area = *areas[i];
+                const Chunk& chunk = *phase[offset + i];
+                tasks.push_back([this, &area, &chunk]() {
+                    area.read(this->chunks, chunk.x, chunk.z);
+                });
+            }
+            pool->run(tasks);
+
+            tasks.clear();
+            for (size_t i = 0; i < count; i++) {
+                LightArea& area = *areas[i];
+                bool expand = !phase[offset + i]->flags.loadedLights;
+                for (int channel = 0; channel < 4; channel++) {
+                    tasks.push_back([&area, channel, expand]() {
+                        area.build(channel, expand);
+                    });
+                }
+            }
+            pool->run(tasks);
+
+            tasks.clear();
+            for (size_t i = 0; i < count; i++) {
+                LightArea& area = *areas[i];
+                tasks.push_back([&area]() { area.write(); });
+            }
+            pool->run(tasks);
+        }
+    }
+}
+
 void Lighting::onBlockSet(int x, int y, int z, blockid_t id){
     const auto& block = content.getIndices()->blocks.require(id);
     solverR->remove(x,y,z);
@@ -172,7 +225,7 @@ void Lighting::onBlockSet(int x, int y, int z, blockid_t id){
         solverB->solve();
         if (chunks.getLight(x,y+1,z, 3) == 0xF){
             for (int i = y; i >= 0; i--){
-                voxel* vox = chunks.get(x,i,z);
+                const voxel* vox = chunks.get(x,i,z);
                 if ((vox == nullptr || vox->id != 0) && block.skyLightPassing)
                     break;
                 solverS->add(x,i,z, 0xF);
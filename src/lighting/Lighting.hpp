@@ -1,5 +1,8 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "typedefs.hpp"
 
 class Content;
@@ -7,6 +10,11 @@ class ContentIndices;
 class Chunk;
 class Chunks;
 class LightSolver;
+class LightArea;
+
+namespace util {
+    class ForkJoinPool;
+}
 
 class Lighting {
     const Content& content;
@@ -15,13 +23,25 @@ class Lighting {
     std::unique_ptr<LightSolver> solverG;
     std::unique_ptr<LightSolver> solverB;
     std::unique_ptr<LightSolver> solverS;
+    std::unique_ptr<util::ForkJoinPool> pool;
+    /// @brief Batch mode workspaces, allocated on first use
+    std::vector<std::unique_ptr<LightArea>> areas;
 public:
-    Lighting(const Content& content, Chunks& chunks);
+    /// @param workers number of threads used to build lights in batch
+    /// mode (see onChunksLoaded), 0 is auto
+    Lighting(const Content& content, Chunks& chunks, uint workers = 1);
     ~Lighting();
 
     void clear();
     void buildSkyLight(int cx, int cz);
     void onChunkLoaded(int cx, int cz, bool expand);
+
+    /// @brief Build lights for a set of chunks. Result is identical to
+    /// buildSkyLight + onChunkLoaded(cx, cz, true) calls for chunks without
+    /// loaded lights and onChunkLoaded(cx, cz, false) for other ones.
+    /// Light channels and chunks with non-overlapping 3x3 neighbourhoods
+    /// are solved in parallel.
+    void onChunksLoaded(const std::vector<Chunk*>& chunks);
     void onBlockSet(int x, int y, int z, blockid_t id);
 
     static void prebuildSkyLight(Chunk& chunk, const ContentIndices& indices);
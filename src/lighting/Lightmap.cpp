@@ -2,15 +2,70 @@
 
 #include "util/data_io.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
+light_t* Lightmap::expand(uint index) {
+    auto& section = sections[index];
+    auto dense = new light_t[CHUNK_SECTION_VOL];
+    std::fill(
+        dense,
+        dense + CHUNK_SECTION_VOL,
+        section.uniform.load(std::memory_order_relaxed)
+    );
+    section.dense.store(dense, std::memory_order_release);
+    return dense;
+}
+
 void Lightmap::set(const Lightmap* lightmap) {
-    set(lightmap->map);
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        set(i, lightmap->get(i));
+    }
 }
 
 void Lightmap::set(const light_t* map) {
-    std::memcpy(this->map, map, sizeof(light_t) * CHUNK_VOL);
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        set(i, map[i]);
+    }
+}
+
+void Lightmap::clear() {
+    // expanded sections are kept as they may be in use by readers
+    for (auto& section : sections) {
+        if (auto dense = section.dense.load(std::memory_order_relaxed)) {
+            std::memset(dense, 0, CHUNK_SECTION_VOL * sizeof(light_t));
+        } else {
+            section.uniform.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void Lightmap::compact() {
+    for (auto& section : sections) {
+        light_t* dense = section.dense.load(std::memory_order_relaxed);
+        if (dense == nullptr ||
+            std::find_if(
+                dense + 1,
+                dense + CHUNK_SECTION_VOL,
+                [value = dense[0]](light_t light) { return light != value; }
+            ) != dense + CHUNK_SECTION_VOL) {
+            continue;
+        }
+        section.uniform.store(dense[0], std::memory_order_relaxed);
+        section.dense.store(nullptr, std::memory_order_relaxed);
+        delete[] dense;
+    }
+}
+
+size_t Lightmap::getMemoryUsage() const {
+    size_t size = sizeof(Lightmap);
+    for (const auto& section : sections) {
+        if (section.dense.load(std::memory_order_relaxed)) {
+            size += CHUNK_SECTION_VOL * sizeof(light_t);
+        }
+    }
+    return size;
 }
 
 static_assert(sizeof(light_t) == 2, "replace dataio calls to new light_t");
@@ -18,7 +73,7 @@ static_assert(sizeof(light_t) == 2, "replace dataio calls to new light_t");
 std::unique_ptr<ubyte[]> Lightmap::encode() const {
     auto buffer = std::make_unique<ubyte[]>(LIGHTMAP_DATA_LEN);
     for (uint i = 0; i < CHUNK_VOL; i+=2) {
-        buffer[i/2] = ((map[i] >> 12) & 0xF) | ((map[i+1] >> 8) & 0xF0);
+        buffer[i/2] = ((get(i) >> 12) & 0xF) | ((get(i+1) >> 8) & 0xF0);
     }
     return buffer;
 }
@@ -3,80 +3,161 @@
 #include "constants.hpp"
 #include "typedefs.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <cstring>
 
 inline constexpr int LIGHTMAP_DATA_LEN = CHUNK_VOL/2;
 
 // Lichtkarte
+/// @brief Chunk lights split into sections of CHUNK_SECTION_H layers.
+/// Section having the same light everywhere (sky or darkness) is collapsed
+/// to a single value. Setting a different light expands the section,
+/// compact() collapses uniform sections back and must not be called while
+/// the lightmap is accessed by other threads.
+/// Lights may be read by other threads while a single thread modifies them
 class Lightmap {
+    struct Section {
+        /// @brief Expanded section or nullptr if section is uniform
+        std::atomic<light_t*> dense {nullptr};
+        /// @brief Light of the uniform section, read by other threads
+        std::atomic<light_t> uniform {0};
+
+        ~Section() {
+            delete[] dense.load(std::memory_order_relaxed);
+        }
+    };
+    Section sections[CHUNK_SECTIONS];
+
+    light_t* expand(uint section);
 public:
-    light_t map[CHUNK_VOL] {};
     int highestPoint = 0;
 
+    Lightmap() = default;
+    Lightmap(const Lightmap&) = delete;
+
     void set(const Lightmap* lightmap);
 
     void set(const light_t* map);
 
-    void clear() {
-        std::memset(map, 0, sizeof(map));
+    /// @brief Set all lights to zero. Must be called by the thread
+    /// modifying the lightmap
+    void clear();
+
+    /// @brief Collapse uniform sections
+    void compact();
+
+    /// @return bytes used by the lightmap including its own size
+    size_t getMemoryUsage() const;
+
+    inline light_t get(uint index) const {
+        const auto& section = sections[index / CHUNK_SECTION_VOL];
+        if (auto dense = section.dense.load(std::memory_order_acquire)) {
+            return dense[index % CHUNK_SECTION_VOL];
+        }
+        return section.uniform.load(std::memory_order_relaxed);
+    }
+
+    inline void set(uint index, light_t value) {
+        auto& section = sections[index / CHUNK_SECTION_VOL];
+        light_t* dense = section.dense.load(std::memory_order_relaxed);
+        if (dense == nullptr) {
+            if (section.uniform.load(std::memory_order_relaxed) == value) {
+                return;
+            }
+            dense = expand(index / CHUNK_SECTION_VOL);
+        }
+        dense[index % CHUNK_SECTION_VOL] = value;
+    }
+
+    /// @brief Copy lights range located in a single section
+    /// @param index first light index
+    /// @param count number of lights
+    /// @param dst destination array
+    inline void copyRange(uint index, uint count, light_t* dst) const {
+        const auto& section = sections[index / CHUNK_SECTION_VOL];
+        if (auto dense = section.dense.load(std::memory_order_acquire)) {
+            std::memcpy(
+                dst, dense + index % CHUNK_SECTION_VOL, count * sizeof(light_t)
+            );
+            return;
+        }
+        std::fill(
+            dst, dst + count, section.uniform.load(std::memory_order_relaxed)
+        );
+    }
+
+    /// @brief Set lights range located in a single section
+    /// @param index first light index
+    /// @param count number of lights
+    /// @param src source array
+    inline void setRange(uint index, uint count, const light_t* src) {
+        auto& section = sections[index / CHUNK_SECTION_VOL];
+        light_t* dense = section.dense.load(std::memory_order_relaxed);
+        if (dense == nullptr) {
+            light_t uniform = section.uniform.load(std::memory_order_relaxed);
+            uint i = 0;
+            while (i < count && src[i] == uniform) {
+                i++;
+            }
+            if (i == count) {
+                return;
+            }
+            dense = expand(index / CHUNK_SECTION_VOL);
+        }
+        std::memcpy(
+            dense + index % CHUNK_SECTION_VOL, src, count * sizeof(light_t)
+        );
     }
 
     inline unsigned short get(int x, int y, int z) const {
-        return (map[y*CHUNK_D*CHUNK_W+z*CHUNK_W+x]);
+        return get(y*CHUNK_D*CHUNK_W+z*CHUNK_W+x);
     }
 
     inline unsigned char get(int x, int y, int z, int channel) const {
-        return (map[y*CHUNK_D*CHUNK_W+z*CHUNK_W+x] >> (channel << 2)) & 0xF;
+        return (get(y*CHUNK_D*CHUNK_W+z*CHUNK_W+x) >> (channel << 2)) & 0xF;
     }
 
     inline unsigned char getR(int x, int y, int z) const {
-        return map[y*CHUNK_D*CHUNK_W+z*CHUNK_W+x] & 0xF;
+        return get(y*CHUNK_D*CHUNK_W+z*CHUNK_W+x) & 0xF;
     }
 
     inline unsigned char getG(int x, int y, int z) const {
-        return (map[y*CHUNK_D*CHUNK_W+z*CHUNK_W+x] >> 4) & 0xF;
+        return (get(y*CHUNK_D*CHUNK_W+z*CHUNK_W+x) >> 4) & 0xF;
     }
 
     inline unsigned char getB(int x, int y, int z) const {
-        return (map[y*CHUNK_D*CHUNK_W+z*CHUNK_W+x] >> 8) & 0xF;
+        return (get(y*CHUNK_D*CHUNK_W+z*CHUNK_W+x) >> 8) & 0xF;
     }
 
     inline unsigned char getS(int x, int y, int z) const {
-        return (map[y*CHUNK_D*CHUNK_W+z*CHUNK_W+x] >> 12) & 0xF;
+        return (get(y*CHUNK_D*CHUNK_W+z*CHUNK_W+x) >> 12) & 0xF;
     }
 
     inline void setR(int x, int y, int z, int value){
         const int index = y*CHUNK_D*CHUNK_W+z*CHUNK_W+x;
-        map[index] = (map[index] & 0xFFF0) | value;
+        set(index, (get(index) & 0xFFF0) | value);
     }
 
     inline void setG(int x, int y, int z, int value){
         const int index = y*CHUNK_D*CHUNK_W+z*CHUNK_W+x;
-        map[index] = (map[index] & 0xFF0F) | (value << 4);
+        set(index, (get(index) & 0xFF0F) | (value << 4));
     }
 
     inline void setB(int x, int y, int z, int value){
         const int index = y*CHUNK_D*CHUNK_W+z*CHUNK_W+x;
-        map[index] = (map[index] & 0xF0FF) | (value << 8);
+        set(index, (get(index) & 0xF0FF) | (value << 8));
     }
 
     inline void setS(int x, int y, int z, int value){
         const int index = y*CHUNK_D*CHUNK_W+z*CHUNK_W+x;
-        map[index] = (map[index] & 0x0FFF) | (value << 12);
+        set(index, (get(index) & 0x0FFF) | (value << 12));
     }
 
     inline void set(int x, int y, int z, int channel, int value){
         const int index = y*CHUNK_D*CHUNK_W+z*CHUNK_W+x;
-        map[index] = (map[index] & (0xFFFF & (~(0xF << (channel*4))))) | (value << (channel << 2));
-    }
-
-    inline const light_t* getLights() const {
-        return map;
-    }
-
-    inline light_t* getLightsWriteable() {
-        return map;
+        set(index, (get(index) & (0xFFFF & (~(0xF << (channel*4))))) | (value << (channel << 2)));
     }
 
     static constexpr light_t combine(int r, int g, int b, int s) {
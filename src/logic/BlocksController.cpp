@@ -38,7 +38,7 @@ void BlocksController::updateSides(int x, int y, int z) {
 }
 
 void BlocksController::updateSides(int x, int y, int z, int w, int h, int d) {
-    voxel* vox = blocks_agent::get(chunks, x, y, z);
+    const voxel* vox = blocks_agent::get(chunks, x, y, z);
     const auto& def = level.content.getIndices()->blocks.require(vox->id);
     const auto& rot = def.rotations.variants[vox->state.rotation];
     const auto& xaxis = rot.axes[0];
@@ -104,7 +104,7 @@ void BlocksController::placeBlock(
 }
 
 void BlocksController::updateBlock(int x, int y, int z) {
-    voxel* vox = blocks_agent::get(chunks, x, y, z);
+    const voxel* vox = blocks_agent::get(chunks, x, y, z);
     if (vox == nullptr) return;
     const auto& def = level.content.getIndices()->blocks.require(vox->id);
     if (def.grounded) {
@@ -156,13 +156,22 @@ void BlocksController::randomTick(
             int bz = random.rand() % CHUNK_D;
             const voxel& vox = chunk.voxels[vox_index(bx, by, bz)];
             auto& block = indices->blocks.require(vox.id);
-            if (block.rt.funcsset.randupdate) {
-                scripting::random_update_block(
-                    block,
-                    glm::ivec3(
-                        chunk.x * CHUNK_W + bx, by, chunk.z * CHUNK_D + bz
-                    )
-                );
+            glm::ivec3 pos(chunk.x * CHUNK_W + bx, by, chunk.z * CHUNK_D + bz);
+            const auto& funcs = block.rt.funcsset;
+            if (funcs.blocksrandupdate && batchRandomUpdates) {
+                if (randomUpdates.size() <= vox.id) {
+                    randomUpdates.resize(vox.id + 1);
+                }
+                auto& positions = randomUpdates[vox.id];
+                if (positions.empty()) {
+                    randomUpdatedBlocks.push_back(vox.id);
+                }
+                positions.push_back(pos);
+            } else if (funcs.randupdate) {
+                scripting::random_update_block(block, pos);
+            } else if (funcs.blocksrandupdate) {
+                // keeping order of updates
+                scripting::random_update_blocks(block, {pos});
             }
         }
     }
@@ -205,6 +214,16 @@ void BlocksController::randomTick(int tickid, int parts, uint padding) {
             }
         }
     }
+    flushRandomUpdates(*indices);
+}
+
+void BlocksController::flushRandomUpdates(const ContentIndices& indices) {
+    for (blockid_t id : randomUpdatedBlocks) {
+        auto& positions = randomUpdates[id];
+        scripting::random_update_blocks(indices.blocks.require(id), positions);
+        positions.clear();
+    }
+    randomUpdatedBlocks.clear();
 }
 
 int64_t BlocksController::createBlockInventory(int x, int y, int z) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <vector>
 #include <glm/glm.hpp>
 
 #include "maths/fastmaths.hpp"
@@ -33,6 +34,14 @@ class BlocksController {
     util::Clock worldTickClock;
     FastRandom random {};
     std::vector<on_block_interaction> blockInteractionCallbacks;
+    /// @brief Random tick positions of blocks handling them in batches
+    /// indexed by block id
+    std::vector<std::vector<glm::ivec3>> randomUpdates;
+    /// @brief Ids of blocks having random tick positions
+    std::vector<blockid_t> randomUpdatedBlocks;
+    bool batchRandomUpdates = true;
+
+    void flushRandomUpdates(const ContentIndices& indices);
 public:
     BlocksController(const Level& level, Lighting* lighting);
 
@@ -46,6 +55,14 @@ public:
     );
 
     void update(float delta, uint padding);
+
+    /// @brief Enable passing random ticks to on_blocks_random_update
+    /// handlers once per tick. Batched updates are performed after the
+    /// other random updates of the tick, so blocks handling them are
+    /// updated in the order of picking only within the block type
+    void setBatchRandomUpdates(bool flag) {
+        batchRandomUpdates = flag;
+    }
     void randomTick(
         const Chunk& chunk, int segments, const ContentIndices* indices
     );
@@ -1,7 +1,9 @@
 #include "ChunksController.hpp"
 
 #include <limits.h>
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 #include "content/Content.hpp"
 #include "world/files/WorldFiles.hpp"
@@ -10,6 +12,7 @@
 #include "maths/voxmaths.hpp"
 #include "util/timeutil.hpp"
 #include "objects/Player.hpp"
+#include "objects/Players.hpp"
 #include "voxels/Block.hpp"
 #include "voxels/Chunk.hpp"
 #include "voxels/Chunks.hpp"
@@ -17,109 +20,289 @@
 #include "world/Level.hpp"
 #include "world/World.hpp"
 #include "world/generator/WorldGenerator.hpp"
+#include "ChunksLoader.hpp"
 
 const uint MAX_WORK_PER_FRAME = 128;
+/// @brief Min number of chunks processed for a player per tick, when
+/// MAX_WORK_PER_FRAME is shared by many players
+const uint MIN_WORK_PER_PLAYER = 8;
 const uint MIN_SURROUNDING = 9;
+const uint MAX_LIGHTS_BATCH = 64;
+/// @brief Max width of the world generator area covering all players
+/// (in chunks)
+const int MAX_GENERATOR_AREA = 256;
 
-ChunksController::ChunksController(Level& level)
+static glm::ivec2 chunk_position(const Player& player) {
+    const auto& position = player.getPosition();
+    return glm::ivec2(
+        floordiv<CHUNK_W>(glm::floor(position.x)),
+        floordiv<CHUNK_D>(glm::floor(position.z))
+    );
+}
+
+/// @brief Squared distance of the chunks matrix slot to the matrix center
+static int slot_distance(const Chunks& chunks, int index) {
+    int lx = index % chunks.getWidth() - chunks.getWidth() / 2;
+    int lz = index / chunks.getWidth() - chunks.getHeight() / 2;
+    return lx * lx + lz * lz;
+}
+
+ChunksController::ChunksController(
+    Level& level, int loadWorkers, uint generatorWorkers
+)
     : level(level),
       generator(std::make_unique<WorldGenerator>(
           level.content.generators.require(level.getWorld()->getGenerator()),
           level.content,
-          level.getWorld()->getSeed()
+          level.getWorld()->getSeed(),
+          generatorWorkers
+      )),
+      loader(std::make_unique<ChunksLoader>(
+          level,
+          *generator,
+          [this](auto chunk) { onChunkLoaded(std::move(chunk)); },
+          [this]() { onChunkDropped(); },
+          loadWorkers
       )) {}
 
 ChunksController::~ChunksController() = default;
 
 void ChunksController::update(
-    int64_t maxDuration, int loadDistance, uint padding, Player& player
-) const {
-    const auto& position = player.getPosition();
-    int centerX = floordiv<CHUNK_W>(glm::floor(position.x));
-    int centerY = floordiv<CHUNK_D>(glm::floor(position.z));
-    
-    if (player.isLoadingChunks()) {
-        /// FIXME: one generator for multiple players
-        generator->update(centerX, centerY, loadDistance);
-    } else {
+    int64_t maxDuration, int loadDistance, uint padding
+) {
+    timeutil::Timer updateTimer;
+    std::vector<Player*> players;
+    for (const auto& [_, player] : *level.players) {
+        if (player->isLoadingChunks() && !player->isSuspended()) {
+            players.push_back(player.get());
+        }
+    }
+    if (demandStats.size() > players.size()) {
+        for (auto it = demandStats.begin(); it != demandStats.end();) {
+            if (level.players->get(it->first) == nullptr) {
+                it = demandStats.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    if (players.empty()) {
         return;
     }
+    updateGenerator(players, loadDistance, padding);
+    loader->update(maxDuration);
+    if (lighting) {
+        for (const auto player : players) {
+            buildLightsBatch(*player, padding);
+        }
+    }
 
-    int64_t mcstotal = 0;
-
+    uint workLimit = std::max(
+        MIN_WORK_PER_PLAYER,
+        MAX_WORK_PER_FRAME / static_cast<uint>(players.size())
+    );
+    std::vector<uint> work(players.size());
+    int64_t mcstotal = updateTimer.stop();
     for (uint i = 0; i < MAX_WORK_PER_FRAME; i++) {
-        timeutil::Timer timer;
-        if (loadVisible(player, padding)) {
-            int64_t mcs = timer.stop();
-            if (mcstotal + mcs < maxDuration * 1000) {
-                mcstotal += mcs;
+        // the nearest slot to any player
+        int nearestPlayer = -1;
+        int nearestIndex = -1;
+        int minDistance = INT_MAX;
+        for (size_t p = 0; p < players.size(); p++) {
+            if (work[p] == workLimit) {
                 continue;
             }
+            int index = findVisible(*players[p], padding);
+            if (index == -1) {
+                continue;
+            }
+            int distance = slot_distance(*players[p]->chunks, index);
+            if (distance < minDistance) {
+                minDistance = distance;
+                nearestPlayer = p;
+                nearestIndex = index;
+            }
+        }
+        if (nearestPlayer == -1) {
+            break;
+        }
+        timeutil::Timer timer;
+        if (!loadVisible(*players[nearestPlayer], nearestIndex)) {
+            break;
+        }
+        if (++work[nearestPlayer] == workLimit) {
+            demandStats[players[nearestPlayer]->getId()].limitedTicks++;
+        }
+        int64_t mcs = timer.stop();
+        if (mcstotal + mcs >= maxDuration * 1000) {
+            break;
         }
-        break;
+        mcstotal += mcs;
     }
 }
 
-bool ChunksController::loadVisible(const Player& player, uint padding) const {
-    const auto& chunks = *player.chunks;
-    int sizeX = chunks.getWidth();
-    int sizeY = chunks.getHeight();
+void ChunksController::updateGenerator(
+    const std::vector<Player*>& players, int loadDistance, uint padding
+) {
+    glm::ivec2 min(INT_MAX);
+    glm::ivec2 max(INT_MIN);
+    for (const auto player : players) {
+        auto center = chunk_position(*player);
+        min = glm::min(min, center - loadDistance);
+        max = glm::max(max, center + loadDistance);
+    }
+    glm::ivec2 size = max - min + 1;
 
-    int nearX = 0;
-    int nearZ = 0;
-    bool assigned = false;
-    int minDistance = ((sizeX - padding * 2) / 2) * ((sizeY - padding * 2) / 2);
-    for (uint z = padding; z < sizeY - padding; z++) {
-        for (uint x = padding; x < sizeX - padding; x++) {
-            int index = z * sizeX + x;
-            auto& chunk = chunks.getChunks()[index];
-            if (chunk != nullptr) {
-                if (chunk->flags.loaded && !chunk->flags.lighted) {
-                    if (buildLights(player, chunk)) {
-                        return true;
-                    }
+    const Player* focus = nullptr;
+    if (std::max(size.x, size.y) > MAX_GENERATOR_AREA) {
+        // players are too far from each other, follow one of them until
+        // its demand is satisfied
+        auto found = std::find(players.begin(), players.end(), generatorFocus);
+        if (found == players.end()) {
+            focus = players.front();
+        } else if (findVisible(**found, padding) == -1) {
+            // the next player waiting for the generator
+            focus = *found;
+            size_t index = found - players.begin();
+            for (size_t i = 1; i < players.size(); i++) {
+                auto player = players[(index + i) % players.size()];
+                if (demandStats[player->getId()].deferred) {
+                    focus = player;
+                    break;
                 }
-                continue;
             }
-            int lx = x - sizeX / 2;
-            int lz = z - sizeY / 2;
-            int distance = (lx * lx + lz * lz);
-            if (distance < minDistance) {
-                minDistance = distance;
-                nearX = x;
-                nearZ = z;
-                assigned = true;
+        } else {
+            focus = *found;
+        }
+        auto center = chunk_position(*focus);
+        min = center - loadDistance;
+        max = center + loadDistance;
+        size = max - min + 1;
+    }
+    if (focus != generatorFocus) {
+        generatorFocus = focus;
+        // skipped slots of other players are processed again
+        for (const auto player : players) {
+            player->chunks->getLoadQueue().reset();
+            demandStats[player->getId()].deferred = false;
+        }
+    }
+    demandMin = min;
+    demandMax = max;
+    generator->update(
+        min.x + size.x / 2, min.y + size.y / 2, std::max(size.x, size.y) / 2
+    );
+}
+
+int ChunksController::findVisible(const Player& player, uint padding) {
+    auto& chunks = *player.chunks;
+    int sizeX = chunks.getWidth();
+    int sizeY = chunks.getHeight();
+    int maxDistance = ((sizeX - padding * 2) / 2) * ((sizeY - padding * 2) / 2);
+
+    auto& queue = chunks.getLoadQueue();
+    queue.configure(sizeX, sizeY, padding);
+    for (int index = queue.current(); index != -1;
+         queue.next(), index = queue.current()) {
+        const auto& chunk = chunks.getChunks()[index];
+        // chunks not surrounded yet are processed again when neighbours
+        // are put, pending chunks - when put or dropped by the loader
+        if (chunk != nullptr) {
+            if (chunk->flags.loaded && !chunk->flags.lighted &&
+                isSurrounded(player, *chunk)) {
+                return index;
             }
+            continue;
+        }
+        if (slot_distance(chunks, index) >= maxDistance) {
+            continue;
         }
+        int x = index % sizeX + chunks.getOffsetX();
+        int z = index / sizeX + chunks.getOffsetY();
+        if (loader->isPending(x, z)) {
+            continue;
+        }
+        if (x < demandMin.x || z < demandMin.y || x > demandMax.x ||
+            z > demandMax.y) {
+            demandStats[player.getId()].deferred = true;
+            continue;
+        }
+        return index;
     }
+    return -1;
+}
 
-    const auto& chunk = chunks.getChunks()[nearZ * sizeX + nearX];
-    if (chunk != nullptr || !assigned || !player.isLoadingChunks()) {
+bool ChunksController::loadVisible(const Player& player, int index) {
+    const auto& chunks = *player.chunks;
+    const auto& chunk = chunks.getChunks()[index];
+    if (chunk != nullptr) {
+        if (buildLights(player, chunk)) {
+            demandStats[player.getId()].lighted++;
+            return true;
+        }
         return false;
     }
-    int offsetX = chunks.getOffsetX();
-    int offsetY = chunks.getOffsetY();
-    createChunk(player, nearX + offsetX, nearZ + offsetY);
-    return true;
+    int x = index % chunks.getWidth() + chunks.getOffsetX();
+    int z = index / chunks.getWidth() + chunks.getOffsetY();
+    if (createChunk(player, x, z)) {
+        demandStats[player.getId()].requested++;
+        return true;
+    }
+    return false;
 }
 
-bool ChunksController::buildLights(
-    const Player& player, const std::shared_ptr<Chunk>& chunk
+bool ChunksController::isSurrounded(
+    const Player& player, const Chunk& chunk
 ) const {
     int surrounding = 0;
     for (int oz = -1; oz <= 1; oz++) {
         for (int ox = -1; ox <= 1; ox++) {
-            if (player.chunks->getChunk(chunk->x + ox, chunk->z + oz))
+            if (player.chunks->getChunk(chunk.x + ox, chunk.z + oz))
                 surrounding++;
         }
     }
-    if (surrounding == MIN_SURROUNDING) {
-        if (lighting) {
-            bool lightsCache = chunk->flags.loadedLights;
-            if (!lightsCache) {
-                lighting->buildSkyLight(chunk->x, chunk->z);
+    return surrounding == MIN_SURROUNDING;
+}
+
+void ChunksController::buildLightsBatch(
+    const Player& player, uint padding
+) const {
+    const auto& chunks = *player.chunks;
+    int sizeX = chunks.getWidth();
+    int sizeY = chunks.getHeight();
+
+    std::vector<Chunk*> batch;
+    for (uint z = padding; z < sizeY - padding; z++) {
+        for (uint x = padding; x < sizeX - padding; x++) {
+            const auto& chunk = chunks.getChunks()[z * sizeX + x];
+            if (chunk == nullptr || !chunk->flags.loaded ||
+                chunk->flags.lighted || !isSurrounded(player, *chunk)) {
+                continue;
+            }
+            batch.push_back(chunk.get());
+            if (batch.size() == MAX_LIGHTS_BATCH) {
+                break;
             }
-            lighting->onChunkLoaded(chunk->x, chunk->z, !lightsCache);
+        }
+        if (batch.size() == MAX_LIGHTS_BATCH) {
+            break;
+        }
+    }
+    if (batch.empty()) {
+        return;
+    }
+    lighting->onChunksLoaded(batch);
+    for (Chunk* chunk : batch) {
+        chunk->flags.lighted = true;
+    }
+}
+
+bool ChunksController::buildLights(
+    const Player& player, const std::shared_ptr<Chunk>& chunk
+) const {
+    if (isSurrounded(player, *chunk)) {
+        if (lighting) {
+            lighting->onChunksLoaded({chunk.get()});
         }
         chunk->flags.lighted = true;
         return true;
@@ -127,26 +310,60 @@ bool ChunksController::buildLights(
     return false;
 }
 
-void ChunksController::createChunk(const Player& player, int x, int z) const {
+bool ChunksController::createChunk(const Player& player, int x, int z) const {
+    if (auto chunk = level.chunks->fetch(x, z)) {
+        player.chunks->putChunk(chunk);
+        return true;
+    }
     if (!player.isLoadingChunks()) {
-        if (auto chunk = level.chunks->fetch(x, z)) {
-            player.chunks->putChunk(chunk);
+        return false;
+    }
+    return loader->enqueue(x, z);
+}
+
+void ChunksController::onChunkLoaded(std::shared_ptr<Chunk> chunk) {
+    if (level.chunks->getChunk(chunk->x, chunk->z)) {
+        return;
+    }
+    bool required = false;
+    for (const auto& [_, player] : *level.players) {
+        if (player->isLoadingChunks() &&
+            player->chunks->isInside(chunk->x, chunk->z)) {
+            required = true;
+            break;
         }
+    }
+    // player has moved away while chunk was loading
+    if (!required) {
         return;
     }
-    auto chunk = level.chunks->create(x, z);
-    player.chunks->putChunk(chunk);
+    level.chunks->install(chunk);
+
     auto& chunkFlags = chunk->flags;
+    chunkFlags.loaded = true;
+    chunkFlags.ready = true;
 
-    if (!chunkFlags.loaded) {
-        generator->generate(chunk->voxels, x, z);
-        chunkFlags.unsaved = true;
+    for (const auto& [_, player] : *level.players) {
+        if (player->isLoadingChunks()) {
+            player->chunks->putChunk(chunk);
+        }
     }
-    chunk->updateHeights();
+}
 
-    if (!chunkFlags.loadedLights) {
-        Lighting::prebuildSkyLight(*chunk, *level.content.getIndices());
+void ChunksController::onChunkDropped() {
+    for (const auto& [_, player] : *level.players) {
+        player->chunks->getLoadQueue().reset();
     }
-    chunkFlags.loaded = true;
-    chunkFlags.ready = true;
+}
+
+ChunksLoaderStats ChunksController::getLoaderStats() const {
+    return loader->getStats();
+}
+
+ChunksDemandStats ChunksController::getDemandStats(u64id_t playerId) const {
+    const auto& found = demandStats.find(playerId);
+    if (found == demandStats.end()) {
+        return {};
+    }
+    return found->second;
 }
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
 
 #include "typedefs.hpp"
 
@@ -10,29 +14,84 @@ class Chunks;
 class Player;
 class Lighting;
 class WorldGenerator;
+class ChunksLoader;
+struct ChunksLoaderStats;
+
+/// @brief Chunks demand scheduling stats of a player
+struct ChunksDemandStats {
+    /// @brief Number of chunks requested (enqueued to the loader or taken
+    /// from the level chunks)
+    uint64_t requested = 0;
+    /// @brief Number of chunks lighted
+    uint64_t lighted = 0;
+    /// @brief Number of ticks the player reached the per player work limit
+    uint64_t limitedTicks = 0;
+    /// @brief Chunks loading is deferred until the world generator area
+    /// moves to the player
+    bool deferred = false;
+};
 
-/// @brief ChunksController manages chunks dynamic loading/unloading
+/// @brief ChunksController manages chunks dynamic loading/unloading.
+/// Chunks demanded by all players are processed in order of the distance
+/// to the nearest player, the world generator area covers all players or,
+/// if they are too far from each other, follows one of them until its
+/// demand is satisfied.
 class ChunksController {
 private:
     Level& level;
     std::unique_ptr<WorldGenerator> generator;
+    std::unique_ptr<ChunksLoader> loader;
+    std::unordered_map<u64id_t, ChunksDemandStats> demandStats;
+    /// @brief Area where chunks are loaded (chunk coordinates, inclusive)
+    glm::ivec2 demandMin {};
+    glm::ivec2 demandMax {};
+    /// @brief Player followed by the world generator or nullptr if the
+    /// generator area covers all players
+    const Player* generatorFocus = nullptr;
 
-    /// @brief Process one chunk: load it or calculate lights for it
-    bool loadVisible(const Player& player, uint padding) const;
+    /// @brief Update world generator and demand area
+    void updateGenerator(
+        const std::vector<Player*>& players, int loadDistance, uint padding
+    );
+    /// @brief Find slot of the player chunks matrix requiring work, skipping
+    /// slots which don't
+    /// @return matrix index or -1
+    int findVisible(const Player& player, uint padding);
+    /// @brief Process chunks matrix slot: load chunk or calculate lights
+    /// for it (see findVisible)
+    bool loadVisible(const Player& player, int index);
     bool buildLights(const Player& player, const std::shared_ptr<Chunk>& chunk) const;
-    void createChunk(const Player& player, int x, int y) const;
+    /// @brief Check if all chunks of 3x3 neighbourhood are available
+    bool isSurrounded(const Player& player, const Chunk& chunk) const;
+    /// @brief Build lights for chunks ready to be lighted at once
+    /// (see Lighting::onChunksLoaded)
+    void buildLightsBatch(const Player& player, uint padding) const;
+    /// @brief Put chunk to the player chunks or enqueue chunk loading
+    /// @return false if chunks loader queue is full
+    bool createChunk(const Player& player, int x, int y) const;
+    /// @brief Install chunk finished by the chunks loader
+    void onChunkLoaded(std::shared_ptr<Chunk> chunk);
+    /// @brief Process again chunks of all players when pending chunk was
+    /// dropped by the chunks loader
+    void onChunkDropped();
 public:
     std::unique_ptr<Lighting> lighting;
 
-    ChunksController(Level& level);
+    /// @param loadWorkers max number of chunks loader workers
+    /// @param generatorWorkers number of world generator prototype stages
+    /// workers, 0 is auto
+    ChunksController(Level& level, int loadWorkers, uint generatorWorkers);
     ~ChunksController();
 
+    /// @brief Process chunks of all players loading chunks
     /// @param maxDuration milliseconds reserved for chunks loading
-    void update(
-        int64_t maxDuration, int loadDistance, uint padding, Player& player
-    ) const;
+    void update(int64_t maxDuration, int loadDistance, uint padding);
 
     const WorldGenerator* getGenerator() const {
         return generator.get();
     }
+
+    ChunksLoaderStats getLoaderStats() const;
+
+    ChunksDemandStats getDemandStats(u64id_t playerId) const;
 };
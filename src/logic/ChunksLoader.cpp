@@ -0,0 +1,276 @@
+#include "ChunksLoader.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "content/Content.hpp"
+#include "debug/Logger.hpp"
+#include "lighting/Lighting.hpp"
+#include "util/timeutil.hpp"
+#include "voxels/Chunk.hpp"
+#include "voxels/GlobalChunks.hpp"
+#include "world/files/WorldFiles.hpp"
+#include "world/generator/WorldGenerator.hpp"
+#include "world/Level.hpp"
+#include "world/World.hpp"
+
+static debug::Logger logger("chunks-loader");
+
+/// @brief Max number of pending chunks per worker
+inline constexpr uint MAX_PENDING_PER_WORKER = 8;
+
+/// @brief Max number of generator prototypes prepared at once
+inline constexpr size_t PREPARE_BATCH_SIZE = 16;
+
+class ChunksLoaderWorker : public util::Worker<ChunkLoadJob, ChunkLoadResult> {
+    ChunksLoader& loader;
+    WorldRegions& regions;
+    const ContentIndices& indices;
+    const WorldGenerator& generator;
+    bool compactChunks;
+    /// @brief Generated voxels buffer
+    std::unique_ptr<voxel[]> voxelsBuffer;
+
+    /// @return false if chunk is not found in regions
+    bool read(Chunk& chunk) {
+        timeutil::Timer timer;
+        auto data = regions.getVoxels(chunk.x, chunk.z);
+        if (data == nullptr) {
+            loader.addStageTime(ChunkLoadStage::READ, timer.stop());
+            return false;
+        }
+        auto lights = regions.getLights(chunk.x, chunk.z);
+        loader.addStageTime(ChunkLoadStage::READ, timer.stop());
+
+        timer = {};
+        chunk.decode(data.get());
+        GlobalChunks::checkVoxels(indices, chunk);
+        chunk.flags.loaded = true;
+        if (lights) {
+            chunk.lightmap.set(lights.get());
+            chunk.flags.loadedLights = true;
+        }
+        loader.addStageTime(ChunkLoadStage::DECODE, timer.stop());
+        return true;
+    }
+
+    ChunkLoadResult process(const ChunkLoadJob& job) {
+        auto chunkPtr = job.chunk;
+        if (chunkPtr == nullptr) {
+            chunkPtr = std::make_shared<Chunk>(job.x, job.z);
+        }
+        auto& chunk = *chunkPtr;
+        try {
+            if (job.prototype == nullptr) {
+                if (!read(chunk)) {
+                    return ChunkLoadResult {chunkPtr, true, false};
+                }
+            } else {
+                timeutil::Timer timer;
+                generator.generate(
+                    voxelsBuffer.get(), *job.prototype, chunk.x, chunk.z
+                );
+                chunk.voxels.assign(voxelsBuffer.get());
+                chunk.flags.unsaved = true;
+                loader.addStageTime(ChunkLoadStage::GENERATE, timer.stop());
+            }
+            chunk.updateHeights();
+            chunk.updateOccupancy(indices);
+
+            if (!chunk.flags.loadedLights) {
+                timeutil::Timer timer;
+                Lighting::prebuildSkyLight(chunk, indices);
+                loader.addStageTime(ChunkLoadStage::SKYLIGHT, timer.stop());
+            }
+            // chunk is not shared with other threads yet
+            if (compactChunks) {
+                chunk.compact();
+            }
+        } catch (const std::exception& err) {
+            logger.error() << "could not load chunk " << chunk.x << "_"
+                           << chunk.z << ": " << err.what();
+            return ChunkLoadResult {chunkPtr, false, true};
+        }
+        return ChunkLoadResult {chunkPtr, false, false};
+    }
+public:
+    ChunksLoaderWorker(
+        ChunksLoader& loader,
+        WorldRegions& regions,
+        const ContentIndices& indices,
+        const WorldGenerator& generator,
+        bool compactChunks
+    )
+        : loader(loader),
+          regions(regions),
+          indices(indices),
+          generator(generator),
+          compactChunks(compactChunks),
+          voxelsBuffer(std::make_unique<voxel[]>(CHUNK_VOL)) {
+    }
+
+    ChunkLoadResult operator()(const ChunkLoadJob& job) override {
+        auto result = process(job);
+        loader.readyCount++;
+        return result;
+    }
+};
+
+ChunksLoader::ChunksLoader(
+    Level& level,
+    WorldGenerator& generator,
+    consumer<std::shared_ptr<Chunk>> onLoaded,
+    runnable onDropped,
+    int maxWorkers
+)
+    : level(level),
+      generator(generator),
+      onLoaded(std::move(onLoaded)),
+      onDropped(std::move(onDropped)),
+      threadPool(
+          "chunks-loader-pool",
+          [this]() {
+              return std::make_shared<ChunksLoaderWorker>(
+                  *this,
+                  this->level.getWorld()->wfile->getRegions(),
+                  *this->level.content.getIndices(),
+                  this->generator,
+                  this->level.chunks->isCompactStorage()
+              );
+          },
+          [this](ChunkLoadResult& result) {
+              readyCount--;
+              processResult(result);
+          },
+          maxWorkers
+      ) {
+    threadPool.setStopOnFail(false);
+    maxPending = threadPool.getWorkersCount() * MAX_PENDING_PER_WORKER;
+    logger.info() << "created " << threadPool.getWorkersCount() << " workers";
+}
+
+ChunksLoader::~ChunksLoader() = default;
+
+void ChunksLoader::processResult(ChunkLoadResult& result) {
+    auto& chunk = result.chunk;
+    glm::ivec2 key(chunk->x, chunk->z);
+    if (result.failed) {
+        pending.erase(key);
+        onDropped();
+        return;
+    }
+    if (result.generationRequired) {
+        generationQueue.push_back(std::move(chunk));
+        return;
+    }
+    installQueue.push(std::move(chunk));
+}
+
+void ChunksLoader::installChunks(timeutil::Timer& timer, int64_t maxDuration) {
+    while (!installQueue.empty()) {
+        auto chunk = std::move(installQueue.front());
+        installQueue.pop();
+        pending.erase(glm::ivec2(chunk->x, chunk->z));
+
+        timeutil::Timer installTimer;
+        onLoaded(std::move(chunk));
+        addStageTime(ChunkLoadStage::INSTALL, installTimer.stop());
+        if (timer.stop() >= maxDuration) {
+            break;
+        }
+    }
+}
+
+void ChunksLoader::prepareGeneration(
+    timeutil::Timer& timer, int64_t maxDuration
+) {
+    bool dropped = false;
+    size_t prepared = 0;
+    while (prepared < generationQueue.size()) {
+        size_t count =
+            std::min(PREPARE_BATCH_SIZE, generationQueue.size() - prepared);
+        std::vector<glm::ivec2> positions;
+        for (size_t i = 0; i < count; i++) {
+            const auto& chunk = generationQueue[prepared + i];
+            positions.emplace_back(chunk->x, chunk->z);
+        }
+        std::vector<std::shared_ptr<const ChunkPrototype>> prototypes;
+        try {
+            prototypes = generator.prepare(positions);
+        } catch (const std::exception& err) {
+            logger.error() << "could not prepare chunks generation: "
+                           << err.what();
+            prototypes.resize(positions.size());
+        }
+        for (size_t i = 0; i < count; i++) {
+            auto& chunk = generationQueue[prepared + i];
+            if (prototypes[i] == nullptr) {
+                // chunk is out of generator area now, will be requested again
+                pending.erase(positions[i]);
+                dropped = true;
+                continue;
+            }
+            threadPool.enqueueJob(ChunkLoadJob {
+                chunk->x, chunk->z, std::move(chunk), std::move(prototypes[i])
+            });
+        }
+        prepared += count;
+        if (timer.stop() >= maxDuration) {
+            break;
+        }
+    }
+    generationQueue.erase(
+        generationQueue.begin(), generationQueue.begin() + prepared
+    );
+    if (dropped) {
+        onDropped();
+    }
+}
+
+bool ChunksLoader::enqueue(int x, int z) {
+    if (isFull()) {
+        return false;
+    }
+    if (!pending.insert(glm::ivec2(x, z)).second) {
+        return false;
+    }
+    threadPool.enqueueJob(ChunkLoadJob {x, z, nullptr, nullptr});
+    return true;
+}
+
+bool ChunksLoader::isPending(int x, int z) const {
+    return pending.find(glm::ivec2(x, z)) != pending.end();
+}
+
+bool ChunksLoader::isFull() const {
+    return pending.size() >= maxPending;
+}
+
+void ChunksLoader::update(int64_t maxDuration) {
+    timeutil::Timer timer;
+    threadPool.update();
+    prepareGeneration(timer, maxDuration * 1000);
+    installChunks(timer, maxDuration * 1000);
+}
+
+void ChunksLoader::addStageTime(ChunkLoadStage stage, uint64_t mcs) {
+    auto& counters = stages[static_cast<int>(stage)];
+    counters.count++;
+    counters.totalTime += mcs;
+    uint64_t prevMax = counters.maxTime;
+    while (prevMax < mcs &&
+           !counters.maxTime.compare_exchange_weak(prevMax, mcs)) {
+    }
+}
+
+ChunksLoaderStats ChunksLoader::getStats() const {
+    ChunksLoaderStats stats {};
+    stats.ready = readyCount + installQueue.size();
+    stats.pending = pending.size() - stats.ready;
+    for (int i = 0; i < static_cast<int>(ChunkLoadStage::COUNT); i++) {
+        stats.stages[i].count = stages[i].count;
+        stats.stages[i].totalTime = stages[i].totalTime;
+        stats.stages[i].maxTime = stages[i].maxTime;
+    }
+    return stats;
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <queue>
+#include <unordered_set>
+#include <vector>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include <glm/gtx/hash.hpp>
+
+#include "typedefs.hpp"
+#include "delegates.hpp"
+#include "util/ThreadPool.hpp"
+#include "util/timeutil.hpp"
+
+class Chunk;
+class Level;
+class WorldGenerator;
+struct ChunkPrototype;
+
+enum class ChunkLoadStage {
+    /// @brief Region read and decompression
+    READ = 0,
+    /// @brief Voxels decoding and validation
+    DECODE,
+    /// @brief Voxels generation from a prepared prototype
+    GENERATE,
+    /// @brief Sky light prebuild
+    SKYLIGHT,
+    /// @brief Installation to the level on the main thread
+    INSTALL,
+
+    COUNT
+};
+
+struct ChunkLoadJob {
+    int x;
+    int z;
+    /// @brief Chunk to generate voxels for. Created by worker if nullptr
+    std::shared_ptr<Chunk> chunk;
+    /// @brief Prepared generator prototype. Chunk is read from regions
+    /// if nullptr
+    std::shared_ptr<const ChunkPrototype> prototype;
+};
+
+struct ChunkLoadResult {
+    std::shared_ptr<Chunk> chunk;
+    /// @brief Chunk is not found in regions and must be generated
+    bool generationRequired;
+    bool failed;
+};
+
+struct ChunkLoadStageStats {
+    uint64_t count = 0;
+    /// @brief Total stage time (microseconds)
+    uint64_t totalTime = 0;
+    /// @brief Max stage time (microseconds)
+    uint64_t maxTime = 0;
+};
+
+struct ChunksLoaderStats {
+    /// @brief Number of chunks queued or being processed by workers
+    uint pending;
+    /// @brief Number of finished chunks waiting to be installed
+    uint ready;
+    ChunkLoadStageStats stages[static_cast<int>(ChunkLoadStage::COUNT)];
+};
+
+/// @brief Loads and generates chunks in worker threads.
+/// Region data reading, decompression, decoding, generation and sky light
+/// prebuild are performed by workers. Generator prototypes preparation
+/// (batched, see WorldGenerator::prepare) and installation of finished
+/// chunks are performed in update() on the main thread within the time
+/// budget.
+class ChunksLoader {
+    friend class ChunksLoaderWorker;
+
+    struct StageCounters {
+        std::atomic<uint64_t> count = 0;
+        std::atomic<uint64_t> totalTime = 0;
+        std::atomic<uint64_t> maxTime = 0;
+    };
+
+    Level& level;
+    WorldGenerator& generator;
+    consumer<std::shared_ptr<Chunk>> onLoaded;
+    runnable onDropped;
+    std::unordered_set<glm::ivec2> pending;
+    /// @brief Chunks not found in regions waiting for generator prototypes
+    std::vector<std::shared_ptr<Chunk>> generationQueue;
+    /// @brief Finished chunks waiting to be installed
+    std::queue<std::shared_ptr<Chunk>> installQueue;
+    /// @brief Number of chunks finished by workers and not processed yet
+    std::atomic<uint> readyCount = 0;
+    StageCounters stages[static_cast<int>(ChunkLoadStage::COUNT)];
+    util::ThreadPool<ChunkLoadJob, ChunkLoadResult> threadPool;
+    size_t maxPending;
+
+    void processResult(ChunkLoadResult& result);
+
+    /// @brief Prepare generator prototypes for queued chunks in batches
+    /// and enqueue generation. At least one batch is prepared
+    /// @param timer update timer
+    /// @param maxDuration update time budget in microseconds
+    void prepareGeneration(timeutil::Timer& timer, int64_t maxDuration);
+
+    /// @brief Install finished chunks. At least one chunk is installed
+    /// @param timer update timer
+    /// @param maxDuration update time budget in microseconds
+    void installChunks(timeutil::Timer& timer, int64_t maxDuration);
+
+    /// @brief Add stage time to stats (thread-safe)
+    void addStageTime(ChunkLoadStage stage, uint64_t mcs);
+public:
+    /// @param level target level
+    /// @param generator world generator
+    /// @param onLoaded callback called on the main thread when chunk is
+    /// ready to be installed
+    /// @param onDropped callback called on the main thread when pending chunk
+    /// is dropped without loading and needs to be requested again
+    /// @param maxWorkers max number of workers (see util::ThreadPool)
+    ChunksLoader(
+        Level& level,
+        WorldGenerator& generator,
+        consumer<std::shared_ptr<Chunk>> onLoaded,
+        runnable onDropped,
+        int maxWorkers
+    );
+    ~ChunksLoader();
+
+    /// @brief Enqueue chunk loading
+    /// @return false if chunk is already pending or the queue is full
+    bool enqueue(int x, int z);
+
+    /// @brief Check if chunk is queued or being processed
+    bool isPending(int x, int z) const;
+
+    /// @brief Check if loader accepts new chunks
+    bool isFull() const;
+
+    /// @brief Process finished chunks. Must be called on the main thread
+    /// @param maxDuration milliseconds reserved for generator prototypes
+    /// preparation and chunks installation
+    void update(int64_t maxDuration);
+
+    ChunksLoaderStats getStats() const;
+};
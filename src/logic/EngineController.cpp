@@ -250,6 +250,37 @@ void EngineController::openWorld(const std::string& name, bool confirmConvert) {
     });
 }
 
+void EngineController::recompressWorld(const std::string& name) {
+    const auto& paths = engine.getPaths();
+    auto& debugSettings = engine.getSettings().debug;
+    auto folder = paths.getWorldsFolder() / name;
+
+    auto content = load_world_content(engine, folder);
+    auto worldFiles = std::make_shared<WorldFiles>(folder, debugSettings);
+    // each region is written and released right after being recompressed
+    worldFiles->getRegions().setAsyncSave(false);
+    auto report = World::checkIndices(worldFiles, content);
+    if (report && report->isUpgradeRequired()) {
+        throw std::runtime_error("world must be upgraded before");
+    }
+    auto task = WorldConverter::startTask(
+        worldFiles,
+        content,
+        report,
+        [this]() {
+            if (engine.isHeadless()) {
+                return;
+            }
+            engine.postRunnable([this]() {
+                engine.setScreen(std::make_shared<MenuScreen>(engine));
+            });
+        },
+        ConvertMode::RECOMPRESS,
+        true
+    );
+    start(engine, std::move(task), L"Recompressing world...");
+}
+
 inline uint64_t str2seed(const std::string& seedstr) {
     if (util::is_integer(seedstr)) {
         try {
@@ -26,6 +26,11 @@ public:
     /// @param name world name
     void deleteWorld(const std::string& name);
 
+    /// @brief Rewrite world regions with the compression methods
+    /// specified in settings
+    /// @param name world name
+    void recompressWorld(const std::string& name);
+
     void reconfigPacks(
         LevelController* controller,
         const std::vector<std::string>& packsToAdd,
@@ -25,7 +25,11 @@ LevelController::LevelController(
 )
     : settings(engine->getSettings()),
       level(std::move(levelPtr)),
-      chunks(std::make_unique<ChunksController>(*level)),
+      chunks(std::make_unique<ChunksController>(
+          *level,
+          settings.chunks.loadWorkers.get(),
+          settings.chunks.generatorWorkers.get()
+      )),
       playerTickClock(20, 3) {
     
     level->events->listen(LevelEventType::CHUNK_PRESENT, [](auto, Chunk* chunk) {
@@ -37,7 +41,9 @@ LevelController::LevelController(
 
     if (clientPlayer) {
         chunks->lighting = std::make_unique<Lighting>(
-            level->content, *clientPlayer->chunks
+            level->content,
+            *clientPlayer->chunks,
+            settings.chunks.lightingWorkers.get()
         );
     }
     blocks = std::make_unique<BlocksController>(
@@ -50,16 +56,19 @@ LevelController::LevelController(
     do {
         confirmed = 0;
         for (const auto& [_, player] : *level->players) {
-            if (!player->isLoadingChunks()) {
-                confirmed++;
+            if (!player->isLoadingChunks() || player->isSuspended()) {
                 continue;
             }
             glm::vec3 position = player->getPosition();
             player->chunks->configure(
                 std::floor(position.x), std::floor(position.z), 1
             );
-            chunks->update(16, 1, 0, *player);
-            if (player->chunks->get(
+        }
+        chunks->update(16, 1, 0);
+        for (const auto& [_, player] : *level->players) {
+            glm::vec3 position = player->getPosition();
+            if (!player->isLoadingChunks() || player->isSuspended() ||
+                player->chunks->get(
                     std::floor(position.x), 0, std::floor(position.z)
                 )) {
                 confirmed++;
@@ -69,6 +78,7 @@ LevelController::LevelController(
 }
 
 void LevelController::update(float delta, bool pause) {
+    level->getWorld()->wfile->getRegions().update();
     for (const auto& [_, player] : *level->players) {
         if (player->isSuspended()) {
             continue;
@@ -81,15 +91,15 @@ void LevelController::update(float delta, bool pause) {
             glm::floor(position.z),
             settings.chunks.loadDistance.get() + settings.chunks.padding.get()
         );
-        chunks->update(
-            settings.chunks.loadSpeed.get(),
-            settings.chunks.loadDistance.get(),
-            settings.chunks.padding.get(),
-            *player
-        );
     }
+    chunks->update(
+        settings.chunks.loadSpeed.get(),
+        settings.chunks.loadDistance.get(),
+        settings.chunks.padding.get()
+    );
     if (!pause) {
         // update all objects that needed
+        blocks->setBatchRandomUpdates(settings.debug.batchRandomUpdates.get());
         blocks->update(delta, settings.chunks.padding.get());
         level->entities->updatePhysics(delta);
         level->entities->update(delta);
@@ -118,17 +128,20 @@ void LevelController::update(float delta, bool pause) {
     level->entities->clean();
 }
 
-void LevelController::saveWorld() {
+void LevelController::saveWorld(runnable onSaved) {
     auto world = level->getWorld();
     if (world->isNameless()) {
         logger.info() << "nameless world will not be saved";
+        if (onSaved) {
+            onSaved();
+        }
         return;
     }
     logger.info() << "writing world '" << world->getName() << "'";
     world->wfile->createDirectories();
     scripting::on_world_save();
     level->onSave();
-    level->getWorld()->write(level.get());
+    level->getWorld()->write(level.get(), std::move(onSaved));
 }
 
 void LevelController::onWorldQuit() {
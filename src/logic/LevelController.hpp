@@ -4,6 +4,7 @@
 
 #include "BlocksController.hpp"
 #include "ChunksController.hpp"
+#include "delegates.hpp"
 #include "util/Clock.hpp"
 
 class Engine;
@@ -27,7 +28,9 @@ public:
     /// @param pause is world and player simulation paused
     void update(float delta, bool pause);
 
-    void saveWorld();
+    /// @param onSaved if not nullptr, regions are written in background and
+    /// the callback is called when done
+    void saveWorld(runnable onSaved = nullptr);
 
     void onWorldQuit();
 
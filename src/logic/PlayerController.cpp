@@ -350,7 +350,7 @@ static int determine_rotation(
     return 0;
 }
 
-voxel* PlayerController::updateSelection(float maxDistance) {
+const voxel* PlayerController::updateSelection(float maxDistance) {
     auto indices = level.content.getIndices();
     auto& chunks = *player.chunks;
     auto camera = player.fpCamera.get();
@@ -359,7 +359,7 @@ voxel* PlayerController::updateSelection(float maxDistance) {
     glm::vec3 end;
     glm::ivec3 iend;
     glm::ivec3 norm;
-    voxel* vox = chunks.rayCast(
+    const voxel* vox = chunks.rayCast(
         camera->position, camera->front, maxDistance, end, norm, iend
     );
     if (vox) {
@@ -0,0 +1,215 @@
+#include "WorldPregenerator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "content/Content.hpp"
+#include "lighting/Lighting.hpp"
+#include "util/ForkJoinPool.hpp"
+#include "voxels/Chunk.hpp"
+#include "voxels/Chunks.hpp"
+#include "voxels/GlobalChunks.hpp"
+#include "world/files/WorldFiles.hpp"
+#include "world/generator/WorldGenerator.hpp"
+#include "world/Level.hpp"
+#include "world/World.hpp"
+
+WorldPregenerator::WorldPregenerator(
+    Level& level, glm::ivec2 areaMin, glm::ivec2 areaMax, uint workers
+)
+    : level(level),
+      regions(level.getWorld()->wfile->getRegions()),
+      areaMin(glm::min(areaMin, areaMax)),
+      areaMax(glm::max(areaMin, areaMax)),
+      pool(std::make_unique<util::ForkJoinPool>(workers)) {
+    const auto& world = *level.getWorld();
+    generator = std::make_unique<WorldGenerator>(
+        level.content.generators.require(world.getGenerator()),
+        level.content,
+        world.getSeed(),
+        pool->getThreadsCount()
+    );
+    int localX, localZ;
+    calc_reg_coords(
+        this->areaMin.x,
+        this->areaMin.y,
+        regionsMin.x,
+        regionsMin.y,
+        localX,
+        localZ
+    );
+    calc_reg_coords(
+        this->areaMax.x,
+        this->areaMax.y,
+        regionsMax.x,
+        regionsMax.y,
+        localX,
+        localZ
+    );
+    glm::ivec2 size = this->areaMax - this->areaMin + 1;
+    chunksTotal = static_cast<uint64_t>(size.x) * size.y;
+}
+
+WorldPregenerator::~WorldPregenerator() = default;
+
+std::shared_ptr<Chunk> WorldPregenerator::read(int x, int z) {
+    auto data = regions.getVoxels(x, z);
+    if (data == nullptr) {
+        return nullptr;
+    }
+    auto lights = regions.getLights(x, z);
+
+    auto chunk = std::make_shared<Chunk>(x, z);
+    chunk->decode(data.get());
+    GlobalChunks::checkVoxels(*level.content.getIndices(), *chunk);
+    if (lights) {
+        chunk->lightmap.set(lights.get());
+        chunk->flags.loadedLights = true;
+    }
+    return chunk;
+}
+
+void WorldPregenerator::processRegion(int regionX, int regionZ) {
+    const auto& indices = *level.content.getIndices();
+
+    glm::ivec2 regionMin =
+        glm::ivec2(regionX, regionZ) * static_cast<int>(REGION_SIZE);
+    glm::ivec2 regionMax = regionMin + static_cast<int>(REGION_SIZE) - 1;
+    // area part inside of the region
+    glm::ivec2 min = glm::max(areaMin, regionMin);
+    glm::ivec2 max = glm::min(areaMax, regionMax);
+    // window covers the area part with one chunk margin
+    glm::ivec2 origin = min - 1;
+    glm::ivec2 size = max - min + 3;
+
+    auto isTarget = [min, max](int x, int z) {
+        return x >= min.x && z >= min.y && x <= max.x && z <= max.y;
+    };
+
+    std::vector<std::shared_ptr<Chunk>> window(size.x * size.y);
+    std::vector<runnable> tasks;
+    for (int i = 0; i < size.x * size.y; i++) {
+        tasks.push_back([this, &window, origin, size, i]() {
+            window[i] = read(origin.x + i % size.x, origin.y + i / size.x);
+        });
+    }
+    pool->run(tasks);
+
+    std::vector<glm::ivec2> missing;
+    std::vector<size_t> missingIndices;
+    size_t targetsCount = 0;
+    for (int i = 0; i < size.x * size.y; i++) {
+        int x = origin.x + i % size.x;
+        int z = origin.y + i / size.x;
+        bool target = isTarget(x, z);
+        if (window[i]) {
+            chunksSkipped += target;
+            continue;
+        }
+        targetsCount += target;
+        missing.emplace_back(x, z);
+        missingIndices.push_back(i);
+    }
+    if (targetsCount == 0) {
+        return;
+    }
+
+    int radius = (std::max(size.x, size.y) + 1) / 2;
+    glm::ivec2 center = origin + radius;
+    generator->update(center.x, center.y, radius + 1);
+    auto prototypes = generator->prepare(missing);
+
+    tasks.clear();
+    for (size_t i = 0; i < missing.size(); i++) {
+        const auto& pos = missing[i];
+        const auto& prototype = prototypes[i];
+        auto& chunk = window[missingIndices[i]];
+        if (prototype == nullptr) {
+            throw std::runtime_error("chunk is out of generator area");
+        }
+        tasks.push_back([this, pos, &prototype, &chunk]() {
+            chunk = std::make_shared<Chunk>(pos.x, pos.y);
+            auto voxels = std::make_unique<voxel[]>(CHUNK_VOL);
+            generator->generate(voxels.get(), *prototype, pos.x, pos.y);
+            chunk->voxels.assign(voxels.get());
+            chunk->flags.unsaved = true;
+        });
+    }
+    pool->run(tasks);
+    prototypes.clear();
+
+    tasks.clear();
+    for (const auto& chunk : window) {
+        tasks.push_back([&chunk, &indices]() {
+            chunk->updateHeights();
+            chunk->updateOccupancy(indices);
+            if (!chunk->flags.loadedLights) {
+                Lighting::prebuildSkyLight(*chunk, indices);
+            }
+            chunk->flags.loaded = true;
+        });
+    }
+    pool->run(tasks);
+
+    Chunks chunks(radius * 2, radius * 2, 0, 0, nullptr, indices);
+    chunks.configure(center.x, center.y, radius);
+    for (const auto& chunk : window) {
+        chunks.putChunk(chunk);
+    }
+    std::vector<Chunk*> targets;
+    for (const auto& chunk : window) {
+        if (chunk->flags.unsaved && isTarget(chunk->x, chunk->z)) {
+            targets.push_back(chunk.get());
+        }
+    }
+    Lighting lighting(level.content, chunks, pool->getThreadsCount());
+    lighting.onChunksLoaded(targets);
+    // spread lights of the stored neighbours to generated chunks
+    for (const auto& chunk : window) {
+        if (chunk->flags.loadedLights) {
+            lighting.onChunkLoaded(chunk->x, chunk->z, true);
+        }
+    }
+
+    for (auto chunk : targets) {
+        chunk->flags.lighted = true;
+        regions.put(chunk, {});
+
+        if (chunk->x == regionMin.x || chunk->z == regionMin.y ||
+            chunk->x == regionMax.x || chunk->z == regionMax.y) {
+            generated.insert({chunk->x, chunk->z});
+        }
+    }
+    // neighbour region chunks generated earlier got lights of the targets
+    for (const auto& chunk : window) {
+        if (chunk->flags.loadedLights &&
+            generated.find({chunk->x, chunk->z}) != generated.end()) {
+            chunk->flags.lighted = true;
+            chunk->flags.unsaved = true;
+            regions.put(chunk.get(), {});
+        }
+    }
+    chunksGenerated += targets.size();
+    regions.writeAllAsync(nullptr);
+}
+
+bool WorldPregenerator::update() {
+    glm::ivec2 count = regionsMax - regionsMin + 1;
+    if (nextRegion >= count.x * count.y) {
+        return false;
+    }
+    int index = nextRegion++;
+    processRegion(
+        regionsMin.x + index % count.x, regionsMin.y + index / count.x
+    );
+    return true;
+}
+
+void WorldPregenerator::finish() {
+    regions.writeAll();
+}
+
+uint WorldPregenerator::getWorkersCount() const {
+    return pool->getThreadsCount();
+}
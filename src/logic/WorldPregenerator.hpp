@@ -0,0 +1,84 @@
+#pragma once
+
+#include <memory>
+#include <unordered_set>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include <glm/gtx/hash.hpp>
+
+#include "typedefs.hpp"
+
+class Level;
+class Chunk;
+class WorldRegions;
+class WorldGenerator;
+
+namespace util {
+    class ForkJoinPool;
+}
+
+/// @brief Generates missing chunks of a rectangular area without players
+/// and streams them to the world regions region by region, so memory usage
+/// does not depend on the area size. Chunks are lighted together with a one
+/// chunk margin around the region, existing chunks are never modified.
+class WorldPregenerator {
+    Level& level;
+    WorldRegions& regions;
+    /// @brief Inclusive area bounds in chunks
+    glm::ivec2 areaMin;
+    glm::ivec2 areaMax;
+    /// @brief Inclusive range of regions intersecting the area
+    glm::ivec2 regionsMin;
+    glm::ivec2 regionsMax;
+    /// @brief Index of the next region in row-major order
+    int nextRegion = 0;
+    uint64_t chunksTotal;
+    uint64_t chunksGenerated = 0;
+    uint64_t chunksSkipped = 0;
+    std::unique_ptr<util::ForkJoinPool> pool;
+    std::unique_ptr<WorldGenerator> generator;
+    /// @brief Region border chunks generated by the pregenerator. Unlike
+    /// pre-existing chunks these are stored again when lights of the
+    /// neighbour region chunks spread to them.
+    std::unordered_set<glm::ivec2> generated;
+
+    /// @brief Read chunk voxels and lights from regions
+    /// @return nullptr if chunk is not found
+    std::shared_ptr<Chunk> read(int x, int z);
+
+    /// @brief Generate, light and store missing chunks of the region
+    void processRegion(int regionX, int regionZ);
+public:
+    /// @param areaMin minimal chunk coordinates of the area
+    /// @param areaMax maximal chunk coordinates of the area (inclusive)
+    /// @param workers number of generation and lighting threads, 0 is auto
+    WorldPregenerator(
+        Level& level, glm::ivec2 areaMin, glm::ivec2 areaMax, uint workers
+    );
+    ~WorldPregenerator();
+
+    /// @brief Process the next region
+    /// @return false if all regions are processed
+    bool update();
+
+    /// @brief Wait until all generated chunks are written to region files
+    void finish();
+
+    uint getWorkersCount() const;
+
+    /// @brief Get total number of chunks in the area
+    uint64_t getChunksTotal() const {
+        return chunksTotal;
+    }
+
+    /// @brief Get number of generated chunks
+    uint64_t getChunksGenerated() const {
+        return chunksGenerated;
+    }
+
+    /// @brief Get number of already existing chunks that have been skipped
+    uint64_t getChunksSkipped() const {
+        return chunksSkipped;
+    }
+};
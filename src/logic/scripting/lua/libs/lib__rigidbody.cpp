@@ -12,7 +12,9 @@ static int l_get_vel(lua::State* L) {
 
 static int l_set_vel(lua::State* L) {
     if (auto entity = get_entity(L, 1)) {
-        entity->getRigidbody().hitbox.velocity = lua::tovec3(L, 2);
+        auto& hitbox = entity->getRigidbody().hitbox;
+        hitbox.velocity = lua::tovec3(L, 2);
+        hitbox.wakeUp();
     }
     return 0;
 }
@@ -26,7 +28,9 @@ static int l_is_enabled(lua::State* L) {
 
 static int l_set_enabled(lua::State* L) {
     if (auto entity = get_entity(L, 1)) {
-        entity->getRigidbody().enabled = lua::toboolean(L, 2);
+        auto& rigidbody = entity->getRigidbody();
+        rigidbody.enabled = lua::toboolean(L, 2);
+        rigidbody.hitbox.wakeUp();
     }
     return 0;
 }
@@ -41,6 +45,7 @@ static int l_get_size(lua::State* L) {
 static int l_set_size(lua::State* L) {
     if (auto entity = get_entity(L, 1)) {
         entity->getRigidbody().hitbox.halfsize = lua::tovec3(L, 2) * 0.5f;
+        entity->updateBounds();
     }
     return 0;
 }
@@ -54,7 +59,9 @@ static int l_get_gravity_scale(lua::State* L) {
 
 static int l_set_gravity_scale(lua::State* L) {
     if (auto entity = get_entity(L, 1)) {
-        entity->getRigidbody().hitbox.gravityScale = lua::tonumber(L, 2);
+        auto& hitbox = entity->getRigidbody().hitbox;
+        hitbox.gravityScale = lua::tonumber(L, 2);
+        hitbox.wakeUp();
     }
     return 0;
 }
@@ -70,7 +77,9 @@ static int l_is_vdamping(lua::State* L) {
 
 static int l_set_vdamping(lua::State* L) {
     if (auto entity = get_entity(L, 1)) {
-        entity->getRigidbody().hitbox.verticalDamping = lua::toboolean(L, 2);
+        auto& hitbox = entity->getRigidbody().hitbox;
+        hitbox.verticalDamping = lua::toboolean(L, 2);
+        hitbox.wakeUp();
     }
     return 0;
 }
@@ -91,7 +100,9 @@ static int l_is_crouching(lua::State* L) {
 
 static int l_set_crouching(lua::State* L) {
     if (auto entity = get_entity(L, 1)) {
-        entity->getRigidbody().hitbox.crouching = lua::toboolean(L, 2);
+        auto& hitbox = entity->getRigidbody().hitbox;
+        hitbox.crouching = lua::toboolean(L, 2);
+        hitbox.wakeUp();
     }
     return 0;
 }
@@ -107,13 +118,13 @@ static int l_get_body_type(lua::State* L) {
 
 static int l_set_body_type(lua::State* L) {
     if (auto entity = get_entity(L, 1)) {
-        if (!BodyTypeMeta.getItem(
-                lua::tostring(L, 2), entity->getRigidbody().hitbox.type
-            )) {
+        auto& hitbox = entity->getRigidbody().hitbox;
+        if (!BodyTypeMeta.getItem(lua::tostring(L, 2), hitbox.type)) {
             throw std::runtime_error(
                 "unknown body type " + util::quote(lua::tostring(L, 2))
             );
         }
+        hitbox.wakeUp();
     }
     return 0;
 }
@@ -127,7 +138,9 @@ static int l_get_linear_damping(lua::State* L) {
 
 static int l_set_linear_damping(lua::State* L) {
     if (auto entity = get_entity(L, 1)) {
-        entity->getRigidbody().hitbox.linearDamping = lua::tonumber(L, 2);
+        auto& hitbox = entity->getRigidbody().hitbox;
+        hitbox.linearDamping = lua::tonumber(L, 2);
+        hitbox.wakeUp();
     }
     return 0;
 }
@@ -11,7 +11,9 @@ static int l_set_pos(lua::State* L) {
     if (auto entity = get_entity(L, 1)) {
         auto vec = lua::tovec3(L, 2);
         entity->getTransform().setPos(vec);
-        entity->getRigidbody().hitbox.position = vec;
+        auto& hitbox = entity->getRigidbody().hitbox;
+        hitbox.position = vec;
+        hitbox.wakeUp();
     }
     return 0;
 }
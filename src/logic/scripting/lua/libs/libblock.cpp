@@ -217,7 +217,7 @@ static int l_set_states(lua::State* L) {
     }
     int lx = x - cx * CHUNK_W;
     int lz = z - cz * CHUNK_D;
-    chunk->voxels[vox_index(lx, y, lz)].state = int2blockstate(states);
+    chunk->voxels.edit(vox_index(lx, y, lz)).state = int2blockstate(states);
     chunk->setModifiedAndUnsaved();
     return 0;
 }
@@ -268,11 +268,11 @@ static int l_set_user_bits(lua::State* L) {
     }
     int lx = x - cx * CHUNK_W;
     int lz = z - cz * CHUNK_D;
-    auto vox = &chunk->voxels[vox_index(lx, y, lz)];
+    auto vox = &chunk->voxels.edit(vox_index(lx, y, lz));
     const auto& def = content->getIndices()->blocks.require(vox->id);
     if (def.rt.extended) {
         auto origin = blocks_agent::seek_origin(chunks, {x, y, z}, def, vox->state);
-        vox = blocks_agent::get(chunks, origin.x, origin.y, origin.z);
+        vox = blocks_agent::edit(chunks, origin.x, origin.y, origin.z);
         if (vox == nullptr) {
             return 0;
         }
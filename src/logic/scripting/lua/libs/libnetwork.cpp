@@ -112,6 +112,10 @@ static int l_send(lua::State* L, network::Network& network) {
     } else if (lua::isstring(L, 2)) {
         auto string = lua::tolstring(L, 2);
         connection->send(string.data(), string.length());
+    } else if (auto bytes = lua::tobytearray(L, 2)) {
+        connection->send(
+            reinterpret_cast<const char*>(bytes->bytes), bytes->size
+        );
     } else {
         auto string = lua::bytearray_as_string(L, 2);
         connection->send(string.data(), string.length());
@@ -127,23 +131,55 @@ static int l_recv(lua::State* L, network::Network& network) {
     if (connection == nullptr) {
         return 0;
     }
-    length = glm::min(length, connection->available());
+    length = glm::max(0, glm::min(length, connection->available()));
+    if (!lua::toboolean(L, 3)) {
+        // received directly into the bytearray memory
+        auto bytes = lua::push_bytearray(L, length);
+        int size =
+            connection->recv(reinterpret_cast<char*>(bytes->bytes), length);
+        if (size == -1) {
+            lua::pop(L);
+            return 0;
+        }
+        bytes->size = size;
+        return 1;
+    }
     util::Buffer<char> buffer(length);
-    
     int size = connection->recv(buffer.data(), length);
     if (size == -1) {
         return 0;
     }
-    if (lua::toboolean(L, 3)) {
-        lua::createtable(L, size, 0);
-        for (size_t i = 0; i < size; i++) {
-            lua::pushinteger(L, buffer[i] & 0xFF);
-            lua::rawseti(L, i+1);
-        }
-        return 1;
-    } else {
-        return lua::create_bytearray(L, buffer.data(), size);
+    lua::createtable(L, size, 0);
+    for (size_t i = 0; i < size; i++) {
+        lua::pushinteger(L, buffer[i] & 0xFF);
+        lua::rawseti(L, i+1);
+    }
+    return 1;
+}
+
+/// @brief Replace Bytearray contents with received data reusing its memory.
+/// Capacity is reserved by the caller (see Socket.recv_into)
+static int l_recv_into(lua::State* L, network::Network& network) {
+    u64id_t id = lua::tointeger(L, 1);
+    auto bytes = lua::tobytearray(L, 2);
+    if (bytes == nullptr) {
+        throw std::runtime_error("Bytearray expected");
+    }
+    auto connection = network.getConnection(id);
+    if (connection == nullptr) {
+        return 0;
+    }
+    int length = glm::min(bytes->capacity, connection->available());
+    if (lua::isnumber(L, 3)) {
+        length = glm::max<int>(0, glm::min<int>(length, lua::tointeger(L, 3)));
+    }
+    int size =
+        connection->recv(reinterpret_cast<char*>(bytes->bytes), length);
+    if (size == -1) {
+        return 0;
     }
+    bytes->size = size;
+    return lua::pushinteger(L, size);
 }
 
 static int l_available(lua::State* L, network::Network& network) {
@@ -252,6 +288,7 @@ const luaL_Reg networklib[] = {
     {"__close", wrap<l_close>},
     {"__send", wrap<l_send>},
     {"__recv", wrap<l_recv>},
+    {"__recv_into", wrap<l_recv_into>},
     {"__available", wrap<l_available>},
     {"__is_alive", wrap<l_is_alive>},
     {"__is_connected", wrap<l_is_connected>},
@@ -13,14 +13,18 @@
 #include "io/engine_paths.hpp"
 #include "io/io.hpp"
 #include "lighting/Lighting.hpp"
+#include "objects/Player.hpp"
+#include "objects/Players.hpp"
 #include "voxels/Chunk.hpp"
 #include "voxels/Chunks.hpp"
 #include "voxels/GlobalChunks.hpp"
+#include "voxels/blocks_agent.hpp"
 #include "voxels/compressed_chunks.hpp"
 #include "world/Level.hpp"
 #include "world/World.hpp"
 #include "logic/LevelController.hpp"
 #include "logic/ChunksController.hpp"
+#include "logic/ChunksLoader.hpp"
 
 using namespace scripting;
 namespace fs = std::filesystem;
@@ -128,33 +132,89 @@ static int l_get_generator(lua::State* L) {
 static int l_get_chunk_data(lua::State* L) {
     int x = static_cast<int>(lua::tointeger(L, 1));
     int z = static_cast<int>(lua::tointeger(L, 2));
-    const auto& chunk = level->chunks->getChunk(x, z);
+    bool lights = lua::toboolean(L, 3);
+    bool stored = lua::toboolean(L, 4);
+    auto chunk = level->chunks->getChunk(x, z);
+
+    auto chunkData = compressed_chunks::encode(
+        x, z, chunk, level->getWorld()->wfile->getRegions(), lights, stored
+    );
+    if (chunkData.empty()) {
+        return 0;
+    }
+    return lua::create_bytearray(L, std::move(chunkData));
+}
 
-    std::vector<ubyte> chunkData;
+static int l_get_chunk_changes(lua::State* L) {
+    int x = static_cast<int>(lua::tointeger(L, 1));
+    int z = static_cast<int>(lua::tointeger(L, 2));
+    if (!lua::istable(L, 3)) {
+        throw std::runtime_error("table expected");
+    }
+    auto chunk = level->chunks->getChunk(x, z);
     if (chunk == nullptr) {
-        auto& regions = level->getWorld()->wfile->getRegions();
-        auto voxelData = regions.getVoxels(x, z);
-        if (voxelData == nullptr) {
-            return 0;
+        return 0;
+    }
+    std::vector<uint> changed;
+    lua::pushvalue(L, 3);
+    size_t length = lua::objlen(L, -1);
+    for (size_t i = 0; i + 3 <= length; i += 3) {
+        int coords[3];
+        for (int j = 0; j < 3; j++) {
+            lua::rawgeti(L, i + j + 1);
+            coords[j] = lua::tointeger(L, -1);
+            lua::pop(L);
+        }
+        int lx = coords[0] - x * CHUNK_W;
+        int ly = coords[1];
+        int lz = coords[2] - z * CHUNK_D;
+        if (lx < 0 || ly < 0 || lz < 0 || lx >= CHUNK_W || ly >= CHUNK_H ||
+            lz >= CHUNK_D) {
+            continue;
+        }
+        changed.push_back(vox_index(lx, ly, lz));
+    }
+    lua::pop(L);
+    return lua::create_bytearray(
+        L, compressed_chunks::encode_changes(*chunk, changed)
+    );
+}
+
+/// @brief Set changed blocks updating lights as block.set does.
+/// Nothing is changed if the batch is invalid
+static void apply_changes(
+    const Chunk& chunk,
+    const std::vector<compressed_chunks::VoxelChange>& changes
+) {
+    compressed_chunks::check_changes(changes, *indices);
+
+    auto chunksController = controller->getChunksController();
+    for (const auto& change : changes) {
+        blockid_t id = change.vox.id;
+        int x = chunk.x * CHUNK_W + change.index % CHUNK_W;
+        int y = change.index / (CHUNK_W * CHUNK_D);
+        int z = chunk.z * CHUNK_D + change.index / CHUNK_W % CHUNK_D;
+        blocks_agent::set(*level->chunks, x, y, z, id, change.vox.state);
+        if (chunksController && chunksController->lighting) {
+            chunksController->lighting->onBlockSet(x, y, z, id);
         }
-        static util::Buffer<ubyte> rleBuffer(CHUNK_DATA_LEN * 2);
-        auto metadata = regions.getBlocksData(x, z);
-        chunkData =
-            compressed_chunks::encode(voxelData.get(), metadata, rleBuffer);
-    } else {
-        chunkData = compressed_chunks::encode(*chunk);
     }
-    return lua::create_bytearray(L, std::move(chunkData));
 }
 
 static void integrate_chunk_client(Chunk& chunk) {
     int x = chunk.x;
     int z = chunk.z;
 
-    chunk.flags.loadedLights = false;
     chunk.flags.lighted = false;
-    chunk.lightmap.clear();
-    Lighting::prebuildSkyLight(chunk, *indices);
+    // lights are not passed with chunk data or are outdated
+    if (!chunk.flags.loadedLights) {
+        chunk.lightmap.clear();
+        Lighting::prebuildSkyLight(chunk, *indices);
+    }
+    // chunk needs to be lighted again
+    for (const auto& [_, player] : *level->players) {
+        player->chunks->getLoadQueue().reset();
+    }
 
     for (int lz = -1; lz <= 1; lz++) {
         for (int lx = -1; lx <= 1; lx++) {
@@ -181,11 +241,15 @@ static int l_set_chunk_data(lua::State* L) {
     if (chunk == nullptr) {
         return lua::pushboolean(L, false);
     }
+    auto data = reinterpret_cast<const ubyte*>(buffer.data());
+    if (compressed_chunks::is_changes(data, buffer.size())) {
+        apply_changes(
+            *chunk, compressed_chunks::decode_changes(data, buffer.size())
+        );
+        return lua::pushboolean(L, true);
+    }
     compressed_chunks::decode(
-        *chunk,
-        reinterpret_cast<const ubyte*>(buffer.data()),
-        buffer.size(),
-        *content->getIndices()
+        *chunk, data, buffer.size(), *content->getIndices()
     );
     if (controller->getChunksController()->lighting == nullptr) {
         return lua::pushboolean(L, true);
@@ -210,7 +274,8 @@ static int l_save_chunk_data(lua::State* L) {
             reinterpret_cast<const ubyte*>(buffer.data()),
             reinterpret_cast<const ubyte*>(buffer.data()) + buffer.size()
         ),
-        level->getWorld()->wfile->getRegions()
+        level->getWorld()->wfile->getRegions(),
+        *indices
     );
     return 0;
 }
@@ -222,6 +287,80 @@ static int l_count_chunks(lua::State* L) {
     return lua::pushinteger(L, level->chunks->size());
 }
 
+static int l_get_save_stats(lua::State* L) {
+    if (level == nullptr) {
+        throw std::runtime_error("no open world");
+    }
+    auto stats = level->getWorld()->wfile->getRegions().getSaveStats();
+    double workTime = stats.workTime / 1e6;
+
+    lua::createtable(L, 0, 7);
+    lua::pushinteger(L, stats.chunksWritten);
+    lua::setfield(L, "chunks_written");
+    lua::pushinteger(L, stats.bytesWritten);
+    lua::setfield(L, "bytes_written");
+    lua::pushnumber(
+        L, workTime > 0.0 ? stats.chunksWritten / workTime : 0.0
+    );
+    lua::setfield(L, "chunks_per_second");
+    lua::pushnumber(L, workTime);
+    lua::setfield(L, "work_time");
+    lua::pushnumber(L, stats.stallTime / 1e6);
+    lua::setfield(L, "stall_time");
+    lua::pushinteger(L, stats.queuedTasks);
+    lua::setfield(L, "queued_tasks");
+    lua::pushinteger(L, stats.queuedBytes);
+    lua::setfield(L, "queued_bytes");
+    return 1;
+}
+
+static int l_get_chunks_stats(lua::State* L) {
+    if (controller == nullptr) {
+        throw std::runtime_error("no open world");
+    }
+    constexpr int STAGES_COUNT = static_cast<int>(ChunkLoadStage::COUNT);
+    static const char* STAGE_NAMES[STAGES_COUNT] = {
+        "read", "decode", "generate", "skylight", "install"
+    };
+    auto chunksController = controller->getChunksController();
+    auto stats = chunksController->getLoaderStats();
+
+    lua::createtable(L, 0, 4);
+    lua::pushinteger(L, stats.pending);
+    lua::setfield(L, "pending");
+    lua::pushinteger(L, stats.ready);
+    lua::setfield(L, "ready");
+
+    lua::createtable(L, 0, STAGES_COUNT);
+    for (int i = 0; i < STAGES_COUNT; i++) {
+        const auto& stage = stats.stages[i];
+        lua::createtable(L, 0, 3);
+        lua::pushinteger(L, stage.count);
+        lua::setfield(L, "count");
+        lua::pushnumber(L, stage.totalTime / 1e6);
+        lua::setfield(L, "total_time");
+        lua::pushnumber(L, stage.maxTime / 1e6);
+        lua::setfield(L, "max_time");
+        lua::setfield(L, STAGE_NAMES[i]);
+    }
+    lua::setfield(L, "stages");
+
+    if (lua::isnumber(L, 1)) {
+        auto demand = chunksController->getDemandStats(lua::tointeger(L, 1));
+        lua::createtable(L, 0, 4);
+        lua::pushinteger(L, demand.requested);
+        lua::setfield(L, "requested");
+        lua::pushinteger(L, demand.lighted);
+        lua::setfield(L, "lighted");
+        lua::pushinteger(L, demand.limitedTicks);
+        lua::setfield(L, "limited_ticks");
+        lua::pushboolean(L, demand.deferred);
+        lua::setfield(L, "deferred");
+        lua::setfield(L, "demand");
+    }
+    return 1;
+}
+
 static int l_reload_script(lua::State* L) {
     auto packid = lua::require_string(L, 1);
     if (content == nullptr) {
@@ -247,9 +386,12 @@ const luaL_Reg worldlib[] = {
     {"is_night", lua::wrap<l_is_night>},
     {"exists", lua::wrap<l_exists>},
     {"get_chunk_data", lua::wrap<l_get_chunk_data>},
+    {"get_chunk_changes", lua::wrap<l_get_chunk_changes>},
     {"set_chunk_data", lua::wrap<l_set_chunk_data>},
     {"save_chunk_data", lua::wrap<l_save_chunk_data>},
     {"count_chunks", lua::wrap<l_count_chunks>},
+    {"get_save_stats", lua::wrap<l_get_save_stats>},
+    {"get_chunks_stats", lua::wrap<l_get_chunks_stats>},
     {"reload_script", lua::wrap<l_reload_script>},
     {NULL, NULL}
 };
@@ -7,6 +7,7 @@
 
 struct fnl_state;
 class Heightmap;
+class HeightmapExpression;
 class VoxelFragment;
 class Texture;
 class ImageData;
@@ -54,6 +55,38 @@ namespace lua {
     };
     static_assert(!std::is_abstract<LuaHeightmap>());
 
+    class LuaHeightmapExpr : public Userdata {
+        std::shared_ptr<const HeightmapExpression> expr;
+        int noiseSeed;
+    public:
+        LuaHeightmapExpr(
+            std::shared_ptr<const HeightmapExpression> expr, int noiseSeed
+        );
+
+        virtual ~LuaHeightmapExpr();
+
+        const std::string& getTypeName() const override {
+            return TYPENAME;
+        }
+
+        const std::shared_ptr<const HeightmapExpression>& getExpression(
+        ) const {
+            return expr;
+        }
+
+        int getNoiseSeed() const {
+            return noiseSeed;
+        }
+
+        void setNoiseSeed(int seed) {
+            noiseSeed = seed;
+        }
+
+        static int createMetatable(lua::State*);
+        inline static std::string TYPENAME = "HeightmapExpr";
+    };
+    static_assert(!std::is_abstract<LuaHeightmapExpr>());
+
     class LuaVoxelFragment : public Userdata {
         std::shared_ptr<VoxelFragment> fragment;
     public:
@@ -2,6 +2,7 @@
 
 #include <iomanip>
 #include <iostream>
+#include <unordered_map>
 
 #include "io/io.hpp"
 #include "io/engine_paths.hpp"
@@ -13,6 +14,8 @@
 
 static debug::Logger logger("lua-state");
 static lua::State* main_thread = nullptr;
+/// @brief Registry references of event handlers lists by event names
+static std::unordered_map<std::string, int> event_handles;
 
 using namespace lua;
 
@@ -118,6 +121,7 @@ void lua::init_state(State* L, StateType stateType) {
     initialize_libs_extends(L);
 
     newusertype<LuaHeightmap>(L);
+    newusertype<LuaHeightmapExpr>(L);
     newusertype<LuaVoxelFragment>(L);
     newusertype<LuaCanvas>(L);
 }
@@ -135,6 +139,7 @@ void lua::initialize(const EnginePaths& paths, const CoreParameters& params) {
 
 void lua::finalize() {
     lua::close(main_thread);
+    event_handles.clear();
 }
 
 bool lua::emit_event(
@@ -152,6 +157,51 @@ bool lua::emit_event(
     return false;
 }
 
+int lua::get_event_handle(State* L, const std::string& name) {
+    const auto& found = event_handles.find(name);
+    if (found != event_handles.end()) {
+        return found->second;
+    }
+    requireglobal(L, "events");
+    requirefield(L, "handlers");
+    if (!getfield(L, name)) {
+        createtable(L, 0, 0);
+        pushvalue(L, -1);
+        setfield(L, name, -3);
+    }
+    int handle = luaL_ref(L, LUA_REGISTRYINDEX);
+    pop(L, 2);
+    event_handles[name] = handle;
+    return handle;
+}
+
+bool lua::emit_event(
+    State* L, int handle, const std::function<int(State*)>& args
+) {
+    if (handle == 0) {
+        return false;
+    }
+    rawgeti(L, handle, LUA_REGISTRYINDEX);
+    if (objlen(L, -1) == 0) {
+        pop(L);
+        return false;
+    }
+    int handlers = gettop(L);
+    int argc = args(L);
+    bool result = false;
+    for (int i = 1; rawgeti(L, i, handlers) && !isnil(L, -1); i++) {
+        for (int j = 1; j <= argc; j++) {
+            pushvalue(L, handlers + j);
+        }
+        if (int added = call_nothrow(L, argc)) {
+            result = result || toboolean(L, -added);
+            pop(L, added);
+        }
+    }
+    pop(L, argc + 2);
+    return result;
+}
+
 State* lua::get_main_state() {
     return main_thread;
 }
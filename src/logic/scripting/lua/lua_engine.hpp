@@ -25,6 +25,18 @@ namespace lua {
         const std::string& name,
         std::function<int(State*)> args = [](auto*) { return 0; }
     );
+
+    /// @brief Get handle of the event handlers list to emit the event
+    /// without the name lookup. Handles are valid until the state is closed
+    int get_event_handle(State* L, const std::string& name);
+
+    /// @brief Call event handlers found by handle (see get_event_handle)
+    /// the way events.emit does. Handle 0 is ignored
+    bool emit_event(
+        State* L,
+        int handle,
+        const std::function<int(State*)>& args = [](auto*) { return 0; }
+    );
     State* get_main_state();
     State* create_state(const EnginePaths& paths, StateType stateType);
     [[nodiscard]] scriptenv create_environment(State* L);
@@ -758,6 +758,51 @@ namespace lua {
         return create_bytearray(L, bytes.data(), bytes.size());
     }
 
+    /// @brief Memory layout of the FFI bytearray_t (core:internal/bytearray)
+    struct Bytearray {
+        ubyte* bytes;
+        int size;
+        int capacity;
+    };
+
+    /// @brief Access Bytearray contents in place, without copying.
+    /// The pointer is valid while the value is on the stack and is not
+    /// resized.
+    /// @return nullptr if the value is not a Bytearray
+    inline Bytearray* tobytearray(lua::State* L, int idx) {
+        // LuaJIT cdata type, not declared in lua.h
+        constexpr int CDATA_TYPE = 10;
+        if (lua_type(L, idx) != CDATA_TYPE) {
+            return nullptr;
+        }
+        if (idx < 0) {
+            idx = lua::gettop(L) + idx + 1;
+        }
+        lua::requireglobal(L, "Bytearray_is");
+        lua::pushvalue(L, idx);
+        lua::call(L, 1, 1);
+        bool valid = lua::toboolean(L, -1);
+        lua::pop(L);
+        if (!valid) {
+            return nullptr;
+        }
+        // LuaJIT returns cdata payload address
+        return reinterpret_cast<Bytearray*>(
+            const_cast<void*>(lua::topointer(L, idx))
+        );
+    }
+
+    /// @brief Push new Bytearray of the given size with uninitialized
+    /// contents to be filled in place
+    inline Bytearray* push_bytearray(lua::State* L, size_t size) {
+        lua::requireglobal(L, "Bytearray_construct");
+        lua::pushinteger(L, size);
+        lua::call(L, 1, 1);
+        return reinterpret_cast<Bytearray*>(
+            const_cast<void*>(lua::topointer(L, -1))
+        );
+    }
+
     inline std::string_view bytearray_as_string(lua::State* L, int idx) {
         lua::requireglobal(L, "Bytearray_as_string");
         lua::pushvalue(L, idx);
@@ -4,10 +4,10 @@
 #include <sstream>
 #include <iomanip>
 #include <filesystem>
+#include <vector>
 
-#include "util/functional_util.hpp"
-#define FNL_IMPL
 #include "maths/FastNoiseLite.h"
+#include "maths/heightmap_kernels.hpp"
 #include "coders/imageio.hpp"
 #include "io/util.hpp"
 #include "graphics/core/ImageData.hpp"
@@ -109,24 +109,37 @@ static int l_noise(lua::State* L) {
             shiftMapY = touserdata<LuaHeightmap>(L, 7);
         }
         noise->noise_type = noise_type;
-        for (uint y = 0; y < h; y++) {
-            for (uint x = 0; x < w; x++) {
-                uint i = y * w + x;
-                for (uint c = 0; c < octaves; c++) {
-                    float m = s * (1 << c);
-                    float value = heights[i];
-                    float u = (x + offset.x) * m;
-                    float v = (y + offset.y) * m;
-                    if (shiftMapX) {
-                        u += shiftMapX->getValues()[i];
+        // noise is evaluated by rows
+        std::vector<float> us(w);
+        std::vector<float> vs(w);
+        std::vector<float> values(w);
+        for (uint c = 0; c < octaves; c++) {
+            float m = s * (1 << c);
+            float octaveDivider = static_cast<float>(1 << c);
+            for (uint y = 0; y < h; y++) {
+                uint row = y * w;
+                for (uint x = 0; x < w; x++) {
+                    us[x] = (x + offset.x) * m;
+                    vs[x] = (y + offset.y) * m;
+                }
+                if (shiftMapX) {
+                    const float* shifts = shiftMapX->getValues() + row;
+                    for (uint x = 0; x < w; x++) {
+                        us[x] += shifts[x];
                     }
-                    if (shiftMapY) {
-                        v += shiftMapY->getValues()[i];
+                }
+                if (shiftMapY) {
+                    const float* shifts = shiftMapY->getValues() + row;
+                    for (uint x = 0; x < w; x++) {
+                        vs[x] += shifts[x];
                     }
-
-                    value += fnlGetNoise2D(noise, u, v) /
-                            static_cast<float>(1 << c) * multiplier;
-                    heights[i] = value;
+                }
+                heightmap_kernels::noise(
+                    *noise, us.data(), vs.data(), values.data(), w
+                );
+                for (uint x = 0; x < w; x++) {
+                    heights[row + x] +=
+                        values[x] / octaveDivider * multiplier;
                 }
             }
         }
@@ -134,9 +147,8 @@ static int l_noise(lua::State* L) {
     return 0;
 }
 
-template<template<class> class Op>
+template<heightmap_kernels::BinaryOp op>
 static int l_binop_func(lua::State* L) {
-    Op<float> op;
     if (auto heightmap = touserdata<LuaHeightmap>(L, 1)) {
         uint w = heightmap->getWidth();
         uint h = heightmap->getHeight();
@@ -144,20 +156,10 @@ static int l_binop_func(lua::State* L) {
 
         if (isnumber(L, 2)) {
             float scalar = tonumber(L, 2);
-            for (uint y = 0; y < h; y++) {
-                for (uint x = 0; x < w; x++) {
-                    uint i = y * w + x;
-                    heights[i] = op(heights[i], scalar);
-                }
-            }
+            heightmap_kernels::apply(op, heights, scalar, w * h);
         } else {
             auto map = touserdata<LuaHeightmap>(L, 2);
-            for (uint y = 0; y < h; y++) {
-                for (uint x = 0; x < w; x++) {
-                    uint i = y * w + x;
-                    heights[i] = op(heights[i], map->getValues()[i]);
-                }
-            }
+            heightmap_kernels::apply(op, heights, map->getValues(), w * h);
         }
     }
     return 0;
@@ -173,51 +175,35 @@ static int l_mixin(lua::State* L) {
             float scalar = tonumber(L, 2);
             if (isnumber(L, 3)) {
                 float t = tonumber(L, 3);
-                for (uint i = 0; i < w * h; i++) {
-                    heights[i] = heights[i] * (1.0f - t) + scalar * t;
-                }
+                heightmap_kernels::mix(heights, scalar, t, w * h);
             } else {
                 auto tmap = touserdata<LuaHeightmap>(L, 3);
-                auto tmapvalues = tmap->getValues();
-                for (uint i = 0; i < w * h; i++) {
-                    float t = tmapvalues[i];
-                    heights[i] = heights[i] * (1.0f - t) + scalar * t;
-                }
+                heightmap_kernels::mix(
+                    heights, scalar, tmap->getValues(), w * h
+                );
             }
         } else {
             auto map = touserdata<LuaHeightmap>(L, 2);
             auto mapvalues = map->getValues();
             if (isnumber(L, 3)) {
                 float t = tonumber(L, 3);
-                for (uint i = 0; i < w * h; i++) {
-                    heights[i] = heights[i] * (1.0f - t) + mapvalues[i] * t;
-                }
+                heightmap_kernels::mix(heights, mapvalues, t, w * h);
             } else {
                 auto tmap = touserdata<LuaHeightmap>(L, 3);
-                auto tmapvalues = tmap->getValues();
-                for (uint i = 0; i < w * h; i++) {
-                    float t = tmapvalues[i];
-                    heights[i] = heights[i] * (1.0f - t) + mapvalues[i] * t;
-                }
+                heightmap_kernels::mix(
+                    heights, mapvalues, tmap->getValues(), w * h
+                );
             }
         }
     }
     return 0;
 }
 
-template<template<class> class Op>
-static int l_unaryop_func(lua::State* L) {
-    Op<float> op;
+static int l_abs(lua::State* L) {
     if (auto heightmap = touserdata<LuaHeightmap>(L, 1)) {
         uint w = heightmap->getWidth();
         uint h = heightmap->getHeight();
-        auto heights = heightmap->getValues();
-        for (uint y = 0; y < h; y++) {
-            for (uint x = 0; x < w; x++) {
-                uint i = y * w + x;
-                heights[i] = op(heights[i]);
-            }
-        }
+        heightmap_kernels::abs(heightmap->getValues(), w * h);
     }
     return 0;
 }
@@ -255,13 +241,13 @@ static std::unordered_map<std::string, lua_CFunction> methods {
     {"dump", lua::wrap<l_dump>},
     {"noise", lua::wrap<l_noise<FNL_NOISE_OPENSIMPLEX2>>},
     {"cellnoise", lua::wrap<l_noise<FNL_NOISE_CELLULAR>>},
-    {"pow", lua::wrap<l_binop_func<util::pow>>},
-    {"add", lua::wrap<l_binop_func<std::plus>>},
-    {"sub", lua::wrap<l_binop_func<std::minus>>},
-    {"mul", lua::wrap<l_binop_func<std::multiplies>>},
-    {"min", lua::wrap<l_binop_func<util::min>>},
-    {"max", lua::wrap<l_binop_func<util::max>>},
-    {"abs", lua::wrap<l_unaryop_func<util::abs>>},
+    {"pow", lua::wrap<l_binop_func<heightmap_kernels::BinaryOp::POW>>},
+    {"add", lua::wrap<l_binop_func<heightmap_kernels::BinaryOp::ADD>>},
+    {"sub", lua::wrap<l_binop_func<heightmap_kernels::BinaryOp::SUB>>},
+    {"mul", lua::wrap<l_binop_func<heightmap_kernels::BinaryOp::MUL>>},
+    {"min", lua::wrap<l_binop_func<heightmap_kernels::BinaryOp::MIN>>},
+    {"max", lua::wrap<l_binop_func<heightmap_kernels::BinaryOp::MAX>>},
+    {"abs", lua::wrap<l_abs>},
     {"resize", lua::wrap<l_resize>},
     {"crop", lua::wrap<l_crop>},
     {"at", lua::wrap<l_at>},
@@ -0,0 +1,228 @@
+#include "../lua_custom_types.hpp"
+
+#include <cstring>
+#include <sstream>
+
+#include "maths/FastNoiseLite.h"
+#include "maths/Heightmap.hpp"
+#include "maths/HeightmapExpression.hpp"
+#include "../lua_util.hpp"
+
+using namespace lua;
+using heightmap_kernels::BinaryOp;
+
+LuaHeightmapExpr::LuaHeightmapExpr(
+    std::shared_ptr<const HeightmapExpression> expr, int noiseSeed
+)
+    : expr(std::move(expr)), noiseSeed(noiseSeed) {
+}
+
+LuaHeightmapExpr::~LuaHeightmapExpr() {
+}
+
+/// @brief Default seed of the FastNoiseLite state
+static int default_noise_seed() {
+    return fnlCreateState().seed;
+}
+
+/// @brief Convert number, Heightmap or HeightmapExpr to an expression
+static HeightmapExpression::Ptr to_expression(lua::State* L, int idx) {
+    if (isnumber(L, idx)) {
+        return HeightmapExpression::value(tonumber(L, idx));
+    }
+    if (auto expr = touserdata<LuaHeightmapExpr>(L, idx)) {
+        return expr->getExpression();
+    }
+    if (auto heightmap = touserdata<LuaHeightmap>(L, idx)) {
+        return HeightmapExpression::map(heightmap->getHeightmap());
+    }
+    throw std::runtime_error(
+        "number, Heightmap or HeightmapExpr expected as argument #" +
+        std::to_string(idx)
+    );
+}
+
+static int push_expression(
+    lua::State* L, HeightmapExpression::Ptr expr, int noiseSeed
+) {
+    return newuserdata<LuaHeightmapExpr>(L, std::move(expr), noiseSeed);
+}
+
+static int l_eval(lua::State* L) {
+    if (auto expr = touserdata<LuaHeightmapExpr>(L, 1)) {
+        auto width = tointeger(L, 2);
+        auto height = tointeger(L, 3);
+        if (width <= 0 || height <= 0) {
+            throw std::runtime_error(
+                "width and height must be greather than 0"
+            );
+        }
+        auto map = std::make_shared<Heightmap>(width, height);
+        expr->getExpression()->evaluate(*map);
+
+        newuserdata<LuaHeightmap>(L, map);
+        touserdata<LuaHeightmap>(L, -1)->setSeed(expr->getNoiseSeed());
+        return 1;
+    }
+    return 0;
+}
+
+template<fnl_noise_type noise_type>
+static int l_noise(lua::State* L) {
+    if (auto expr = touserdata<LuaHeightmapExpr>(L, 1)) {
+        HeightmapNoiseParams params;
+        params.type = noise_type;
+        params.seed = expr->getNoiseSeed();
+        params.offset = tovec<2>(L, 2);
+        params.scale = tonumber(L, 3);
+        if (gettop(L) > 3) {
+            params.octaves = tointeger(L, 4);
+        }
+        if (gettop(L) > 4) {
+            params.multiplier = tonumber(L, 5);
+        }
+        HeightmapExpression::Ptr shiftX;
+        HeightmapExpression::Ptr shiftY;
+        if (gettop(L) > 5 && !isnil(L, 6)) {
+            shiftX = to_expression(L, 6);
+        }
+        if (gettop(L) > 6 && !isnil(L, 7)) {
+            shiftY = to_expression(L, 7);
+        }
+        return push_expression(
+            L,
+            HeightmapExpression::noise(
+                expr->getExpression(), params, shiftX, shiftY
+            ),
+            expr->getNoiseSeed()
+        );
+    }
+    return 0;
+}
+
+template<BinaryOp op>
+static int l_binop_func(lua::State* L) {
+    if (auto expr = touserdata<LuaHeightmapExpr>(L, 1)) {
+        return push_expression(
+            L,
+            HeightmapExpression::binary(
+                op, expr->getExpression(), to_expression(L, 2)
+            ),
+            expr->getNoiseSeed()
+        );
+    }
+    return 0;
+}
+
+static int l_abs(lua::State* L) {
+    if (auto expr = touserdata<LuaHeightmapExpr>(L, 1)) {
+        return push_expression(
+            L,
+            HeightmapExpression::abs(expr->getExpression()),
+            expr->getNoiseSeed()
+        );
+    }
+    return 0;
+}
+
+static int l_mixin(lua::State* L) {
+    if (auto expr = touserdata<LuaHeightmapExpr>(L, 1)) {
+        return push_expression(
+            L,
+            HeightmapExpression::mix(
+                expr->getExpression(),
+                to_expression(L, 2),
+                to_expression(L, 3)
+            ),
+            expr->getNoiseSeed()
+        );
+    }
+    return 0;
+}
+
+static std::unordered_map<std::string, lua_CFunction> methods {
+    {"eval", lua::wrap<l_eval>},
+    {"noise", lua::wrap<l_noise<FNL_NOISE_OPENSIMPLEX2>>},
+    {"cellnoise", lua::wrap<l_noise<FNL_NOISE_CELLULAR>>},
+    {"pow", lua::wrap<l_binop_func<BinaryOp::POW>>},
+    {"add", lua::wrap<l_binop_func<BinaryOp::ADD>>},
+    {"sub", lua::wrap<l_binop_func<BinaryOp::SUB>>},
+    {"mul", lua::wrap<l_binop_func<BinaryOp::MUL>>},
+    {"min", lua::wrap<l_binop_func<BinaryOp::MIN>>},
+    {"max", lua::wrap<l_binop_func<BinaryOp::MAX>>},
+    {"abs", lua::wrap<l_abs>},
+    {"mixin", lua::wrap<l_mixin>},
+};
+
+static int l_meta_meta_call(lua::State* L) {
+    if (gettop(L) < 2 || isnil(L, 2)) {
+        return push_expression(
+            L, HeightmapExpression::value(0.0f), default_noise_seed()
+        );
+    }
+    int noiseSeed = default_noise_seed();
+    if (auto heightmap = touserdata<LuaHeightmap>(L, 2)) {
+        noiseSeed = heightmap->getNoise()->seed;
+    }
+    return push_expression(L, to_expression(L, 2), noiseSeed);
+}
+
+static int l_meta_index(lua::State* L) {
+    auto expr = touserdata<LuaHeightmapExpr>(L, 1);
+    if (expr == nullptr) {
+        return 0;
+    }
+    if (isstring(L, 2)) {
+        auto fieldname = tostring(L, 2);
+        if (!std::strcmp(fieldname, "noiseSeed")) {
+            return pushinteger(L, expr->getNoiseSeed());
+        } else {
+            auto found = methods.find(fieldname);
+            if (found != methods.end()) {
+                return pushcfunction(L, found->second);
+            }
+        }
+    }
+    return 0;
+}
+
+static int l_meta_newindex(lua::State* L) {
+    auto expr = touserdata<LuaHeightmapExpr>(L, 1);
+    if (expr == nullptr) {
+        return 0;
+    }
+    if (isstring(L, 2)) {
+        auto fieldname = tostring(L, 2);
+        if (!std::strcmp(fieldname, "noiseSeed")) {
+            expr->setNoiseSeed(tointeger(L, 3));
+        }
+    }
+    return 0;
+}
+
+static int l_meta_tostring(lua::State* L) {
+    auto expr = touserdata<LuaHeightmapExpr>(L, 1);
+    if (expr == nullptr) {
+        return 0;
+    }
+
+    std::stringstream stream;
+    stream << std::hex << reinterpret_cast<ptrdiff_t>(expr);
+    return pushstring(L, "HeightmapExpr(at 0x" + stream.str() + ")");
+}
+
+int LuaHeightmapExpr::createMetatable(lua::State* L) {
+    createtable(L, 0, 3);
+    pushcfunction(L, lua::wrap<l_meta_tostring>);
+    setfield(L, "__tostring");
+    pushcfunction(L, lua::wrap<l_meta_index>);
+    setfield(L, "__index");
+    pushcfunction(L, lua::wrap<l_meta_newindex>);
+    setfield(L, "__newindex");
+
+    createtable(L, 0, 1);
+    pushcfunction(L, lua::wrap<l_meta_meta_call>);
+    setfield(L, "__call");
+    setmetatable(L);
+    return 1;
+}
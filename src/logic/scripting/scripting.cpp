@@ -329,45 +329,64 @@ void scripting::cleanup() {
 }
 
 void scripting::on_blocks_tick(const Block& block, int tps) {
-    std::string name = block.name + ".blockstick";
-    lua::emit_event(lua::get_main_state(), name, [tps](auto L) {
-        return lua::pushinteger(L, tps);
-    });
+    lua::emit_event(
+        lua::get_main_state(),
+        block.rt.funcsset.events.blockstick,
+        [tps](auto L) { return lua::pushinteger(L, tps); }
+    );
 }
 
 void scripting::update_block(const Block& block, const glm::ivec3& pos) {
-    std::string name = block.name + ".update";
-    lua::emit_event(lua::get_main_state(), name, [pos](auto L) {
-        return lua::pushivec_stack(L, pos);
-    });
+    lua::emit_event(
+        lua::get_main_state(),
+        block.rt.funcsset.events.update,
+        [pos](auto L) { return lua::pushivec_stack(L, pos); }
+    );
 }
 
 void scripting::random_update_block(const Block& block, const glm::ivec3& pos) {
-    std::string name = block.name + ".randupdate";
-    lua::emit_event(lua::get_main_state(), name, [pos](auto L) {
-        return lua::pushivec_stack(L, pos);
-    });
+    lua::emit_event(
+        lua::get_main_state(),
+        block.rt.funcsset.events.randupdate,
+        [pos](auto L) { return lua::pushivec_stack(L, pos); }
+    );
 }
 
-/// TODO: replace template with index
-template<bool WorldFuncsSet::*worldfunc>
+void scripting::random_update_blocks(
+    const Block& block, const std::vector<glm::ivec3>& positions
+) {
+    lua::emit_event(
+        lua::get_main_state(),
+        block.rt.funcsset.events.blocksrandupdate,
+        [&positions](auto L) {
+            // flat array of x, y, z: a single preallocated table per block
+            // type is cheaper to index in scripts than bytearray decoding
+            lua::createtable(L, positions.size() * 3, 0);
+            for (size_t i = 0; i < positions.size(); i++) {
+                for (int j = 0; j < 3; j++) {
+                    lua::pushinteger(L, positions[i][j]);
+                    lua::rawseti(L, i * 3 + j + 1);
+                }
+            }
+            return 1;
+        }
+    );
+}
+
+template <
+    int BlockEventHandles::*blockevent,
+    int WorldBlockEventHandles::*worldevent>
 static bool on_block_common(
-    const std::string& suffix,
-    bool blockfunc,
-    Player* player,
-    const Block& block,
-    const glm::ivec3& pos
+    Player* player, const Block& block, const glm::ivec3& pos
 ) {
-    bool result = false;
-    if (blockfunc) {
-        std::string name = block.name + "." + suffix;
-        result =
-            lua::emit_event(lua::get_main_state(), name, [pos, player](auto L) {
-                lua::pushivec_stack(L, pos);
-                lua::pushinteger(L, player ? player->getId() : -1);
-                return 4;
-            });
-    }
+    auto L = lua::get_main_state();
+    bool result = lua::emit_event(
+        L, block.rt.funcsset.events.*blockevent, [pos, player](auto L) {
+            lua::pushivec_stack(L, pos);
+            lua::pushinteger(L, player ? player->getId() : -1);
+            return 4;
+        }
+    );
     auto args = [&](lua::State* L) {
         lua::pushinteger(L, block.rt.id);
         lua::pushivec_stack(L, pos);
@@ -375,11 +394,7 @@ static bool on_block_common(
         return 5;
     };
     for (auto& [packid, pack] : content->getPacks()) {
-        if (pack->worldfuncsset.*worldfunc) {
-            lua::emit_event(
-                lua::get_main_state(), packid + ":.block" + suffix, args
-            );
-        }
+        lua::emit_event(L, pack->worldfuncsset.blockevents.*worldevent, args);
     }
     return result;
 }
@@ -387,41 +402,41 @@ static bool on_block_common(
 void scripting::on_block_placed(
     Player* player, const Block& block, const glm::ivec3& pos
 ) {
-    on_block_common<&WorldFuncsSet::onblockplaced>(
-        "placed", block.rt.funcsset.onplaced, player, block, pos
-    );
+    on_block_common<
+        &BlockEventHandles::placed,
+        &WorldBlockEventHandles::placed>(player, block, pos);
 }
 
 void scripting::on_block_replaced(
     Player* player, const Block& block, const glm::ivec3& pos
 ) {
-    on_block_common<&WorldFuncsSet::onblockreplaced>(
-        "replaced", block.rt.funcsset.onreplaced, player, block, pos
-    );
+    on_block_common<
+        &BlockEventHandles::replaced,
+        &WorldBlockEventHandles::replaced>(player, block, pos);
 }
 
 void scripting::on_block_breaking(
     Player* player, const Block& block, const glm::ivec3& pos
 ) {
-    on_block_common<&WorldFuncsSet::onblockbreaking>(
-        "breaking", block.rt.funcsset.onbreaking, player, block, pos
-    );
+    on_block_common<
+        &BlockEventHandles::breaking,
+        &WorldBlockEventHandles::breaking>(player, block, pos);
 }
 
 void scripting::on_block_broken(
     Player* player, const Block& block, const glm::ivec3& pos
 ) {
-    on_block_common<&WorldFuncsSet::onblockbroken>(
-        "broken", block.rt.funcsset.onbroken, player, block, pos
-    );
+    on_block_common<
+        &BlockEventHandles::broken,
+        &WorldBlockEventHandles::broken>(player, block, pos);
 }
 
 bool scripting::on_block_interact(
     Player* player, const Block& block, const glm::ivec3& pos
 ) {
-    return on_block_common<&WorldFuncsSet::onblockinteract>(
-        "interact", block.rt.funcsset.oninteract, player, block, pos
-    );
+    return on_block_common<
+        &BlockEventHandles::interact,
+        &WorldBlockEventHandles::interact>(player, block, pos);
 }
 
 void scripting::on_chunk_present(const Chunk& chunk, bool loaded) {
@@ -832,6 +847,15 @@ bool scripting::register_event(
     return success;
 }
 
+/// @brief Get handle of the event registered by register_event
+/// @return 0 if the event is not registered
+static int event_handle(bool registered, const std::string& id) {
+    if (!registered) {
+        return 0;
+    }
+    return lua::get_event_handle(lua::get_main_state(), id);
+}
+
 int scripting::get_values_on_stack() {
     return lua::gettop(lua::get_main_state());
 }
@@ -851,6 +875,9 @@ void scripting::load_content_script(
     funcsset.update = register_event(env, "on_update", prefix + ".update");
     funcsset.randupdate =
         register_event(env, "on_random_update", prefix + ".randupdate");
+    funcsset.blocksrandupdate = register_event(
+        env, "on_blocks_random_update", prefix + ".blocksrandupdate"
+    );
     funcsset.onbreaking =
         register_event(env, "on_breaking", prefix + ".breaking");
     funcsset.onbroken = register_event(env, "on_broken", prefix + ".broken");
@@ -861,6 +888,20 @@ void scripting::load_content_script(
         register_event(env, "on_interact", prefix + ".interact");
     funcsset.onblockstick =
         register_event(env, "on_blocks_tick", prefix + ".blockstick");
+
+    auto& events = funcsset.events;
+    events.update = event_handle(funcsset.update, prefix + ".update");
+    events.randupdate =
+        event_handle(funcsset.randupdate, prefix + ".randupdate");
+    events.blocksrandupdate =
+        event_handle(funcsset.blocksrandupdate, prefix + ".blocksrandupdate");
+    events.placed = event_handle(funcsset.onplaced, prefix + ".placed");
+    events.replaced = event_handle(funcsset.onreplaced, prefix + ".replaced");
+    events.breaking = event_handle(funcsset.onbreaking, prefix + ".breaking");
+    events.broken = event_handle(funcsset.onbroken, prefix + ".broken");
+    events.interact = event_handle(funcsset.oninteract, prefix + ".interact");
+    events.blockstick =
+        event_handle(funcsset.onblockstick, prefix + ".blockstick");
 }
 
 void scripting::load_content_script(
@@ -928,6 +969,18 @@ void scripting::load_world_script(
         register_event(env, "on_inventory_open", prefix + ":.inventoryopen");
     funcsset.oninventoryclosed =
         register_event(env, "on_inventory_closed", prefix + ":.inventoryclosed");
+
+    auto& events = funcsset.blockevents;
+    events.placed =
+        event_handle(funcsset.onblockplaced, prefix + ":.blockplaced");
+    events.replaced =
+        event_handle(funcsset.onblockreplaced, prefix + ":.blockreplaced");
+    events.breaking =
+        event_handle(funcsset.onblockbreaking, prefix + ":.blockbreaking");
+    events.broken =
+        event_handle(funcsset.onblockbroken, prefix + ":.blockbroken");
+    events.interact =
+        event_handle(funcsset.onblockinteract, prefix + ":.blockinteract");
 }
 
 void scripting::load_layout_script(
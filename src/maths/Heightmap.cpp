@@ -5,6 +5,8 @@
 #include <stdexcept>
 #include <glm/glm.hpp>
 
+#include "heightmap_kernels.hpp"
+
 static inline float sample_at(
     const float* buffer,
     uint width,
@@ -84,6 +86,73 @@ static inline float sample_at(
     return val;
 }
 
+/// @brief Separable bicubic resize: source rows are interpolated
+/// horizontally once, then destination rows are interpolated vertically
+/// in batches. Results are identical to sampling with interpolate_bicubic.
+static void resize_cubic(
+    const float* buffer,
+    uint width,
+    uint height,
+    float* dst,
+    uint dstwidth,
+    uint dstheight
+) {
+    std::vector<uint> columns(dstwidth * 4);
+    std::vector<float> factors(dstwidth);
+    for (uint x = 0; x < dstwidth; x++) {
+        float sx = static_cast<float>(x) / dstwidth * width;
+        uint ix = static_cast<uint>(sx);
+        factors[x] = sx - ix;
+        for (int j = 0; j < 4; j++) {
+            // ix - 1 underflow is clamped to the last column as in sample_at
+            uint column = ix + j - 1;
+            columns[x * 4 + j] = column >= width ? width - 1 : column;
+        }
+    }
+    std::vector<uint> rows(dstheight * 4);
+    std::vector<float> rowFactors(dstheight);
+    std::vector<bool> usedRows(height);
+    for (uint y = 0; y < dstheight; y++) {
+        float sy = static_cast<float>(y) / dstheight * height;
+        uint iy = static_cast<uint>(sy);
+        rowFactors[y] = sy - iy;
+        for (int i = 0; i < 4; i++) {
+            uint row = iy + i - 1;
+            row = row >= height ? height - 1 : row;
+            rows[y * 4 + i] = row;
+            usedRows[row] = true;
+        }
+    }
+    // horizontally interpolated source rows
+    std::vector<float> interpolated(height * dstwidth);
+    for (uint row = 0; row < height; row++) {
+        if (!usedRows[row]) {
+            continue;
+        }
+        const float* src = buffer + row * width;
+        float* out = interpolated.data() + row * dstwidth;
+        for (uint x = 0; x < dstwidth; x++) {
+            const uint* indices = columns.data() + x * 4;
+            float p[4] {
+                src[indices[0]],
+                src[indices[1]],
+                src[indices[2]],
+                src[indices[3]],
+            };
+            out[x] = interpolate_cubic(p, factors[x]);
+        }
+    }
+    for (uint y = 0; y < dstheight; y++) {
+        const float* samples[4];
+        for (int i = 0; i < 4; i++) {
+            samples[i] = interpolated.data() + rows[y * 4 + i] * dstwidth;
+        }
+        heightmap_kernels::interpolate_cubic(
+            samples, rowFactors[y], dst + y * dstwidth, dstwidth
+        );
+    }
+}
+
 void Heightmap::resize(
     uint dstwidth, uint dstheight, InterpolationType interp
 ) {
@@ -93,6 +162,15 @@ void Heightmap::resize(
     std::vector<float> dst;
     dst.resize(dstwidth*dstheight);
 
+    if (interp == InterpolationType::CUBIC) {
+        resize_cubic(
+            buffer.data(), width, height, dst.data(), dstwidth, dstheight
+        );
+        width = dstwidth;
+        height = dstheight;
+        buffer = std::move(dst);
+        return;
+    }
     uint index = 0;
     for (uint y = 0; y < dstheight; y++) {
         for (uint x = 0; x < dstwidth; x++, index++) {
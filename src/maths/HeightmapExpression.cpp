@@ -0,0 +1,254 @@
+#include "HeightmapExpression.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "Heightmap.hpp"
+
+using namespace heightmap_kernels;
+using Ptr = HeightmapExpression::Ptr;
+
+Ptr HeightmapExpression::value(float value) {
+    auto expr = new HeightmapExpression(Type::VALUE);
+    expr->constant = value;
+    return Ptr(expr);
+}
+
+Ptr HeightmapExpression::map(std::shared_ptr<const Heightmap> map) {
+    auto expr = new HeightmapExpression(Type::MAP);
+    expr->source = std::move(map);
+    return Ptr(expr);
+}
+
+Ptr HeightmapExpression::binary(BinaryOp op, Ptr a, Ptr b) {
+    auto expr = new HeightmapExpression(Type::BINARY);
+    expr->op = op;
+    expr->operands[0] = std::move(a);
+    expr->operands[1] = std::move(b);
+    return Ptr(expr);
+}
+
+Ptr HeightmapExpression::abs(Ptr a) {
+    auto expr = new HeightmapExpression(Type::ABS);
+    expr->operands[0] = std::move(a);
+    return Ptr(expr);
+}
+
+Ptr HeightmapExpression::mix(Ptr a, Ptr b, Ptr t) {
+    auto expr = new HeightmapExpression(Type::MIX);
+    expr->operands[0] = std::move(a);
+    expr->operands[1] = std::move(b);
+    expr->operands[2] = std::move(t);
+    return Ptr(expr);
+}
+
+Ptr HeightmapExpression::noise(
+    Ptr base, const HeightmapNoiseParams& params, Ptr shiftX, Ptr shiftY
+) {
+    auto expr = new HeightmapExpression(Type::NOISE);
+    expr->noiseParams = params;
+    expr->operands[0] = std::move(base);
+    expr->operands[1] = std::move(shiftX);
+    expr->operands[2] = std::move(shiftY);
+    return Ptr(expr);
+}
+
+/// @brief Expression tree flattened to a list of steps in evaluation order.
+/// Every step writes a block of values to its own buffer, operands used once
+/// are modified in place. Values and heightmaps are read directly.
+class HeightmapEvaluator {
+    using Type = HeightmapExpression::Type;
+    static constexpr uint BLOCK_SIZE = HeightmapExpression::BLOCK_SIZE;
+
+    struct Step {
+        const HeightmapExpression* expr;
+        int operands[3] {-1, -1, -1};
+        int uses = 0;
+        /// @brief index of the buffer or -1 for values and heightmaps
+        int buffer = -1;
+        /// @brief block of the step results, nullptr for values
+        const float* output = nullptr;
+        fnl_state noise {};
+    };
+
+    uint width;
+    uint height;
+    std::vector<Step> steps;
+    std::unordered_map<const HeightmapExpression*, int> indices;
+    std::vector<float> buffers;
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<float> values;
+
+    int compile(const HeightmapExpression& expr) {
+        const auto& found = indices.find(&expr);
+        if (found != indices.end()) {
+            steps[found->second].uses++;
+            return found->second;
+        }
+        Step step {&expr};
+        for (int i = 0; i < 3; i++) {
+            if (expr.operands[i]) {
+                step.operands[i] = compile(*expr.operands[i]);
+            }
+        }
+        if (expr.type == Type::MAP && (expr.source->getWidth() != width ||
+                                       expr.source->getHeight() != height)) {
+            throw std::runtime_error("heightmap size mismatch");
+        }
+        if (expr.type == Type::NOISE) {
+            step.noise = fnlCreateState();
+            step.noise.seed = expr.noiseParams.seed;
+            step.noise.noise_type = expr.noiseParams.type;
+        }
+        int index = steps.size();
+        step.uses = 1;
+        steps.push_back(step);
+        indices[&expr] = index;
+        return index;
+    }
+
+    void allocate() {
+        int buffersCount = 0;
+        for (auto& step : steps) {
+            auto type = step.expr->type;
+            if (type == Type::VALUE || type == Type::MAP) {
+                continue;
+            }
+            const auto& base = steps[step.operands[0]];
+            if (base.buffer != -1 && base.uses == 1) {
+                step.buffer = base.buffer;
+            } else {
+                step.buffer = buffersCount++;
+            }
+        }
+        buffers.resize(buffersCount * BLOCK_SIZE);
+    }
+
+    /// @brief Copy operand values to the block
+    void copy(const Step& step, float* dst, uint count) const {
+        if (step.output == dst) {
+            return;
+        }
+        if (step.output == nullptr) {
+            std::fill(dst, dst + count, step.expr->constant);
+        } else {
+            std::copy(step.output, step.output + count, dst);
+        }
+    }
+
+    void evaluateNoise(Step& step, float* dst, uint offset, uint count) {
+        const auto& params = step.expr->noiseParams;
+        const Step* shifts[2] {};
+        for (int i = 0; i < 2; i++) {
+            if (step.operands[i + 1] != -1) {
+                shifts[i] = &steps[step.operands[i + 1]];
+            }
+        }
+        for (int c = 0; c < params.octaves; c++) {
+            float m = params.scale * (1 << c);
+            float octaveDivider = static_cast<float>(1 << c);
+            for (uint i = 0; i < count; i++) {
+                uint x = (offset + i) % width;
+                uint y = (offset + i) / width;
+                xs[i] = (x + params.offset.x) * m;
+                ys[i] = (y + params.offset.y) * m;
+            }
+            for (int axis = 0; axis < 2; axis++) {
+                if (shifts[axis] == nullptr) {
+                    continue;
+                }
+                float* coords = axis == 0 ? xs.data() : ys.data();
+                const float* shift = shifts[axis]->output;
+                for (uint i = 0; i < count; i++) {
+                    coords[i] += shift ? shift[i]
+                                       : shifts[axis]->expr->constant;
+                }
+            }
+            heightmap_kernels::noise(
+                step.noise, xs.data(), ys.data(), values.data(), count
+            );
+            for (uint i = 0; i < count; i++) {
+                dst[i] += values[i] / octaveDivider * params.multiplier;
+            }
+        }
+    }
+
+    void evaluateMix(const Step& step, float* dst, uint count) {
+        const auto& b = steps[step.operands[1]];
+        const auto& t = steps[step.operands[2]];
+        if (b.output && t.output) {
+            mix(dst, b.output, t.output, count);
+        } else if (b.output) {
+            mix(dst, b.output, t.expr->constant, count);
+        } else if (t.output) {
+            mix(dst, b.expr->constant, t.output, count);
+        } else {
+            mix(dst, b.expr->constant, t.expr->constant, count);
+        }
+    }
+
+    void evaluateBlock(uint offset, uint count) {
+        for (auto& step : steps) {
+            const auto& expr = *step.expr;
+            if (expr.type == Type::VALUE) {
+                continue;
+            }
+            if (expr.type == Type::MAP) {
+                step.output = expr.source->getValues() + offset;
+                continue;
+            }
+            float* dst = buffers.data() + step.buffer * BLOCK_SIZE;
+            copy(steps[step.operands[0]], dst, count);
+            switch (expr.type) {
+                case Type::BINARY: {
+                    const auto& b = steps[step.operands[1]];
+                    if (b.output) {
+                        apply(expr.op, dst, b.output, count);
+                    } else {
+                        apply(expr.op, dst, b.expr->constant, count);
+                    }
+                    break;
+                }
+                case Type::ABS:
+                    heightmap_kernels::abs(dst, count);
+                    break;
+                case Type::MIX:
+                    evaluateMix(step, dst, count);
+                    break;
+                case Type::NOISE:
+                    evaluateNoise(step, dst, offset, count);
+                    break;
+                default:
+                    break;
+            }
+            step.output = dst;
+        }
+    }
+public:
+    HeightmapEvaluator(const HeightmapExpression& root, uint width, uint height)
+        : width(width),
+          height(height),
+          xs(BLOCK_SIZE),
+          ys(BLOCK_SIZE),
+          values(BLOCK_SIZE) {
+        compile(root);
+        allocate();
+    }
+
+    void evaluate(float* dst) {
+        size_t total = static_cast<size_t>(width) * height;
+        for (size_t offset = 0; offset < total; offset += BLOCK_SIZE) {
+            uint count = std::min<size_t>(BLOCK_SIZE, total - offset);
+            evaluateBlock(offset, count);
+            copy(steps.back(), dst + offset, count);
+        }
+    }
+};
+
+void HeightmapExpression::evaluate(Heightmap& dst) const {
+    HeightmapEvaluator evaluator(*this, dst.getWidth(), dst.getHeight());
+    evaluator.evaluate(dst.getValues());
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <memory>
+
+#include "typedefs.hpp"
+#include "maths/heightmap_kernels.hpp"
+
+#include <glm/glm.hpp>
+
+class Heightmap;
+
+struct HeightmapNoiseParams {
+    fnl_noise_type type = FNL_NOISE_OPENSIMPLEX2;
+    int seed = 0;
+    glm::vec2 offset {};
+    float scale = 1.0f;
+    int octaves = 1;
+    float multiplier = 1.0f;
+};
+
+/// @brief Immutable lazy heightmap expression tree. The whole tree is
+/// evaluated in one pass by blocks of values, so intermediate results never
+/// take a full heightmap. Results are bit-identical to the same sequence of
+/// operations applied to heightmaps one by one.
+class HeightmapExpression {
+public:
+    using Ptr = std::shared_ptr<const HeightmapExpression>;
+
+    enum class Type {
+        VALUE,
+        MAP,
+        BINARY,
+        ABS,
+        MIX,
+        NOISE,
+    };
+
+    /// @brief Number of values evaluated at once
+    static inline constexpr uint BLOCK_SIZE = 1024;
+
+    static Ptr value(float value);
+
+    /// @brief Heightmap values are read at evaluation time
+    static Ptr map(std::shared_ptr<const Heightmap> map);
+
+    /// @brief op(a, b)
+    static Ptr binary(heightmap_kernels::BinaryOp op, Ptr a, Ptr b);
+
+    static Ptr abs(Ptr a);
+
+    /// @brief a * (1 - t) + b * t
+    static Ptr mix(Ptr a, Ptr b, Ptr t);
+
+    /// @brief Noise octaves added to the base expression
+    /// @param shiftX nullable expression added to x noise coordinates
+    /// @param shiftY nullable expression added to y noise coordinates
+    static Ptr noise(
+        Ptr base, const HeightmapNoiseParams& params, Ptr shiftX, Ptr shiftY
+    );
+
+    /// @brief Evaluate expression into the heightmap. Sizes of heightmaps
+    /// used in the expression must match the destination size.
+    /// @throws std::runtime_error on heightmap size mismatch
+    void evaluate(Heightmap& dst) const;
+
+    Type getType() const {
+        return type;
+    }
+private:
+    explicit HeightmapExpression(Type type) : type(type) {}
+
+    Type type;
+    float constant = 0.0f;
+    std::shared_ptr<const Heightmap> source;
+    heightmap_kernels::BinaryOp op = heightmap_kernels::BinaryOp::ADD;
+    HeightmapNoiseParams noiseParams {};
+    Ptr operands[3] {};
+
+    friend class HeightmapEvaluator;
+};
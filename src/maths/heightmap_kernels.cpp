@@ -0,0 +1,319 @@
+#define FNL_IMPL
+#include "heightmap_kernels_simd.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <functional>
+
+#include <glm/glm.hpp>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define HEIGHTMAP_KERNELS_CPUID_MSVC
+#elif (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define HEIGHTMAP_KERNELS_CPUID_BUILTIN
+#endif
+
+using namespace heightmap_kernels;
+
+const float* const heightmap_kernels::NOISE_GRADIENTS_2D = GRADIENTS_2D;
+const float* const heightmap_kernels::NOISE_RAND_VECS_2D = RAND_VECS_2D;
+
+template <class Op>
+static void apply_scalar(float* dst, const float* src, size_t count) {
+    Op op;
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = op(dst[i], src[i]);
+    }
+}
+
+template <class Op>
+static void apply_value_scalar(float* dst, float value, size_t count) {
+    Op op;
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = op(dst[i], value);
+    }
+}
+
+namespace {
+    struct Pow {
+        float operator()(float a, float b) const {
+            return glm::pow(a, b);
+        }
+    };
+
+    // same as glm::min and glm::max, written explicitly as vectorized
+    // kernels depend on the exact comparison
+
+    struct Min {
+        float operator()(float a, float b) const {
+            return b < a ? b : a;
+        }
+    };
+
+    struct Max {
+        float operator()(float a, float b) const {
+            return a < b ? b : a;
+        }
+    };
+}
+
+static void abs_scalar(float* dst, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        // same as glm::abs
+        dst[i] = dst[i] >= 0.0f ? dst[i] : -dst[i];
+    }
+}
+
+static void mix_scalar(
+    float* dst,
+    const float* src,
+    float value,
+    const float* t,
+    float tValue,
+    size_t count
+) {
+    for (size_t i = 0; i < count; i++) {
+        float b = src ? src[i] : value;
+        float k = t ? t[i] : tValue;
+        dst[i] = dst[i] * (1.0f - k) + b * k;
+    }
+}
+
+static void noise_scalar(
+    fnl_state& state,
+    const float* xs,
+    const float* ys,
+    float* dst,
+    size_t count
+) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = fnlGetNoise2D(&state, xs[i], ys[i]);
+    }
+}
+
+static void interpolate_cubic_scalar(
+    const float* const rows[4], float t, float* dst, size_t count
+) {
+    double x = t;
+    for (size_t i = 0; i < count; i++) {
+        float p[4] {rows[0][i], rows[1][i], rows[2][i], rows[3][i]};
+        dst[i] = p[1] + 0.5 * x*(p[2] - p[0] + x*(2.0*p[0] - 5.0*p[1] +
+                 4.0*p[2] - p[3] + x*(3.0*(p[1] - p[2]) + p[3] - p[0])));
+    }
+}
+
+static Kernels create_scalar_kernels() {
+    Kernels kernels {};
+    auto& binary = kernels.binary;
+    binary[static_cast<int>(BinaryOp::ADD)] = apply_scalar<std::plus<float>>;
+    binary[static_cast<int>(BinaryOp::SUB)] = apply_scalar<std::minus<float>>;
+    binary[static_cast<int>(BinaryOp::MUL)] =
+        apply_scalar<std::multiplies<float>>;
+    binary[static_cast<int>(BinaryOp::MIN)] = apply_scalar<Min>;
+    binary[static_cast<int>(BinaryOp::MAX)] = apply_scalar<Max>;
+    binary[static_cast<int>(BinaryOp::POW)] = apply_scalar<Pow>;
+
+    auto& binaryValue = kernels.binaryValue;
+    binaryValue[static_cast<int>(BinaryOp::ADD)] =
+        apply_value_scalar<std::plus<float>>;
+    binaryValue[static_cast<int>(BinaryOp::SUB)] =
+        apply_value_scalar<std::minus<float>>;
+    binaryValue[static_cast<int>(BinaryOp::MUL)] =
+        apply_value_scalar<std::multiplies<float>>;
+    binaryValue[static_cast<int>(BinaryOp::MIN)] = apply_value_scalar<Min>;
+    binaryValue[static_cast<int>(BinaryOp::MAX)] = apply_value_scalar<Max>;
+    binaryValue[static_cast<int>(BinaryOp::POW)] = apply_value_scalar<Pow>;
+
+    kernels.abs = abs_scalar;
+    kernels.mix = mix_scalar;
+    kernels.noise = noise_scalar;
+    kernels.interpolateCubic = interpolate_cubic_scalar;
+    return kernels;
+}
+
+const Kernels* heightmap_kernels::get_scalar_kernels() {
+    static const Kernels kernels = create_scalar_kernels();
+    return &kernels;
+}
+
+static bool is_cpu_supported(InstructionSet set) {
+    if (set == InstructionSet::SCALAR) {
+        return true;
+    }
+#if defined(HEIGHTMAP_KERNELS_CPUID_MSVC)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse41 = info[2] & (1 << 19);
+    if (set == InstructionSet::SSE41) {
+        return sse41;
+    }
+    bool osxsave = info[2] & (1 << 27);
+    bool avx = info[2] & (1 << 28);
+    // check that the OS saves AVX registers
+    if (maxLeaf < 7 || !osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+#elif defined(HEIGHTMAP_KERNELS_CPUID_BUILTIN)
+    __builtin_cpu_init();
+    if (set == InstructionSet::SSE41) {
+        return __builtin_cpu_supports("sse4.1");
+    }
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+static const Kernels* get_kernels(InstructionSet set) {
+    if (!is_cpu_supported(set)) {
+        return nullptr;
+    }
+    switch (set) {
+        case InstructionSet::SCALAR:
+            return get_scalar_kernels();
+        case InstructionSet::SSE41:
+            return get_sse41_kernels();
+        case InstructionSet::AVX2:
+            return get_avx2_kernels();
+    }
+    return nullptr;
+}
+
+InstructionSet heightmap_kernels::get_supported_instruction_set() {
+    static const InstructionSet supported = []() {
+        for (auto set : {InstructionSet::AVX2, InstructionSet::SSE41}) {
+            if (get_kernels(set)) {
+                return set;
+            }
+        }
+        return InstructionSet::SCALAR;
+    }();
+    return supported;
+}
+
+/// @brief Selected kernels, initialized on first use
+static std::atomic<const Kernels*> current_kernels {nullptr};
+static std::atomic<InstructionSet> current_set {InstructionSet::SCALAR};
+
+static const Kernels* get_current_kernels() {
+    const Kernels* kernels = current_kernels;
+    if (kernels == nullptr) {
+        auto set = get_supported_instruction_set();
+        kernels = get_kernels(set);
+        current_set = set;
+        current_kernels = kernels;
+    }
+    return kernels;
+}
+
+InstructionSet heightmap_kernels::get_instruction_set() {
+    get_current_kernels();
+    return current_set;
+}
+
+bool heightmap_kernels::set_instruction_set(InstructionSet set) {
+    auto kernels = get_kernels(set);
+    if (kernels == nullptr) {
+        return false;
+    }
+    current_set = set;
+    current_kernels = kernels;
+    return true;
+}
+
+const char* heightmap_kernels::to_string(InstructionSet set) {
+    switch (set) {
+        case InstructionSet::SCALAR:
+            return "scalar";
+        case InstructionSet::SSE41:
+            return "sse4.1";
+        case InstructionSet::AVX2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+void heightmap_kernels::apply(
+    BinaryOp op, float* dst, const float* src, size_t count
+) {
+    get_current_kernels()->binary[static_cast<int>(op)](dst, src, count);
+}
+
+void heightmap_kernels::apply(
+    BinaryOp op, float* dst, float value, size_t count
+) {
+    get_current_kernels()->binaryValue[static_cast<int>(op)](
+        dst, value, count
+    );
+}
+
+void heightmap_kernels::abs(float* dst, size_t count) {
+    get_current_kernels()->abs(dst, count);
+}
+
+void heightmap_kernels::mix(
+    float* dst, const float* src, const float* t, size_t count
+) {
+    get_current_kernels()->mix(dst, src, 0.0f, t, 0.0f, count);
+}
+
+void heightmap_kernels::mix(
+    float* dst, const float* src, float t, size_t count
+) {
+    get_current_kernels()->mix(dst, src, 0.0f, nullptr, t, count);
+}
+
+void heightmap_kernels::mix(
+    float* dst, float value, const float* t, size_t count
+) {
+    get_current_kernels()->mix(dst, nullptr, value, t, 0.0f, count);
+}
+
+void heightmap_kernels::mix(float* dst, float value, float t, size_t count) {
+    get_current_kernels()->mix(dst, nullptr, value, nullptr, t, count);
+}
+
+/// @brief Check if the noise configuration is supported by vectorized
+/// kernels
+static bool is_batch_noise(const fnl_state& state) {
+    if (state.fractal_type != FNL_FRACTAL_NONE) {
+        return false;
+    }
+    switch (state.noise_type) {
+        case FNL_NOISE_OPENSIMPLEX2:
+            return true;
+        case FNL_NOISE_CELLULAR:
+            return state.cellular_distance_func ==
+                       FNL_CELLULAR_DISTANCE_EUCLIDEAN ||
+                   state.cellular_distance_func ==
+                       FNL_CELLULAR_DISTANCE_EUCLIDEANSQ;
+        default:
+            return false;
+    }
+}
+
+void heightmap_kernels::noise(
+    fnl_state& state,
+    const float* xs,
+    const float* ys,
+    float* dst,
+    size_t count
+) {
+    const Kernels* kernels = get_current_kernels();
+    if (!is_batch_noise(state)) {
+        kernels = get_scalar_kernels();
+    }
+    kernels->noise(state, xs, ys, dst, count);
+}
+
+void heightmap_kernels::interpolate_cubic(
+    const float* const rows[4], float t, float* dst, size_t count
+) {
+    get_current_kernels()->interpolateCubic(rows, t, dst, count);
+}
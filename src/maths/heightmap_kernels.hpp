@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+
+#include "maths/FastNoiseLite.h"
+
+/// @brief Batched heightmap operations. Kernels use the best instruction
+/// set supported by the CPU (selected at runtime) and produce results
+/// bit-identical to the scalar implementation, so generated worlds do not
+/// depend on the hardware.
+namespace heightmap_kernels {
+    enum class InstructionSet {
+        SCALAR,
+        SSE41,
+        AVX2,
+    };
+
+    enum class BinaryOp {
+        ADD,
+        SUB,
+        MUL,
+        MIN,
+        MAX,
+        POW,
+        COUNT
+    };
+
+    /// @return the best instruction set supported by the CPU
+    InstructionSet get_supported_instruction_set();
+
+    /// @return instruction set used by kernels
+    InstructionSet get_instruction_set();
+
+    /// @brief Select instruction set used by kernels (tests and benchmarks)
+    /// @return false if the instruction set is not supported,
+    /// kernels are not changed in that case
+    bool set_instruction_set(InstructionSet set);
+
+    const char* to_string(InstructionSet set);
+
+    /// @brief dst[i] = op(dst[i], src[i])
+    void apply(BinaryOp op, float* dst, const float* src, size_t count);
+
+    /// @brief dst[i] = op(dst[i], value)
+    void apply(BinaryOp op, float* dst, float value, size_t count);
+
+    /// @brief dst[i] = abs(dst[i])
+    void abs(float* dst, size_t count);
+
+    /// @brief dst[i] = dst[i] * (1 - t[i]) + src[i] * t[i]
+    void mix(float* dst, const float* src, const float* t, size_t count);
+    void mix(float* dst, const float* src, float t, size_t count);
+    void mix(float* dst, float value, const float* t, size_t count);
+    void mix(float* dst, float value, float t, size_t count);
+
+    /// @brief dst[i] = fnlGetNoise2D(&state, xs[i], ys[i]). OpenSimplex2
+    /// and euclidean cellular noise without fractal are evaluated in
+    /// batches, other configurations fall back to per-sample calls.
+    void noise(
+        fnl_state& state,
+        const float* xs,
+        const float* ys,
+        float* dst,
+        size_t count
+    );
+
+    /// @brief Cubic interpolation between rows (Catmull-Rom spline)
+    /// @param rows four consecutive rows, interpolated between rows[1]
+    /// and rows[2]
+    /// @param t interpolation factor
+    void interpolate_cubic(
+        const float* const rows[4], float t, float* dst, size_t count
+    );
+}
@@ -0,0 +1,184 @@
+#include "heightmap_kernels_simd.hpp"
+
+// compiled with AVX2 enabled (see src/CMakeLists.txt), MSVC provides
+// the intrinsics without extra flags
+#if defined(__AVX2__) || \
+    (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+#define HEIGHTMAP_KERNELS_AVX2
+#include <immintrin.h>
+#endif
+
+using namespace heightmap_kernels;
+
+#ifdef HEIGHTMAP_KERNELS_AVX2
+
+namespace {
+    struct Avx2 {
+        static constexpr size_t SIZE = 8;
+        using F = __m256;
+        using I = __m256i;
+        using D = __m256d;
+
+        static F load(const float* src) {
+            return _mm256_loadu_ps(src);
+        }
+
+        static void store(float* dst, F value) {
+            _mm256_storeu_ps(dst, value);
+        }
+
+        static F set(float value) {
+            return _mm256_set1_ps(value);
+        }
+
+        static F add(F a, F b) {
+            return _mm256_add_ps(a, b);
+        }
+
+        static F sub(F a, F b) {
+            return _mm256_sub_ps(a, b);
+        }
+
+        static F mul(F a, F b) {
+            return _mm256_mul_ps(a, b);
+        }
+
+        static F div(F a, F b) {
+            return _mm256_div_ps(a, b);
+        }
+
+        static F min(F a, F b) {
+            return _mm256_min_ps(a, b);
+        }
+
+        static F max(F a, F b) {
+            return _mm256_max_ps(a, b);
+        }
+
+        static F neg(F a) {
+            return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f));
+        }
+
+        static F lt(F a, F b) {
+            return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+        }
+
+        static F le(F a, F b) {
+            return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+        }
+
+        static F gt(F a, F b) {
+            return _mm256_cmp_ps(a, b, _CMP_GT_OQ);
+        }
+
+        static F ge(F a, F b) {
+            return _mm256_cmp_ps(a, b, _CMP_GE_OQ);
+        }
+
+        static F select(F mask, F a, F b) {
+            return _mm256_blendv_ps(b, a, mask);
+        }
+
+        static I seti(int value) {
+            return _mm256_set1_epi32(value);
+        }
+
+        static I toint(F a) {
+            return _mm256_cvttps_epi32(a);
+        }
+
+        static F tofloat(I a) {
+            return _mm256_cvtepi32_ps(a);
+        }
+
+        static I asint(F a) {
+            return _mm256_castps_si256(a);
+        }
+
+        static F asfloat(I a) {
+            return _mm256_castsi256_ps(a);
+        }
+
+        static I iadd(I a, I b) {
+            return _mm256_add_epi32(a, b);
+        }
+
+        static I isub(I a, I b) {
+            return _mm256_sub_epi32(a, b);
+        }
+
+        static I imul(I a, I b) {
+            return _mm256_mullo_epi32(a, b);
+        }
+
+        static I ixor(I a, I b) {
+            return _mm256_xor_si256(a, b);
+        }
+
+        static I iand(I a, I b) {
+            return _mm256_and_si256(a, b);
+        }
+
+        static I ior(I a, I b) {
+            return _mm256_or_si256(a, b);
+        }
+
+        template <int n>
+        static I isra(I a) {
+            return _mm256_srai_epi32(a, n);
+        }
+
+        static I iselect(F mask, I a, I b) {
+            return _mm256_blendv_epi8(b, a, _mm256_castps_si256(mask));
+        }
+
+        static F gather(const float* table, I indices) {
+            return _mm256_i32gather_ps(table, indices, 4);
+        }
+
+        static D dset(double value) {
+            return _mm256_set1_pd(value);
+        }
+
+        static D dadd(D a, D b) {
+            return _mm256_add_pd(a, b);
+        }
+
+        static D dsub(D a, D b) {
+            return _mm256_sub_pd(a, b);
+        }
+
+        static D dmul(D a, D b) {
+            return _mm256_mul_pd(a, b);
+        }
+
+        static D lo(F a) {
+            return _mm256_cvtps_pd(_mm256_castps256_ps128(a));
+        }
+
+        static D hi(F a) {
+            return _mm256_cvtps_pd(_mm256_extractf128_ps(a, 1));
+        }
+
+        static F fromd(D lo, D hi) {
+            return _mm256_insertf128_ps(
+                _mm256_castps128_ps256(_mm256_cvtpd_ps(lo)),
+                _mm256_cvtpd_ps(hi),
+                1
+            );
+        }
+    };
+}
+
+const Kernels* heightmap_kernels::get_avx2_kernels() {
+    static const Kernels kernels = VectorKernels<Avx2>::create();
+    return &kernels;
+}
+
+#else
+
+const Kernels* heightmap_kernels::get_avx2_kernels() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,470 @@
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+
+#include "heightmap_kernels.hpp"
+
+/// Internal part of heightmap_kernels shared by the dispatcher and the
+/// instruction set specific translation units.
+///
+/// VectorKernels must be instantiated only in translation units compiled
+/// for the corresponding instruction set with a vector type declared in an
+/// anonymous namespace, so instantiations never leak to other units.
+/// Operations order repeats the scalar implementation (no FMA, doubles where
+/// the scalar code uses doubles) to keep results bit-identical.
+namespace heightmap_kernels {
+    struct Kernels {
+        using BinaryFunc = void (*)(float* dst, const float* src, size_t count);
+        using BinaryValueFunc = void (*)(float* dst, float value, size_t count);
+
+        BinaryFunc binary[static_cast<int>(BinaryOp::COUNT)];
+        BinaryValueFunc binaryValue[static_cast<int>(BinaryOp::COUNT)];
+        void (*abs)(float* dst, size_t count);
+        /// @brief Mix with src array or value using t array or tValue
+        /// (arrays are used if not nullptr)
+        void (*mix)(
+            float* dst,
+            const float* src,
+            float value,
+            const float* t,
+            float tValue,
+            size_t count
+        );
+        /// @brief Noise kernel. Vectorized kernels support configurations
+        /// accepted by is_batch_noise only
+        void (*noise)(
+            fnl_state& state,
+            const float* xs,
+            const float* ys,
+            float* dst,
+            size_t count
+        );
+        void (*interpolateCubic)(
+            const float* const rows[4], float t, float* dst, size_t count
+        );
+    };
+
+    const Kernels* get_scalar_kernels();
+    /// @return nullptr if the kernels are not available for the target
+    const Kernels* get_sse41_kernels();
+    /// @return nullptr if the kernels are not available for the target
+    const Kernels* get_avx2_kernels();
+
+    /// @brief FastNoiseLite lookup tables
+    extern const float* const NOISE_GRADIENTS_2D;
+    extern const float* const NOISE_RAND_VECS_2D;
+
+    inline constexpr int NOISE_PRIME_X = 501125321;
+    inline constexpr int NOISE_PRIME_Y = 1136930381;
+
+    /// @brief Vectorized kernels
+    /// @tparam V vector operations:
+    /// - F, I, D: float, int32 and double vectors, D holds SIZE / 2 values
+    /// - min(a, b) is a < b ? a : b, max(a, b) is a > b ? a : b
+    /// - select(mask, a, b) is mask ? a : b
+    /// - lo/hi convert lower/higher half of F to D, fromd does the reverse
+    template <class V>
+    struct VectorKernels {
+        using F = typename V::F;
+        using I = typename V::I;
+        using D = typename V::D;
+        static constexpr size_t N = V::SIZE;
+
+        static F load(const float* src, size_t n) {
+            if (n == N) {
+                return V::load(src);
+            }
+            float buffer[N] {};
+            std::memcpy(buffer, src, n * sizeof(float));
+            return V::load(buffer);
+        }
+
+        static void store(float* dst, F value, size_t n) {
+            if (n == N) {
+                V::store(dst, value);
+                return;
+            }
+            float buffer[N];
+            V::store(buffer, value);
+            std::memcpy(dst, buffer, n * sizeof(float));
+        }
+
+        static size_t batch(size_t count, size_t offset) {
+            return count - offset < N ? count - offset : N;
+        }
+
+        template <BinaryOp op>
+        static F binary(F a, F b) {
+            if constexpr (op == BinaryOp::ADD) {
+                return V::add(a, b);
+            } else if constexpr (op == BinaryOp::SUB) {
+                return V::sub(a, b);
+            } else if constexpr (op == BinaryOp::MUL) {
+                return V::mul(a, b);
+            } else if constexpr (op == BinaryOp::MIN) {
+                // glm::min(a, b) is b < a ? b : a
+                return V::min(b, a);
+            } else {
+                // glm::max(a, b) is a < b ? b : a
+                return V::max(b, a);
+            }
+        }
+
+        template <BinaryOp op>
+        static void apply(float* dst, const float* src, size_t count) {
+            for (size_t i = 0; i < count; i += N) {
+                size_t n = batch(count, i);
+                store(
+                    dst + i, binary<op>(load(dst + i, n), load(src + i, n)), n
+                );
+            }
+        }
+
+        template <BinaryOp op>
+        static void applyValue(float* dst, float value, size_t count) {
+            F b = V::set(value);
+            for (size_t i = 0; i < count; i += N) {
+                size_t n = batch(count, i);
+                store(dst + i, binary<op>(load(dst + i, n), b), n);
+            }
+        }
+
+        static void abs(float* dst, size_t count) {
+            F zero = V::set(0.0f);
+            for (size_t i = 0; i < count; i += N) {
+                size_t n = batch(count, i);
+                F x = load(dst + i, n);
+                // glm::abs(x) is x >= 0 ? x : -x
+                store(dst + i, V::select(V::ge(x, zero), x, V::neg(x)), n);
+            }
+        }
+
+        static void mix(
+            float* dst,
+            const float* src,
+            float value,
+            const float* t,
+            float tValue,
+            size_t count
+        ) {
+            F one = V::set(1.0f);
+            F srcValue = V::set(value);
+            F tVector = V::set(tValue);
+            for (size_t i = 0; i < count; i += N) {
+                size_t n = batch(count, i);
+                F a = load(dst + i, n);
+                F b = src ? load(src + i, n) : srcValue;
+                F k = t ? load(t + i, n) : tVector;
+                store(
+                    dst + i, V::add(V::mul(a, V::sub(one, k)), V::mul(b, k)), n
+                );
+            }
+        }
+
+        static I fastFloor(F f) {
+            I value = V::toint(f);
+            return V::iselect(
+                V::ge(f, V::set(0.0f)), value, V::isub(value, V::seti(1))
+            );
+        }
+
+        static I fastRound(F f) {
+            F half = V::set(0.5f);
+            return V::iselect(
+                V::ge(f, V::set(0.0f)),
+                V::toint(V::add(f, half)),
+                V::toint(V::sub(f, half))
+            );
+        }
+
+        static F fastSqrt(F a) {
+            F xhalf = V::mul(V::set(0.5f), a);
+            F inv = V::asfloat(V::isub(
+                V::seti(0x5f3759df), V::template isra<1>(V::asint(a))
+            ));
+            inv = V::mul(
+                inv, V::sub(V::set(1.5f), V::mul(V::mul(xhalf, inv), inv))
+            );
+            return V::mul(a, inv);
+        }
+
+        static I hash(I seed, I xPrimed, I yPrimed) {
+            return V::imul(
+                V::ixor(V::ixor(seed, xPrimed), yPrimed), V::seti(0x27d4eb2d)
+            );
+        }
+
+        static F gradCoord(I seed, I xPrimed, I yPrimed, F xd, F yd) {
+            I index = hash(seed, xPrimed, yPrimed);
+            index = V::ixor(index, V::template isra<15>(index));
+            index = V::iand(index, V::seti(127 << 1));
+            F gradX = V::gather(NOISE_GRADIENTS_2D, index);
+            F gradY = V::gather(NOISE_GRADIENTS_2D, V::ior(index, V::seti(1)));
+            return V::add(V::mul(xd, gradX), V::mul(yd, gradY));
+        }
+
+        static F attenuate(F a, F gradient) {
+            F zero = V::set(0.0f);
+            F value = V::mul(V::mul(V::mul(a, a), V::mul(a, a)), gradient);
+            return V::select(V::le(a, zero), zero, value);
+        }
+
+        /// @brief Vectorized _fnlSingleSimplex2D
+        static F simplex(I seed, F x, F y) {
+            const float SQRT3 = 1.7320508075688772935274463415059f;
+            const float G2 = (3 - SQRT3) / 6;
+
+            I i = fastFloor(x);
+            I j = fastFloor(y);
+            F xi = V::sub(x, V::tofloat(i));
+            F yi = V::sub(y, V::tofloat(j));
+
+            F t = V::mul(V::add(xi, yi), V::set(G2));
+            F x0 = V::sub(xi, t);
+            F y0 = V::sub(yi, t);
+
+            i = V::imul(i, V::seti(NOISE_PRIME_X));
+            j = V::imul(j, V::seti(NOISE_PRIME_Y));
+            I iNext = V::iadd(i, V::seti(NOISE_PRIME_X));
+            I jNext = V::iadd(j, V::seti(NOISE_PRIME_Y));
+
+            F a = V::sub(
+                V::sub(V::set(0.5f), V::mul(x0, x0)), V::mul(y0, y0)
+            );
+            F n0 = attenuate(a, gradCoord(seed, i, j, x0, y0));
+
+            F c = V::add(
+                V::mul(
+                    V::set(
+                        static_cast<float>(2 * (1 - 2 * G2) * (1 / G2 - 2))
+                    ),
+                    t
+                ),
+                V::add(
+                    V::set(
+                        static_cast<float>(-2 * (1 - 2 * G2) * (1 - 2 * G2))
+                    ),
+                    a
+                )
+            );
+            F x2 = V::add(x0, V::set(2 * G2 - 1));
+            F y2 = V::add(y0, V::set(2 * G2 - 1));
+            F n2 = attenuate(c, gradCoord(seed, iNext, jNext, x2, y2));
+
+            F upper = V::gt(y0, x0);
+            F x1 = V::add(x0, V::select(upper, V::set(G2), V::set(G2 - 1)));
+            F y1 = V::add(y0, V::select(upper, V::set(G2 - 1), V::set(G2)));
+            F b = V::sub(
+                V::sub(V::set(0.5f), V::mul(x1, x1)), V::mul(y1, y1)
+            );
+            F n1 = attenuate(
+                b,
+                gradCoord(
+                    seed,
+                    V::iselect(upper, i, iNext),
+                    V::iselect(upper, jNext, j),
+                    x1,
+                    y1
+                )
+            );
+            return V::mul(
+                V::add(V::add(n0, n1), n2), V::set(99.83685446303647f)
+            );
+        }
+
+        /// @brief Vectorized _fnlSingleCellular2D for euclidean distance
+        static F cellular(const fnl_state& state, I seed, F x, F y) {
+            I xr = fastRound(x);
+            I yr = fastRound(y);
+
+            F distance0 = V::set(FLT_MAX);
+            F distance1 = V::set(FLT_MAX);
+            I closestHash = V::seti(0);
+
+            F jitter = V::set(0.5f * state.cellular_jitter_mod);
+
+            I xPrimed = V::imul(
+                V::isub(xr, V::seti(1)), V::seti(NOISE_PRIME_X)
+            );
+            I yPrimedBase = V::imul(
+                V::isub(yr, V::seti(1)), V::seti(NOISE_PRIME_Y)
+            );
+            for (int xi = -1; xi <= 1; xi++) {
+                I yPrimed = yPrimedBase;
+                F offsetX = V::sub(V::tofloat(V::iadd(xr, V::seti(xi))), x);
+
+                for (int yi = -1; yi <= 1; yi++) {
+                    I cellHash = hash(seed, xPrimed, yPrimed);
+                    I index = V::iand(cellHash, V::seti(255 << 1));
+
+                    F vecX = V::add(
+                        offsetX,
+                        V::mul(V::gather(NOISE_RAND_VECS_2D, index), jitter)
+                    );
+                    F vecY = V::add(
+                        V::sub(V::tofloat(V::iadd(yr, V::seti(yi))), y),
+                        V::mul(
+                            V::gather(
+                                NOISE_RAND_VECS_2D, V::ior(index, V::seti(1))
+                            ),
+                            jitter
+                        )
+                    );
+                    F newDistance =
+                        V::add(V::mul(vecX, vecX), V::mul(vecY, vecY));
+
+                    distance1 = V::max(
+                        V::min(distance1, newDistance), distance0
+                    );
+                    F closer = V::lt(newDistance, distance0);
+                    distance0 = V::select(closer, newDistance, distance0);
+                    closestHash = V::iselect(closer, cellHash, closestHash);
+
+                    yPrimed = V::iadd(yPrimed, V::seti(NOISE_PRIME_Y));
+                }
+                xPrimed = V::iadd(xPrimed, V::seti(NOISE_PRIME_X));
+            }
+
+            auto returnType = state.cellular_return_type;
+            if (state.cellular_distance_func ==
+                    FNL_CELLULAR_DISTANCE_EUCLIDEAN &&
+                returnType >= FNL_CELLULAR_RETURN_VALUE_DISTANCE) {
+                distance0 = fastSqrt(distance0);
+                if (returnType >= FNL_CELLULAR_RETURN_VALUE_DISTANCE2) {
+                    distance1 = fastSqrt(distance1);
+                }
+            }
+            F one = V::set(1.0f);
+            switch (returnType) {
+                case FNL_CELLULAR_RETURN_VALUE_CELLVALUE:
+                    return V::mul(
+                        V::tofloat(closestHash), V::set(1 / 2147483648.0f)
+                    );
+                case FNL_CELLULAR_RETURN_VALUE_DISTANCE:
+                    return V::sub(distance0, one);
+                case FNL_CELLULAR_RETURN_VALUE_DISTANCE2:
+                    return V::sub(distance1, one);
+                case FNL_CELLULAR_RETURN_VALUE_DISTANCE2ADD:
+                    return V::sub(
+                        V::mul(V::add(distance1, distance0), V::set(0.5f)),
+                        one
+                    );
+                case FNL_CELLULAR_RETURN_VALUE_DISTANCE2SUB:
+                    return V::sub(V::sub(distance1, distance0), one);
+                case FNL_CELLULAR_RETURN_VALUE_DISTANCE2MUL:
+                    return V::sub(
+                        V::mul(V::mul(distance1, distance0), V::set(0.5f)),
+                        one
+                    );
+                case FNL_CELLULAR_RETURN_VALUE_DISTANCE2DIV:
+                    return V::sub(V::div(distance0, distance1), one);
+                default:
+                    return V::set(0.0f);
+            }
+        }
+
+        static void noise(
+            fnl_state& state,
+            const float* xs,
+            const float* ys,
+            float* dst,
+            size_t count
+        ) {
+            const float SQRT3 = 1.7320508075688772935274463415059f;
+            const float F2 = 0.5f * (SQRT3 - 1);
+
+            bool simplexNoise = state.noise_type == FNL_NOISE_OPENSIMPLEX2;
+            I seed = V::seti(state.seed);
+            F frequency = V::set(state.frequency);
+            for (size_t i = 0; i < count; i += N) {
+                size_t n = batch(count, i);
+                F x = V::mul(load(xs + i, n), frequency);
+                F y = V::mul(load(ys + i, n), frequency);
+                if (simplexNoise) {
+                    F t = V::mul(V::add(x, y), V::set(F2));
+                    store(
+                        dst + i, simplex(seed, V::add(x, t), V::add(y, t)), n
+                    );
+                } else {
+                    store(dst + i, cellular(state, seed, x, y), n);
+                }
+            }
+        }
+
+        /// @brief Vectorized interpolate_cubic (see Heightmap.cpp) for a
+        /// half of the vector
+        static D cubic(D p0, D p1, D p2, D p3, D d20, D d12, D x) {
+            D inner = V::dsub(V::dadd(V::dmul(V::dset(3.0), d12), p3), p0);
+            D middle = V::dadd(
+                V::dsub(
+                    V::dadd(
+                        V::dsub(
+                            V::dmul(V::dset(2.0), p0), V::dmul(V::dset(5.0), p1)
+                        ),
+                        V::dmul(V::dset(4.0), p2)
+                    ),
+                    p3
+                ),
+                V::dmul(x, inner)
+            );
+            D outer = V::dadd(d20, V::dmul(x, middle));
+            return V::dadd(p1, V::dmul(V::dmul(V::dset(0.5), x), outer));
+        }
+
+        static void interpolateCubic(
+            const float* const rows[4], float t, float* dst, size_t count
+        ) {
+            D x = V::dset(t);
+            for (size_t i = 0; i < count; i += N) {
+                size_t n = batch(count, i);
+                F p0 = load(rows[0] + i, n);
+                F p1 = load(rows[1] + i, n);
+                F p2 = load(rows[2] + i, n);
+                F p3 = load(rows[3] + i, n);
+                // float differences as in the scalar implementation
+                F d20 = V::sub(p2, p0);
+                F d12 = V::sub(p1, p2);
+                D lo = cubic(
+                    V::lo(p0), V::lo(p1), V::lo(p2), V::lo(p3),
+                    V::lo(d20), V::lo(d12), x
+                );
+                D hi = cubic(
+                    V::hi(p0), V::hi(p1), V::hi(p2), V::hi(p3),
+                    V::hi(d20), V::hi(d12), x
+                );
+                store(dst + i, V::fromd(lo, hi), n);
+            }
+        }
+
+        static Kernels create() {
+            Kernels kernels = *get_scalar_kernels();
+            auto& binary = kernels.binary;
+            binary[static_cast<int>(BinaryOp::ADD)] = apply<BinaryOp::ADD>;
+            binary[static_cast<int>(BinaryOp::SUB)] = apply<BinaryOp::SUB>;
+            binary[static_cast<int>(BinaryOp::MUL)] = apply<BinaryOp::MUL>;
+            binary[static_cast<int>(BinaryOp::MIN)] = apply<BinaryOp::MIN>;
+            binary[static_cast<int>(BinaryOp::MAX)] = apply<BinaryOp::MAX>;
+            // pow is left scalar
+
+            auto& binaryValue = kernels.binaryValue;
+            binaryValue[static_cast<int>(BinaryOp::ADD)] =
+                applyValue<BinaryOp::ADD>;
+            binaryValue[static_cast<int>(BinaryOp::SUB)] =
+                applyValue<BinaryOp::SUB>;
+            binaryValue[static_cast<int>(BinaryOp::MUL)] =
+                applyValue<BinaryOp::MUL>;
+            binaryValue[static_cast<int>(BinaryOp::MIN)] =
+                applyValue<BinaryOp::MIN>;
+            binaryValue[static_cast<int>(BinaryOp::MAX)] =
+                applyValue<BinaryOp::MAX>;
+
+            kernels.abs = abs;
+            kernels.mix = mix;
+            kernels.noise = noise;
+            kernels.interpolateCubic = interpolateCubic;
+            return kernels;
+        }
+    };
+}
@@ -0,0 +1,185 @@
+#include "heightmap_kernels_simd.hpp"
+
+// compiled with SSE4.1 enabled (see src/CMakeLists.txt), MSVC provides
+// the intrinsics without extra flags
+#if defined(__SSE4_1__) || \
+    (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+#define HEIGHTMAP_KERNELS_SSE41
+#include <smmintrin.h>
+#endif
+
+using namespace heightmap_kernels;
+
+#ifdef HEIGHTMAP_KERNELS_SSE41
+
+namespace {
+    struct Sse41 {
+        static constexpr size_t SIZE = 4;
+        using F = __m128;
+        using I = __m128i;
+        using D = __m128d;
+
+        static F load(const float* src) {
+            return _mm_loadu_ps(src);
+        }
+
+        static void store(float* dst, F value) {
+            _mm_storeu_ps(dst, value);
+        }
+
+        static F set(float value) {
+            return _mm_set1_ps(value);
+        }
+
+        static F add(F a, F b) {
+            return _mm_add_ps(a, b);
+        }
+
+        static F sub(F a, F b) {
+            return _mm_sub_ps(a, b);
+        }
+
+        static F mul(F a, F b) {
+            return _mm_mul_ps(a, b);
+        }
+
+        static F div(F a, F b) {
+            return _mm_div_ps(a, b);
+        }
+
+        static F min(F a, F b) {
+            return _mm_min_ps(a, b);
+        }
+
+        static F max(F a, F b) {
+            return _mm_max_ps(a, b);
+        }
+
+        static F neg(F a) {
+            return _mm_xor_ps(a, _mm_set1_ps(-0.0f));
+        }
+
+        static F lt(F a, F b) {
+            return _mm_cmplt_ps(a, b);
+        }
+
+        static F le(F a, F b) {
+            return _mm_cmple_ps(a, b);
+        }
+
+        static F gt(F a, F b) {
+            return _mm_cmpgt_ps(a, b);
+        }
+
+        static F ge(F a, F b) {
+            return _mm_cmpge_ps(a, b);
+        }
+
+        static F select(F mask, F a, F b) {
+            return _mm_blendv_ps(b, a, mask);
+        }
+
+        static I seti(int value) {
+            return _mm_set1_epi32(value);
+        }
+
+        static I toint(F a) {
+            return _mm_cvttps_epi32(a);
+        }
+
+        static F tofloat(I a) {
+            return _mm_cvtepi32_ps(a);
+        }
+
+        static I asint(F a) {
+            return _mm_castps_si128(a);
+        }
+
+        static F asfloat(I a) {
+            return _mm_castsi128_ps(a);
+        }
+
+        static I iadd(I a, I b) {
+            return _mm_add_epi32(a, b);
+        }
+
+        static I isub(I a, I b) {
+            return _mm_sub_epi32(a, b);
+        }
+
+        static I imul(I a, I b) {
+            return _mm_mullo_epi32(a, b);
+        }
+
+        static I ixor(I a, I b) {
+            return _mm_xor_si128(a, b);
+        }
+
+        static I iand(I a, I b) {
+            return _mm_and_si128(a, b);
+        }
+
+        static I ior(I a, I b) {
+            return _mm_or_si128(a, b);
+        }
+
+        template <int n>
+        static I isra(I a) {
+            return _mm_srai_epi32(a, n);
+        }
+
+        static I iselect(F mask, I a, I b) {
+            return _mm_blendv_epi8(b, a, _mm_castps_si128(mask));
+        }
+
+        static F gather(const float* table, I indices) {
+            return _mm_setr_ps(
+                table[_mm_extract_epi32(indices, 0)],
+                table[_mm_extract_epi32(indices, 1)],
+                table[_mm_extract_epi32(indices, 2)],
+                table[_mm_extract_epi32(indices, 3)]
+            );
+        }
+
+        static D dset(double value) {
+            return _mm_set1_pd(value);
+        }
+
+        static D dadd(D a, D b) {
+            return _mm_add_pd(a, b);
+        }
+
+        static D dsub(D a, D b) {
+            return _mm_sub_pd(a, b);
+        }
+
+        static D dmul(D a, D b) {
+            return _mm_mul_pd(a, b);
+        }
+
+        static D lo(F a) {
+            return _mm_cvtps_pd(a);
+        }
+
+        static D hi(F a) {
+            return _mm_cvtps_pd(_mm_movehl_ps(a, a));
+        }
+
+        static F fromd(D lo, D hi) {
+            return _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+        }
+    };
+}
+
+const Kernels* heightmap_kernels::get_sse41_kernels() {
+    static const Kernels kernels = VectorKernels<Sse41>::create();
+    return &kernels;
+}
+
+#else
+
+const Kernels* heightmap_kernels::get_sse41_kernels() {
+    return nullptr;
+}
+
+#endif
@@ -4,10 +4,13 @@
 
 #define NOMINMAX
 #include <curl/curl.h>
+#include <atomic>
+#include <chrono>
 #include <stdexcept>
 #include <limits>
 #include <queue>
 #include <thread>
+#include <unordered_map>
 
 #ifdef _WIN32
 /// included in curl.h
@@ -21,11 +24,17 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
 
 using SOCKET = int;
 #endif // _WIN32
 
 #include "debug/Logger.hpp"
+#include "util/RingBuffer.hpp"
 #include "util/stringutil.hpp"
 
 using namespace network;
@@ -262,23 +271,59 @@ static inline std::runtime_error handle_socket_error(const std::string& message)
 #endif
 
 static inline int connectsocket(
-    int descriptor, const sockaddr* addr, socklen_t len
+    SOCKET descriptor, const sockaddr* addr, socklen_t len
 ) noexcept {
     return connect(descriptor, addr, len);
 }
 
 static inline int recvsocket(
-    int descriptor, char* buf, size_t len
+    SOCKET descriptor, char* buf, size_t len
 ) noexcept {
     return recv(descriptor, buf, len, 0);
 }
 
 static inline int sendsocket(
-    int descriptor, const char* buf, size_t len, int flags
+    SOCKET descriptor, const char* buf, size_t len, int flags
 ) noexcept {
     return send(descriptor, buf, len, flags);
 }
 
+#ifdef MSG_NOSIGNAL
+/// @brief Don't raise SIGPIPE if connection is closed by the peer
+static constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static constexpr int SEND_FLAGS = 0;
+#endif
+
+static bool set_nonblocking(SOCKET descriptor) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(descriptor, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(descriptor, F_GETFL, 0);
+    return flags != -1 && fcntl(descriptor, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+/// @brief Check if the last non-blocking socket operation failed because
+/// it would block
+static bool would_block() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+/// @brief Check if the last non-blocking connect is in progress
+static bool connect_in_progress() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EINPROGRESS;
+#endif
+}
+
 static std::string to_string(const sockaddr_in& addr, bool port=true) {
     char ip[INET_ADDRSTRLEN];
     if (inet_ntop(AF_INET, &(addr.sin_addr), ip, INET_ADDRSTRLEN)) {
@@ -288,147 +333,510 @@ static std::string to_string(const sockaddr_in& addr, bool port=true) {
     return "";
 }
 
-class SocketConnection : public Connection {
+/// @brief Socket events handler called on the reactor thread
+class SocketHandler {
+public:
+    virtual ~SocketHandler() {}
+
+    /// @brief Socket has data to read, is closed by the peer or failed
+    virtual void onReadable() = 0;
+
+    /// @brief Socket is ready to send data or connected
+    virtual void onWritable() = 0;
+};
+
+namespace network {
+    /// @brief Serves events of all sockets on a single thread.
+    /// Uses epoll on Linux and poll on other platforms
+    class SocketReactor {
+        enum SocketEvent {
+            READABLE = 1, WRITABLE = 2
+        };
+
+        struct Entry {
+            SOCKET descriptor;
+            std::weak_ptr<SocketHandler> handler;
+            bool writable;
+        };
+
+        std::unordered_map<u64id_t, Entry> entries;
+        u64id_t nextToken = 1;
+        std::mutex mutex;
+        /// @brief Locked while handlers are called
+        std::mutex dispatchMutex;
+        std::atomic<bool> running = true;
+#ifdef __linux__
+        int epollDescriptor;
+#else
+        /// @brief Sockets set was modified since the last poll call
+        bool modified = true;
+        std::vector<pollfd> pollDescriptors;
+        std::vector<u64id_t> pollTokens;
+#endif
+#ifndef _WIN32
+        /// @brief Pipe used to wake the reactor thread up
+        int wakeupPipe[2];
+#endif
+        std::thread thread;
+
+        void wakeUp() {
+#ifndef _WIN32
+            char byte = 0;
+            if (::write(wakeupPipe[1], &byte, 1) < 0) {
+                // pipe is full, the reactor will wake up anyway
+            }
+#endif
+        }
+
+        /// @brief Wait for sockets events
+        /// @param events destination (token, events) pairs
+        void wait(std::vector<std::pair<u64id_t, int>>& events) {
+#ifdef __linux__
+            constexpr int MAX_EVENTS = 256;
+            epoll_event buffer[MAX_EVENTS];
+            int count = epoll_wait(epollDescriptor, buffer, MAX_EVENTS, -1);
+            for (int i = 0; i < count; i++) {
+                const auto& event = buffer[i];
+                int flags = 0;
+                if (event.events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                    flags |= READABLE;
+                }
+                if (event.events & EPOLLOUT) {
+                    flags |= WRITABLE;
+                }
+                events.emplace_back(event.data.u64, flags);
+            }
+#else
+            {
+                std::lock_guard lock(mutex);
+                if (modified) {
+                    modified = false;
+                    pollDescriptors.clear();
+                    pollTokens.clear();
+#ifndef _WIN32
+                    pollDescriptors.push_back({wakeupPipe[0], POLLIN, 0});
+                    pollTokens.push_back(0);
+#endif
+                    for (const auto& [token, entry] : entries) {
+                        short flags = POLLIN;
+                        if (entry.writable) {
+                            flags |= POLLOUT;
+                        }
+                        pollDescriptors.push_back({entry.descriptor, flags, 0});
+                        pollTokens.push_back(token);
+                    }
+                }
+            }
+#ifdef _WIN32
+            // no wake up pipe, sockets set changes are applied by timeout
+            constexpr int TIMEOUT = 10;
+            if (pollDescriptors.empty()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(TIMEOUT));
+                return;
+            }
+            int count = WSAPoll(
+                pollDescriptors.data(), pollDescriptors.size(), TIMEOUT
+            );
+#else
+            int count = poll(pollDescriptors.data(), pollDescriptors.size(), -1);
+#endif
+            for (size_t i = 0; i < pollDescriptors.size() && count > 0; i++) {
+                short revents = pollDescriptors[i].revents;
+                if (revents == 0) {
+                    continue;
+                }
+                count--;
+                int flags = 0;
+                if (revents & (POLLIN | POLLERR | POLLHUP)) {
+                    flags |= READABLE;
+                }
+                if (revents & POLLOUT) {
+                    flags |= WRITABLE;
+                }
+                events.emplace_back(pollTokens[i], flags);
+            }
+#endif
+        }
+
+        void run() {
+            std::vector<std::pair<u64id_t, int>> events;
+            while (running) {
+                events.clear();
+                wait(events);
+
+                std::lock_guard dispatchLock(dispatchMutex);
+                for (const auto& [token, flags] : events) {
+                    if (token == 0) {
+#ifndef _WIN32
+                        char buffer[64];
+                        while (::read(wakeupPipe[0], buffer, sizeof(buffer)) > 0) {
+                        }
+#endif
+                        continue;
+                    }
+                    std::shared_ptr<SocketHandler> handler;
+                    {
+                        std::lock_guard lock(mutex);
+                        const auto& found = entries.find(token);
+                        if (found == entries.end()) {
+                            continue;
+                        }
+                        handler = found->second.handler.lock();
+                    }
+                    if (handler == nullptr) {
+                        continue;
+                    }
+                    if (flags & WRITABLE) {
+                        handler->onWritable();
+                    }
+                    if (flags & READABLE) {
+                        handler->onReadable();
+                    }
+                }
+            }
+        }
+
+#ifdef __linux__
+        void control(int operation, const Entry& entry, u64id_t token) {
+            epoll_event event {};
+            event.events = EPOLLIN | (entry.writable
+                                          ? static_cast<uint32_t>(EPOLLOUT)
+                                          : 0u);
+            event.data.u64 = token;
+            if (epoll_ctl(epollDescriptor, operation, entry.descriptor, &event)) {
+                logger.error() << handle_socket_error("epoll_ctl(...) error").what();
+            }
+        }
+#endif
+    public:
+        SocketReactor() {
+#ifndef _WIN32
+            if (pipe(wakeupPipe)) {
+                throw handle_socket_error("could not create reactor pipe");
+            }
+            set_nonblocking(wakeupPipe[0]);
+            set_nonblocking(wakeupPipe[1]);
+#endif
+#ifdef __linux__
+            epollDescriptor = epoll_create1(0);
+            if (epollDescriptor == -1) {
+                throw handle_socket_error("could not create epoll instance");
+            }
+            epoll_event event {};
+            event.events = EPOLLIN;
+            event.data.u64 = 0;
+            epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, wakeupPipe[0], &event);
+#endif
+            thread = std::thread([this]() { run(); });
+        }
+
+        ~SocketReactor() {
+            running = false;
+            wakeUp();
+            thread.join();
+#ifdef __linux__
+            ::close(epollDescriptor);
+#endif
+#ifndef _WIN32
+            ::close(wakeupPipe[0]);
+            ::close(wakeupPipe[1]);
+#endif
+        }
+
+        /// @brief Start serving socket events
+        /// @param writable call handler when socket is ready to send data
+        /// @return socket token
+        u64id_t add(
+            SOCKET descriptor,
+            std::weak_ptr<SocketHandler> handler,
+            bool writable = false
+        ) {
+            std::lock_guard lock(mutex);
+            u64id_t token = nextToken++;
+            auto& entry = entries[token];
+            entry = Entry {descriptor, std::move(handler), writable};
+#ifdef __linux__
+            control(EPOLL_CTL_ADD, entry, token);
+#else
+            modified = true;
+            wakeUp();
+#endif
+            return token;
+        }
+
+        void setWritable(u64id_t token, bool flag) {
+            std::lock_guard lock(mutex);
+            const auto& found = entries.find(token);
+            if (found == entries.end() || found->second.writable == flag) {
+                return;
+            }
+            found->second.writable = flag;
+#ifdef __linux__
+            control(EPOLL_CTL_MOD, found->second, token);
+#else
+            modified = true;
+            wakeUp();
+#endif
+        }
+
+        /// @brief Stop serving socket events. Handler is not called after
+        /// return, so the socket may be closed
+        void remove(u64id_t token) {
+            {
+                std::lock_guard lock(mutex);
+                const auto& found = entries.find(token);
+                if (found == entries.end()) {
+                    return;
+                }
+#ifdef __linux__
+                epoll_ctl(
+                    epollDescriptor,
+                    EPOLL_CTL_DEL,
+                    found->second.descriptor,
+                    nullptr
+                );
+#else
+                modified = true;
+#endif
+                entries.erase(found);
+            }
+            if (std::this_thread::get_id() != thread.get_id()) {
+                // wait for handlers being called
+                std::lock_guard lock(dispatchMutex);
+            }
+        }
+    };
+}
+
+class SocketConnection : public Connection, public SocketHandler {
+    SocketReactor& reactor;
     SOCKET descriptor;
     sockaddr_in addr;
-    size_t totalUpload = 0;
-    size_t totalDownload = 0;
-    ConnectionState state = ConnectionState::INITIAL;
-    std::unique_ptr<std::thread> thread = nullptr;
-    std::vector<char> readBatch;
-    util::Buffer<char> buffer;
+    u64id_t token = 0;
+    std::atomic<size_t> totalUpload = 0;
+    std::atomic<size_t> totalDownload = 0;
+    std::atomic<ConnectionState> state = ConnectionState::INITIAL;
+    runnable onConnected;
+    /// @brief Received data not read yet
+    util::RingBuffer<char> readBuffer;
+    /// @brief Data not accepted by the socket yet
+    util::RingBuffer<char> sendBuffer;
     std::mutex mutex;
 
-    void connectSocket() {
-        state = ConnectionState::CONNECTING;
-        logger.info() << "connecting to " << to_string(addr);
-        int res = connectsocket(descriptor, (const sockaddr*)&addr, sizeof(sockaddr_in));
-        if (res < 0) {
-            auto error = handle_socket_error("Connect failed");
-            closesocket(descriptor);
-            state = ConnectionState::CLOSED;
-            logger.error() << error.what();
+    /// @brief Send queued data until the socket would block (mutex must
+    /// be locked)
+    /// @return false on error
+    bool flush() {
+        while (!sendBuffer.empty()) {
+            auto [src, count] = sendBuffer.readable();
+            int len = sendsocket(descriptor, src, count, SEND_FLAGS);
+            if (len < 0) {
+                if (would_block()) {
+                    return true;
+                }
+                logger.error() << handle_socket_error("send(...) error").what();
+                return false;
+            }
+            sendBuffer.consume(len);
+            totalUpload += len;
+        }
+        return true;
+    }
+
+    void finishConnect() {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (getsockopt(
+                descriptor, SOL_SOCKET, SO_ERROR, (char*)&error, &length
+            ) ||
+            error) {
+            logger.error() << "could not connect to " << to_string(addr)
+                           << " [error=" << error << "]";
+            closeSocket();
             return;
         }
         logger.info() << "connected to " << to_string(addr);
-        state = ConnectionState::CONNECTED;
+        {
+            std::lock_guard lock(mutex);
+            state = ConnectionState::CONNECTED;
+            reactor.setWritable(token, !sendBuffer.empty());
+        }
+        if (onConnected) {
+            onConnected();
+        }
     }
-public:
-    SocketConnection(SOCKET descriptor, sockaddr_in addr)
-        : descriptor(descriptor), addr(std::move(addr)), buffer(16'384) {}
 
-    ~SocketConnection() {
+    /// @brief Remove socket from the reactor and close it (mutex must not
+    /// be locked)
+    void closeSocket() {
+        u64id_t token;
+        {
+            std::lock_guard lock(mutex);
+            token = this->token;
+        }
+        reactor.remove(token);
+
+        std::lock_guard lock(mutex);
         if (state != ConnectionState::CLOSED) {
             shutdown(descriptor, 2);
+            closesocket(descriptor);
+            state = ConnectionState::CLOSED;
         }
-        if (thread) {
-            thread->join();
-        }
+    }
+public:
+    SocketConnection(
+        SocketReactor& reactor, SOCKET descriptor, sockaddr_in addr
+    )
+        : reactor(reactor),
+          descriptor(descriptor),
+          addr(std::move(addr)),
+          readBuffer(16'384) {
     }
 
-    void startListen() {
-        while (state == ConnectionState::CONNECTED) {
-            int size = recvsocket(descriptor, buffer.data(), buffer.size());
-            if (size == 0) {
-                logger.info() << "closed connection with " << to_string(addr);
-                closesocket(descriptor);
-                state = ConnectionState::CLOSED;
-                break;
-            } else if (size < 0) {
-                logger.warning() << "an error ocurred while receiving from "
-                            << to_string(addr);
-                auto error = handle_socket_error("recv(...) error");
-                closesocket(descriptor);
-                state = ConnectionState::CLOSED;
-                logger.error() << error.what();
-                break;
+    ~SocketConnection() {
+        closeSocket();
+    }
+
+    void onReadable() override {
+        if (state == ConnectionState::CONNECTING) {
+            finishConnect();
+            return;
+        }
+        bool closed = false;
+        size_t total = 0;
+        {
+            std::lock_guard lock(mutex);
+            if (state != ConnectionState::CONNECTED) {
+                return;
             }
-            {
-                std::lock_guard lock(mutex);
-                for (size_t i = 0; i < size; i++) {
-                    readBatch.emplace_back(buffer[i]);
+            // read until the socket is drained
+            while (true) {
+                auto [dst, free] = readBuffer.writable();
+                int size = recvsocket(descriptor, dst, free);
+                if (size > 0) {
+                    readBuffer.commit(size);
+                    total += size;
+                    if (static_cast<size_t>(size) == free) {
+                        continue;
+                    }
+                } else if (size == 0) {
+                    logger.info() << "closed connection with "
+                                  << to_string(addr);
+                    closed = true;
+                } else if (!would_block()) {
+                    logger.warning() << "an error ocurred while receiving from "
+                                     << to_string(addr);
+                    logger.error()
+                        << handle_socket_error("recv(...) error").what();
+                    closed = true;
                 }
-                totalDownload += size;
+                break;
             }
-            logger.debug() << "read " << size << " bytes from " << to_string(addr);
+        }
+        totalDownload += total;
+        if (closed) {
+            closeSocket();
         }
     }
 
-    void startClient() {
-        state = ConnectionState::CONNECTED;
-        thread = std::make_unique<std::thread>([this]() { startListen();});
+    void onWritable() override {
+        if (state == ConnectionState::CONNECTING) {
+            finishConnect();
+            return;
+        }
+        bool failed;
+        {
+            std::lock_guard lock(mutex);
+            failed = !flush();
+            if (!failed && sendBuffer.empty()) {
+                reactor.setWritable(token, false);
+            }
+        }
+        if (failed) {
+            closeSocket();
+        }
     }
 
     void connect(runnable callback) override {
-        thread = std::make_unique<std::thread>([this, callback]() {
-            connectSocket();
-            if (state == ConnectionState::CONNECTED) {
-                callback();
-            }
-            startListen();
-        });
+        onConnected = std::move(callback);
+        state = ConnectionState::CONNECTING;
+        logger.info() << "connecting to " << to_string(addr);
+        int res = connectsocket(
+            descriptor, (const sockaddr*)&addr, sizeof(sockaddr_in)
+        );
+        if (res < 0 && !connect_in_progress()) {
+            auto error = handle_socket_error("Connect failed");
+            closesocket(descriptor);
+            state = ConnectionState::CLOSED;
+            logger.error() << error.what();
+        }
     }
 
     int recv(char* buffer, size_t length) override {
         std::lock_guard lock(mutex);
 
-        if (state != ConnectionState::CONNECTED && readBatch.empty()) {
+        if (state != ConnectionState::CONNECTED && readBuffer.empty()) {
             return -1;
         }
-        int size = std::min(readBatch.size(), length);
-        std::memcpy(buffer, readBatch.data(), size);
-        readBatch.erase(readBatch.begin(), readBatch.begin() + size);
-        return size;
+        return readBuffer.read(buffer, length);
     }
 
     int send(const char* buffer, size_t length) override {
         if (state == ConnectionState::CLOSED) {
             return 0;
         }
-        int len = sendsocket(descriptor, buffer, length, 0);
-        if (len == -1) {
-            int err = errno;
-            close();
-            throw std::runtime_error(
-                "Send failed [errno=" + std::to_string(err) + "]: "
-                 + std::string(strerror(err))
-            );
+        std::string error;
+        {
+            std::lock_guard lock(mutex);
+            size_t sent = 0;
+            // queued data must be sent first
+            if (sendBuffer.empty() && state == ConnectionState::CONNECTED) {
+                int len = sendsocket(descriptor, buffer, length, SEND_FLAGS);
+                if (len >= 0) {
+                    sent = len;
+                    totalUpload += len;
+                } else if (!would_block()) {
+                    error = handle_socket_error("Send failed").what();
+                }
+            }
+            if (error.empty() && sent < length) {
+                sendBuffer.write(buffer + sent, length - sent);
+                reactor.setWritable(token, true);
+            }
+        }
+        if (!error.empty()) {
+            closeSocket();
+            throw std::runtime_error(error);
         }
-        totalUpload += len;
-        return len;
+        return length;
     }
 
     int available() override {
         std::lock_guard lock(mutex);
-        return readBatch.size();
+        return readBuffer.size();
     }
 
     void close(bool discardAll=false) override {
-        {
+        if (!discardAll) {
+            // send queued data if the socket accepts it without blocking
             std::lock_guard lock(mutex);
-            readBatch.clear();
-
-            if (state != ConnectionState::CLOSED) {
-                shutdown(descriptor, 2);
-                closesocket(descriptor);
+            if (state == ConnectionState::CONNECTED) {
+                flush();
             }
         }
-        if (thread) {
-            thread->join();
-            thread = nullptr;
-        }
+        closeSocket();
+
+        std::lock_guard lock(mutex);
+        readBuffer.clear();
+        sendBuffer.clear();
     }
 
     size_t pullUpload() override {
-        size_t size = totalUpload;
-        totalUpload = 0;
-        return size;
+        return totalUpload.exchange(0);
     }
 
     size_t pullDownload() override {
-        size_t size = totalDownload;
-        totalDownload = 0;
-        return size;
+        return totalDownload.exchange(0);
     }
 
     int getPort() const override {
@@ -439,8 +847,23 @@ public:
         return to_string(addr, false);
     }
 
+    /// @brief Serve connection accepted by a server
+    static std::shared_ptr<SocketConnection> accept(
+        SocketReactor& reactor, SOCKET descriptor, sockaddr_in addr
+    ) {
+        auto socket =
+            std::make_shared<SocketConnection>(reactor, descriptor, addr);
+        std::lock_guard lock(socket->mutex);
+        socket->state = ConnectionState::CONNECTED;
+        socket->token = reactor.add(descriptor, socket);
+        return socket;
+    }
+
     static std::shared_ptr<SocketConnection> connect(
-        const std::string& address, int port, runnable callback
+        SocketReactor& reactor,
+        const std::string& address,
+        int port,
+        runnable callback
     ) {
         addrinfo hints {};
 
@@ -463,8 +886,19 @@ public:
         if (descriptor == -1) {
             throw std::runtime_error("Could not create socket");
         }
-        auto socket = std::make_shared<SocketConnection>(descriptor, std::move(serverAddress));
+        if (!set_nonblocking(descriptor)) {
+            closesocket(descriptor);
+            throw handle_socket_error("Could not make socket non-blocking");
+        }
+        auto socket = std::make_shared<SocketConnection>(
+            reactor, descriptor, std::move(serverAddress)
+        );
         socket->connect(std::move(callback));
+        if (socket->state == ConnectionState::CONNECTING) {
+            // connection is finished when the socket becomes writable
+            std::lock_guard lock(socket->mutex);
+            socket->token = reactor.add(descriptor, socket, true);
+        }
         return socket;
     }
 
@@ -473,73 +907,93 @@ public:
     }
 };
 
-class SocketTcpSServer : public TcpServer {
+class SocketTcpSServer : public TcpServer, public SocketHandler {
     Network* network;
+    SocketReactor& reactor;
     SOCKET descriptor;
+    u64id_t token = 0;
     std::vector<u64id_t> clients;
     std::mutex clientsMutex;
-    bool open = true;
-    std::unique_ptr<std::thread> thread = nullptr;
+    std::atomic<bool> open = true;
     int port;
+    consumer<u64id_t> handler;
 public:
-    SocketTcpSServer(Network* network, SOCKET descriptor, int port)
-    : network(network), descriptor(descriptor), port(port) {}
+    SocketTcpSServer(
+        Network* network, SocketReactor& reactor, SOCKET descriptor, int port
+    )
+        : network(network),
+          reactor(reactor),
+          descriptor(descriptor),
+          port(port) {
+    }
 
     ~SocketTcpSServer() {
         closeSocket();
     }
 
     void startListen(consumer<u64id_t> handler) override {
-        thread = std::make_unique<std::thread>([this, handler]() {
-            while (open) {
-                logger.info() << "listening for connections";
-                if (listen(descriptor, 2) < 0) {
-                    close();
-                    break;
-                }
-                socklen_t addrlen = sizeof(sockaddr_in);
-                SOCKET clientDescriptor;
-                sockaddr_in address;
-                logger.info() << "accepting clients";
-                if ((clientDescriptor = accept(descriptor, (sockaddr*)&address, &addrlen)) == -1) {
+        this->handler = std::move(handler);
+        logger.info() << "listening for connections";
+        if (listen(descriptor, SOMAXCONN) < 0) {
+            logger.error() << handle_socket_error("listen(...) error").what();
+            close();
+        }
+    }
+
+    void onReadable() override {
+        // accept all pending clients
+        while (open) {
+            socklen_t addrlen = sizeof(sockaddr_in);
+            sockaddr_in address;
+            SOCKET clientDescriptor =
+                ::accept(descriptor, (sockaddr*)&address, &addrlen);
+            if (clientDescriptor == -1) {
+                if (!would_block()) {
+                    logger.error()
+                        << handle_socket_error("accept(...) error").what();
                     close();
-                    break;
-                }
-                logger.info() << "client connected: " << to_string(address);
-                auto socket = std::make_shared<SocketConnection>(
-                    clientDescriptor, address
-                );
-                socket->startClient();
-                u64id_t id = network->addConnection(socket);
-                {
-                    std::lock_guard lock(clientsMutex);
-                    clients.push_back(id);
                 }
-                handler(id);
+                break;
+            }
+            if (!set_nonblocking(clientDescriptor)) {
+                closesocket(clientDescriptor);
+                continue;
+            }
+            logger.info() << "client connected: " << to_string(address);
+            auto socket = SocketConnection::accept(
+                reactor, clientDescriptor, address
+            );
+            u64id_t id = network->addConnection(socket);
+            {
+                std::lock_guard lock(clientsMutex);
+                clients.push_back(id);
             }
-        });
+            handler(id);
+        }
     }
-    
+
+    void onWritable() override {
+    }
+
     void closeSocket() {
-        if (!open) {
+        if (!open.exchange(false)) {
             return;
         }
         logger.info() << "closing server";
-        open = false;
+        reactor.remove(token);
 
+        std::vector<u64id_t> clients;
         {
             std::lock_guard lock(clientsMutex);
-            for (u64id_t clientid : clients) {
-                if (auto client = network->getConnection(clientid)) {
-                    client->close();
-                }
+            std::swap(clients, this->clients);
+        }
+        for (u64id_t clientid : clients) {
+            if (auto client = network->getConnection(clientid)) {
+                client->close();
             }
         }
-        clients.clear();
-
         shutdown(descriptor, 2);
         closesocket(descriptor);
-        thread->join();
     }
 
     void close() override {
@@ -555,7 +1009,10 @@ public:
     }
 
     static std::shared_ptr<SocketTcpSServer> openServer(
-        Network* network, int port, consumer<u64id_t> handler
+        Network* network,
+        SocketReactor& reactor,
+        int port,
+        consumer<u64id_t> handler
     ) {
         SOCKET descriptor = socket(
             AF_INET, SOCK_STREAM, 0
@@ -580,16 +1037,25 @@ public:
             closesocket(descriptor);
             throw std::runtime_error("could not bind port "+std::to_string(port));
         }
+        if (!set_nonblocking(descriptor)) {
+            closesocket(descriptor);
+            throw handle_socket_error("Could not make socket non-blocking");
+        }
         logger.info() << "opened server at port " << port;
-        auto server =
-            std::make_shared<SocketTcpSServer>(network, descriptor, port);
+        auto server = std::make_shared<SocketTcpSServer>(
+            network, reactor, descriptor, port
+        );
         server->startListen(std::move(handler));
+        if (server->isOpen()) {
+            server->token = reactor.add(descriptor, server);
+        }
         return server;
     }
 };
 
 Network::Network(std::unique_ptr<Requests> requests)
-: requests(std::move(requests)) {
+    : requests(std::move(requests)),
+      reactor(std::make_unique<SocketReactor>()) {
 }
 
 Network::~Network() = default;
@@ -632,19 +1098,24 @@ TcpServer* Network::getServer(u64id_t id) const {
 }
 
 u64id_t Network::connect(const std::string& address, int port, consumer<u64id_t> callback) {
+    u64id_t id;
+    {
+        std::lock_guard lock(connectionsMutex);
+        id = nextConnection++;
+    }
+    // address resolution may take a while, the lock is not held
+    auto socket = SocketConnection::connect(
+        *reactor, address, port, [id, callback]() { callback(id); }
+    );
     std::lock_guard lock(connectionsMutex);
-    
-    u64id_t id = nextConnection++;
-    auto socket = SocketConnection::connect(address, port, [id, callback]() {
-        callback(id);
-    });
     connections[id] = std::move(socket);
     return id;
 }
 
 u64id_t Network::openServer(int port, consumer<u64id_t> handler) {
     u64id_t id = nextServer++;
-    auto server = SocketTcpSServer::openServer(this, port, handler);
+    auto server =
+        SocketTcpSServer::openServer(this, *reactor, port, handler);
     servers[id] = std::move(server);
     return id;
 }
@@ -668,6 +1139,9 @@ size_t Network::getTotalDownload() const {
 void Network::update() {
     requests->update();
 
+    // destroyed without the lock held as connections wait for the reactor
+    // handlers which may add connections
+    std::vector<std::shared_ptr<Connection>> closed;
     {
         std::lock_guard lock(connectionsMutex);
         auto socketiter = connections.begin();
@@ -677,6 +1151,7 @@ void Network::update() {
             totalUpload += socket->pullUpload();
             if (socket->available() == 0 && 
                 socket->getState() == ConnectionState::CLOSED) {
+                closed.push_back(std::move(socketiter->second));
                 socketiter = connections.erase(socketiter);
                 continue;
             }
@@ -61,6 +61,8 @@ namespace network {
         virtual ConnectionState getState() const = 0;
     };
 
+    class SocketReactor;
+
     class TcpServer {
     public:
         virtual ~TcpServer() {}
@@ -72,6 +74,9 @@ namespace network {
 
     class Network {
         std::unique_ptr<Requests> requests;
+        /// @brief Serves all connections and servers sockets, must outlive
+        /// them
+        std::unique_ptr<SocketReactor> reactor;
 
         std::unordered_map<u64id_t, std::shared_ptr<Connection>> connections;
         std::mutex connectionsMutex {};
@@ -20,6 +20,7 @@
 #include "rigging.hpp"
 #include "physics/Hitbox.hpp"
 #include "physics/PhysicsSolver.hpp"
+#include "util/ForkJoinPool.hpp"
 #include "world/Level.hpp"
 
 static debug::Logger logger("entities");
@@ -28,6 +29,17 @@ static inline std::string COMP_TRANSFORM = "transform";
 static inline std::string COMP_RIGIDBODY = "rigidbody";
 static inline std::string COMP_SKELETON = "skeleton";
 static inline std::string SAVED_DATA_VARNAME = "SAVED_DATA";
+/// @brief Size of the entities spatial index cell
+static inline constexpr float GRID_CELL_SIZE = 8.0f;
+/// @brief Minimal number of bodies to step physics in parallel
+static inline constexpr size_t PARALLEL_PHYSICS_MIN_BODIES = 64;
+/// @brief Number of body physics substeps, collisions are swept so fast
+/// bodies do not need more
+static inline constexpr uint PHYSICS_SUBSTEPS = 2;
+/// @brief Max velocity of a resting body
+static inline constexpr float SLEEP_VELOCITY = 0.01f;
+/// @brief Number of physics steps a body must rest before falling asleep
+static inline constexpr uint SLEEP_TICKS = 30;
 
 void Transform::refresh() {
     combined = glm::mat4(1.0f);
@@ -51,6 +63,11 @@ glm::vec3 Entity::getInterpolatedPosition() const {
     return getTransform().pos;
 }
 
+void Entity::updateBounds() {
+    getRigidbody().hitbox.wakeUp();
+    entities.updateBounds(entity);
+}
+
 void Entity::destroy() {
     if (isValid()) {
         entities.despawn(id);
@@ -72,8 +89,41 @@ void Entity::setRig(const rigging::SkeletonConfig* rigConfig) {
     );
 }
 
-Entities::Entities(Level& level)
-    : level(level), sensorsTickClock(20, 3), updateTickClock(20, 3) {
+Entities::Entities(Level& level, uint physicsWorkers)
+    : level(level),
+      sensorsTickClock(20, 3),
+      updateTickClock(20, 3),
+      grid(GRID_CELL_SIZE),
+      pool(std::make_unique<util::ForkJoinPool>(physicsWorkers)) {
+}
+
+Entities::~Entities() = default;
+
+void Entities::updateBounds(entt::entity entity) {
+    auto& transform = registry.get<Transform>(entity);
+    if (transform.moved) {
+        transform.moved = false;
+        movedTransforms--;
+    }
+    auto aabb = registry.get<Rigidbody>(entity).hitbox.getAABB();
+    aabb.fix();
+    aabb.addPoint(transform.pos);
+    grid.set(entity, aabb);
+}
+
+void Entities::flushBounds() {
+    if (movedTransforms == 0) {
+        return;
+    }
+    auto view = registry.view<Transform, Rigidbody>();
+    for (auto [entity, transform, rigidbody] : view.each()) {
+        if (transform.moved) {
+            updateBounds(entity);
+            if (movedTransforms == 0) {
+                break;
+            }
+        }
+    }
 }
 
 template <void (*callback)(const Entity&, size_t, entityid_t)>
@@ -154,7 +204,7 @@ entityid_t Entities::spawn(
     uids[entity] = id;
 
     registry.emplace<EntityId>(entity, static_cast<entityid_t>(id), def);
-    const auto& tsf = registry.emplace<Transform>(
+    auto& tsf = registry.emplace<Transform>(
         entity,
         position,
         glm::vec3(1.0f),
@@ -162,6 +212,7 @@ entityid_t Entities::spawn(
         glm::mat4(1.0f),
         true
     );
+    tsf.movedCounter = &movedTransforms;
     auto& body = registry.emplace<Rigidbody>(
         entity,
         true,
@@ -185,6 +236,7 @@ entityid_t Entities::spawn(
         loadEntity(saved, get(id).value());
     }
     body.hitbox.position = tsf.pos;
+    updateBounds(entity);
     scripting::on_entity_spawn(
         def, id, scripting.components, args, componentsMap);
     return id;
@@ -255,14 +307,16 @@ std::optional<Entities::RaycastResult> Entities::rayCast(
     glm::vec3 start, glm::vec3 dir, float maxDistance, entityid_t ignore
 ) {
     Ray ray(start, dir);
-    auto view = registry.view<EntityId, Transform, Rigidbody>();
 
     entityid_t foundUID = 0;
     glm::ivec3 foundNormal;
 
-    for (auto [entity, eid, transform, body] : view.each()) {
+    flushBounds();
+    grid.raycast(start, dir, maxDistance, [&](entt::entity entity) {
+        const auto& eid = registry.get<EntityId>(entity);
+        const auto& body = registry.get<Rigidbody>(entity);
         if (eid.uid == ignore || !body.enabled) {
-            continue;
+            return maxDistance;
         }
         auto& hitbox = body.hitbox;
         glm::ivec3 normal;
@@ -274,7 +328,8 @@ std::optional<Entities::RaycastResult> Entities::rayCast(
             foundNormal = normal;
             maxDistance = static_cast<float>(distance);
         }
-    }
+        return maxDistance;
+    });
     if (foundUID) {
         return Entities::RaycastResult {foundUID, foundNormal, maxDistance};
     } else {
@@ -398,7 +453,11 @@ void Entities::clean() {
             for (auto& sensor : rigidbody.sensors) {
                 physics->removeSensor(&sensor);
             }
+            if (registry.get<Transform>(it->second).moved) {
+                movedTransforms--;
+            }
             uids.erase(it->second);
+            grid.remove(it->second);
             registry.destroy(it->second);
             it = entities.erase(it);
         }
@@ -457,34 +516,151 @@ void Entities::preparePhysics(float delta) {
     }
 }
 
+namespace {
+    struct BodyStep {
+        entt::entity entity;
+        entityid_t uid;
+        Hitbox* hitbox;
+        Transform* transform;
+        glm::vec3 prevVel;
+        bool prevGrounded;
+        bool grounded = false;
+        /// @brief Body is awake and simulated in this step
+        bool stepped = false;
+        /// @brief Velocity change length
+        float impact = 0.0f;
+        /// @brief Range of sensors triggered by the body in the task list
+        size_t sensorsBegin = 0;
+        size_t sensorsEnd = 0;
+    };
+}
+
 void Entities::updatePhysics(float delta) {
+    flushBounds();
     preparePhysics(delta);
 
     auto view = registry.view<EntityId, Transform, Rigidbody>();
     auto physics = level.physics.get();
+
+    std::vector<BodyStep> bodies;
+    size_t awake = 0;
     for (auto [entity, eid, transform, rigidbody] : view.each()) {
         if (!rigidbody.enabled || rigidbody.hitbox.type == BodyType::STATIC) {
             continue;
         }
         auto& hitbox = rigidbody.hitbox;
-        auto prevVel = hitbox.velocity;
-        bool grounded = hitbox.grounded;
+        // velocity may be changed by scripts or the player controller
+        if (hitbox.sleeping && glm::length(hitbox.velocity) > SLEEP_VELOCITY) {
+            hitbox.wakeUp();
+        }
+        awake += !hitbox.sleeping;
+        bodies.push_back(BodyStep {
+            entity,
+            eid.uid,
+            &hitbox,
+            &transform,
+            hitbox.velocity,
+            hitbox.grounded});
+    }
+
+    // bodies are stepped in parallel by contiguous ranges, scripting
+    // events are dispatched after that in the bodies order
+    size_t tasksCount = 1;
+    if (awake >= PARALLEL_PHYSICS_MIN_BODIES) {
+        tasksCount = std::min<size_t>(
+            bodies.size(), pool->getThreadsCount() * 4
+        );
+    }
+    std::vector<std::vector<Sensor*>> triggered(tasksCount);
+    std::vector<runnable> tasks;
+    for (size_t task = 0; task < tasksCount; task++) {
+        size_t begin = bodies.size() * task / tasksCount;
+        size_t end = bodies.size() * (task + 1) / tasksCount;
+        tasks.push_back([&, task, begin, end]() {
+            auto& sensors = triggered[task];
+            for (size_t i = begin; i < end; i++) {
+                auto& body = bodies[i];
+                auto& hitbox = *body.hitbox;
+
+                body.stepped = !hitbox.sleeping;
+                if (body.stepped) {
+                    physics->step(
+                        *level.chunks, hitbox, delta, PHYSICS_SUBSTEPS
+                    );
+                    hitbox.linearDamping = hitbox.grounded * 24;
+                    body.impact = glm::length(body.prevVel - hitbox.velocity);
+                    body.transform->setPos(hitbox.position);
+
+                    if (hitbox.grounded &&
+                        glm::length(hitbox.velocity) <= SLEEP_VELOCITY) {
+                        if (++hitbox.restTicks >= SLEEP_TICKS) {
+                            hitbox.sleeping = true;
+                            hitbox.velocity = glm::vec3(0.0f);
+                        }
+                    } else {
+                        hitbox.restTicks = 0;
+                    }
+                }
+                body.grounded = hitbox.grounded;
+
+                // resting bodies stay inside of sensors
+                body.sensorsBegin = sensors.size();
+                physics->getTriggeredSensors(hitbox, body.uid, sensors);
+                body.sensorsEnd = sensors.size();
+            }
+        });
+    }
+    if (tasks.size() == 1) {
+        tasks[0]();
+    } else {
+        pool->run(tasks);
+    }
+
+    awakeBodies = 0;
+    sleepingBodies = 0;
+    for (size_t task = 0; task < tasksCount; task++) {
+        const auto& sensors = triggered[task];
+        size_t begin = bodies.size() * task / tasksCount;
+        size_t end = bodies.size() * (task + 1) / tasksCount;
+        for (size_t i = begin; i < end; i++) {
+            const auto& body = bodies[i];
+            if (body.stepped) {
+                updateBounds(body.entity);
+            }
+            if (body.hitbox->sleeping) {
+                sleepingBodies++;
+            } else {
+                awakeBodies++;
+            }
+            for (size_t j = body.sensorsBegin; j < body.sensorsEnd; j++) {
+                PhysicsSolver::enterSensor(*sensors[j], body.uid);
+            }
+            if (body.grounded && !body.prevGrounded) {
+                scripting::on_entity_grounded(*get(body.uid), body.impact);
+            }
+            if (!body.grounded && body.prevGrounded) {
+                scripting::on_entity_fall(*get(body.uid));
+            }
+        }
+    }
+}
 
-        float vel = glm::length(prevVel);
-        int substeps = static_cast<int>(delta * vel * 20);
-        substeps = std::min(100, std::max(2, substeps));
-        physics->step(*level.chunks, hitbox, delta, substeps, eid.uid);
-        hitbox.linearDamping = hitbox.grounded * 24;
-        transform.setPos(hitbox.position);
-        if (hitbox.grounded && !grounded) {
-            scripting::on_entity_grounded(
-                *get(eid.uid), glm::length(prevVel - hitbox.velocity)
-            );
+void Entities::wakeUpBodies(const AABB& area) {
+    if (sleepingBodies == 0) {
+        return;
+    }
+    flushBounds();
+    grid.query(area, [this, &area](entt::entity entity) {
+        auto& hitbox = registry.get<Rigidbody>(entity).hitbox;
+        if (!hitbox.sleeping) {
+            return;
         }
-        if (!hitbox.grounded && grounded) {
-            scripting::on_entity_fall(*get(eid.uid));
+        auto aabb = hitbox.getAABB();
+        aabb.fix();
+        if (aabb.intersect(area)) {
+            hitbox.wakeUp();
         }
-    }
+    });
 }
 
 void Entities::update(float delta) {
@@ -588,45 +764,57 @@ void Entities::render(
 }
 
 bool Entities::hasBlockingInside(AABB aabb) {
-    auto view = registry.view<EntityId, Rigidbody>();
-    for (auto [entity, eid, body] : view.each()) {
-        if (eid.def.blocking && aabb.intersect(body.hitbox.getAABB(), -0.05f)) {
-            return true;
+    bool found = false;
+    AABB area = aabb;
+    area.fix();
+    flushBounds();
+    grid.query(area, [&](entt::entity entity) {
+        const auto& eid = registry.get<EntityId>(entity);
+        const auto& body = registry.get<Rigidbody>(entity);
+        if (!found && eid.def.blocking &&
+            aabb.intersect(body.hitbox.getAABB(), -0.05f)) {
+            found = true;
+        }
+    });
+    return found;
+}
+
+template <class Func>
+void Entities::collectInside(
+    const AABB& area, std::vector<Entity>& collected, const Func& filter
+) {
+    flushBounds();
+    grid.query(area, [&](entt::entity entity) {
+        if (!filter(registry.get<EntityId>(entity),
+                    registry.get<Transform>(entity))) {
+            return;
         }
-    }
-    return false;
+        const auto& found = uids.find(entity);
+        if (found == uids.end()) {
+            return;
+        }
+        if (auto wrapper = get(found->second)) {
+            collected.push_back(*wrapper);
+        }
+    });
 }
 
 std::vector<Entity> Entities::getAllInside(AABB aabb) {
     std::vector<Entity> collected;
-    auto view = registry.view<EntityId, Transform>();
-    for (auto [entity, eid, transform] : view.each()) {
-        if (!eid.destroyFlag && aabb.contains(transform.pos)) {
-            const auto& found = uids.find(entity);
-            if (found == uids.end()) {
-                continue;
-            }
-            if (auto wrapper = get(found->second)) {
-                collected.push_back(*wrapper);
-            }
-        }
-    }
+    AABB area = aabb;
+    area.fix();
+    collectInside(area, collected, [&aabb](auto& eid, auto& transform) {
+        return !eid.destroyFlag && aabb.contains(transform.pos);
+    });
     return collected;
 }
 
 std::vector<Entity> Entities::getAllInRadius(glm::vec3 center, float radius) {
     std::vector<Entity> collected;
-    auto view = registry.view<Transform>();
-    for (auto [entity, transform] : view.each()) {
-        if (glm::distance2(transform.pos, center) <= radius * radius) {
-            const auto& found = uids.find(entity);
-            if (found == uids.end()) {
-                continue;
-            }
-            if (auto wrapper = get(found->second)) {
-                collected.push_back(*wrapper);
-            }
-        }
-    }
+    AABB area(center - radius, center + radius);
+    area.fix();
+    collectInside(area, collected, [=](auto&, auto& transform) {
+        return glm::distance2(transform.pos, center) <= radius * radius;
+    });
     return collected;
 }
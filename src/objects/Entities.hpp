@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <glm/glm.hpp>
 #include <memory>
 #include <optional>
@@ -7,6 +8,7 @@
 
 #include "data/dv.hpp"
 #include "physics/Hitbox.hpp"
+#include "physics/SpatialGrid.hpp"
 #include "typedefs.hpp"
 #include "util/Clock.hpp"
 #define GLM_ENABLE_EXPERIMENTAL
@@ -48,6 +50,12 @@ struct Transform {
     glm::vec3 displayPos;
     glm::vec3 displaySize;
 
+    /// @brief Position changed since the entity was updated in the spatial
+    /// index
+    bool moved = false;
+    /// @brief Number of moved transforms of the entities registry
+    std::atomic<size_t>* movedCounter = nullptr;
+
     void refresh();
 
     inline void setRot(glm::mat3 m) {
@@ -66,6 +74,12 @@ struct Transform {
         if (glm::distance2(displayPos, v) >= EPSILON) {
             dirty = true;
         }
+        if (!moved && v != pos) {
+            moved = true;
+            if (movedCounter) {
+                (*movedCounter)++;
+            }
+        }
         pos = v;
     }
 };
@@ -111,6 +125,10 @@ namespace rigging {
     class SkeletonConfig;
 }
 
+namespace util {
+    class ForkJoinPool;
+}
+
 class Entity {
     Entities& entities;
     entityid_t id;
@@ -172,6 +190,11 @@ public:
 
     void setInterpolatedPosition(const glm::vec3& position);
 
+    /// @brief Update the entity in the spatial index and wake up the body.
+    /// Must be called after changing the hitbox, transform position changes
+    /// are tracked by Transform::setPos
+    void updateBounds();
+
     glm::vec3 getInterpolatedPosition() const;
 
     void destroy();
@@ -185,11 +208,29 @@ class Entities {
     entityid_t nextID = 1;
     util::Clock sensorsTickClock;
     util::Clock updateTickClock;
+    /// @brief Spatial index of entity hitboxes and transform positions
+    SpatialGrid<entt::entity> grid;
+    /// @brief Number of transforms moved since their entities were updated
+    /// in the spatial index
+    std::atomic<size_t> movedTransforms = 0;
+    /// @brief Physics steps workers
+    std::unique_ptr<util::ForkJoinPool> pool;
+    /// @brief Number of bodies simulated in the last physics step
+    size_t awakeBodies = 0;
+    /// @brief Number of resting bodies skipped in the last physics step
+    size_t sleepingBodies = 0;
 
     void updateSensors(
         Rigidbody& body, const Transform& tsf, std::vector<Sensor*>& sensors
     );
     void preparePhysics(float delta);
+    /// @brief Update entities with moved transforms in the spatial index
+    void flushBounds();
+
+    template <class Func>
+    void collectInside(
+        const AABB& area, std::vector<Entity>& collected, const Func& filter
+    );
 public:
     struct RaycastResult {
         entityid_t entity;
@@ -197,10 +238,17 @@ public:
         float distance;
     };
 
-    Entities(Level& level);
+    /// @param physicsWorkers number of threads stepping bodies physics,
+    /// 0 is auto
+    Entities(Level& level, uint physicsWorkers = 1);
+    ~Entities();
 
     void clean();
+    void updateBounds(entt::entity entity);
     void updatePhysics(float delta);
+
+    /// @brief Wake up resting bodies which boxes intersect the area
+    void wakeUpBodies(const AABB& area);
     void update(float delta);
 
     void renderDebug(
@@ -267,4 +315,12 @@ public:
     inline entityid_t peekNextID() const {
         return nextID;
     }
+
+    inline size_t getAwakeBodiesCount() const {
+        return awakeBodies;
+    }
+
+    inline size_t getSleepingBodiesCount() const {
+        return sleepingBodies;
+    }
 };
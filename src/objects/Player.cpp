@@ -182,7 +182,9 @@ void Player::teleport(glm::vec3 position) {
     this->position = position;
 
     if (auto entity = level.entities->get(eid)) {
-        entity->getRigidbody().hitbox.position = position;
+        auto& hitbox = entity->getRigidbody().hitbox;
+        hitbox.position = position;
+        hitbox.wakeUp();
         entity->getTransform().setPos(position);
         entity->setInterpolatedPosition(position);
     }
@@ -199,7 +201,7 @@ void Player::attemptToFindSpawnpoint() {
         newpos.y--;
     }
 
-    voxel* headvox = chunks->get(newpos.x, newpos.y + 1, newpos.z);
+    const voxel* headvox = chunks->get(newpos.x, newpos.y + 1, newpos.z);
     if (chunks->isObstacleBlock(newpos.x, newpos.y, newpos.z) ||
         headvox == nullptr || headvox->id != 0) {
         return;
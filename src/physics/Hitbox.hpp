@@ -57,9 +57,18 @@ struct Hitbox {
     bool grounded = false;
     float gravityScale = 1.0f;
     bool crouching = false;
+    /// @brief Resting body is not simulated until woken up
+    bool sleeping = false;
+    /// @brief Number of physics steps the body stays grounded and still
+    uint restTicks = 0;
 
     Hitbox(BodyType type, glm::vec3 position, glm::vec3 halfsize);
 
+    void wakeUp() {
+        sleeping = false;
+        restTicks = 0;
+    }
+
     AABB getAABB() const {
         return AABB(position-halfsize, position+halfsize);
     }
@@ -1,9 +1,13 @@
 #include "PhysicsSolver.hpp"
 #include "Hitbox.hpp"
 
+#include "content/Content.hpp"
 #include "maths/aabb.hpp"
+#include "maths/voxmaths.hpp"
 #include "voxels/Block.hpp"
+#include "voxels/Chunk.hpp"
 #include "voxels/GlobalChunks.hpp"
+#include "voxels/blocks_agent.hpp"
 #include "voxels/voxel.hpp"
 
 #include <iostream>
@@ -11,88 +15,298 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/norm.hpp>
 
+/// @brief Contact tolerance. Obstacles penetrated less than that are
+/// pushed out, touching side faces are not considered obstacles
 const float E = 0.03f;
-const float MAX_FIX = 0.1f;
+/// @brief Max height of obstacles a grounded body walks on
+const float STEP_HEIGHT = 0.5f;
+const float SENSORS_GRID_CELL_SIZE = 8.0f;
+/// @brief Max number of voxels checked for obstacles in one step,
+/// steps of faster bodies are split
+const float MAX_OBSTACLES_AREA = 32768.0f;
+/// @brief Min duration of a split step
+const float MIN_SPLIT_DELTA = 1.0f / 1024.0f;
+/// @brief Max distance covered by the obstacles area when the step can not
+/// be split anymore
+const float MAX_TRAVEL = 64.0f;
 
-PhysicsSolver::PhysicsSolver(glm::vec3 gravity) : gravity(gravity) {
+PhysicsSolver::PhysicsSolver(glm::vec3 gravity)
+    : gravity(gravity), sensorsGrid(SENSORS_GRID_CELL_SIZE) {
+}
+
+/// @brief Collect obstacle boxes of the voxels area. Block hitboxes are
+/// clipped by voxels the way point checks see them, missing chunks and
+/// voxels below the world are solid.
+static void collect_obstacles(
+    const GlobalChunks& chunks,
+    const glm::ivec3& min,
+    const glm::ivec3& max,
+    std::vector<AABB>& dst
+) {
+    const auto& blocks = chunks.getContentIndices().blocks;
+    int maxY = std::min(max.y, CHUNK_H - 1);
+    for (int cz = floordiv<CHUNK_D>(min.z); cz <= floordiv<CHUNK_D>(max.z);
+         cz++) {
+        int z0 = std::max(min.z, cz * CHUNK_D);
+        int z1 = std::min(max.z, cz * CHUNK_D + CHUNK_D - 1);
+        for (int cx = floordiv<CHUNK_W>(min.x);
+             cx <= floordiv<CHUNK_W>(max.x);
+             cx++) {
+            int x0 = std::max(min.x, cx * CHUNK_W);
+            int x1 = std::min(max.x, cx * CHUNK_W + CHUNK_W - 1);
+            const Chunk* chunk = chunks.getChunk(cx, cz);
+            for (int y = min.y; y <= maxY; y++) {
+                for (int z = z0; z <= z1; z++) {
+                    for (int x = x0; x <= x1; x++) {
+                        glm::vec3 pos(x, y, z);
+                        if (chunk == nullptr || y < 0) {
+                            dst.emplace_back(pos, pos + 1.0f);
+                            continue;
+                        }
+                        const auto& vox = chunk->voxels[vox_index(
+                            x - cx * CHUNK_W, y, z - cz * CHUNK_D
+                        )];
+                        const auto& def = blocks.require(vox.id);
+                        if (!def.obstacle) {
+                            continue;
+                        }
+                        glm::vec3 offset {};
+                        if (vox.state.segment) {
+                            glm::ivec3 point(x, y, z);
+                            offset = blocks_agent::seek_origin(
+                                         chunks, point, def, vox.state
+                                     ) -
+                                     point;
+                        }
+                        const auto& boxes =
+                            def.rotatable ? def.rt.hitboxes[vox.state.rotation]
+                                          : def.hitboxes;
+                        for (const auto& box : boxes) {
+                            auto a = glm::max(box.min() + offset, 0.0f);
+                            auto b = glm::min(box.max() + offset, 1.0f);
+                            if (a.x < b.x && a.y < b.y && a.z < b.z) {
+                                dst.emplace_back(pos + a, pos + b);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
 }
 
 void PhysicsSolver::step(
     const GlobalChunks& chunks, 
     Hitbox& hitbox, 
     float delta, 
-    uint substeps, 
-    entityid_t entity
+    uint substeps
+) {
+    glm::vec3 gravityPart =
+        glm::abs(gravity) * std::abs(hitbox.gravityScale) * delta;
+    glm::vec3 travel = (glm::abs(hitbox.velocity) + gravityPart) * delta;
+    glm::vec3 area = hitbox.halfsize * 2.0f + travel * 2.0f + 3.0f;
+    if (!(area.x * area.y * area.z <= MAX_OBSTACLES_AREA)) {
+        if (delta > MIN_SPLIT_DELTA) {
+            substeps = std::max(1u, substeps / 2);
+            step(chunks, hitbox, delta * 0.5f, substeps);
+            step(chunks, hitbox, delta * 0.5f, substeps);
+            return;
+        }
+        travel = glm::min(travel, glm::vec3(MAX_TRAVEL));
+    }
+    AABB bounds = hitbox.getAABB();
+    bounds.fix();
+    // one voxel margin covers steps and supports checks
+    glm::ivec3 min = glm::floor(bounds.min() - travel - 1.0f);
+    glm::ivec3 max = glm::floor(bounds.max() + travel + 1.0f);
+
+    static thread_local std::vector<AABB> obstacles;
+    obstacles.clear();
+    collect_obstacles(chunks, min, max, obstacles);
+    step(obstacles, hitbox, delta, substeps);
+}
+
+/// @brief Move the box along the axis until it touches an obstacle
+/// @param offset movement distance, clipped by obstacles
+/// @param e contact tolerance
+/// @return true if the movement is clipped
+static bool sweep_axis(
+    const std::vector<AABB>& obstacles,
+    AABB& box,
+    int axis,
+    float& offset,
+    float e
 ) {
+    if (offset == 0.0f) {
+        return false;
+    }
+    int u = (axis + 1) % 3;
+    int v = (axis + 2) % 3;
+    bool positive = offset > 0.0f;
+    bool clipped = false;
+    for (const auto& obstacle : obstacles) {
+        if (obstacle.b[u] <= box.a[u] + e || obstacle.a[u] >= box.b[u] - e ||
+            obstacle.b[v] <= box.a[v] + e || obstacle.a[v] >= box.b[v] - e) {
+            continue;
+        }
+        if (positive && obstacle.a[axis] >= box.b[axis] - e) {
+            float gap = obstacle.a[axis] - box.b[axis];
+            if (gap <= offset) {
+                offset = gap;
+                clipped = true;
+            }
+        } else if (!positive && obstacle.b[axis] <= box.a[axis] + e) {
+            float gap = obstacle.b[axis] - box.a[axis];
+            if (gap >= offset) {
+                offset = gap;
+                clipped = true;
+            }
+        }
+    }
+    box.a[axis] += offset;
+    box.b[axis] += offset;
+    return clipped;
+}
+
+namespace {
+    struct Movement {
+        AABB box;
+        glm::vec3 offset;
+        glm::bvec3 clipped;
+    };
+}
+
+/// @brief Sweep the box along Y, X and Z axes
+static Movement move_box(
+    const std::vector<AABB>& obstacles,
+    const AABB& box,
+    const glm::vec3& offset,
+    float e
+) {
+    Movement movement {box, offset, glm::bvec3(false)};
+    for (int axis : {1, 0, 2}) {
+        movement.clipped[axis] = sweep_axis(
+            obstacles, movement.box, axis, movement.offset[axis], e
+        );
+    }
+    return movement;
+}
+
+/// @brief Check if there is an obstacle under the box
+static bool has_support(
+    const std::vector<AABB>& obstacles, const AABB& box
+) {
+    float y = box.a.y - E;
+    for (const auto& obstacle : obstacles) {
+        if (obstacle.a.y <= y && obstacle.b.y >= y &&
+            obstacle.a.x <= box.b.x - E && obstacle.b.x >= box.a.x + E &&
+            obstacle.a.z <= box.b.z - E && obstacle.b.z >= box.a.z + E) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PhysicsSolver::step(
+    const std::vector<AABB>& obstacles,
+    Hitbox& hitbox,
+    float delta,
+    uint substeps
+) const {
     float dt = delta / static_cast<float>(substeps);
     float linearDamping = hitbox.linearDamping;
-    float s = 2.0f/BLOCK_AABB_GRID;
 
     const glm::vec3& half = hitbox.halfsize;
     glm::vec3& pos = hitbox.position;
     glm::vec3& vel = hitbox.velocity;
     float gravityScale = hitbox.gravityScale;
-    
-    bool prevGrounded = hitbox.grounded;
+    // tolerance must not exceed the body size
+    float e = std::min(E, std::min(half.x, std::min(half.y, half.z)) * 0.5f);
+
+    float stepHeight =
+        (hitbox.grounded && gravityScale > 0.0f) ? STEP_HEIGHT : 0.0f;
     hitbox.grounded = false;
     for (uint i = 0; i < substeps; i++) {
-        float px = pos.x;
-        float py = pos.y;
-        float pz = pos.z;
-        
         vel += gravity * dt * gravityScale;
-        if (hitbox.type == BodyType::DYNAMIC) {
-            colisionCalc(chunks, hitbox, vel, pos, half, 
-                         (prevGrounded && gravityScale > 0.0f) ? 0.5f : 0.0f);
-        }
         vel.x *= glm::max(0.0f, 1.0f - dt * linearDamping);
         if (hitbox.verticalDamping) {
             vel.y *= glm::max(0.0f, 1.0f - dt * linearDamping);
         }
         vel.z *= glm::max(0.0f, 1.0f - dt * linearDamping);
 
-        pos += vel * dt + gravity * gravityScale * dt * dt * 0.5f;
-        if (hitbox.grounded && pos.y < py) {
-            pos.y = py;
+        glm::vec3 offset = vel * dt + gravity * gravityScale * dt * dt * 0.5f;
+        if (hitbox.type != BodyType::DYNAMIC) {
+            pos += offset;
+            continue;
         }
+        AABB box(pos - half, pos + half);
+        auto movement = move_box(obstacles, box, offset, e);
+        if (stepHeight > 0.0f && (movement.clipped.x || movement.clipped.z)) {
+            // try to walk over the obstacle: raise, move and lower the box
+            float raise = stepHeight;
+            AABB raised = box;
+            sweep_axis(obstacles, raised, 1, raise, e);
+            auto stepped = move_box(
+                obstacles, raised, {offset.x, 0.0f, offset.z}, e
+            );
+            stepped.offset.y = std::min(offset.y, 0.0f) - raise;
+            stepped.clipped.y = sweep_axis(
+                obstacles, stepped.box, 1, stepped.offset.y, e
+            );
+            stepped.offset.y += raise;
 
-        if (hitbox.crouching && hitbox.grounded){
-            float y = (pos.y-half.y-E);
-            hitbox.grounded = false;
-            for (int ix = 0; ix <= (half.x-E)*2/s; ix++) {
-                float x = (px-half.x+E) + ix * s;
-                for (int iz = 0; iz <= (half.z-E)*2/s; iz++){
-                    float z = (pos.z-half.z+E) + iz * s;
-                    if (chunks.isObstacleAt(x,y,z)){
-                        hitbox.grounded = true;
-                        break;
-                    }
-                }
+            glm::vec2 walked(movement.offset.x, movement.offset.z);
+            glm::vec2 steppedWalked(stepped.offset.x, stepped.offset.z);
+            if (glm::dot(steppedWalked, steppedWalked) >
+                glm::dot(walked, walked)) {
+                movement = stepped;
             }
-            if (!hitbox.grounded) {
-                pos.z = pz;
+        }
+        for (int axis = 0; axis < 3; axis++) {
+            if (movement.clipped[axis]) {
+                vel[axis] = 0.0f;
             }
-            hitbox.grounded = false;
-            for (int ix = 0; ix <= (half.x-E)*2/s; ix++) {
-                float x = (pos.x-half.x+E) + ix * s;
-                for (int iz = 0; iz <= (half.z-E)*2/s; iz++){
-                    float z = (pz-half.z+E) + iz * s;
-                    if (chunks.isObstacleAt(x,y,z)){
-                        hitbox.grounded = true;
-                        break;
-                    }
-                }
+        }
+        if (movement.clipped.y && offset.y < 0.0f) {
+            hitbox.grounded = true;
+        }
+        glm::vec3 prevPos = pos;
+        pos = movement.box.center();
+
+        if (hitbox.crouching && hitbox.grounded) {
+            // don't fall from edges
+            glm::vec3 p(prevPos.x, pos.y, pos.z);
+            if (!has_support(obstacles, AABB(p - half, p + half))) {
+                pos.z = prevPos.z;
             }
-            if (!hitbox.grounded) {
-                pos.x = px;
+            p = glm::vec3(pos.x, pos.y, prevPos.z);
+            if (!has_support(obstacles, AABB(p - half, p + half))) {
+                pos.x = prevPos.x;
             }
-            hitbox.grounded = true;
         }
     }
+}
+
+void PhysicsSolver::getTriggeredSensors(
+    const Hitbox& hitbox, entityid_t entity, std::vector<Sensor*>& dst
+) const {
+    if (sensorsGrid.size() == 0) {
+        return;
+    }
     AABB aabb;
     aabb.a = hitbox.position - hitbox.halfsize;
     aabb.b = hitbox.position + hitbox.halfsize;
-    for (size_t i = 0; i < sensors.size(); i++) {
+    AABB area = aabb;
+    area.fix();
+
+    static thread_local std::vector<size_t> candidates;
+    candidates.clear();
+    sensorsGrid.query(area, [](size_t index) {
+        candidates.push_back(index);
+    });
+    // keep order of the sensors callbacks
+    std::sort(candidates.begin(), candidates.end());
+    for (size_t i : candidates) {
         auto& sensor = *sensors[i];
         if (sensor.entity == entity) {
             continue;
@@ -110,158 +324,16 @@ void PhysicsSolver::step(
                 break;
         }
         if (triggered) {
-            if (sensor.prevEntered.find(entity) == sensor.prevEntered.end()) {
-                sensor.enterCallback(sensor.entity, sensor.index, entity);
-            }
-            sensor.nextEntered.insert(entity);
+            dst.push_back(&sensor);
         }
     }
 }
 
-static float calc_step_height(
-    const GlobalChunks& chunks, 
-    const glm::vec3& pos, 
-    const glm::vec3& half,
-    float stepHeight,
-    float s
-) {
-    if (stepHeight > 0.0f) {
-        for (int ix = 0; ix <= (half.x-E)*2/s; ix++) {
-            float x = (pos.x-half.x+E) + ix * s;
-            for (int iz = 0; iz <= (half.z-E)*2/s; iz++) {
-                float z = (pos.z-half.z+E) + iz * s;
-                if (chunks.isObstacleAt(x, pos.y+half.y+stepHeight, z)) {
-                    return 0.0f;
-                }
-            }
-        }
-    }
-    return stepHeight;
-}
-
-template <int nx, int ny, int nz>
-static bool calc_collision_neg(
-    const GlobalChunks& chunks,
-    glm::vec3& pos,
-    glm::vec3& vel,
-    const glm::vec3& half,
-    float stepHeight,
-    float s
-) {
-    if (vel[nx] >= 0.0f) {
-        return false;
-    }
-    glm::vec3 offset(0.0f, stepHeight, 0.0f);
-    for (int iy = 0; iy <= ((half-offset*0.5f)[ny]-E)*2/s; iy++) {
-        glm::vec3 coord;
-        coord[ny] = ((pos+offset)[ny]-half[ny]+E) + iy * s;
-        for (int iz = 0; iz <= (half[nz]-E)*2/s; iz++){
-            coord[nz] = (pos[nz]-half[nz]+E) + iz * s;
-            coord[nx] = (pos[nx]-half[nx]-E);
-
-            if (const auto aabb = chunks.isObstacleAt(coord.x, coord.y, coord.z)) {
-                vel[nx] = 0.0f;
-                float newx = std::floor(coord[nx]) + aabb->max()[nx] + half[nx] + E;
-                if (std::abs(newx-pos[nx]) <= MAX_FIX) {
-                    pos[nx] = newx;
-                }
-                return true;
-            }
-        }
-    }
-    return false;
-}
-
-template <int nx, int ny, int nz>
-static void calc_collision_pos(
-    const GlobalChunks& chunks,
-    glm::vec3& pos,
-    glm::vec3& vel,
-    const glm::vec3& half,
-    float stepHeight,
-    float s
-) {
-    if (vel[nx] <= 0.0f) {
-        return;
-    }
-    glm::vec3 offset(0.0f, stepHeight, 0.0f);
-    for (int iy = 0; iy <= ((half-offset*0.5f)[ny]-E)*2/s; iy++) {
-        glm::vec3 coord;
-        coord[ny] = ((pos+offset)[ny]-half[ny]+E) + iy * s;
-        for (int iz = 0; iz <= (half[nz]-E)*2/s; iz++) {
-            coord[nz] = (pos[nz]-half[nz]+E) + iz * s;
-            coord[nx] = (pos[nx]+half[nx]+E);
-            if (const auto aabb = chunks.isObstacleAt(coord.x, coord.y, coord.z)) {
-                vel[nx] = 0.0f;
-                float newx = std::floor(coord[nx]) - half[nx] + aabb->min()[nx] - E;
-                if (std::abs(newx-pos[nx]) <= MAX_FIX) {
-                    pos[nx] = newx;
-                }
-                return;
-            }
-        }
-    }
-}
-
-void PhysicsSolver::colisionCalc(
-    const GlobalChunks& chunks, 
-    Hitbox& hitbox, 
-    glm::vec3& vel, 
-    glm::vec3& pos, 
-    const glm::vec3 half,
-    float stepHeight
-) {
-    // step size (smaller - more accurate, but slower)
-    float s = 2.0f/BLOCK_AABB_GRID;
-
-    stepHeight = calc_step_height(chunks, pos, half, stepHeight, s);
-
-    const AABB* aabb;
-    
-    calc_collision_neg<0, 1, 2>(chunks, pos, vel, half, stepHeight, s);
-    calc_collision_pos<0, 1, 2>(chunks, pos, vel, half, stepHeight, s);
-
-    calc_collision_neg<2, 1, 0>(chunks, pos, vel, half, stepHeight, s);
-    calc_collision_pos<2, 1, 0>(chunks, pos, vel, half, stepHeight, s);
-
-    if (calc_collision_neg<1, 0, 2>(chunks, pos, vel, half, stepHeight, s)) {
-        hitbox.grounded = true;
-    }
-
-    if (stepHeight > 0.0 && vel.y <= 0.0f){
-        for (int ix = 0; ix <= (half.x-E)*2/s; ix++) {
-            float x = (pos.x-half.x+E) + ix * s;
-            for (int iz = 0; iz <= (half.z-E)*2/s; iz++) {
-                float z = (pos.z-half.z+E) + iz * s;
-                float y = (pos.y-half.y+E);
-                if ((aabb = chunks.isObstacleAt(x,y,z))){
-                    vel.y = 0.0f;
-                    float newy = std::floor(y) + aabb->max().y + half.y;
-                    if (std::abs(newy-pos.y) <= MAX_FIX+stepHeight) {
-                        pos.y = newy;    
-                    }
-                    break;
-                }
-            }
-        }
-    }
-    if (vel.y > 0.0f){
-        for (int ix = 0; ix <= (half.x-E)*2/s; ix++) {
-            float x = (pos.x-half.x+E) + ix * s;
-            for (int iz = 0; iz <= (half.z-E)*2/s; iz++) {
-                float z = (pos.z-half.z+E) + iz * s;
-                float y = (pos.y+half.y+E);
-                if ((aabb = chunks.isObstacleAt(x,y,z))){
-                    vel.y = 0.0f;
-                    float newy = std::floor(y) - half.y + aabb->min().y - E;
-                    if (std::abs(newy-pos.y) <= MAX_FIX) {
-                        pos.y = newy;
-                    }
-                    break;
-                }
-            }
-        }
+void PhysicsSolver::enterSensor(Sensor& sensor, entityid_t entity) {
+    if (sensor.prevEntered.find(entity) == sensor.prevEntered.end()) {
+        sensor.enterCallback(sensor.entity, sensor.index, entity);
     }
+    sensor.nextEntered.insert(entity);
 }
 
 bool PhysicsSolver::isBlockInside(int x, int y, int z, Hitbox* hitbox) {
@@ -290,6 +362,35 @@ bool PhysicsSolver::isBlockInside(int x, int y, int z, Block* def, blockstate st
     return false;
 }
 
+static AABB calc_sensor_bounds(const Sensor& sensor) {
+    switch (sensor.type) {
+        case SensorType::AABB: {
+            AABB aabb = sensor.calculated.aabb;
+            aabb.fix();
+            return aabb;
+        }
+        case SensorType::RADIUS: {
+            glm::vec3 center(sensor.calculated.radial);
+            float radius = std::sqrt(sensor.calculated.radial.w);
+            return AABB(center - radius, center + radius);
+        }
+    }
+    return AABB();
+}
+
+void PhysicsSolver::setSensors(std::vector<Sensor*> sensors) {
+    this->sensors = std::move(sensors);
+    sensorsGrid.clear();
+    for (size_t i = 0; i < this->sensors.size(); i++) {
+        sensorsGrid.set(i, calc_sensor_bounds(*this->sensors[i]));
+    }
+}
+
 void PhysicsSolver::removeSensor(Sensor* sensor) {
-    sensors.erase(std::remove(sensors.begin(), sensors.end(), sensor), sensors.end());
+    for (size_t i = 0; i < sensors.size(); i++) {
+        if (sensors[i] == sensor) {
+            sensors[i] = nullptr;
+            sensorsGrid.remove(i);
+        }
+    }
 }
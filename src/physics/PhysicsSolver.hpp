@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Hitbox.hpp"
+#include "SpatialGrid.hpp"
 
 #include "typedefs.hpp"
 #include "voxels/voxel.hpp"
@@ -14,30 +15,49 @@ struct Sensor;
 
 class PhysicsSolver {
     glm::vec3 gravity;
+    /// @brief Sensors updated on the last sensors tick, removed sensors
+    /// are replaced with nullptr
     std::vector<Sensor*> sensors;
+    /// @brief Sensors broadphase, contains indices of the sensors
+    SpatialGrid<size_t> sensorsGrid;
 public:
     PhysicsSolver(glm::vec3 gravity);
+
+    /// @brief Move the body colliding with blocks. Thread-safe for different
+    /// hitboxes while chunks are not modified
     void step(
         const GlobalChunks& chunks,
         Hitbox& hitbox,
         float delta,
-        uint substeps,
-        entityid_t entity
+        uint substeps
     );
-    void colisionCalc(
-        const GlobalChunks& chunks,
+
+    /// @brief Move the body colliding with the obstacles. Collisions are
+    /// swept, so one or two substeps are enough for fast bodies
+    /// @param obstacles boxes covering the area passed by the body
+    void step(
+        const std::vector<AABB>& obstacles,
         Hitbox& hitbox,
-        glm::vec3& vel,
-        glm::vec3& pos,
-        const glm::vec3 half,
-        float stepHeight
-    );
+        float delta,
+        uint substeps
+    ) const;
+
+    /// @brief Collect sensors triggered by the body in order of sensors.
+    /// Thread-safe while sensors are not modified
+    /// @param entity body entity ignored by own sensors
+    /// @param dst triggered sensors destination
+    void getTriggeredSensors(
+        const Hitbox& hitbox, entityid_t entity, std::vector<Sensor*>& dst
+    ) const;
+
+    /// @brief Call sensor enter callback if the entity was not inside
+    /// of the sensor on previous tick and mark the entity as entered
+    static void enterSensor(Sensor& sensor, entityid_t entity);
+
     bool isBlockInside(int x, int y, int z, Hitbox* hitbox);
     bool isBlockInside(int x, int y, int z, Block* def, blockstate state, Hitbox* hitbox);
 
-    void setSensors(std::vector<Sensor*> sensors) {
-        this->sensors = std::move(sensors);
-    }
+    void setSensors(std::vector<Sensor*> sensors);
 
     void removeSensor(Sensor* sensor);
 };
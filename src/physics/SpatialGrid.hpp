@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "maths/aabb.hpp"
+
+#include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+/// @brief Uniform grid spatial index of boxes. Every value is stored in all
+/// cells its box overlaps. Queries return candidates whose boxes may overlap
+/// the queried area, exact checks are performed by the caller.
+template <typename T>
+class SpatialGrid {
+    struct Item {
+        T value;
+        /// @brief first cell of the value box, used to report values
+        /// overlapping several queried cells once
+        glm::ivec3 min;
+    };
+
+    struct Entry {
+        glm::ivec3 min;
+        glm::ivec3 max;
+    };
+
+    float cellSize;
+    std::unordered_map<glm::ivec3, std::vector<Item>> cells;
+    std::unordered_map<T, Entry> entries;
+
+    glm::ivec3 toCell(const glm::vec3& pos) const {
+        return glm::ivec3(glm::floor(pos / cellSize));
+    }
+
+    void addToCells(const T& value, const Entry& entry) {
+        for (int y = entry.min.y; y <= entry.max.y; y++) {
+            for (int z = entry.min.z; z <= entry.max.z; z++) {
+                for (int x = entry.min.x; x <= entry.max.x; x++) {
+                    cells[{x, y, z}].push_back(Item {value, entry.min});
+                }
+            }
+        }
+    }
+
+    void removeFromCells(const T& value, const Entry& entry) {
+        for (int y = entry.min.y; y <= entry.max.y; y++) {
+            for (int z = entry.min.z; z <= entry.max.z; z++) {
+                for (int x = entry.min.x; x <= entry.max.x; x++) {
+                    const auto& found = cells.find({x, y, z});
+                    if (found == cells.end()) {
+                        continue;
+                    }
+                    auto& items = found->second;
+                    for (size_t i = 0; i < items.size(); i++) {
+                        if (items[i].value == value) {
+                            items[i] = std::move(items.back());
+                            items.pop_back();
+                            break;
+                        }
+                    }
+                    if (items.empty()) {
+                        cells.erase(found);
+                    }
+                }
+            }
+        }
+    }
+public:
+    SpatialGrid(float cellSize) : cellSize(cellSize) {
+    }
+
+    /// @brief Add value or update its box
+    void set(const T& value, const AABB& box) {
+        Entry entry {toCell(box.min()), toCell(box.max())};
+        const auto& found = entries.find(value);
+        if (found != entries.end()) {
+            auto& prev = found->second;
+            if (prev.min == entry.min && prev.max == entry.max) {
+                return;
+            }
+            removeFromCells(value, prev);
+            prev = entry;
+        } else {
+            entries[value] = entry;
+        }
+        addToCells(value, entry);
+    }
+
+    void remove(const T& value) {
+        const auto& found = entries.find(value);
+        if (found == entries.end()) {
+            return;
+        }
+        removeFromCells(value, found->second);
+        entries.erase(found);
+    }
+
+    void clear() {
+        cells.clear();
+        entries.clear();
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    /// @brief Call func once for every value which box may overlap the area
+    template <class Func>
+    void query(const AABB& area, const Func& func) const {
+        glm::ivec3 min = toCell(area.min());
+        glm::ivec3 max = toCell(area.max());
+        glm::ivec3 size = max - min + 1;
+        // brute force when area covers more cells than occupied
+        if (static_cast<double>(size.x) * size.y * size.z >
+            static_cast<double>(cells.size())) {
+            for (const auto& [pos, items] : cells) {
+                if (pos.x < min.x || pos.y < min.y || pos.z < min.z ||
+                    pos.x > max.x || pos.y > max.y || pos.z > max.z) {
+                    continue;
+                }
+                for (const auto& item : items) {
+                    if (glm::max(item.min, min) == pos) {
+                        func(item.value);
+                    }
+                }
+            }
+            return;
+        }
+        for (int y = min.y; y <= max.y; y++) {
+            for (int z = min.z; z <= max.z; z++) {
+                for (int x = min.x; x <= max.x; x++) {
+                    glm::ivec3 pos(x, y, z);
+                    const auto& found = cells.find(pos);
+                    if (found == cells.end()) {
+                        continue;
+                    }
+                    for (const auto& item : found->second) {
+                        if (glm::max(item.min, min) == pos) {
+                            func(item.value);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /// @brief Call func for values in cells crossed by the ray in order of
+    /// the distance. A value may be reported more than once.
+    /// @param dir normalized ray direction
+    /// @param func returns updated max distance, traversal stops when
+    /// the ray leaves cells closer than the distance
+    template <class Func>
+    void raycast(
+        const glm::vec3& start,
+        const glm::vec3& dir,
+        float maxDistance,
+        const Func& func
+    ) const {
+        // brute force when the ray crosses more cells than occupied
+        if (!(maxDistance / cellSize * 3.0f <
+              static_cast<float>(cells.size()))) {
+            for (const auto& [pos, items] : cells) {
+                for (const auto& item : items) {
+                    if (item.min == pos) {
+                        func(item.value);
+                    }
+                }
+            }
+            return;
+        }
+        constexpr float INF = std::numeric_limits<float>::infinity();
+        glm::ivec3 cell = toCell(start);
+        glm::ivec3 step;
+        glm::vec3 tMax;
+        glm::vec3 tDelta;
+        for (int i = 0; i < 3; i++) {
+            if (dir[i] > 0.0f) {
+                step[i] = 1;
+                tMax[i] = ((cell[i] + 1) * cellSize - start[i]) / dir[i];
+                tDelta[i] = cellSize / dir[i];
+            } else if (dir[i] < 0.0f) {
+                step[i] = -1;
+                tMax[i] = (cell[i] * cellSize - start[i]) / dir[i];
+                tDelta[i] = -cellSize / dir[i];
+            } else {
+                step[i] = 0;
+                tMax[i] = INF;
+                tDelta[i] = INF;
+            }
+        }
+        float distance = 0.0f;
+        while (distance <= maxDistance) {
+            const auto& found = cells.find(cell);
+            if (found != cells.end()) {
+                for (const auto& item : found->second) {
+                    maxDistance = func(item.value);
+                }
+            }
+            int axis = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2)
+                                       : (tMax.y < tMax.z ? 1 : 2);
+            distance = tMax[axis];
+            cell[axis] += step[axis];
+            tMax[axis] += tDelta[axis];
+        }
+    }
+};
@@ -40,6 +40,16 @@ struct ChunksSettings {
     IntegerSetting loadDistance {22, 3, 80};
     /// @brief Buffer zone where chunks are not unloading (chunk is unit)
     IntegerSetting padding {2, 1, 8};
+    /// @brief Limit of chunks loader workers count
+    IntegerSetting loadWorkers {4, -4, 32};
+    /// @brief Number of threads building chunks lights, 0 is auto
+    IntegerSetting lightingWorkers {0, 0, 32};
+    /// @brief Number of threads performing world generator prototype
+    /// stages (each one has own generator script state), 0 is auto
+    IntegerSetting generatorWorkers {1, 0, 32};
+    /// @brief Keep loaded chunks voxels palette-packed and uniform lights
+    /// sections collapsed, edited sections are expanded
+    FlagSetting compactStorage {false};
 };
 
 struct CameraSettings {
@@ -67,6 +77,8 @@ struct GraphicsSettings {
     FlagSetting denseRender {true};
     /// @brief Enable chunks frustum culling
     FlagSetting frustumCulling {true};
+    /// @brief Merge coplanar full cube faces into larger quads
+    FlagSetting greedyMeshing {false};
     /// @brief Skybox texture face resolution
     IntegerSetting skyboxResolution {64 + 32, 64, 128};
     /// @brief Chunk renderer vertices buffer capacity
@@ -82,6 +94,20 @@ struct DebugSettings {
     FlagSetting generatorTestMode {false};
     /// @brief Write lights cache
     FlagSetting doWriteLights {true};
+    /// @brief Voxels regions compression method (see compression::Method)
+    StringSetting voxelsCompression {"extrle16"};
+    /// @brief Lights regions compression method
+    StringSetting lightsCompression {"extrle8"};
+    /// @brief Compress chunks data and write regions on a dedicated thread
+    FlagSetting asyncSave {false};
+    /// @brief Pass random ticks to on_blocks_random_update handlers in
+    /// batches instead of calling on_random_update per position
+    FlagSetting batchRandomUpdates {true};
+};
+
+struct PhysicsSettings {
+    /// @brief Number of threads stepping entities physics, 0 is auto
+    IntegerSetting workers {0, 0, 32};
 };
 
 struct UiSettings {
@@ -99,6 +125,7 @@ struct EngineSettings {
     CameraSettings camera;
     GraphicsSettings graphics;
     DebugSettings debug;
+    PhysicsSettings physics;
     UiSettings ui;
     NetworkSettings network;
 };
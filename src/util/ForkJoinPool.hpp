@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "typedefs.hpp"
+#include "delegates.hpp"
+
+namespace util {
+    /// @brief Fixed set of threads executing batches of independent tasks.
+    /// Unlike ThreadPool, run() blocks until the whole batch is done, so
+    /// tasks may reference data owned by the caller.
+    /// Calling thread takes part in tasks execution.
+    class ForkJoinPool {
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable tasksCondition;
+        std::condition_variable doneCondition;
+        const std::vector<runnable>* tasks = nullptr;
+        size_t nextTask = 0;
+        size_t unfinished = 0;
+        bool working = true;
+        std::exception_ptr error;
+
+        /// @brief Execute next task of the current batch
+        /// @param lock locked pool mutex lock
+        /// @return false if there are no tasks left
+        bool runNext(std::unique_lock<std::mutex>& lock) {
+            if (tasks == nullptr || nextTask >= tasks->size()) {
+                return false;
+            }
+            const auto& task = (*tasks)[nextTask++];
+            lock.unlock();
+            std::exception_ptr taskError;
+            try {
+                task();
+            } catch (...) {
+                taskError = std::current_exception();
+            }
+            lock.lock();
+            if (taskError && error == nullptr) {
+                error = taskError;
+            }
+            if (--unfinished == 0) {
+                doneCondition.notify_all();
+            }
+            return true;
+        }
+
+        void threadLoop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                tasksCondition.wait(lock, [this] {
+                    return !working ||
+                           (tasks != nullptr && nextTask < tasks->size());
+                });
+                if (!working) {
+                    break;
+                }
+                runNext(lock);
+            }
+        }
+    public:
+        /// @param threadsCount total number of threads including the
+        /// calling one. 0 is auto (hardware concurrency)
+        explicit ForkJoinPool(uint threadsCount) {
+            if (threadsCount == 0) {
+                threadsCount = std::max(1U, std::thread::hardware_concurrency());
+            }
+            for (uint i = 1; i < threadsCount; i++) {
+                threads.emplace_back(&ForkJoinPool::threadLoop, this);
+            }
+        }
+
+        ~ForkJoinPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                working = false;
+            }
+            tasksCondition.notify_all();
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+
+        ForkJoinPool(const ForkJoinPool&) = delete;
+
+        /// @brief Execute all tasks and wait for them to finish.
+        /// First exception thrown by a task is rethrown after that.
+        /// Must not be called concurrently
+        void run(const std::vector<runnable>& batch) {
+            if (batch.empty()) {
+                return;
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            tasks = &batch;
+            nextTask = 0;
+            unfinished = batch.size();
+            tasksCondition.notify_all();
+
+            while (runNext(lock));
+            doneCondition.wait(lock, [this] { return unfinished == 0; });
+            tasks = nullptr;
+
+            if (error) {
+                auto taskError = error;
+                error = nullptr;
+                std::rethrow_exception(taskError);
+            }
+        }
+
+        /// @return total number of threads including the calling one
+        uint getThreadsCount() const {
+            return threads.size() + 1;
+        }
+    };
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "Buffer.hpp"
+
+namespace util {
+    /// @brief Growable FIFO byte-like buffer. Capacity is a power of two,
+    /// readable and writable regions are exposed as contiguous spans so data
+    /// may be received or sent in place.
+    /// @tparam T trivially copyable elements type
+    template <typename T>
+    class RingBuffer {
+        Buffer<T> buffer;
+        /// @brief Index of the first element (masked on access)
+        size_t head = 0;
+        size_t length = 0;
+
+        size_t mask() const {
+            return buffer.size() - 1;
+        }
+    public:
+        RingBuffer(size_t capacity = 16) {
+            size_t size = 1;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            buffer = Buffer<T>(size);
+        }
+
+        size_t size() const {
+            return length;
+        }
+
+        size_t capacity() const {
+            return buffer.size();
+        }
+
+        bool empty() const {
+            return length == 0;
+        }
+
+        void clear() {
+            head = 0;
+            length = 0;
+        }
+
+        /// @brief Grow capacity to fit at least `count` more elements
+        void reserve(size_t count) {
+            if (length + count <= buffer.size()) {
+                return;
+            }
+            size_t size = buffer.size();
+            while (size < length + count) {
+                size <<= 1;
+            }
+            Buffer<T> grown(size);
+            size_t prevLength = length;
+            read(grown.data(), prevLength);
+            buffer = std::move(grown);
+            head = 0;
+            length = prevLength;
+        }
+
+        /// @brief Contiguous readable span starting from the first element
+        std::pair<const T*, size_t> readable() const {
+            size_t start = head & mask();
+            return {buffer.data() + start,
+                    std::min(length, buffer.size() - start)};
+        }
+
+        /// @brief Remove first elements
+        void consume(size_t count) {
+            count = std::min(count, length);
+            head += count;
+            length -= count;
+            if (length == 0) {
+                head = 0;
+            }
+        }
+
+        /// @brief Contiguous writable span after the last element, grows
+        /// the buffer if there is no free space
+        std::pair<T*, size_t> writable() {
+            reserve(1);
+            size_t end = (head + length) & mask();
+            size_t start = head & mask();
+            size_t count = end < start ? start - end : buffer.size() - end;
+            return {buffer.data() + end, count};
+        }
+
+        /// @brief Append elements written to the writable span
+        void commit(size_t count) {
+            length += count;
+        }
+
+        void write(const T* src, size_t count) {
+            reserve(count);
+            while (count) {
+                auto [dst, free] = writable();
+                size_t n = std::min(free, count);
+                std::memcpy(dst, src, n * sizeof(T));
+                commit(n);
+                src += n;
+                count -= n;
+            }
+        }
+
+        /// @brief Copy and remove first elements
+        /// @return number of elements read
+        size_t read(T* dst, size_t count) {
+            count = std::min(count, length);
+            size_t left = count;
+            while (left) {
+                auto [src, available] = readable();
+                size_t n = std::min(available, left);
+                std::memcpy(dst, src, n * sizeof(T));
+                consume(n);
+                dst += n;
+                left -= n;
+            }
+            return count;
+        }
+    };
+}
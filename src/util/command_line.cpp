@@ -1,13 +1,47 @@
 #include "command_line.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 #include "io/engine_paths.hpp"
 #include "util/ArgsReader.hpp"
+#include "util/stringutil.hpp"
 #include "engine/Engine.hpp"
 
 namespace fs = std::filesystem;
 
+static int parse_chunk_coord(const std::string& text) {
+    bool negative = !text.empty() && text[0] == '-';
+    auto digits = negative ? text.substr(1) : text;
+    if (digits.empty() || !util::is_integer(digits)) {
+        throw std::runtime_error("invalid chunk coordinate '" + text + "'");
+    }
+    return std::stoi(text);
+}
+
+/// @brief Parse pre-generation area: radius around the world origin
+/// or x1,z1,x2,z2 chunks rectangle
+static std::array<int, 4> parse_pregen_area(const std::string& text) {
+    auto parts = util::split(text, ',');
+    if (parts.size() == 1) {
+        int radius = parse_chunk_coord(parts[0]);
+        if (radius < 0) {
+            throw std::runtime_error("negative pre-generation radius");
+        }
+        return {-radius, -radius, radius, radius};
+    } else if (parts.size() == 4) {
+        int x1 = parse_chunk_coord(parts[0]);
+        int z1 = parse_chunk_coord(parts[1]);
+        int x2 = parse_chunk_coord(parts[2]);
+        int z2 = parse_chunk_coord(parts[3]);
+        return {
+            std::min(x1, x2), std::min(z1, z2),
+            std::max(x1, x2), std::max(z1, z2)
+        };
+    }
+    throw std::runtime_error("invalid pre-generation area '" + text + "'");
+}
+
 static bool perform_keyword(
     util::ArgsReader& reader, const std::string& keyword, CoreParameters& params
 ) {
@@ -27,6 +61,8 @@ static bool perform_keyword(
         std::cout << " --headless - run in headless mode\n";
         std::cout << " --test <path> - test script file\n";
         std::cout << " --script <path> - main script file\n";
+        std::cout << " --pregen <world> <radius|x1,z1,x2,z2> - pre-generate "
+                     "world chunks in headless mode\n";
         std::cout << std::endl;
         return false;
     } else if (keyword == "--version") {
@@ -42,6 +78,10 @@ static bool perform_keyword(
         auto token = reader.next();
         params.testMode = false;
         params.scriptFile = token;
+    } else if (keyword == "--pregen") {
+        params.pregenWorld = reader.next();
+        params.pregenArea = parse_pregen_area(reader.next());
+        params.headless = true;
     } else {
         throw std::runtime_error("unknown argument " + keyword);
     }
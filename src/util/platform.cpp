@@ -15,7 +15,9 @@ static debug::Logger logger("platform");
 
 #ifdef _WIN32
 #include <Windows.h>
+#include <psapi.h>
 #pragma comment(lib, "winmm.lib")
+#pragma comment(lib, "psapi.lib")
 
 void platform::configure_encoding() {
     // set utf-8 encoding to console output
@@ -65,8 +67,19 @@ int platform::get_process_id() {
     return GetCurrentProcessId(); 
 }
 
+size_t platform::get_peak_memory_usage() {
+    PROCESS_MEMORY_COUNTERS counters {};
+    if (!GetProcessMemoryInfo(
+            GetCurrentProcess(), &counters, sizeof(counters)
+        )) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+}
+
 #else // _WIN32
 
+#include <sys/resource.h>
 #include <unistd.h>
 #include "frontend/locale.hpp"
 
@@ -92,6 +105,19 @@ void platform::sleep(size_t millis) {
 int platform::get_process_id() {
     return getpid();
 }
+
+size_t platform::get_peak_memory_usage() {
+    rusage usage {};
+    if (getrusage(RUSAGE_SELF, &usage)) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    // kilobytes on Linux
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
 #endif // _WIN32
 
 void platform::open_folder(const std::filesystem::path& folder) {
@@ -13,4 +13,7 @@ namespace platform {
     /// Makes the current thread sleep for the specified amount of milliseconds.
     void sleep(size_t millis);
     int get_process_id();
+    /// @return peak resident set size of the process in bytes
+    /// or 0 if not available
+    size_t get_peak_memory_usage();
 }
@@ -35,6 +35,20 @@ inline constexpr size_t MAX_USER_BLOCK_FIELDS_SIZE = 240;
 
 inline std::string DEFAULT_MATERIAL = "base:stone";
 
+/// @brief Handles of block script events to emit them without building
+/// event names, 0 if the event is not defined by the script
+struct BlockEventHandles {
+    int update = 0;
+    int randupdate = 0;
+    int blocksrandupdate = 0;
+    int placed = 0;
+    int replaced = 0;
+    int breaking = 0;
+    int broken = 0;
+    int interact = 0;
+    int blockstick = 0;
+};
+
 struct BlockFuncsSet {
     bool init : 1;
     bool update : 1;
@@ -44,7 +58,9 @@ struct BlockFuncsSet {
     bool onreplaced : 1;
     bool oninteract : 1;
     bool randupdate : 1;
+    bool blocksrandupdate : 1;
     bool onblockstick : 1;
+    BlockEventHandles events {};
 };
 
 struct CoordSystem {
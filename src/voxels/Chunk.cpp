@@ -1,11 +1,14 @@
 #include "Chunk.hpp"
 
+#include <algorithm>
 #include <utility>
 
+#include "content/Content.hpp"
 #include "content/ContentReport.hpp"
 #include "items/Inventory.hpp"
 #include "lighting/Lightmap.hpp"
 #include "util/data_io.hpp"
+#include "Block.hpp"
 #include "voxel.hpp"
 
 Chunk::Chunk(int xpos, int zpos) : x(xpos), z(zpos) {
@@ -28,6 +31,51 @@ void Chunk::updateHeights() {
     }
 }
 
+static inline SectionOccupancy occupancy_of(const Block& def) {
+    if (def.rt.id == BLOCK_AIR) {
+        return SectionOccupancy::EMPTY;
+    }
+    // see BlocksRenderer::isOpen
+    if (def.model == BlockModel::block && def.drawGroup == 0 &&
+        def.culling == CullingMode::DEFAULT) {
+        return SectionOccupancy::SOLID;
+    }
+    return SectionOccupancy::MIXED;
+}
+
+void Chunk::updateOccupancy(const ContentIndices& indices) {
+    auto defs = indices.blocks.getDefs();
+    for (uint section = 0; section < CHUNK_SECTIONS; section++) {
+        uint begin = section * CHUNK_SECTION_VOL;
+        auto value = occupancy_of(*defs[voxels[begin].id]);
+        for (uint i = begin + 1;
+             i < begin + CHUNK_SECTION_VOL &&
+             value != SectionOccupancy::MIXED;
+             i++) {
+            if (occupancy_of(*defs[voxels[i].id]) != value) {
+                value = SectionOccupancy::MIXED;
+            }
+        }
+        occupancy[section] = value;
+    }
+}
+
+void Chunk::updateOccupancy(uint index, const Block& def) {
+    auto& value = occupancy[index / CHUNK_SECTION_VOL];
+    if (value != occupancy_of(def)) {
+        value = SectionOccupancy::MIXED;
+    }
+}
+
+void Chunk::compact() {
+    voxels.compact();
+    lightmap.compact();
+}
+
+size_t Chunk::getMemoryUsage() const {
+    return voxels.getMemoryUsage() + lightmap.getMemoryUsage();
+}
+
 void Chunk::addBlockInventory(
     std::shared_ptr<Inventory> inventory, uint x, uint y, uint z
 ) {
@@ -58,7 +106,7 @@ std::shared_ptr<Inventory> Chunk::getBlockInventory(uint x, uint y, uint z)
 std::unique_ptr<Chunk> Chunk::clone() const {
     auto other = std::make_unique<Chunk>(x, z);
     for (uint i = 0; i < CHUNK_VOL; i++) {
-        other->voxels[i] = voxels[i];
+        other->voxels.edit(i) = voxels[i];
     }
     other->lightmap.set(&lightmap);
     return other;
@@ -86,9 +134,12 @@ std::unique_ptr<ubyte[]> Chunk::encode() const {
 }
 
 bool Chunk::decode(const ubyte* data) {
+    std::fill(
+        std::begin(occupancy), std::end(occupancy), SectionOccupancy::MIXED
+    );
     auto src = reinterpret_cast<const uint16_t*>(data);
     for (uint i = 0; i < CHUNK_VOL; i++) {
-        voxel& vox = voxels[i];
+        voxel& vox = voxels.edit(i);
 
         vox.id = dataio::le2h(src[i]);
         vox.state = int2blockstate(dataio::le2h(src[CHUNK_VOL + i]));
@@ -10,10 +10,13 @@
 #include "util/SmallHeap.hpp"
 #include "maths/aabb.hpp"
 #include "voxel.hpp"
+#include "PalettedVoxels.hpp"
 
 /// @brief Total bytes number of chunk voxel data
 inline constexpr int CHUNK_DATA_LEN = CHUNK_VOL * 4;
 
+class Block;
+class ContentIndices;
 class ContentReport;
 class Inventory;
 
@@ -22,11 +25,23 @@ using ChunkInventoriesMap =
 
 using BlocksMetadata = util::SmallHeap<uint16_t, uint8_t>;
 
+/// @brief Chunk section contents summary used to skip hidden voxels on
+/// mesh building
+enum class SectionOccupancy : ubyte {
+    /// @brief Different blocks or contents are not known
+    MIXED = 0,
+    /// @brief Air only
+    EMPTY,
+    /// @brief Full cube blocks of the default draw group hiding faces of
+    /// each other
+    SOLID,
+};
+
 class Chunk {
 public:
     int x, z;
     int bottom, top;
-    voxel voxels[CHUNK_VOL] {};
+    PalettedVoxels voxels;
     Lightmap lightmap;
     struct {
         bool modified : 1;
@@ -38,6 +53,9 @@ public:
         bool entities : 1;
         bool blocksData : 1;
     } flags {};
+    /// @brief Sections summaries. Kept conservative: a section is never
+    /// marked EMPTY or SOLID unless it is known to be one
+    SectionOccupancy occupancy[CHUNK_SECTIONS] {};
 
     /// @brief Block inventories map where key is index of block in voxels array
     ChunkInventoriesMap inventories;
@@ -49,6 +67,21 @@ public:
     /// @brief Refresh `bottom` and `top` values
     void updateHeights();
 
+    /// @brief Recalculate all sections occupancy
+    void updateOccupancy(const ContentIndices& indices);
+
+    /// @brief Update section occupancy after voxel modification
+    /// @param index modified voxel index
+    /// @param def new block definition
+    void updateOccupancy(uint index, const Block& def);
+
+    /// @brief Pack voxels sections and collapse uniform lights sections.
+    /// Must not be called while the chunk is accessed by other threads
+    void compact();
+
+    /// @return bytes used by the chunk voxels and lights
+    size_t getMemoryUsage() const;
+
     // unused
     std::unique_ptr<Chunk> clone() const;
 
@@ -46,11 +46,11 @@ void Chunks::configure(int32_t x, int32_t z, uint32_t radius) {
     setCenter(x, z);
 }
 
-voxel* Chunks::get(int32_t x, int32_t y, int32_t z) const {
+const voxel* Chunks::get(int32_t x, int32_t y, int32_t z) const {
     return blocks_agent::get(*this, x, y, z);
 }
 
-voxel& Chunks::require(int32_t x, int32_t y, int32_t z) const {
+const voxel& Chunks::require(int32_t x, int32_t y, int32_t z) const {
     return blocks_agent::require(*this, x, y, z);
 }
 
@@ -58,7 +58,7 @@ const AABB* Chunks::isObstacleAt(float x, float y, float z) const {
     int ix = std::floor(x);
     int iy = std::floor(y);
     int iz = std::floor(z);
-    voxel* v = get(ix, iy, iz);
+    const voxel* v = get(ix, iy, iz);
     if (v == nullptr) {
         if (iy >= CHUNK_H) {
             return nullptr;
@@ -96,7 +96,7 @@ bool Chunks::isReplaceableBlock(int32_t x, int32_t y, int32_t z) {
 }
 
 bool Chunks::isObstacleBlock(int32_t x, int32_t y, int32_t z) {
-    voxel* v = get(x, y, z);
+    const voxel* v = get(x, y, z);
     if (v == nullptr) return false;
     return indices.blocks.require(v->id).obstacle;
 }
@@ -203,7 +203,7 @@ void Chunks::set(
     blocks_agent::set(*this, x, y, z, id, state);
 }
 
-voxel* Chunks::rayCast(
+const voxel* Chunks::rayCast(
     const glm::vec3& start,
     const glm::vec3& dir,
     float maxDist,
@@ -252,7 +252,7 @@ glm::vec3 Chunks::rayCastToObstacle(
     float tzMax = (tzDelta < infinity) ? tzDelta * zdist : infinity;
 
     while (t <= maxDist) {
-        voxel* voxel = get(ix, iy, iz);
+        const voxel* voxel = get(ix, iy, iz);
         if (voxel) {
             const auto& def = indices.blocks.require(voxel->id);
             if (def.obstacle) {
@@ -313,15 +313,24 @@ glm::vec3 Chunks::rayCastToObstacle(
 }
 
 void Chunks::setCenter(int32_t x, int32_t z) {
+    int32_t offsetX = areaMap.getOffsetX();
+    int32_t offsetY = areaMap.getOffsetY();
     areaMap.setCenter(floordiv<CHUNK_W>(x), floordiv<CHUNK_D>(z));
+    if (offsetX != areaMap.getOffsetX() || offsetY != areaMap.getOffsetY()) {
+        loadQueue.reset();
+    }
 }
 
 void Chunks::resize(uint32_t newW, uint32_t newD) {
     areaMap.resize(newW, newD);
+    loadQueue.reset();
 }
 
 bool Chunks::putChunk(const std::shared_ptr<Chunk>& chunk) {
     if (areaMap.set(chunk->x, chunk->z, chunk)) {
+        loadQueue.onChanged(
+            chunk->x - areaMap.getOffsetX(), chunk->z - areaMap.getOffsetY()
+        );
         if (events) {
             events->trigger(LevelEventType::CHUNK_SHOWN, chunk.get());
         }
@@ -373,8 +382,8 @@ void Chunks::getVoxels(VoxelsVolume& volume, bool backlight) const {
                     }
                 }
             } else {
-                const voxel* cvoxels = chunk->voxels;
-                const light_t* clights = chunk->lightmap.getLights();
+                const auto& cvoxels = chunk->voxels;
+                const auto& clights = chunk->lightmap;
                 for (int ly = y; ly < y + h; ly++) {
                     for (int lz = std::max(z, cz * CHUNK_D);
                              lz < std::min(z + d, (cz + 1) * CHUNK_D);
@@ -391,7 +400,7 @@ void Chunks::getVoxels(VoxelsVolume& volume, bool backlight) const {
                                 CHUNK_D
                             );
                             voxels[vidx] = cvoxels[cidx];
-                            light_t light = clights[cidx];
+                            light_t light = clights.get(cidx);
                             if (backlight) {
                                 const auto block =
                                     indices.blocks.get(voxels[vidx].id);
@@ -419,4 +428,5 @@ void Chunks::getVoxels(VoxelsVolume& volume, bool backlight) const {
 
 void Chunks::saveAndClear() {
     areaMap.clear();
+    loadQueue.reset();
 }
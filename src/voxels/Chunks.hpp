@@ -9,6 +9,7 @@
 
 #include "typedefs.hpp"
 #include "voxel.hpp"
+#include "ChunksLoadQueue.hpp"
 #include "util/AreaMap2D.hpp"
 
 class VoxelRenderer;
@@ -39,6 +40,7 @@ class Chunks {
     );
 
     util::AreaMap2D<std::shared_ptr<Chunk>, int32_t> areaMap;
+    ChunksLoadQueue loadQueue;
 public:
     Chunks(
         int32_t w,
@@ -55,6 +57,11 @@ public:
     bool putChunk(const std::shared_ptr<Chunk>& chunk);
 
     Chunk* getChunk(int32_t x, int32_t z) const;
+
+    /// @brief Check if chunk position is inside of the chunks matrix
+    bool isInside(int32_t x, int32_t z) const {
+        return areaMap.isInside(x, z);
+    }
     Chunk* getChunkByVoxel(int32_t x, int32_t y, int32_t z) const;
 
     template <typename T>
@@ -64,12 +71,8 @@ public:
         );
     }
 
-    voxel* get(int32_t x, int32_t y, int32_t z) const;
-    voxel& require(int32_t x, int32_t y, int32_t z) const;
-
-    inline voxel* get(const glm::ivec3& pos) {
-        return get(pos.x, pos.y, pos.z);
-    }
+    const voxel* get(int32_t x, int32_t y, int32_t z) const;
+    const voxel& require(int32_t x, int32_t y, int32_t z) const;
 
     inline const voxel* get(const glm::ivec3& pos) const {
         return get(pos.x, pos.y, pos.z);
@@ -102,7 +105,7 @@ public:
 
     void setRotation(int32_t x, int32_t y, int32_t z, uint8_t rotation);
 
-    voxel* rayCast(
+    const voxel* rayCast(
         const glm::vec3& start,
         const glm::vec3& dir,
         float maxLength,
@@ -161,6 +164,11 @@ public:
         return areaMap.area();
     }
 
+    /// @brief Order of chunks loading and lighting (see ChunksController)
+    ChunksLoadQueue& getLoadQueue() {
+        return loadQueue;
+    }
+
     const ContentIndices& getContentIndices() const {
         return indices;
     }
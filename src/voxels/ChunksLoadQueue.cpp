@@ -0,0 +1,57 @@
+#include "ChunksLoadQueue.hpp"
+
+#include <algorithm>
+#include <limits>
+
+static constexpr uint32_t NO_RANK = std::numeric_limits<uint32_t>::max();
+
+void ChunksLoadQueue::configure(int width, int height, uint padding) {
+    if (this->width == width && this->height == height &&
+        this->padding == static_cast<int>(padding)) {
+        return;
+    }
+    this->width = width;
+    this->height = height;
+    this->padding = padding;
+
+    order.clear();
+    ranks.assign(width * height, NO_RANK);
+    for (int z = this->padding; z < height - this->padding; z++) {
+        for (int x = this->padding; x < width - this->padding; x++) {
+            order.push_back(z * width + x);
+        }
+    }
+    auto distance = [width, height](uint32_t index) {
+        int lx = static_cast<int>(index % width) - width / 2;
+        int lz = static_cast<int>(index / width) - height / 2;
+        return lx * lx + lz * lz;
+    };
+    // stable to keep rows order of equally distant slots
+    std::stable_sort(
+        order.begin(),
+        order.end(),
+        [&distance](uint32_t a, uint32_t b) {
+            return distance(a) < distance(b);
+        }
+    );
+    for (size_t i = 0; i < order.size(); i++) {
+        ranks[order[i]] = i;
+    }
+    cursor = 0;
+}
+
+void ChunksLoadQueue::onChanged(int x, int z) {
+    for (int oz = -1; oz <= 1; oz++) {
+        for (int ox = -1; ox <= 1; ox++) {
+            int nx = x + ox;
+            int nz = z + oz;
+            if (nx < 0 || nz < 0 || nx >= width || nz >= height) {
+                continue;
+            }
+            uint32_t rank = ranks[nz * width + nx];
+            if (rank < cursor) {
+                cursor = rank;
+            }
+        }
+    }
+}
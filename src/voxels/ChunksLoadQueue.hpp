@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "typedefs.hpp"
+
+/// @brief Order of chunks matrix slots processed by chunks loading, from the
+/// center to the edges. Slots before the cursor are known to require no work,
+/// so the next slot is found without scanning the whole matrix.
+/// The cursor is rewound by the matrix owner when slots state changes.
+class ChunksLoadQueue {
+    int width = 0;
+    int height = 0;
+    int padding = 0;
+    /// @brief Matrix indices of slots sorted by distance to the center
+    std::vector<uint32_t> order;
+    /// @brief Position of a matrix index in the order
+    std::vector<uint32_t> ranks;
+    size_t cursor = 0;
+public:
+    /// @brief Build the order if matrix size or padding has changed
+    void configure(int width, int height, uint padding);
+
+    /// @brief Process all slots again
+    void reset() {
+        cursor = 0;
+    }
+
+    /// @brief Process again 3x3 slots area around the matrix slot
+    /// (neighbours of a put chunk may become ready for lighting)
+    void onChanged(int x, int z);
+
+    /// @return matrix index of the current slot or -1 if all slots were
+    /// processed
+    int current() const {
+        return cursor < order.size() ? order[cursor] : -1;
+    }
+
+    /// @brief Mark current slot as requiring no work
+    void next() {
+        cursor++;
+    }
+};
@@ -37,30 +37,6 @@ std::shared_ptr<Chunk> GlobalChunks::fetch(int x, int z) {
     return found->second;
 }
 
-static void check_voxels(const ContentIndices& indices, Chunk& chunk) {
-    bool corrupted = false;
-    blockid_t defsCount = indices.blocks.count();
-    for (size_t i = 0; i < CHUNK_VOL; i++) {
-        blockid_t id = chunk.voxels[i].id;
-        if (id >= defsCount) {
-            if (!corrupted) {
-#ifdef NDEBUG
-                // release
-                auto logline = logger.error();
-                logline << "corruped blocks detected at " << i << " of chunk ";
-                logline << chunk.x << "x" << chunk.z;
-                logline << " -> " << id;
-                corrupted = true;
-#else
-                // debug
-                abort();
-#endif
-            }
-            chunk.voxels[i].id = BLOCK_AIR;
-        }
-    }
-}
-
 void GlobalChunks::erase(int x, int z) {
     chunksMap.erase(keyfrom(x, z));
 }
@@ -88,6 +64,32 @@ static inline auto load_inventories(
     return invs;
 }
 
+void GlobalChunks::checkVoxels(const ContentIndices& indices, Chunk& chunk) {
+    bool corrupted = false;
+    blockid_t defsCount = indices.blocks.count();
+    for (size_t i = 0; i < CHUNK_VOL; i++) {
+        blockid_t id = chunk.voxels[i].id;
+        if (id >= defsCount) {
+            if (!corrupted) {
+#ifdef NDEBUG
+                // release
+                auto logline = logger.error();
+                logline << "corruped blocks detected at " << i << " of chunk ";
+                logline << chunk.x << "x" << chunk.z;
+                logline << " -> " << id;
+                corrupted = true;
+#else
+                // debug
+                abort();
+#endif
+            }
+            chunk.voxels.edit(i).id = BLOCK_AIR;
+            // stored data differs from the repaired one
+            chunk.flags.unsaved = true;
+        }
+    }
+}
+
 std::shared_ptr<Chunk> GlobalChunks::create(int x, int z) {
     const auto& found = chunksMap.find(keyfrom(x, z));
     if (found != chunksMap.end()) {
@@ -95,17 +97,34 @@ std::shared_ptr<Chunk> GlobalChunks::create(int x, int z) {
     }
 
     auto chunk = std::make_shared<Chunk>(x, z);
-    chunksMap[keyfrom(x, z)] = chunk;
 
     World& world = *level.getWorld();
     auto& regions = world.wfile.get()->getRegions();
 
     if (auto data = regions.getVoxels(chunk->x, chunk->z)) {
-        const auto& indices = *level.content.getIndices();
-
         chunk->decode(data.get());
-        check_voxels(indices, *chunk);
+        checkVoxels(indices, *chunk);
+        chunk->updateOccupancy(indices);
+        chunk->flags.loaded = true;
+    }
+    if (auto lights = regions.getLights(chunk->x, chunk->z)) {
+        chunk->lightmap.set(lights.get());
+        chunk->flags.loadedLights = true;
+    }
+    if (compactStorage) {
+        chunk->compact();
+    }
+    install(chunk);
+    return chunk;
+}
 
+void GlobalChunks::install(std::shared_ptr<Chunk> chunk) {
+    chunksMap[keyfrom(chunk->x, chunk->z)] = chunk;
+
+    World& world = *level.getWorld();
+    auto& regions = world.wfile.get()->getRegions();
+
+    if (chunk->flags.loaded) {
         chunk->setBlockInventories(
             load_inventories(regions, *chunk, indices.blocks)
         );
@@ -116,19 +135,13 @@ std::shared_ptr<Chunk> GlobalChunks::create(int x, int z) {
             chunk->flags.entities = true;
         }
 
-        chunk->flags.loaded = true;
         for (auto& entry : chunk->inventories) {
             level.inventories->store(entry.second);
         }
     }
-    if (auto lights = regions.getLights(chunk->x, chunk->z)) {
-        chunk->lightmap.set(lights.get());
-        chunk->flags.loadedLights = true;
-    }
     chunk->blocksMetadata = regions.getBlocksData(chunk->x, chunk->z);
 
     level.events->trigger(LevelEventType::CHUNK_PRESENT, chunk.get());
-    return chunk;
 }
 
 void GlobalChunks::pinChunk(std::shared_ptr<Chunk> chunk) {
@@ -207,3 +220,11 @@ void GlobalChunks::putChunk(std::shared_ptr<Chunk> chunk) {
 const AABB* GlobalChunks::isObstacleAt(float x, float y, float z) const {
     return blocks_agent::is_obstacle_at(*this, x, y, z);
 }
+
+void GlobalChunks::onBlockSet(int x, int y, int z) {
+    if (level.entities == nullptr) {
+        return;
+    }
+    glm::vec3 pos(x, y, z);
+    level.entities->wakeUpBodies(AABB(pos - 1.0f, pos + 2.0f));
+}
@@ -33,15 +33,31 @@ class GlobalChunks {
     std::unordered_map<ptrdiff_t, int> refCounters;
 
     consumer<Chunk&> onUnload;
+    bool compactStorage = false;
 public:
     GlobalChunks(Level& level);
     ~GlobalChunks() = default;
 
     void setOnUnload(consumer<Chunk&> onUnload);
 
+    /// @brief Enable compaction of chunks read or generated
+    /// (see Chunk::compact)
+    void setCompactStorage(bool flag) {
+        compactStorage = flag;
+    }
+
+    bool isCompactStorage() const {
+        return compactStorage;
+    }
+
     std::shared_ptr<Chunk> fetch(int x, int z);
     std::shared_ptr<Chunk> create(int x, int z);
 
+    /// @brief Add chunk which voxels and lights are already read or generated
+    /// (see ChunksLoader). Loads the rest of the chunk data and triggers
+    /// CHUNK_PRESENT event.
+    void install(std::shared_ptr<Chunk> chunk);
+
     void pinChunk(std::shared_ptr<Chunk> chunk);
     void unpinChunk(int x, int z);
 
@@ -59,6 +75,9 @@ public:
 
     const AABB* isObstacleAt(float x, float y, float z) const;
 
+    /// @brief Wake up resting bodies around the changed block
+    void onBlockSet(int x, int y, int z);
+
     inline Chunk* getChunk(int cx, int cz) const {
         const auto& found = chunksMap.find(keyfrom(cx, cz));
         if (found == chunksMap.end()) {
@@ -70,4 +89,7 @@ public:
     const ContentIndices& getContentIndices() const {
         return indices;
     }
+
+    /// @brief Replace voxels with unknown block id with air
+    static void checkVoxels(const ContentIndices& indices, Chunk& chunk);
 };
@@ -0,0 +1,155 @@
+#include "PalettedVoxels.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+static inline uint32_t voxel2int(const voxel& vox) {
+    return vox.id | (static_cast<uint32_t>(blockstate2int(vox.state)) << 16);
+}
+
+/// @brief Get number of bits per palette index. Powers of two only to keep
+/// indices from crossing 64-bit words bounds
+static inline ubyte palette_bits(size_t paletteSize) {
+    if (paletteSize <= 1) {
+        return 0;
+    } else if (paletteSize <= 2) {
+        return 1;
+    } else if (paletteSize <= 4) {
+        return 2;
+    } else if (paletteSize <= 16) {
+        return 4;
+    } else if (paletteSize <= 256) {
+        return 8;
+    }
+    return 16;
+}
+
+voxel* PalettedVoxels::expand(uint index) {
+    const auto& section = sections[index];
+    auto dense = new voxel[CHUNK_SECTION_VOL];
+    if (section.bits == 0) {
+        std::fill(dense, dense + CHUNK_SECTION_VOL, section.uniform);
+    } else {
+        for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+            dense[i] = unpack(section, i);
+        }
+    }
+    sections[index].dense.store(dense, std::memory_order_release);
+    // readers coming after the fence see the dense array, so packed data
+    // may be released if there are no readers at the moment
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (readers.load(std::memory_order_acquire) == 0) {
+        releasePacked();
+    }
+    return dense;
+}
+
+void PalettedVoxels::releasePacked() {
+    for (auto& section : sections) {
+        if (section.bits && section.dense.load(std::memory_order_relaxed)) {
+            section.palette.reset();
+            section.indices.reset();
+            section.paletteSize = 1;
+            section.bits = 0;
+        }
+    }
+}
+
+void PalettedVoxels::pack(uint index, const voxel* src) {
+    auto& section = sections[index];
+
+    uint16_t localIndices[CHUNK_SECTION_VOL];
+    std::vector<voxel> palette;
+    std::unordered_map<uint32_t, uint16_t> paletteIndices;
+    uint32_t prevKey = 0;
+    uint16_t prevIndex = 0;
+    for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+        uint32_t key = voxel2int(src[i]);
+        // voxels are mostly stored in runs
+        if (i == 0 || key != prevKey) {
+            auto [found, inserted] =
+                paletteIndices.try_emplace(key, palette.size());
+            if (inserted) {
+                palette.push_back(src[i]);
+            }
+            prevKey = key;
+            prevIndex = found->second;
+        }
+        localIndices[i] = prevIndex;
+    }
+
+    section.paletteSize = palette.size();
+    section.bits = palette_bits(palette.size());
+    section.palette.reset();
+    section.indices.reset();
+    if (section.bits == 0) {
+        section.uniform = palette[0];
+        return;
+    }
+    section.palette = std::make_unique<voxel[]>(palette.size());
+    std::copy(palette.begin(), palette.end(), section.palette.get());
+
+    section.indices =
+        std::make_unique<uint64_t[]>(CHUNK_SECTION_VOL * section.bits / 64);
+    uint64_t* indices = section.indices.get();
+    for (uint i = 0; i < CHUNK_SECTION_VOL; i++) {
+        uint bit = i * section.bits;
+        indices[bit / 64] |= static_cast<uint64_t>(localIndices[i])
+                             << (bit % 64);
+    }
+}
+
+void PalettedVoxels::assign(const voxel* src) {
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        std::memcpy(
+            editSection(i),
+            src + i * CHUNK_SECTION_VOL,
+            CHUNK_SECTION_VOL * sizeof(voxel)
+        );
+    }
+}
+
+void PalettedVoxels::copyTo(voxel* dst) const {
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        const auto& section = sections[i];
+        voxel* sectionDst = dst + i * CHUNK_SECTION_VOL;
+        if (auto dense = section.dense.load(std::memory_order_acquire)) {
+            std::memcpy(sectionDst, dense, CHUNK_SECTION_VOL * sizeof(voxel));
+        } else if (section.bits == 0) {
+            std::fill(
+                sectionDst, sectionDst + CHUNK_SECTION_VOL, section.uniform
+            );
+        } else {
+            for (uint j = 0; j < CHUNK_SECTION_VOL; j++) {
+                sectionDst[j] = unpack(section, j);
+            }
+        }
+    }
+}
+
+void PalettedVoxels::compact() {
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        auto& section = sections[i];
+        if (auto dense = section.dense.load(std::memory_order_relaxed)) {
+            pack(i, dense);
+            section.dense.store(nullptr, std::memory_order_relaxed);
+            delete[] dense;
+        }
+    }
+}
+
+size_t PalettedVoxels::getMemoryUsage() const {
+    size_t size = sizeof(PalettedVoxels);
+    for (const auto& section : sections) {
+        if (section.dense.load(std::memory_order_relaxed)) {
+            size += CHUNK_SECTION_VOL * sizeof(voxel);
+        }
+        if (section.bits) {
+            size += section.paletteSize * sizeof(voxel);
+            size += CHUNK_SECTION_VOL * section.bits / 8;
+        }
+    }
+    return size;
+}
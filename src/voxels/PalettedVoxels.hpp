@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+#include "constants.hpp"
+#include "typedefs.hpp"
+#include "voxel.hpp"
+
+/// @brief Chunk voxels storage split into sections of CHUNK_SECTION_H
+/// layers. Section is stored as dense voxels array or as palette of unique
+/// voxels with bit-packed palette indices. Uniform section has a single
+/// palette entry and no indices.
+///
+/// Reading never allocates. Modification expands the section to dense
+/// array. Other threads must read the storage holding a ReadGuard: packed
+/// data of expanded sections is released as soon as no guarded readers
+/// left. compact() releases memory and must not be called while the
+/// storage is accessed by other threads.
+class PalettedVoxels {
+    struct Section {
+        /// @brief Expanded section or nullptr if section is packed
+        std::atomic<voxel*> dense {nullptr};
+        /// @brief Palette of packed section having more than one entry
+        std::unique_ptr<voxel[]> palette;
+        /// @brief Bit-packed palette indices
+        std::unique_ptr<uint64_t[]> indices;
+        /// @brief Value of packed uniform section
+        voxel uniform {};
+        uint16_t paletteSize = 1;
+        /// @brief Palette index bits (0, 1, 2, 4, 8 or 16), 0 means uniform
+        /// section
+        ubyte bits = 0;
+
+        ~Section() {
+            delete[] dense.load(std::memory_order_relaxed);
+        }
+    };
+    Section sections[CHUNK_SECTIONS];
+    /// @brief Number of readers from other threads
+    mutable std::atomic<int> readers {0};
+
+    static inline const voxel& unpack(const Section& section, uint local) {
+        if (section.bits == 0) {
+            return section.uniform;
+        }
+        uint bit = local * section.bits;
+        uint mask = (1U << section.bits) - 1;
+        uint index = (section.indices[bit / 64] >> (bit % 64)) & mask;
+        return section.palette[index];
+    }
+
+    voxel* expand(uint section);
+    void pack(uint section, const voxel* src);
+    void releasePacked();
+public:
+    /// @brief Keeps packed data of sections alive while the storage is read
+    /// by another thread
+    class ReadGuard {
+        const PalettedVoxels& voxels;
+    public:
+        ReadGuard(const PalettedVoxels& voxels) : voxels(voxels) {
+            voxels.readers.fetch_add(1, std::memory_order_relaxed);
+            // pairs with the fence in expand()
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        ReadGuard(const ReadGuard&) = delete;
+
+        ~ReadGuard() {
+            voxels.readers.fetch_sub(1, std::memory_order_release);
+        }
+    };
+
+    /// @brief Creates storage filled with air
+    PalettedVoxels() = default;
+    PalettedVoxels(const PalettedVoxels&) = delete;
+
+    inline const voxel& operator[](uint index) const {
+        const auto& section = sections[index / CHUNK_SECTION_VOL];
+        uint local = index % CHUNK_SECTION_VOL;
+        if (auto dense = section.dense.load(std::memory_order_acquire)) {
+            return dense[local];
+        }
+        return unpack(section, local);
+    }
+
+    /// @brief Copy voxels range located in a single section
+    /// @param index first voxel index
+    /// @param count number of voxels
+    /// @param dst destination array
+    inline void copyRange(uint index, uint count, voxel* dst) const {
+        const auto& section = sections[index / CHUNK_SECTION_VOL];
+        uint local = index % CHUNK_SECTION_VOL;
+        if (auto dense = section.dense.load(std::memory_order_acquire)) {
+            std::memcpy(dst, dense + local, count * sizeof(voxel));
+            return;
+        }
+        for (uint i = 0; i < count; i++) {
+            dst[i] = unpack(section, local + i);
+        }
+    }
+
+    /// @brief Get dense voxels array of the section for modification.
+    /// Expands packed section
+    /// @param section section index
+    inline voxel* editSection(uint section) {
+        auto dense = sections[section].dense.load(std::memory_order_relaxed);
+        if (dense) {
+            return dense;
+        }
+        return expand(section);
+    }
+
+    /// @brief Get voxel for modification. Expands packed section
+    /// @param index voxel index
+    inline voxel& edit(uint index) {
+        voxel* dense = editSection(index / CHUNK_SECTION_VOL);
+        return dense[index % CHUNK_SECTION_VOL];
+    }
+
+    /// @brief Check if section is stored packed
+    inline bool isPacked(uint section) const {
+        return sections[section].dense.load(std::memory_order_acquire) ==
+               nullptr;
+    }
+
+    /// @brief Replace all voxels
+    /// @param src array of CHUNK_VOL voxels
+    void assign(const voxel* src);
+
+    /// @brief Copy all voxels to the array
+    /// @param dst array of CHUNK_VOL voxels
+    void copyTo(voxel* dst) const;
+
+    /// @brief Pack expanded sections and release unused memory.
+    /// Must not be called while the storage is accessed by other threads
+    void compact();
+
+    /// @return bytes used by the storage including its own size
+    size_t getMemoryUsage() const;
+};
@@ -30,7 +30,7 @@ static inline void set_block(
     size_t index = vox_index(lx, y, lz);
 
     // block finalization
-    voxel& vox = chunk->voxels[(y * CHUNK_D + lz) * CHUNK_W + lx];
+    voxel& vox = chunk->voxels.edit((y * CHUNK_D + lz) * CHUNK_W + lx);
     const auto& prevdef = indices.blocks.require(vox.id);
     if (prevdef.inventorySize != 0) {
         chunk->removeBlockInventory(lx, y, lz);
@@ -50,6 +50,7 @@ static inline void set_block(
     const auto& newdef = indices.blocks.require(id);
     vox.id = id;
     vox.state = state;
+    chunk->updateOccupancy(index, newdef);
     chunk->setModifiedAndUnsaved();
     if (!state.segment && newdef.rt.extended) {
         repair_segments(chunks, newdef, state, x, y, z);
@@ -96,10 +97,11 @@ void blocks_agent::set(
     blockstate state
 ) {
     set_block(chunks, x, y, z, id, state);
+    chunks.onBlockSet(x, y, z);
 }
 
 template <class Storage>
-static inline voxel* raycast_blocks(
+static inline const voxel* raycast_blocks(
     const Storage& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -144,7 +146,7 @@ static inline voxel* raycast_blocks(
     int steppedIndex = -1;
 
     while (t <= maxDist) {
-        voxel* voxel = get(chunks, ix, iy, iz);
+        const voxel* voxel = get(chunks, ix, iy, iz);
         if (voxel == nullptr) {
             return nullptr;
         }
@@ -240,7 +242,7 @@ static inline voxel* raycast_blocks(
     return nullptr;
 }
 
-voxel* blocks_agent::raycast(
+const voxel* blocks_agent::raycast(
     const Chunks& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -253,7 +255,7 @@ voxel* blocks_agent::raycast(
     return raycast_blocks(chunks, start, dir, maxDist, end, norm, iend, filter);
 }
 
-voxel* blocks_agent::raycast(
+const voxel* blocks_agent::raycast(
     const GlobalChunks& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -313,8 +315,10 @@ inline void get_voxels_impl(
                     }
                 }
             } else {
-                const voxel* cvoxels = chunk->voxels;
-                const light_t* clights = chunk->lightmap.getLights();
+                const auto& cvoxels = chunk->voxels;
+                const auto& clights = chunk->lightmap;
+                // chunks are read by mesh building threads
+                PalettedVoxels::ReadGuard guard(cvoxels);
                 for (int ly = y; ly < y + h; ly++) {
                     for (int lz = std::max(z, cz * CHUNK_D);
                              lz < std::min(z + d, (cz + 1) * CHUNK_D);
@@ -331,7 +335,7 @@ inline void get_voxels_impl(
                                 CHUNK_D
                             );
                             voxels[vidx] = cvoxels[cidx];
-                            light_t light = clights[cidx];
+                            light_t light = clights.get(cidx);
                             if (backlight) {
                                 const auto block = blocks.get(voxels[vidx].id);
                                 if (block && block->lightPassing) {
@@ -44,7 +44,7 @@ inline Chunk* get_chunk(const Storage& chunks, int cx, int cz) {
 /// @param z position Z
 /// @return voxel pointer or nullptr
 template<class Storage>
-inline voxel* get(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
+inline const voxel* get(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
     if (y < 0 || y >= CHUNK_H) {
         return nullptr;
     }
@@ -59,6 +59,31 @@ inline voxel* get(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
     return &chunk->voxels[(y * CHUNK_D + lz) * CHUNK_W + lx];
 }
 
+/// @brief Get voxel at specified position for modification.
+/// Expands packed chunk section (see PalettedVoxels).
+/// Returns nullptr if voxel does not exists. 
+/// @tparam Storage chunks storage class
+/// @param chunks chunks storage
+/// @param x position X
+/// @param y position Y
+/// @param z position Z
+/// @return voxel pointer or nullptr
+template<class Storage>
+inline voxel* edit(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
+    if (y < 0 || y >= CHUNK_H) {
+        return nullptr;
+    }
+    int cx = floordiv<CHUNK_W>(x);
+    int cz = floordiv<CHUNK_D>(z);
+    Chunk* chunk = get_chunk(chunks, cx, cz);
+    if (chunk == nullptr) {
+        return nullptr;
+    }
+    int lx = x - cx * CHUNK_W;
+    int lz = z - cz * CHUNK_D;
+    return &chunk->voxels.edit((y * CHUNK_D + lz) * CHUNK_W + lx);
+}
+
 /// @brief Get voxel at specified position.
 /// @throws std::runtime_error if voxel does not exists
 /// @tparam Storage chunks storage class
@@ -68,7 +93,7 @@ inline voxel* get(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
 /// @param z position Z
 /// @return voxel reference
 template<class Storage>
-inline voxel& require(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
+inline const voxel& require(const Storage& chunks, int32_t x, int32_t y, int32_t z) {
     auto vox = get(chunks, x, y, z);
     if (vox == nullptr) {
         throw std::runtime_error("voxel does not exist");
@@ -325,7 +350,7 @@ inline void set_rotation_extended(
                 blockstate segState = newstate;
                 segState.segment = segment_to_int(sx, sy, sz);
 
-                auto vox = get(chunks, pos.x, pos.y, pos.z);
+                auto vox = edit(chunks, pos.x, pos.y, pos.z);
                 // checked for nullptr by checkReplaceability
                 if (vox->id != def.rt.id) {
                     set(chunks, pos.x, pos.y, pos.z, def.rt.id, segState);
@@ -386,7 +411,7 @@ inline void set_rotation(
         vox = get(chunks, origin.x, origin.y, origin.z);
         set_rotation_extended(chunks, def, vox->state, origin, index);
     } else {
-        vox->state.rotation = index;
+        edit(chunks, x, y, z)->state.rotation = index;
         int cx = floordiv<CHUNK_W>(x);
         int cz = floordiv<CHUNK_D>(z);
         auto chunk = get_chunk(chunks, cx, cz);
@@ -405,7 +430,7 @@ inline void set_rotation(
 /// @param iend [out] ray end integer position (voxel position + normal)
 /// @param filter filtered ids
 /// @return voxel pointer or nullptr
-voxel* raycast(
+const voxel* raycast(
     const Chunks& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -426,7 +451,7 @@ voxel* raycast(
 /// @param iend [out] ray end integer position (voxel position + normal)
 /// @param filter filtered ids
 /// @return voxel pointer or nullptr
-voxel* raycast(
+const voxel* raycast(
     const GlobalChunks& chunks,
     const glm::vec3& start,
     const glm::vec3& dir,
@@ -446,7 +471,7 @@ inline const AABB* is_obstacle_at(const Storage& chunks, float x, float y, float
     int ix = std::floor(x);
     int iy = std::floor(y);
     int iz = std::floor(z);
-    voxel* v = get(chunks, ix, iy, iz);
+    const voxel* v = get(chunks, ix, iy, iz);
     if (v == nullptr) {
         if (iy >= CHUNK_H) {
             return nullptr;
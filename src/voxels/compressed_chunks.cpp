@@ -1,52 +1,324 @@
 #include "compressed_chunks.hpp"
 
+#include <cstring>
+#include <optional>
+
 #include "coders/rle.hpp"
 #include "coders/gzip.hpp"
+#include "coders/compression.hpp"
 
 #include "world/files/WorldFiles.hpp"
 #include "content/Content.hpp"
+#include "Block.hpp"
 
 inline constexpr int HAS_VOXELS = 0x1;
 inline constexpr int HAS_METADATA = 0x2;
+inline constexpr int HAS_LIGHTS = 0x4;
+inline constexpr int HAS_CHANGES = 0x8;
+/// @brief Voxels are compressed with the method stored in the second byte
+/// instead of GZIP over EXTRLE16
+inline constexpr int VOXELS_METHOD = 0x10;
 
-std::vector<ubyte> compressed_chunks::encode(
+/// @brief Lights stored in packets are compressed the way regions do
+inline constexpr auto LIGHTS_METHOD = compression::Method::EXTRLE8;
+
+static_assert(CHUNK_VOL <= 0x10000, "voxel index must fit 16 bits");
+
+static void put_section(ByteBuilder& builder, const ubyte* data, size_t size) {
+    builder.putInt32(size);
+    builder.put(data, size);
+}
+
+static void put_lights(
+    ByteBuilder& builder,
     const ubyte* data,
-    const BlocksMetadata& metadata,
-    util::Buffer<ubyte>& rleBuffer
+    size_t size,
+    compression::Method method
 ) {
+    if (method == compression::Method::NONE) {
+        size_t length;
+        auto compressed =
+            compression::compress(data, size, length, LIGHTS_METHOD);
+        builder.put(static_cast<ubyte>(LIGHTS_METHOD));
+        put_section(builder, compressed.get(), length);
+        return;
+    }
+    builder.put(static_cast<ubyte>(method));
+    put_section(builder, data, size);
+}
+
+static std::vector<ubyte> compress_voxels(const ubyte* data) {
+    // chunks may be encoded by multiple threads
+    static thread_local util::Buffer<ubyte> rleBuffer(CHUNK_DATA_LEN * 2);
     size_t rleCompressedSize =
         extrle::encode16(data, CHUNK_DATA_LEN, rleBuffer.data());
+    return gzip::compress(rleBuffer.data(), rleCompressedSize);
+}
 
-    const auto gzipCompressedData = gzip::compress(
-        rleBuffer.data(), rleCompressedSize
-    );
+/// @brief Chunk lights data to be put to a packet
+struct LightsData {
+    std::unique_ptr<ubyte[]> data;
+    uint32_t size = 0;
+    compression::Method method = compression::Method::NONE;
+};
+
+/// @param voxels compressed voxels data
+/// @param method voxels compression method, nullopt for GZIP over EXTRLE16
+/// @param lights lights data or nullptr
+static std::vector<ubyte> build_packet(
+    const ubyte* voxels,
+    size_t size,
+    std::optional<compression::Method> method,
+    const BlocksMetadata& metadata,
+    const LightsData* lights
+) {
     auto metadataBytes = metadata.serialize();
+    bool hasLights = lights && lights->data;
 
-    ByteBuilder builder(2 + 8 + gzipCompressedData.size() + metadataBytes.size());
-    builder.put(HAS_VOXELS | HAS_METADATA); // flags
-    builder.put(0); // reserved
-    builder.putInt32(gzipCompressedData.size());
-    builder.put(gzipCompressedData.data(), gzipCompressedData.size());
-    builder.putInt32(metadataBytes.size());
-    builder.put(metadataBytes.data(), metadataBytes.size());
+    ByteBuilder builder(2 + 8 + size + metadataBytes.size());
+    builder.put(
+        HAS_VOXELS | HAS_METADATA | (method ? VOXELS_METHOD : 0) |
+        (hasLights ? HAS_LIGHTS : 0)
+    ); // flags
+    builder.put(method ? static_cast<ubyte>(*method) : 0);
+    put_section(builder, voxels, size);
+    put_section(builder, metadataBytes.data(), metadataBytes.size());
+    if (hasLights) {
+        put_lights(builder, lights->data.get(), lights->size, lights->method);
+    }
     return builder.build();
 }
 
-std::vector<ubyte> compressed_chunks::encode(const Chunk& chunk) {
+static LightsData get_lights(const Lightmap& lightmap) {
+    return LightsData {lightmap.encode(), LIGHTMAP_DATA_LEN};
+}
+
+std::vector<ubyte> compressed_chunks::encode(
+    const ubyte* data,
+    const BlocksMetadata& metadata,
+    const Lightmap* lights
+) {
+    const auto gzipCompressedData = compress_voxels(data);
+    LightsData lightsData;
+    if (lights) {
+        lightsData = get_lights(*lights);
+    }
+    return build_packet(
+        gzipCompressedData.data(),
+        gzipCompressedData.size(),
+        std::nullopt,
+        metadata,
+        &lightsData
+    );
+}
+
+std::vector<ubyte> compressed_chunks::encode(const Chunk& chunk, bool lights) {
     auto data = chunk.encode();
+    return encode(
+        data.get(), chunk.blocksMetadata, lights ? &chunk.lightmap : nullptr
+    );
+}
+
+std::vector<ubyte> compressed_chunks::encode(
+    int x,
+    int z,
+    const Chunk* chunk,
+    WorldRegions& regions,
+    bool lights,
+    bool passStored
+) {
+    bool stored = chunk == nullptr ||
+                  (passStored && chunk->flags.loaded && !chunk->flags.unsaved);
+    if (!stored) {
+        return encode(*chunk, lights);
+    }
+    uint32_t size, srcSize;
+    compression::Method method;
+    auto voxels = regions.getCompressed(
+        x, z, REGION_LAYER_VOXELS, size, srcSize, method
+    );
+    if (voxels == nullptr || srcSize != CHUNK_DATA_LEN) {
+        return chunk ? encode(*chunk, lights) : std::vector<ubyte>();
+    }
+    BlocksMetadata storedMetadata;
+    if (chunk == nullptr) {
+        storedMetadata = regions.getBlocksData(x, z);
+    }
+    const auto& metadata = chunk ? chunk->blocksMetadata : storedMetadata;
+
+    // lights of loaded chunks are actual, stored ones are cache
+    LightsData lightsData;
+    if (lights && chunk) {
+        lightsData = get_lights(chunk->lightmap);
+    } else if (lights) {
+        uint32_t lightsSrcSize = 0;
+        lightsData.data = regions.getCompressed(
+            x,
+            z,
+            REGION_LAYER_LIGHTS,
+            lightsData.size,
+            lightsSrcSize,
+            lightsData.method
+        );
+        if (lightsSrcSize != LIGHTMAP_DATA_LEN) {
+            lightsData.data = nullptr;
+        }
+    }
+    if (!passStored || method == compression::Method::NONE) {
+        // data queued by the regions saver is not compressed yet
+        if (method != compression::Method::NONE) {
+            voxels = compression::decompress(
+                voxels.get(), size, srcSize, method
+            );
+        }
+        auto compressed = compress_voxels(voxels.get());
+        return build_packet(
+            compressed.data(),
+            compressed.size(),
+            std::nullopt,
+            metadata,
+            &lightsData
+        );
+    }
+    return build_packet(voxels.get(), size, method, metadata, &lightsData);
+}
+
+std::vector<ubyte> compressed_chunks::encode_changes(
+    const Chunk& chunk, const std::vector<uint>& indices
+) {
+    ByteBuilder builder(2 + 4 + indices.size() * 6);
+    builder.put(HAS_CHANGES); // flags
+    builder.put(0); // reserved
+    builder.putInt32(indices.size());
+    for (uint index : indices) {
+        const voxel& vox = chunk.voxels[index];
+        builder.putInt16(index);
+        builder.putInt16(vox.id);
+        builder.putInt16(blockstate2int(vox.state));
+    }
+    return builder.build();
+}
+
+bool compressed_chunks::is_changes(const ubyte* src, size_t size) {
+    return size >= 2 && (src[0] & HAS_CHANGES);
+}
+
+static void read_changes(
+    ByteReader& reader, std::vector<compressed_chunks::VoxelChange>& dst
+) {
+    size_t count = reader.getInt32();
+    if (count * 6 > reader.remaining()) {
+        throw std::runtime_error("invalid block changes batch");
+    }
+    dst.reserve(dst.size() + count);
+    for (size_t i = 0; i < count; i++) {
+        uint index = static_cast<uint16_t>(reader.getInt16());
+        blockid_t id = reader.getInt16();
+        auto state = int2blockstate(static_cast<uint16_t>(reader.getInt16()));
+        dst.push_back({index, voxel {id, state}});
+    }
+}
+
+std::vector<compressed_chunks::VoxelChange> compressed_chunks::decode_changes(
+    const ubyte* src, size_t size
+) {
+    ByteReader reader(src, size);
+    ubyte flags = reader.get();
+    reader.skip(1); // reserved byte
+
+    std::vector<VoxelChange> changes;
+    if (flags & HAS_CHANGES) {
+        read_changes(reader, changes);
+    }
+    return changes;
+}
+
+void compressed_chunks::check_changes(
+    const std::vector<VoxelChange>& changes, const ContentIndices& indices
+) {
+    for (const auto& change : changes) {
+        if (change.index >= CHUNK_VOL) {
+            throw std::runtime_error(
+                "voxel index is out of chunk: " + std::to_string(change.index)
+            );
+        }
+        const Block* def = indices.blocks.get(change.vox.id);
+        if (def == nullptr) {
+            throw std::runtime_error(
+                "unknown block id " + std::to_string(change.vox.id)
+            );
+        }
+        const auto& state = change.vox.state;
+        if ((def->rotatable &&
+             state.rotation >= def->rotations.variantsCount) ||
+            (state.segment && !def->rt.extended)) {
+            throw std::runtime_error(
+                "invalid state " + std::to_string(blockstate2int(state)) +
+                " of block " + def->name
+            );
+        }
+    }
+}
+
+static size_t read_section_size(ByteReader& reader) {
+    size_t size = reader.getInt32();
+    if (size > reader.remaining()) {
+        throw std::runtime_error("chunk packet is truncated");
+    }
+    return size;
+}
 
-    /// world.get_chunk_data is only available in the main Lua state
-    static util::Buffer<ubyte> rleBuffer(CHUNK_DATA_LEN * 2);
-    return encode(data.get(), chunk.blocksMetadata, rleBuffer);
+static void read_voxel_data(
+    ByteReader& reader, ubyte flags, ubyte method, util::Buffer<ubyte>& dst
+) {
+    size_t size = read_section_size(reader);
+    if (!(flags & VOXELS_METHOD)) {
+        auto rleData = gzip::decompress(reader.pointer(), size);
+        extrle::decode16(rleData.data(), rleData.size(), dst.data());
+    } else if (auto m = compression::method_from_byte(method);
+               m != compression::Method::NONE) {
+        auto data = compression::decompress(
+            reader.pointer(), size, CHUNK_DATA_LEN, m
+        );
+        std::memcpy(dst.data(), data.get(), CHUNK_DATA_LEN);
+    } else if (size == CHUNK_DATA_LEN) {
+        std::memcpy(dst.data(), reader.pointer(), CHUNK_DATA_LEN);
+    } else {
+        throw std::runtime_error("invalid chunk data size");
+    }
+    reader.skip(size);
 }
 
-static void read_voxel_data(ByteReader& reader, util::Buffer<ubyte>& dst) {
-    size_t gzipCompressedSize = reader.getInt32();
-        
-    auto rleData = gzip::decompress(reader.pointer(), gzipCompressedSize);
-    reader.skip(gzipCompressedSize);
+/// @return lights data of LIGHTMAP_DATA_LEN bytes
+static std::unique_ptr<ubyte[]> read_lights(ByteReader& reader) {
+    auto method = compression::method_from_byte(reader.get());
+    size_t size = read_section_size(reader);
+    std::unique_ptr<ubyte[]> data;
+    if (method != compression::Method::NONE) {
+        data = compression::decompress(
+            reader.pointer(), size, LIGHTMAP_DATA_LEN, method
+        );
+    } else if (size == LIGHTMAP_DATA_LEN) {
+        data = std::make_unique<ubyte[]>(size);
+        std::memcpy(data.get(), reader.pointer(), size);
+    } else {
+        throw std::runtime_error("invalid lights data size");
+    }
+    reader.skip(size);
+    return data;
+}
 
-    extrle::decode16(rleData.data(), rleData.size(), dst.data());
+static const Block& require_block(
+    const Chunk& chunk, const ContentIndices& indices, uint index, blockid_t id
+) {
+    if (auto def = indices.blocks.get(id)) {
+        return *def;
+    }
+    throw std::runtime_error(
+        "block data corruption (chunk: " + std::to_string(chunk.x) +
+        ", " + std::to_string(chunk.z) + ") at " +
+        std::to_string(index) + " id: " + std::to_string(id)
+    );
 }
 
 void compressed_chunks::decode(
@@ -55,51 +327,60 @@ void compressed_chunks::decode(
     ByteReader reader(src, size);
 
     ubyte flags = reader.get();
-    reader.skip(1); // reserved byte
+    ubyte method = reader.get();
+    if (flags & HAS_CHANGES) {
+        throw std::runtime_error(
+            "block changes batch must be decoded with decode_changes"
+        );
+    }
 
     if (flags & HAS_VOXELS) {
-        /// world.get_chunk_data is only available in the main Lua state
-        static util::Buffer<ubyte> voxelData (CHUNK_DATA_LEN);
-        read_voxel_data(reader, voxelData);
+        static thread_local util::Buffer<ubyte> voxelData (CHUNK_DATA_LEN);
+        read_voxel_data(reader, flags, method, voxelData);
         // TODO: move somewhere in Chunk
         auto src = reinterpret_cast<const uint16_t*>(voxelData.data());
         for (size_t i = 0; i < CHUNK_VOL; i++) {
-            blockid_t id = dataio::le2h(src[i]);;
-            if (indices.blocks.get(id) == nullptr) {
-                throw std::runtime_error(
-                    "block data corruption (chunk: " + std::to_string(chunk.x) +
-                    ", " + std::to_string(chunk.z) + ") at " +
-                    std::to_string(i) + " id: " + std::to_string(id)
-                );
-            }
+            require_block(chunk, indices, i, dataio::le2h(src[i]));
         }
         chunk.decode(voxelData.data());
         chunk.updateHeights();
+        chunk.updateOccupancy(indices);
+        // lights of previous voxels
+        chunk.flags.loadedLights = false;
     }
     if (flags & HAS_METADATA) {
-        size_t metadataSize = reader.getInt32();
+        size_t metadataSize = read_section_size(reader);
         chunk.blocksMetadata.deserialize(reader.pointer(), metadataSize);
         reader.skip(metadataSize);
     }
+    if (flags & HAS_LIGHTS) {
+        auto lights = Lightmap::decode(read_lights(reader).get());
+        chunk.lightmap.set(lights.get());
+        chunk.flags.loadedLights = true;
+    }
     chunk.setModifiedAndUnsaved();
 }
 
 void compressed_chunks::save(
-    int x, int z, std::vector<ubyte> bytes, WorldRegions& regions
+    int x,
+    int z,
+    std::vector<ubyte> bytes,
+    WorldRegions& regions,
+    const ContentIndices& indices
 ) {
     ByteReader reader(bytes.data(), bytes.size());
 
     ubyte flags = reader.get();
-    reader.skip(1); // reserved byte
+    ubyte method = reader.get();
     if (flags & HAS_VOXELS) {
         util::Buffer<ubyte> voxelData (CHUNK_DATA_LEN);
-        read_voxel_data(reader, voxelData);
+        read_voxel_data(reader, flags, method, voxelData);
         regions.put(
             x, z, REGION_LAYER_VOXELS, voxelData.release(), CHUNK_DATA_LEN
         );
     }
     if (flags & HAS_METADATA) {
-        size_t metadataSize = reader.getInt32();
+        size_t metadataSize = read_section_size(reader);
         regions.put(
             x,
             z,
@@ -109,4 +390,27 @@ void compressed_chunks::save(
         );
         reader.skip(metadataSize);
     }
+    if (flags & HAS_LIGHTS) {
+        regions.put(
+            x, z, REGION_LAYER_LIGHTS, read_lights(reader), LIGHTMAP_DATA_LEN
+        );
+    }
+    if (flags & HAS_CHANGES) {
+        std::vector<VoxelChange> changes;
+        read_changes(reader, changes);
+        check_changes(changes, indices);
+
+        auto voxelData = regions.getVoxels(x, z);
+        if (voxelData == nullptr) {
+            throw std::runtime_error("chunk data not found");
+        }
+        Chunk chunk(x, z);
+        chunk.decode(voxelData.get());
+        for (const auto& change : changes) {
+            chunk.voxels.edit(change.index) = change.vox;
+        }
+        regions.put(
+            x, z, REGION_LAYER_VOXELS, chunk.encode(), CHUNK_DATA_LEN
+        );
+    }
 }
@@ -9,18 +9,86 @@
 class ContentIndices;
 class WorldRegions;
 
+/// @brief Chunk packets used to pass chunks over the network.
+/// Encoding and decoding functions are thread-safe.
+/// @see /doc/specs/chunk_packet_spec.md
 namespace compressed_chunks {
+    /// @brief Voxel of a block changes batch
+    struct VoxelChange {
+        /// @brief Voxel index in the chunk
+        uint index;
+        voxel vox;
+    };
+
+    /// @brief Encode voxels and metadata
+    /// @param voxelData chunk voxels data of CHUNK_DATA_LEN bytes
+    /// @param lights chunk lights to include sky lights of or nullptr
     std::vector<ubyte> encode(
         const ubyte* voxelData,
         const BlocksMetadata& metadata,
-        util::Buffer<ubyte>& rleBuffer
+        const Lightmap* lights = nullptr
+    );
+
+    /// @brief Encode chunk voxels, metadata and optionally sky lights
+    std::vector<ubyte> encode(const Chunk& chunk, bool lights = false);
+
+    /// @brief Encode chunk or its data stored in regions if the chunk is
+    /// not loaded. Stored lights are passed on without recompression
+    /// @param chunk loaded chunk or nullptr
+    /// @param passStored pass stored voxels on without recompression,
+    /// also if the chunk is not modified since it was loaded. Faster, but
+    /// packets are larger unless regions are compressed with GZIP
+    /// @return empty vector if the chunk is not loaded and is not found
+    /// in regions
+    std::vector<ubyte> encode(
+        int x,
+        int z,
+        const Chunk* chunk,
+        WorldRegions& regions,
+        bool lights,
+        bool passStored = false
+    );
+
+    /// @brief Encode block changes batch with the current voxels values
+    /// @param indices changed voxels indices
+    std::vector<ubyte> encode_changes(
+        const Chunk& chunk, const std::vector<uint>& indices
+    );
+
+    /// @return true if the packet is a block changes batch
+    bool is_changes(const ubyte* src, size_t size);
+
+    std::vector<VoxelChange> decode_changes(const ubyte* src, size_t size);
+
+    /// @brief Check block changes batch before applying any of changes
+    /// @throws std::runtime_error if a change is out of the chunk bounds,
+    /// contains unknown block or a state the block can not have
+    void check_changes(
+        const std::vector<VoxelChange>& changes,
+        const ContentIndices& indices
     );
-    std::vector<ubyte> encode(const Chunk& chunk);
+
+    /// @brief Decode chunk packet. Chunk lights are replaced and marked as
+    /// loaded if included, otherwise replaced voxels lights are marked as
+    /// not loaded
+    /// @throws std::runtime_error if packet contains unknown blocks or is
+    /// a block changes batch
     void decode(
         Chunk& chunk,
         const ubyte* src,
         size_t size,
         const ContentIndices& indices
     );
-    void save(int x, int z, std::vector<ubyte> bytes, WorldRegions& regions);
+
+    /// @brief Write chunk packet to regions. Block changes batch is applied
+    /// to the stored voxels
+    /// @throws std::runtime_error if block changes batch is invalid
+    /// (see check_changes) or chunk voxels are not stored
+    void save(
+        int x,
+        int z,
+        std::vector<ubyte> bytes,
+        WorldRegions& regions,
+        const ContentIndices& indices
+    );
 }
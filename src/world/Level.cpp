@@ -26,8 +26,11 @@ Level::Level(
       chunks(std::make_unique<GlobalChunks>(*this)),
       physics(std::make_unique<PhysicsSolver>(glm::vec3(0, -22.6f, 0))),
       events(std::make_unique<LevelEvents>()),
-      entities(std::make_unique<Entities>(*this)),
+      entities(std::make_unique<Entities>(
+          *this, settings.physics.workers.get()
+      )),
       players(std::make_unique<Players>(*this)) {
+    chunks->setCompactStorage(settings.chunks.compactStorage.get());
     const auto& worldInfo = world->getInfo();
     auto& cameraIndices = content.getIndices(ResourceType::CAMERA);
     for (size_t i = 0; i < cameraIndices.size(); i++) {
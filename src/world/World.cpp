@@ -65,10 +65,10 @@ void World::writeResources(const Content& content) {
     io::write_json(wfile->getResourcesFile(), root);
 }
 
-void World::write(Level* level) {
+void World::write(Level* level, runnable onSaved) {
     level->chunks->saveAll();
     info.nextEntityId = level->entities->peekNextID();
-    wfile->write(this, &content);
+    wfile->write(this, &content, std::move(onSaved));
 
     auto playerFile = level->players->serialize();
     io::write_json(wfile->getPlayerFile(), playerFile);
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "content/ContentPack.hpp"
+#include "delegates.hpp"
 #include "interfaces/Serializable.hpp"
 #include "io/fwd.hpp"
 #include "typedefs.hpp"
@@ -74,7 +75,9 @@ public:
     void updateTimers(float delta);
 
     /// @brief Write all unsaved level data to the world directory
-    void write(Level* level);
+    /// @param onSaved if not nullptr, regions are written in background and
+    /// the callback is called when done
+    void write(Level* level, runnable onSaved = nullptr);
 
     /// @brief Check world indices and generate ContentReport if convert required
     /// @param directory world directory
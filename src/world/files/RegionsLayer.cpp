@@ -1,17 +1,28 @@
 #include "WorldRegions.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 
 #include "util/data_io.hpp"
 
 #define REGION_FORMAT_MAGIC ".VOXREG"
 
+inline constexpr uint REGION_COMPACT_MIN_FREE_SECTORS = 64;
+
 static io::path get_region_filename(int x, int z) {
     return std::to_string(x) + "_" + std::to_string(z) + ".bin";
 }
 
 /// @brief Read missing chunks data (null pointers) from region file
-static void fetch_chunks(WorldRegion* region, int x, int z, regfile* file) {
+static void fetch_chunks(
+    const RegionsLayer& layer,
+    WorldRegion* region,
+    int x,
+    int z,
+    regfile* file
+) {
     auto* chunks = region->getChunks();
     auto sizes = region->getSizes();
 
@@ -19,17 +30,34 @@ static void fetch_chunks(WorldRegion* region, int x, int z, regfile* file) {
         int chunk_x = (i % REGION_SIZE) + x * REGION_SIZE;
         int chunk_z = (i / REGION_SIZE) + z * REGION_SIZE;
         if (chunks[i] == nullptr) {
-            chunks[i] = RegionsLayer::readChunkData(
-                    chunk_x, chunk_z, sizes[i][0], sizes[i][1], file);
+            auto data = RegionsLayer::readChunkData(
+                chunk_x, chunk_z, sizes[i][0], sizes[i][1], file
+            );
+            chunks[i] = layer.recompress(
+                std::move(data), sizes[i][0], sizes[i][1], *file
+            );
         }
     }
 }
 
-regfile::regfile(io::path filename) : file(std::move(filename)) {
-    if (file.length() < REGION_HEADER_SIZE)
-        throw std::runtime_error("incomplete region file header");
-    char header[REGION_HEADER_SIZE];
-    file.read(header, REGION_HEADER_SIZE);
+static inline uint32_t read_uint32(const ubyte* src) {
+    uint32_t value;
+    std::memcpy(&value, src, sizeof(value));
+    return dataio::le2h(value);
+}
+
+static inline void write_uint32(std::ostream& stream, uint32_t value) {
+    value = dataio::h2le(value);
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+regfile::regfile(const io::path& filename)
+    : file(filename),
+      offsets(std::make_unique<uint32_t[]>(REGION_CHUNKS_COUNT)),
+      sectors(std::make_unique<uint32_t[]>(REGION_CHUNKS_COUNT)) {
+    if (file.size() < REGION_HEADER_SIZE)
+        throw std::runtime_error("incomplete region file");
+    const char* header = reinterpret_cast<const char*>(file.data());
 
     // avoid of use strcmp_s
     if (std::string(header, std::strlen(REGION_FORMAT_MAGIC)) !=
@@ -42,91 +70,129 @@ regfile::regfile(io::path filename) : file(std::move(filename)) {
             "region format " + std::to_string(version) + " is not supported"
         );
     }
-}
+    try {
+        compression = compression::method_from_byte(header[9]);
+    } catch (const std::invalid_argument& err) {
+        throw illegal_region_format(err.what());
+    }
 
-std::unique_ptr<ubyte[]> regfile::read(int index, uint32_t& size, uint32_t& srcSize) {
-    size_t file_size = file.length();
-    size_t table_offset = file_size - REGION_CHUNKS_COUNT * 4;
+    const ubyte* bytes = file.data();
+    if (version < 4) {
+        if (file.size() < REGION_HEADER_SIZE + REGION_TABLE_SIZE_V3)
+            throw std::runtime_error("incomplete region file");
+        const ubyte* table = bytes + file.size() - REGION_TABLE_SIZE_V3;
+        for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+            offsets[i] = read_uint32(table + i * 4);
+        }
+        return;
+    }
+    if (file.size() < REGION_HEADER_SECTORS * REGION_SECTOR_SIZE)
+        throw std::runtime_error("incomplete region file");
+    const ubyte* table = bytes + REGION_TABLE_OFFSET;
+    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        uint32_t sector = read_uint32(table + i * 8);
+        if (sector != 0 && sector < REGION_HEADER_SECTORS) {
+            throw illegal_region_format("chunk sector overlaps header");
+        }
+        offsets[i] = sector * REGION_SECTOR_SIZE;
+        sectors[i] = read_uint32(table + i * 8 + 4);
+    }
+}
 
-    uint32_t buff32;
-    file.seekg(table_offset + index * 4);
-    file.read(reinterpret_cast<char*>(&buff32), 4);
-    uint32_t offset = dataio::le2h(buff32);
+const ubyte* regfile::read(
+    int index, uint32_t& size, uint32_t& srcSize
+) const {
+    const ubyte* bytes = file.data();
+    // version 3 chunks data ends with the offsets table
+    size_t dataEnd = file.size();
+    if (version < 4) {
+        dataEnd -= REGION_TABLE_SIZE_V3;
+    }
+    uint32_t offset = offsets[index];
     if (offset == 0) {
         return nullptr;
     }
-
-    file.seekg(offset);
-    file.read(reinterpret_cast<char*>(&buff32), 4);
-    size = dataio::le2h(buff32);
-    file.read(reinterpret_cast<char*>(&buff32), 4);
-    srcSize = dataio::le2h(buff32);
-
-    auto data = std::make_unique<ubyte[]>(size);
-    file.read(reinterpret_cast<char*>(data.get()), size);
-    return data;
+    if (offset < REGION_HEADER_SIZE || offset + 8 > dataEnd) {
+        throw illegal_region_format("chunk offset is out of region bounds");
+    }
+    size = read_uint32(bytes + offset);
+    srcSize = read_uint32(bytes + offset + 4);
+    if (size > dataEnd - offset - 8) {
+        throw illegal_region_format("chunk data is out of region bounds");
+    }
+    return bytes + offset + 8;
 }
 
-
 void RegionsLayer::closeRegFile(glm::ivec2 coord) {
-    openRegFiles.erase(coord);
-    regFilesCv.notify_one();
-}
-
-regfile_ptr RegionsLayer::useRegFile(glm::ivec2 coord) {
-    auto* file = openRegFiles[coord].get();
-    file->inUse = true;
-    return regfile_ptr(file, &regFilesCv);
+    // released out of the lock
+    regfile_ptr file;
+    std::lock_guard lock(regFilesMutex);
+    const auto found = openRegFiles.find(coord);
+    if (found != openRegFiles.end()) {
+        file = std::move(found->second);
+        openRegFiles.erase(found);
+    }
 }
 
-// Marks regfile as used and unmarks when shared_ptr dies
 regfile_ptr RegionsLayer::getRegFile(glm::ivec2 coord, bool create) {
-    {
-        std::lock_guard lock(regFilesMutex);
-        const auto found = openRegFiles.find(coord);
-        if (found != openRegFiles.end()) {
-            if (found->second->inUse) {
-                throw std::runtime_error("regfile is currently in use");
-            }
-            return useRegFile(found->first);
-        }
+    regfile_ptr evicted;
+    std::unique_lock lock(regFilesMutex);
+    regFilesCondition.wait(lock, [this, coord]() {
+        return writtenRegFiles.find(coord) == writtenRegFiles.end();
+    });
+    const auto found = openRegFiles.find(coord);
+    if (found != openRegFiles.end()) {
+        return found->second;
     }
-    if (create) {
-        return createRegFile(coord);
+    if (!create) {
+        return nullptr;
     }
-    return nullptr;
-}
-
-regfile_ptr RegionsLayer::createRegFile(glm::ivec2 coord) {
-    auto file = folder / get_region_filename(coord[0], coord[1]);
-    if (!io::exists(file)) {
+    auto filename = folder / get_region_filename(coord[0], coord[1]);
+    if (!io::exists(filename)) {
         return nullptr;
     }
-    if (openRegFiles.size() == MAX_OPEN_REGION_FILES) {
-        std::unique_lock lock(regFilesMutex);
-        while (true) {
-            bool closed = false;
-            // FIXME: bad choosing algorithm
-            for (auto& entry : openRegFiles) {
-                if (!entry.second->inUse) {
-                    closeRegFile(entry.first);
-                    closed = true;
-                    break;
-                }
-            }
-            if (closed) {
-                break;
-            }
-            // notified when any regfile gets out of use or closed
-            regFilesCv.wait(lock);
+    if (openRegFiles.size() >= MAX_OPEN_REGION_FILES) {
+        // FIXME: bad choosing algorithm
+        // readers still holding the file keep it mapped
+        evicted = std::move(openRegFiles.begin()->second);
+        openRegFiles.erase(openRegFiles.begin());
+    }
+    auto file = regfile_ptr(new regfile(filename), [this, coord](regfile* file) {
+        delete file;
+        std::lock_guard lock(regFilesMutex);
+        auto found = mappedRegFiles.find(coord);
+        if (--found->second == 0) {
+            mappedRegFiles.erase(found);
         }
-        openRegFiles[coord] = std::make_unique<regfile>(file);
-        return useRegFile(coord);
-    } else {
+        regFilesCondition.notify_all();
+    });
+    mappedRegFiles[coord]++;
+    openRegFiles[coord] = file;
+    return file;
+}
+
+void RegionsLayer::beginRegFileWrite(
+    glm::ivec2 coord, std::unique_lock<std::mutex>& lock
+) {
+    {
+        std::lock_guard filesLock(regFilesMutex);
+        writtenRegFiles.insert(coord);
+    }
+    closeRegFile(coord);
+    lock.unlock();
+
+    std::unique_lock filesLock(regFilesMutex);
+    regFilesCondition.wait(filesLock, [this, coord]() {
+        return mappedRegFiles.find(coord) == mappedRegFiles.end();
+    });
+}
+
+void RegionsLayer::endRegFileWrite(glm::ivec2 coord) {
+    {
         std::lock_guard lock(regFilesMutex);
-        openRegFiles[coord] = std::make_unique<regfile>(file);
-        return useRegFile(coord);
+        writtenRegFiles.erase(coord);
     }
+    regFilesCondition.notify_all();
 }
 
 WorldRegion* RegionsLayer::getRegion(int x, int z) {
@@ -153,82 +219,292 @@ WorldRegion* RegionsLayer::getOrCreateRegion(int x, int z) {
     return region;
 }
 
-ubyte* RegionsLayer::getData(int x, int z, uint32_t& size, uint32_t& srcSize) {
-    int regionX, regionZ, localX, localZ;
-    calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
+/// @brief Get number of sectors required to store chunk data
+static inline uint32_t count_sectors(uint32_t size) {
+    return (8 + size + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE;
+}
 
-    WorldRegion* region = getOrCreateRegion(regionX, regionZ);
-    ubyte* data = region->getChunkData(localX, localZ);
-    if (data == nullptr) {
-        auto regfile = getRegFile({regionX, regionZ});
-        if (regfile != nullptr) {
-            auto dataptr = readChunkData(x, z, size, srcSize, regfile.get());
-            if (dataptr) {
-                data = dataptr.get();
-                region->put(localX, localZ, std::move(dataptr), size, srcSize);
-            }
-        }
+/// @brief Region file is compacted when it has at least the number of free
+/// sectors and they take at least a third of the file
+static inline bool is_fragmented(uint32_t used, uint32_t total) {
+    if (used >= total) {
+        return false;
     }
-    if (data != nullptr) {
-        auto sizevec = region->getChunkDataSize(localX, localZ);
-        size = sizevec[0];
-        srcSize = sizevec[1];
-        return data;
+    uint32_t free = total - used;
+    return free >= REGION_COMPACT_MIN_FREE_SECTORS && free * 2 >= used;
+}
+
+/// @brief Find first free sectors run of required length, extend the file
+/// if not found
+/// @param used [in/out] used sectors map
+/// @param count required number of sectors
+/// @return first sector of the allocated run
+static uint32_t allocate_sectors(std::vector<bool>& used, uint32_t count) {
+    uint32_t run = 0;
+    for (uint32_t i = REGION_HEADER_SECTORS; i < used.size(); i++) {
+        run = used[i] ? 0 : run + 1;
+        if (run == count) {
+            uint32_t start = i + 1 - count;
+            std::fill(used.begin() + start, used.begin() + i + 1, true);
+            return start;
+        }
     }
-    return nullptr;
+    // free sectors run at the end of the file is extended
+    uint32_t start = used.size() - run;
+    used.resize(start + count);
+    std::fill(used.begin() + start, used.end(), true);
+    return start;
 }
 
-void RegionsLayer::writeRegion(int x, int z, WorldRegion* entry) {
-    io::path filename = folder / get_region_filename(x, z);
+static void write_header(std::ostream& file, compression::Method method) {
+    char header[REGION_TABLE_OFFSET] = REGION_FORMAT_MAGIC;
+    header[8] = REGION_FORMAT_VERSION;
+    header[9] = static_cast<ubyte>(method);
+    file.write(header, REGION_TABLE_OFFSET);
+}
 
-    glm::ivec2 regcoord(x, z);
-    if (auto regfile = getRegFile(regcoord, false)) {
-        fetch_chunks(entry, x, z, regfile.get());
+/// @brief Write chunk data entry to the sectors run padded with zeros,
+/// so the file size stays a multiple of the sector size
+static void write_chunk(
+    std::ostream& file,
+    uint32_t sector,
+    uint32_t count,
+    const ubyte* data,
+    uint32_t size,
+    uint32_t srcSize
+) {
+    static const char zeros[REGION_SECTOR_SIZE] {};
 
-        std::lock_guard lock(regFilesMutex);
-        regfile.reset();
-        closeRegFile(regcoord);
+    file.seekp(static_cast<std::streamoff>(sector) * REGION_SECTOR_SIZE);
+    write_uint32(file, size);
+    write_uint32(file, srcSize);
+    file.write(reinterpret_cast<const char*>(data), size);
+    file.write(zeros, count * REGION_SECTOR_SIZE - 8 - size);
+}
+
+/// @brief Reserve header sectors of the new file
+static void write_header_padding(std::ostream& file) {
+    file.seekp(REGION_HEADER_SECTORS * REGION_SECTOR_SIZE - 1);
+    file.put(0);
+}
+
+/// @brief Blocks region file readers while it is being modified
+class RegFileWriteScope {
+    RegionsLayer& layer;
+    glm::ivec2 coord;
+public:
+    RegFileWriteScope(
+        RegionsLayer& layer,
+        glm::ivec2 coord,
+        std::unique_lock<std::mutex>& lock
+    )
+        : layer(layer), coord(coord) {
+        layer.beginRegFileWrite(coord, lock);
     }
 
-    char header[REGION_HEADER_SIZE] = REGION_FORMAT_MAGIC;
-    header[8] = REGION_FORMAT_VERSION;
-    header[9] = static_cast<ubyte>(compression); // FIXME
-    std::ofstream file(io::resolve(filename), std::ios::out | std::ios::binary);
-    file.write(header, REGION_HEADER_SIZE);
+    ~RegFileWriteScope() {
+        layer.endRegFileWrite(coord);
+    }
+};
 
-    size_t offset = REGION_HEADER_SIZE;
-    uint32_t intbuf;
-    uint offsets[REGION_CHUNKS_COUNT] {};
+bool RegionsLayer::writeRegion(
+    int x, int z, WorldRegion* entry, std::unique_lock<std::mutex>& lock
+) {
+    io::path filename = folder / get_region_filename(x, z);
 
-    auto region = entry->getChunks();
+    auto chunks = entry->getChunks();
     auto sizes = entry->getSizes();
 
+    glm::ivec2 regcoord(x, z);
+    // chunks table: first sector and sectors count
+    std::vector<glm::u32vec2> table(REGION_CHUNKS_COUNT);
+    // used sectors map, current chunks sectors are released only after
+    // the table is updated, so interrupted write keeps the file valid
+    std::vector<bool> used(REGION_HEADER_SECTORS, true);
+    bool inplace = false;
+    if (auto regfile = getRegFile(regcoord)) {
+        inplace = static_cast<uint>(regfile->version) ==
+                      REGION_FORMAT_VERSION &&
+                  regfile->compression == compression;
+        if (inplace) {
+            used.resize(
+                (regfile->file.size() + REGION_SECTOR_SIZE - 1) /
+                REGION_SECTOR_SIZE
+            );
+            for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+                uint32_t sector = regfile->offsets[i] / REGION_SECTOR_SIZE;
+                uint32_t count = regfile->sectors[i];
+                if (sector == 0) {
+                    continue;
+                }
+                table[i] = {sector, count};
+                if (sector + count > used.size()) {
+                    used.resize(sector + count);
+                }
+                std::fill(
+                    used.begin() + sector, used.begin() + sector + count, true
+                );
+            }
+        } else {
+            // older format or other compression method
+            fetch_chunks(*this, entry, x, z, regfile.get());
+        }
+    }
+    generations[regcoord]++;
+    // chunks stored while waiting for the readers are written too
+    RegFileWriteScope writeScope(*this, regcoord, lock);
+    lock.lock();
+
+    std::fstream file;
+    if (inplace) {
+        file.open(
+            io::resolve(filename),
+            std::ios::in | std::ios::out | std::ios::binary
+        );
+    } else {
+        file.open(
+            io::resolve(filename),
+            std::ios::out | std::ios::binary | std::ios::trunc
+        );
+    }
+    if (!file) {
+        throw std::runtime_error(
+            "could not open region file " + filename.string()
+        );
+    }
+    if (!inplace) {
+        write_header_padding(file);
+    }
+    std::vector<glm::u32vec2> written = table;
     for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
-        ubyte* chunk = region[i].get();
-        if (chunk == nullptr) {
+        if (chunks[i] == nullptr) {
             continue;
         }
-        offsets[i] = offset;
+        uint32_t count = count_sectors(sizes[i][0]);
+        uint32_t sector = allocate_sectors(used, count);
+        write_chunk(
+            file, sector, count, chunks[i].get(), sizes[i][0], sizes[i][1]
+        );
+        written[i] = {sector, count};
+    }
+    file.flush();
 
-        auto sizevec = sizes[i];
-        uint32_t compressedSize = sizevec[0];
-        uint32_t srcSize = sizevec[1];
-        
-        intbuf = dataio::h2le(compressedSize);
-        file.write(reinterpret_cast<const char*>(&intbuf), 4);
-        offset += 4;
+    file.seekp(0);
+    write_header(file, compression);
+    for (const auto& chunk : written) {
+        write_uint32(file, chunk[0]);
+        write_uint32(file, chunk[1]);
+    }
+    file.close();
+    if (!file) {
+        throw std::runtime_error(
+            "could not write region file " + filename.string()
+        );
+    }
+    // chunks data is read from the file now
+    for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        chunks[i].reset();
+        sizes[i] = {};
+    }
+    entry->setUnsaved(false);
+
+    uint32_t usedSectors = REGION_HEADER_SECTORS;
+    for (const auto& chunk : written) {
+        usedSectors += chunk[1];
+    }
+    return is_fragmented(usedSectors, used.size());
+}
 
-        intbuf = dataio::h2le(srcSize);
-        file.write(reinterpret_cast<const char*>(&intbuf), 4);
-        offset += 4;
+void RegionsLayer::compactRegion(int x, int z) {
+    glm::ivec2 regcoord(x, z);
+    io::path filename = getRegionFilePath(x, z);
+    io::path tmpfile = filename.string() + ".tmp";
 
-        file.write(reinterpret_cast<const char*>(chunk), compressedSize);
-        offset += compressedSize;
+    regfile_ptr rfile;
+    uint generation;
+    {
+        std::lock_guard lock(dataMutex);
+        generation = generations[regcoord];
+    }
+    rfile = getRegFile(regcoord);
+    if (rfile == nullptr ||
+        static_cast<uint>(rfile->version) != REGION_FORMAT_VERSION) {
+        return;
     }
+    uint32_t totalSectors =
+        (rfile->file.size() + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE;
+    uint32_t usedSectors = REGION_HEADER_SECTORS;
     for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
-        intbuf = dataio::h2le(offsets[i]);
-        file.write(reinterpret_cast<const char*>(&intbuf), 4);
+        usedSectors += rfile->sectors[i];
     }
+    if (!is_fragmented(usedSectors, totalSectors)) {
+        return;
+    }
+    {
+        std::ofstream file(
+            io::resolve(tmpfile),
+            std::ios::out | std::ios::binary | std::ios::trunc
+        );
+        write_header_padding(file);
+        std::vector<glm::u32vec2> table(REGION_CHUNKS_COUNT);
+        uint32_t sector = REGION_HEADER_SECTORS;
+        for (size_t i = 0; i < REGION_CHUNKS_COUNT; i++) {
+            uint32_t size, srcSize;
+            const ubyte* data = rfile->read(i, size, srcSize);
+            if (data == nullptr) {
+                continue;
+            }
+            uint32_t count = count_sectors(size);
+            write_chunk(file, sector, count, data, size, srcSize);
+            table[i] = {sector, count};
+            sector += count;
+        }
+        file.seekp(0);
+        write_header(file, rfile->compression);
+        for (const auto& chunk : table) {
+            write_uint32(file, chunk[0]);
+            write_uint32(file, chunk[1]);
+        }
+        file.close();
+        if (!file) {
+            throw std::runtime_error(
+                "could not write region file " + tmpfile.string()
+            );
+        }
+    }
+    rfile.reset();
+
+    std::unique_lock lock(dataMutex);
+    if (generations[regcoord] != generation) {
+        io::remove(tmpfile);
+        return;
+    }
+    // writer started meanwhile waits for the file replacement
+    RegFileWriteScope writeScope(*this, regcoord, lock);
+    std::filesystem::rename(io::resolve(tmpfile), io::resolve(filename));
+}
+
+std::unique_ptr<ubyte[]> RegionsLayer::recompress(
+    std::unique_ptr<ubyte[]> data,
+    uint32_t& size,
+    uint32_t srcSize,
+    const regfile& rfile
+) const {
+    if (data == nullptr || rfile.compression == compression) {
+        return data;
+    }
+    if (rfile.compression != compression::Method::NONE) {
+        data = compression::decompress(
+            data.get(), size, srcSize, rfile.compression
+        );
+    }
+    size = srcSize;
+    if (compression != compression::Method::NONE) {
+        size_t length;
+        data = compression::compress(data.get(), srcSize, length, compression);
+        size = length;
+    }
+    return data;
 }
 
 std::unique_ptr<ubyte[]> RegionsLayer::readChunkData(
@@ -237,5 +513,11 @@ std::unique_ptr<ubyte[]> RegionsLayer::readChunkData(
     int regionX, regionZ, localX, localZ;
     calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
     int chunkIndex = localZ * REGION_SIZE + localX;
-    return rfile->read(chunkIndex, size, srcSize);
+    const ubyte* data = rfile->read(chunkIndex, size, srcSize);
+    if (data == nullptr) {
+        return nullptr;
+    }
+    auto copy = std::make_unique<ubyte[]>(size);
+    std::memcpy(copy.get(), data, size);
+    return copy;
 }
@@ -0,0 +1,112 @@
+#include "RegionsSaver.hpp"
+
+#include "debug/Logger.hpp"
+#include "util/timeutil.hpp"
+
+static debug::Logger logger("regions-saver");
+
+RegionsSaver::RegionsSaver(size_t maxQueuedBytes)
+    : maxQueuedBytes(maxQueuedBytes),
+      thread(&RegionsSaver::threadLoop, this) {
+}
+
+RegionsSaver::~RegionsSaver() {
+    {
+        std::lock_guard lock(mutex);
+        working = false;
+    }
+    tasksCondition.notify_all();
+    thread.join();
+}
+
+void RegionsSaver::threadLoop() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock lock(mutex);
+            tasksCondition.wait(lock, [this]() {
+                return !tasks.empty() || !working;
+            });
+            // queued tasks are finished before stop
+            if (tasks.empty()) {
+                break;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+            busy = true;
+        }
+        timeutil::Timer timer;
+        try {
+            task.func();
+        } catch (const std::exception& err) {
+            logger.error() << err.what();
+        }
+        {
+            std::lock_guard lock(mutex);
+            busy = false;
+            stats.queuedTasks--;
+            stats.queuedBytes -= task.bytes;
+            stats.workTime += timer.stop();
+        }
+        doneCondition.notify_all();
+    }
+}
+
+void RegionsSaver::enqueue(runnable task, size_t bytes) {
+    {
+        std::unique_lock lock(mutex);
+        if (stats.queuedBytes > 0 &&
+            stats.queuedBytes + bytes > maxQueuedBytes) {
+            timeutil::Timer timer;
+            doneCondition.wait(lock, [this, bytes]() {
+                return stats.queuedBytes == 0 ||
+                       stats.queuedBytes + bytes <= maxQueuedBytes;
+            });
+            stats.stallTime += timer.stop();
+        }
+        tasks.push(Task {std::move(task), bytes});
+        stats.queuedTasks++;
+        stats.queuedBytes += bytes;
+    }
+    tasksCondition.notify_one();
+}
+
+void RegionsSaver::flush() {
+    std::unique_lock lock(mutex);
+    if (tasks.empty() && !busy) {
+        return;
+    }
+    timeutil::Timer timer;
+    doneCondition.wait(lock, [this]() { return tasks.empty() && !busy; });
+    stats.stallTime += timer.stop();
+}
+
+void RegionsSaver::postCallback(runnable callback) {
+    std::lock_guard lock(mutex);
+    callbacks.push_back(std::move(callback));
+}
+
+void RegionsSaver::update() {
+    std::vector<runnable> finished;
+    {
+        std::lock_guard lock(mutex);
+        if (callbacks.empty()) {
+            return;
+        }
+        std::swap(finished, callbacks);
+    }
+    for (const auto& callback : finished) {
+        callback();
+    }
+}
+
+void RegionsSaver::addWritten(uint64_t chunks, uint64_t bytes) {
+    std::lock_guard lock(mutex);
+    stats.chunksWritten += chunks;
+    stats.bytesWritten += bytes;
+}
+
+RegionsSaveStats RegionsSaver::getStats() {
+    std::lock_guard lock(mutex);
+    return stats;
+}
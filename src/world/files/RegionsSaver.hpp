@@ -0,0 +1,74 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "delegates.hpp"
+#include "typedefs.hpp"
+
+struct RegionsSaveStats {
+    /// @brief Number of chunks data entries compressed and stored
+    uint64_t chunksWritten = 0;
+    /// @brief Compressed chunks data length in bytes
+    uint64_t bytesWritten = 0;
+    /// @brief I/O thread busy time in microseconds
+    uint64_t workTime = 0;
+    /// @brief Time callers were blocked by full queue or waiting for
+    /// queued tasks in microseconds
+    uint64_t stallTime = 0;
+    /// @brief Number of queued tasks
+    size_t queuedTasks = 0;
+    /// @brief Source data length of queued tasks
+    size_t queuedBytes = 0;
+};
+
+/// @brief Runs chunks data compression and region files writes on a
+/// dedicated I/O thread in order of submission
+class RegionsSaver {
+    struct Task {
+        runnable func;
+        size_t bytes;
+    };
+    std::queue<Task> tasks;
+    /// @brief Queued tasks data length limit, enqueue blocks the caller
+    /// when exceeded
+    size_t maxQueuedBytes;
+    RegionsSaveStats stats;
+    bool busy = false;
+    bool working = true;
+    /// @brief Completion callbacks to be called in update()
+    std::vector<runnable> callbacks;
+    std::mutex mutex;
+    std::condition_variable tasksCondition;
+    std::condition_variable doneCondition;
+    std::thread thread;
+
+    void threadLoop();
+public:
+    RegionsSaver(size_t maxQueuedBytes);
+    /// @brief Finishes all queued tasks
+    ~RegionsSaver();
+
+    /// @brief Add task to the queue. Blocks while queued data length
+    /// exceeds the limit. Must not be called from the I/O thread
+    /// @param task task to run on the I/O thread
+    /// @param bytes task data length
+    void enqueue(runnable task, size_t bytes);
+
+    /// @brief Wait for all queued tasks to finish
+    void flush();
+
+    /// @brief Add callback to be called in update() after the current
+    /// task is finished
+    void postCallback(runnable callback);
+
+    /// @brief Call completion callbacks of finished tasks
+    void update();
+
+    void addWritten(uint64_t chunks, uint64_t bytes);
+
+    RegionsSaveStats getStats();
+};
@@ -43,6 +43,9 @@ void WorldConverter::addRegionsTasks(
         return;
     }
     for (const auto& file :io::directory_iterator(regionsFolder)) {
+        if (file.extension() != ".bin") {
+            continue;
+        }
         int x, z;
         std::string name = file.stem();
         if (!WorldRegions::parseRegionFilename(name, x, z)) {
@@ -116,6 +119,15 @@ void WorldConverter::createBlockFieldsConvertTasks() {
     }
 }
 
+void WorldConverter::createRecompressTasks() {
+    for (size_t i = 0; i < REGION_LAYERS_COUNT; i++) {
+        addRegionsTasks(
+            static_cast<RegionLayerIndex>(i),
+            ConvertTaskType::RECOMPRESS_REGION
+        );
+    }
+}
+
 WorldConverter::WorldConverter(
     const std::shared_ptr<WorldFiles>& worldFiles,
     const Content* content,
@@ -137,6 +149,9 @@ WorldConverter::WorldConverter(
         case ConvertMode::BLOCK_FIELDS:
             createBlockFieldsConvertTasks();
             break;
+        case ConvertMode::RECOMPRESS:
+            createRecompressTasks();
+            break;
     }
 }
 
@@ -183,8 +198,20 @@ void WorldConverter::upgradeRegion(
     const io::path& file, int x, int z, RegionLayerIndex layer
 ) const {
     auto path = wfile->getRegions().getRegionFilePath(layer, x, z);
-    auto bytes = io::read_bytes_buffer(path);
-    auto buffer = compatibility::convert_region_2to3(bytes, layer);
+    auto buffer = io::read_bytes_buffer(path);
+    if (buffer.size() <= REGION_HEADER_SIZE) {
+        throw std::runtime_error("incomplete region file " + path.string());
+    }
+    uint version = buffer[8];
+    if (version >= REGION_FORMAT_VERSION) {
+        return;
+    }
+    logger.info() << "upgrading region " << x << "_" << z << " from version "
+                  << version;
+    if (version == 2) {
+        buffer = compatibility::convert_region_2to3(buffer, layer);
+    }
+    buffer = compatibility::convert_region_3to4(buffer);
     io::write_bytes(path, buffer.data(), buffer.size());
 }
 
@@ -239,6 +266,17 @@ void WorldConverter::convertBlocksData(int x, int z, const ContentReport& report
     });
 }
 
+void WorldConverter::recompressRegion(
+    int x, int z, RegionLayerIndex layer
+) const {
+    auto& regions = wfile->getRegions();
+    if (regions.recompressRegion(x, z, layer)) {
+        logger.info() << "recompressed region " << x << "_" << z << " ("
+                      << compression::to_string(regions.getCompression(layer))
+                      << ")";
+    }
+}
+
 void WorldConverter::convert(const ConvertTask& task) const {
     if (!io::is_regular_file(task.file)) return;
 
@@ -258,6 +296,9 @@ void WorldConverter::convert(const ConvertTask& task) const {
         case ConvertTaskType::CONVERT_BLOCKS_DATA:
             convertBlocksData(task.x, task.z, *report);
             break;
+        case ConvertTaskType::RECOMPRESS_REGION:
+            recompressRegion(task.x, task.z, task.layer);
+            break;
     }
 }
 
@@ -305,6 +346,8 @@ void WorldConverter::write() {
         case ConvertMode::BLOCK_FIELDS:
             WorldFiles::createBlockFieldsIndices(content->getIndices(), patch);
             break;
+        case ConvertMode::RECOMPRESS:
+            break;
     }
     wfile->patchIndicesFile(patch);
     wfile->write(nullptr, nullptr);
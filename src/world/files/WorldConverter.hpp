@@ -24,6 +24,8 @@ enum class ConvertTaskType {
     UPGRADE_REGION,
     /// @brief convert blocks data to updated layouts
     CONVERT_BLOCKS_DATA,
+    /// @brief rewrite region with the current layer compression method
+    RECOMPRESS_REGION,
 };
 
 struct ConvertTask {
@@ -39,6 +41,8 @@ enum class ConvertMode {
     UPGRADE,
     REINDEX,
     BLOCK_FIELDS,
+    /// @brief recompress regions with the current layers compression methods
+    RECOMPRESS,
 };
 
 class WorldConverter : public Task {
@@ -56,6 +60,7 @@ class WorldConverter : public Task {
     void convertVoxels(const io::path& file, int x, int z) const;
     void convertInventories(const io::path& file, int x, int z) const;
     void convertBlocksData(int x, int z, const ContentReport& report) const;
+    void recompressRegion(int x, int z, RegionLayerIndex layer) const;
 
     void addRegionsTasks(
         RegionLayerIndex layerid,
@@ -65,6 +70,7 @@ class WorldConverter : public Task {
     void createUpgradeTasks();
     void createConvertTasks();
     void createBlockFieldsConvertTasks();
+    void createRecompressTasks();
 public:
     WorldConverter(
         const std::shared_ptr<WorldFiles>& worldFiles,
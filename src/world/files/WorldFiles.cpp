@@ -41,12 +41,29 @@ WorldFiles::WorldFiles(const io::path& directory)
     : directory(directory), regions(directory) {
 }
 
+static void set_compression(
+    WorldRegions& regions, RegionLayerIndex layer, const std::string& name
+) {
+    try {
+        regions.setCompression(layer, compression::parse_method(name));
+    } catch (const std::invalid_argument& err) {
+        logger.error() << err.what();
+    }
+}
+
 WorldFiles::WorldFiles(const io::path& directory, const DebugSettings& settings)
     : WorldFiles(directory) {
     generatorTestMode = settings.generatorTestMode.get();
     doWriteLights = settings.doWriteLights.get();
     regions.generatorTestMode = generatorTestMode;
     regions.doWriteLights = doWriteLights;
+    set_compression(
+        regions, REGION_LAYER_VOXELS, settings.voxelsCompression.get()
+    );
+    set_compression(
+        regions, REGION_LAYER_LIGHTS, settings.lightsCompression.get()
+    );
+    regions.setAsyncSave(settings.asyncSave.get());
 }
 
 WorldFiles::~WorldFiles() = default;
@@ -77,7 +94,7 @@ io::path WorldFiles::getPacksFile() const {
 }
 
 void WorldFiles::write(
-    const World* world, const Content* content
+    const World* world, const Content* content, runnable onSaved
 ) {
     if (world) {
         writeWorldInfo(world->getInfo());
@@ -86,12 +103,19 @@ void WorldFiles::write(
         }
     }
     if (generatorTestMode) {
+        if (onSaved) {
+            onSaved();
+        }
         return;
     }
     if (content) {
         writeIndices(content->getIndices());
     }
-    regions.writeAll();
+    if (onSaved) {
+        regions.writeAllAsync(std::move(onSaved));
+    } else {
+        regions.writeAll();
+    }
 }
 
 void WorldFiles::writePacks(const std::vector<ContentPack>& packs) {
@@ -60,7 +60,12 @@ public:
     /// @brief Write all unsaved data to world files
     /// @param world target world
     /// @param content world content
-    void write(const World* world, const Content* content);
+    /// @param onSaved if not nullptr, regions are written in background
+    /// (if asynchronous saving is enabled) and the callback is called
+    /// when done
+    void write(
+        const World* world, const Content* content, runnable onSaved = nullptr
+    );
 
     void writePacks(const std::vector<ContentPack>& packs);
 
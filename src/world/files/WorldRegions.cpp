@@ -12,11 +12,27 @@
 #include "items/Inventory.hpp"
 #include "maths/voxmaths.hpp"
 #include "util/data_io.hpp"
+#include "util/ThreadPool.hpp"
 
 #define REGION_FORMAT_MAGIC ".VOXREG"
 
 static debug::Logger logger("world-regions");
 
+/// @brief Queued chunks data length limit for asynchronous saving
+inline constexpr size_t SAVE_QUEUE_MAX_BYTES = 64 * 1024 * 1024;
+
+class RegionsCompactWorker : public util::Worker<RegionCompactJob, int> {
+    RegionsLayer* layers;
+public:
+    RegionsCompactWorker(RegionsLayer* layers) : layers(layers) {
+    }
+
+    int operator()(const RegionCompactJob& job) override {
+        layers[job.layer].compactRegion(job.x, job.z);
+        return 0;
+    }
+};
+
 WorldRegion::WorldRegion()
     : chunksData(
           std::make_unique<std::unique_ptr<ubyte[]>[]>(REGION_CHUNKS_COUNT)
@@ -79,15 +95,25 @@ WorldRegions::WorldRegions(const io::path& directory) : directory(directory) {
 
 WorldRegions::~WorldRegions() = default;
 
-void RegionsLayer::writeAll() {
-    for (auto& it : regions) {
-        WorldRegion* region = it.second.get();
-        if (region->getChunks() == nullptr || !region->isUnsaved()) {
-            continue;
+std::vector<glm::ivec2> RegionsLayer::writeAll() {
+    std::vector<glm::ivec2> fragmented;
+    std::unique_lock lock(dataMutex);
+    // the lock is released while waiting for region files readers
+    std::vector<std::pair<glm::ivec2, WorldRegion*>> unsaved;
+    {
+        std::lock_guard mapLock(mapMutex);
+        for (auto& [key, region] : regions) {
+            if (region->getChunks() != nullptr && region->isUnsaved()) {
+                unsaved.emplace_back(key, region.get());
+            }
+        }
+    }
+    for (const auto& [key, region] : unsaved) {
+        if (writeRegion(key[0], key[1], region, lock)) {
+            fragmented.push_back(key);
         }
-        const auto& key = it.first;
-        writeRegion(key[0], key[1], region);
     }
+    return fragmented;
 }
 
 void WorldRegions::put(
@@ -99,22 +125,80 @@ void WorldRegions::put(
 ) {
     size_t size = srcSize;
     auto& layer = layers[layerid];
+    if (saver) {
+        auto entry = std::make_shared<PendingChunk>(
+            PendingChunk {std::move(data), static_cast<uint32_t>(srcSize)}
+        );
+        {
+            std::lock_guard lock(layer.pendingMutex);
+            layer.pending[{x, z}] = entry;
+        }
+        saver->enqueue(
+            [this, layerid, x, z, entry]() {
+                storePending(layerid, x, z, entry);
+            },
+            srcSize
+        );
+        return;
+    }
+    if (data != nullptr && layer.compression != compression::Method::NONE) {
+        data = compression::compress(
+            data.get(), size, size, layer.compression);
+    }
+    store(layer, x, z, std::move(data), size, srcSize);
+}
+
+void WorldRegions::store(
+    RegionsLayer& layer,
+    int x,
+    int z,
+    std::unique_ptr<ubyte[]> data,
+    uint32_t size,
+    uint32_t srcSize
+) {
     int regionX, regionZ, localX, localZ;
     calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
 
     WorldRegion* region = layer.getOrCreateRegion(regionX, regionZ);
+
+    std::lock_guard lock(layer.dataMutex);
     region->setUnsaved(true);
-    
     if (data == nullptr) {
         region->put(localX, localZ, nullptr, 0, 0);
         return;
     }
+    region->put(localX, localZ, std::move(data), size, srcSize);
+}
 
-    if (layer.compression != compression::Method::NONE) {
+void WorldRegions::storePending(
+    RegionLayerIndex layerid,
+    int x,
+    int z,
+    const std::shared_ptr<PendingChunk>& entry
+) {
+    auto& layer = layers[layerid];
+    // pending data stays readable until stored
+    std::unique_ptr<ubyte[]> data;
+    size_t size = entry->size;
+    if (entry->data == nullptr) {
+        size = 0;
+    } else if (layer.compression != compression::Method::NONE) {
         data = compression::compress(
-            data.get(), size, size, layer.compression);
+            entry->data.get(), entry->size, size, layer.compression
+        );
+    } else {
+        data = std::make_unique<ubyte[]>(size);
+        std::memcpy(data.get(), entry->data.get(), size);
+    }
+    store(layer, x, z, std::move(data), size, entry->size);
+    {
+        std::lock_guard lock(layer.pendingMutex);
+        auto found = layer.pending.find({x, z});
+        if (found != layer.pending.end() && found->second == entry) {
+            layer.pending.erase(found);
+        }
     }
-    region->put(localX, localZ, std::move(data), size, srcSize);
+    saver->addWritten(1, size);
 }
 
 static std::unique_ptr<ubyte[]> write_inventories(
@@ -215,52 +299,159 @@ void WorldRegions::put(Chunk* chunk, std::vector<ubyte> entitiesData) {
     }
 }
 
-std::unique_ptr<ubyte[]> WorldRegions::getVoxels(int x, int z) {
+/// @brief Decompress chunk data or copy it if not compressed
+static std::unique_ptr<ubyte[]> decompress(
+    const ubyte* src,
+    uint32_t size,
+    uint32_t srcSize,
+    compression::Method method
+) {
+    if (method != compression::Method::NONE) {
+        return compression::decompress(src, size, srcSize, method);
+    }
+    auto data = std::make_unique<ubyte[]>(srcSize);
+    std::memcpy(data.get(), src, srcSize);
+    return data;
+}
+
+std::unique_ptr<ubyte[]> RegionsLayer::read(
+    int x, int z, uint32_t& srcSize
+) {
+    int regionX, regionZ, localX, localZ;
+    calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
+
+    std::shared_ptr<PendingChunk> entry;
+    {
+        std::lock_guard lock(pendingMutex);
+        auto found = pending.find({x, z});
+        if (found != pending.end()) {
+            entry = found->second;
+        }
+    }
+    if (entry && entry->data) {
+        srcSize = entry->size;
+        auto data = std::make_unique<ubyte[]>(srcSize);
+        std::memcpy(data.get(), entry->data.get(), srcSize);
+        return data;
+    }
+    {
+        std::lock_guard lock(dataMutex);
+        if (WorldRegion* region = getRegion(regionX, regionZ)) {
+            if (ubyte* data = region->getChunkData(localX, localZ)) {
+                auto sizes = region->getChunkDataSize(localX, localZ);
+                srcSize = sizes[1];
+                return decompress(data, sizes[0], srcSize, compression);
+            }
+        }
+    }
+    auto file = getRegFile({regionX, regionZ});
+    if (file == nullptr) {
+        return nullptr;
+    }
     uint32_t size;
+    int chunkIndex = localZ * REGION_SIZE + localX;
+    const ubyte* data = file->read(chunkIndex, size, srcSize);
+    if (data == nullptr) {
+        return nullptr;
+    }
+    return decompress(data, size, srcSize, file->compression);
+}
+
+std::unique_ptr<ubyte[]> RegionsLayer::readCompressed(
+    int x,
+    int z,
+    uint32_t& size,
+    uint32_t& srcSize,
+    compression::Method& method
+) {
+    int regionX, regionZ, localX, localZ;
+    calc_reg_coords(x, z, regionX, regionZ, localX, localZ);
+
+    std::shared_ptr<PendingChunk> entry;
+    {
+        std::lock_guard lock(pendingMutex);
+        auto found = pending.find({x, z});
+        if (found != pending.end()) {
+            entry = found->second;
+        }
+    }
+    if (entry && entry->data) {
+        size = srcSize = entry->size;
+        method = compression::Method::NONE;
+        auto data = std::make_unique<ubyte[]>(size);
+        std::memcpy(data.get(), entry->data.get(), size);
+        return data;
+    }
+    {
+        std::lock_guard lock(dataMutex);
+        if (WorldRegion* region = getRegion(regionX, regionZ)) {
+            if (ubyte* data = region->getChunkData(localX, localZ)) {
+                auto sizes = region->getChunkDataSize(localX, localZ);
+                size = sizes[0];
+                srcSize = sizes[1];
+                method = compression;
+                auto copy = std::make_unique<ubyte[]>(size);
+                std::memcpy(copy.get(), data, size);
+                return copy;
+            }
+        }
+    }
+    auto file = getRegFile({regionX, regionZ});
+    if (file == nullptr) {
+        return nullptr;
+    }
+    method = file->compression;
+    return readChunkData(x, z, size, srcSize, file.get());
+}
+
+std::unique_ptr<ubyte[]> WorldRegions::getCompressed(
+    int x,
+    int z,
+    RegionLayerIndex layerid,
+    uint32_t& size,
+    uint32_t& srcSize,
+    compression::Method& method
+) {
+    return layers[layerid].readCompressed(x, z, size, srcSize, method);
+}
+
+std::unique_ptr<ubyte[]> WorldRegions::getVoxels(int x, int z) {
     uint32_t srcSize;
-    auto& layer = layers[REGION_LAYER_VOXELS];
-    auto* data = layer.getData(x, z, size, srcSize);
+    auto data = layers[REGION_LAYER_VOXELS].read(x, z, srcSize);
     if (data == nullptr) {
         return nullptr;
     }
     assert(srcSize == CHUNK_DATA_LEN);
-    return compression::decompress(data, size, srcSize, layer.compression);
+    return data;
 }
 
 std::unique_ptr<light_t[]> WorldRegions::getLights(int x, int z) {
-    uint32_t size;
     uint32_t srcSize;
-    auto& layer = layers[REGION_LAYER_LIGHTS];
-    auto* bytes = layer.getData(x, z, size, srcSize);
-    if (bytes == nullptr) {
+    auto data = layers[REGION_LAYER_LIGHTS].read(x, z, srcSize);
+    if (data == nullptr) {
         return nullptr;
     }
-    auto data = compression::decompress(
-        bytes, size, srcSize, layer.compression
-    );
     assert(srcSize == LIGHTMAP_DATA_LEN);
     return Lightmap::decode(data.get());
 }
 
 ChunkInventoriesMap WorldRegions::fetchInventories(int x, int z) {
     uint32_t bytesSize;
-    uint32_t srcSize;
-    auto bytes = layers[REGION_LAYER_INVENTORIES].getData(x, z, bytesSize, srcSize);
+    auto bytes = layers[REGION_LAYER_INVENTORIES].read(x, z, bytesSize);
     if (bytes == nullptr) {
         return {};
     }
-    return load_inventories(bytes, bytesSize);
+    return load_inventories(bytes.get(), bytesSize);
 }
 
 BlocksMetadata WorldRegions::getBlocksData(int x, int z) {
     uint32_t bytesSize;
-    uint32_t srcSize;
-    auto bytes = layers[REGION_LAYER_BLOCKS_DATA].getData(x, z, bytesSize, srcSize);
+    auto bytes = layers[REGION_LAYER_BLOCKS_DATA].read(x, z, bytesSize);
     if (bytes == nullptr) {
         return {};
     }
     BlocksMetadata heap;
-    heap.deserialize(bytes, bytesSize);
+    heap.deserialize(bytes.get(), bytesSize);
     return heap;
 }
 
@@ -289,9 +480,11 @@ void WorldRegions::processBlocksData(int x, int z, const BlockDataProc& func) {
     if (voxRegfile == nullptr) {
         logger.warning() << "missing voxels region - discard blocks data for "
             << x << "_" << z;
+        datRegfile.reset();
         deleteRegion(REGION_LAYER_BLOCKS_DATA, x, z);
         return;
     }
+    auto voxCompression = voxRegfile->compression;
     for (uint cz = 0; cz < REGION_SIZE; cz++) {
         for (uint cx = 0; cx < REGION_SIZE; cx++) {
             int gx = cx + x * REGION_SIZE;
@@ -316,8 +509,8 @@ void WorldRegions::processBlocksData(int x, int z, const BlockDataProc& func) {
                 put(gx, gz, REGION_LAYER_BLOCKS_DATA, nullptr, 0);
                 continue;
             }
-            voxData = compression::decompress(
-                voxData.get(), voxLength, voxSrcSize, voxLayer.compression
+            voxData = decompress(
+                voxData.get(), voxLength, voxSrcSize, voxCompression
             );
 
             BlocksMetadata blocksData;
@@ -340,12 +533,11 @@ dv::value WorldRegions::fetchEntities(int x, int z) {
         return nullptr;
     }
     uint32_t bytesSize;
-    uint32_t srcSize;
-    const ubyte* data = layers[REGION_LAYER_ENTITIES].getData(x, z, bytesSize, srcSize);
+    auto data = layers[REGION_LAYER_ENTITIES].read(x, z, bytesSize);
     if (data == nullptr) {
         return nullptr;
     }
-    auto map = json::from_binary(data, bytesSize);
+    auto map = json::from_binary(data.get(), bytesSize);
     if (map.empty()) {
         return nullptr;
     }
@@ -363,6 +555,7 @@ void WorldRegions::processRegion(
     if (regfile == nullptr) {
         throw std::runtime_error("could not open region file");
     }
+    auto fileCompression = regfile->compression;
     for (uint cz = 0; cz < REGION_SIZE; cz++) {
         for (uint cx = 0; cx < REGION_SIZE; cx++) {
             int gx = cx + x * REGION_SIZE;
@@ -374,9 +567,9 @@ void WorldRegions::processRegion(
             if (data == nullptr) {
                 continue;
             }
-            if (layer.compression != compression::Method::NONE) {
+            if (fileCompression != compression::Method::NONE) {
                 data = compression::decompress(
-                    data.get(), length, srcSize, layer.compression
+                    data.get(), length, srcSize, fileCompression
                 );
             } else {
                 srcSize = length;
@@ -388,6 +581,51 @@ void WorldRegions::processRegion(
     }
 }
 
+bool WorldRegions::recompressRegion(
+    int x, int z, RegionLayerIndex layerid
+) {
+    auto& layer = layers[layerid];
+    {
+        auto regfile = layer.getRegFile({x, z});
+        if (regfile == nullptr) {
+            throw std::runtime_error("could not open region file");
+        }
+        if (regfile->compression == layer.compression) {
+            return false;
+        }
+    }
+    processRegion(x, z, layerid, [](auto data, uint32_t*) { return data; });
+    if (saver) {
+        // region must not be accessed by the saver after being erased
+        saver->flush();
+    }
+
+    std::unique_lock lock(layer.dataMutex);
+    layer.writeRegion(x, z, layer.getOrCreateRegion(x, z), lock);
+    std::lock_guard mapLock(layer.mapMutex);
+    layer.regions.erase({x, z});
+    return true;
+}
+
+void WorldRegions::setCompression(
+    RegionLayerIndex layerid, compression::Method method
+) {
+    auto& layer = layers[layerid];
+    std::lock_guard lock(layer.dataMutex);
+    if (!layer.regions.empty()) {
+        throw std::runtime_error(
+            "could not change compression of layer with in-memory regions"
+        );
+    }
+    layer.compression = method;
+}
+
+compression::Method WorldRegions::getCompression(
+    RegionLayerIndex layerid
+) const {
+    return layers[layerid].compression;
+}
+
 const io::path& WorldRegions::getRegionsFolder(RegionLayerIndex layerid) const {
     return layers[layerid].folder;
 }
@@ -397,17 +635,93 @@ io::path WorldRegions::getRegionFilePath(RegionLayerIndex layerid, int x, int z)
 }
 
 void WorldRegions::writeAll() {
+    if (saver) {
+        saver->flush();
+    }
+    writeRegions();
+}
+
+void WorldRegions::writeAllAsync(runnable onComplete) {
+    if (saver == nullptr) {
+        writeAll();
+        if (onComplete) {
+            onComplete();
+        }
+        return;
+    }
+    saver->enqueue(
+        [this, onComplete = std::move(onComplete)]() {
+            writeRegions();
+            if (onComplete) {
+                saver->postCallback(onComplete);
+            }
+        },
+        0
+    );
+}
+
+void WorldRegions::setAsyncSave(bool enabled) {
+    if (!enabled) {
+        saver.reset();
+    } else if (saver == nullptr) {
+        saver = std::make_unique<RegionsSaver>(SAVE_QUEUE_MAX_BYTES);
+    }
+}
+
+bool WorldRegions::isAsyncSave() const {
+    return saver != nullptr;
+}
+
+void WorldRegions::update() {
+    if (saver) {
+        saver->update();
+    }
+    std::lock_guard lock(compactorMutex);
+    if (compactor) {
+        compactor->update();
+    }
+}
+
+RegionsSaveStats WorldRegions::getSaveStats() const {
+    if (saver == nullptr) {
+        return {};
+    }
+    return saver->getStats();
+}
+
+void WorldRegions::writeRegions() {
     for (auto& layer : layers) {
         io::create_directories(layer.folder);
-        layer.writeAll();
+        for (const auto& coord : layer.writeAll()) {
+            std::lock_guard lock(compactorMutex);
+            if (compactor == nullptr) {
+                compactor = std::make_unique<
+                    util::ThreadPool<RegionCompactJob, int>>(
+                    "regions-compactor",
+                    [this]() {
+                        return std::make_shared<RegionsCompactWorker>(layers);
+                    },
+                    [](int&) {},
+                    1
+                );
+                compactor->setStopOnFail(false);
+                // worker must not wait for update() as regions may be
+                // written without the main loop running
+                compactor->setStandaloneResults(true);
+            }
+            compactor->enqueueJob({layer.layer, coord.x, coord.y});
+        }
     }
 }
 
 void WorldRegions::deleteRegion(RegionLayerIndex layerid, int x, int z) {
     auto& layer = layers[layerid];
-    if (layer.getRegFile({x, z}, false)) {
-        throw std::runtime_error("region file is currently in use");
+    {
+        // discard compaction result
+        std::lock_guard lock(layer.dataMutex);
+        layer.generations[{x, z}]++;
     }
+    layer.closeRegFile({x, z});
     auto file = layer.getRegionFilePath(x, z);
     if (io::exists(file)) {
         logger.info() << "remove region file " << file.string();
@@ -6,6 +6,8 @@
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "typedefs.hpp"
 #include "util/BufferPool.hpp"
@@ -13,8 +15,15 @@
 #include "maths/voxmaths.hpp"
 #include "coders/compression.hpp"
 #include "io/io.hpp"
+#include "io/mapped_file.hpp"
+#include "RegionsSaver.hpp"
 #include "world_regions_fwd.hpp"
 
+namespace util {
+    template <class T, class R>
+    class ThreadPool;
+}
+
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/hash.hpp>
 
@@ -23,6 +32,16 @@ inline constexpr uint REGION_HEADER_SIZE = 10;
 inline constexpr uint REGION_SIZE_BIT = 5;
 inline constexpr uint REGION_SIZE = (1 << (REGION_SIZE_BIT));
 inline constexpr uint REGION_CHUNKS_COUNT = ((REGION_SIZE) * (REGION_SIZE));
+/// @brief Size of chunks offsets table at the end of region file (version 3)
+inline constexpr uint REGION_TABLE_SIZE_V3 = REGION_CHUNKS_COUNT * 4;
+/// @brief Region file allocation unit (version 4+)
+inline constexpr uint REGION_SECTOR_SIZE = 4096;
+/// @brief Chunks table position in region file (version 4+)
+inline constexpr uint REGION_TABLE_OFFSET = 16;
+/// @brief Number of sectors taken by header and chunks table
+inline constexpr uint REGION_HEADER_SECTORS =
+    (REGION_TABLE_OFFSET + REGION_CHUNKS_COUNT * 8 + REGION_SECTOR_SIZE - 1) /
+    REGION_SECTOR_SIZE;
 
 class illegal_region_format : public std::runtime_error {
 public:
@@ -51,59 +70,43 @@ public:
 };
 
 struct regfile {
-    io::rafile file;
+    io::mapped_file file;
     int version;
-    bool inUse = false;
-
-    regfile(io::path filename);
+    /// @brief Compression method of chunks data stored in the file
+    compression::Method compression;
+    /// @brief Chunks data positions in the file, 0 if chunk is not present
+    std::unique_ptr<uint32_t[]> offsets;
+    /// @brief Number of sectors allocated for chunks data (version 4+)
+    std::unique_ptr<uint32_t[]> sectors;
+
+    regfile(const io::path& filename);
     regfile(const regfile&) = delete;
 
-    std::unique_ptr<ubyte[]> read(int index, uint32_t& size, uint32_t& srcSize);
+    /// @brief Get chunk data stored in the mapped file
+    /// @param index chunk index in the region
+    /// @param size [out] compressed chunk data length
+    /// @param srcSize [out] source chunk data length
+    /// @return pointer to the mapped chunk data or nullptr if chunk is not
+    /// present in the file
+    /// @throws illegal_region_format if chunk data is out of file bounds
+    const ubyte* read(int index, uint32_t& size, uint32_t& srcSize) const;
+};
+
+/// @brief Chunk data snapshot queued for compression and storing
+struct PendingChunk {
+    std::unique_ptr<ubyte[]> data;
+    uint32_t size;
 };
 
+/// @brief Region file shared with readers. Closed file stays mapped until
+/// the last reader releases it
+using regfile_ptr = std::shared_ptr<regfile>;
+
 using RegionsMap = std::unordered_map<glm::ivec2, std::unique_ptr<WorldRegion>>;
 using RegionProc = std::function<std::unique_ptr<ubyte[]>(std::unique_ptr<ubyte[]>,uint32_t*)>;
 using InventoryProc = std::function<void(Inventory*)>;
 using BlockDataProc = std::function<void(BlocksMetadata*, std::unique_ptr<ubyte[]>)>;
 
-/// @brief Region file pointer keeping inUse flag on until destroyed
-class regfile_ptr {
-    regfile* file;
-    std::condition_variable* cv;
-public:
-    regfile_ptr(regfile* file, std::condition_variable* cv)
-        : file(file), cv(cv) {
-    }
-
-    regfile_ptr(const regfile_ptr&) = delete;
-
-    regfile_ptr(std::nullptr_t) : file(nullptr), cv(nullptr) {
-    }
-
-    bool operator==(std::nullptr_t) const {
-        return file == nullptr;
-    }
-    bool operator!=(std::nullptr_t) const {
-        return file != nullptr;
-    }
-    operator bool() const {
-        return file != nullptr;
-    }
-    ~regfile_ptr() {
-        reset();
-    }
-    regfile* get() {
-        return file;
-    }
-    void reset() {
-        if (file) {
-            file->inUse = false;
-            cv->notify_one();
-            file = nullptr;
-        }
-    }
-};
-
 inline void calc_reg_coords(
     int x, int z, int& regionX, int& regionZ, int& localX, int& localZ
 ) {
@@ -128,38 +131,125 @@ struct RegionsLayer {
     /// @brief In-memory regions map mutex
     std::mutex mapMutex;
 
-    /// @brief Open region files map
-    std::unordered_map<glm::ivec2, std::unique_ptr<regfile>> openRegFiles;
+    /// @brief In-memory chunks data mutex. Chunks data is read by chunks
+    /// loader workers while the main thread stores and writes regions.
+    /// Region files must not be acquired under the lock
+    std::mutex dataMutex;
 
-    /// @brief Open region files map mutex
+    /// @brief Region files maps mutex
     std::mutex regFilesMutex;
-    std::condition_variable regFilesCv;
 
+    /// @brief Notified when a region file mapping is released or a region
+    /// file write is finished
+    std::condition_variable regFilesCondition;
+
+    /// @brief Numbers of mapped region files including closed ones still
+    /// used by readers
+    std::unordered_map<glm::ivec2, uint> mappedRegFiles;
+
+    /// @brief Region files being modified. Readers wait for the write to
+    /// finish before opening them
+    std::unordered_set<glm::ivec2> writtenRegFiles;
+
+    /// @brief Open region files map. Declared after the mutex as released
+    /// files update the mapped files counters
+    std::unordered_map<glm::ivec2, regfile_ptr> openRegFiles;
+
+    /// @brief Chunks data queued by the regions saver and not stored in
+    /// regions yet
+    std::unordered_map<glm::ivec2, std::shared_ptr<PendingChunk>> pending;
+
+    /// @brief Pending chunks map mutex
+    std::mutex pendingMutex;
+
+    /// @brief Region files writes counters used to discard compaction
+    /// results of files modified while being compacted. Guarded by
+    /// dataMutex
+    std::unordered_map<glm::ivec2, uint> generations;
+
+    /// @brief Get open region file or open it. Waits for the region file
+    /// write to finish
+    /// @param coord region coords
+    /// @param create open region file if not open yet
+    /// @return nullptr if region file is not found or not open
     [[nodiscard]] regfile_ptr getRegFile(glm::ivec2 coord, bool create = true);
-    [[nodiscard]] regfile_ptr useRegFile(glm::ivec2 coord);
-    regfile_ptr createRegFile(glm::ivec2 coord);
     void closeRegFile(glm::ivec2 coord);
 
+    /// @brief Close region file and wait for readers to release its
+    /// mapping. New readers wait for endRegFileWrite call
+    /// @param lock dataMutex lock, unlocked before waiting
+    void beginRegFileWrite(
+        glm::ivec2 coord, std::unique_lock<std::mutex>& lock
+    );
+    void endRegFileWrite(glm::ivec2 coord);
+
     WorldRegion* getRegion(int x, int z);
     WorldRegion* getOrCreateRegion(int x, int z);
 
     io::path getRegionFilePath(int x, int z) const;
 
-    /// @brief Get chunk data. Read from file if not loaded yet.
+    /// @brief Get decompressed chunk data from pending chunks, in-memory
+    /// region or directly from the mapped region file if not loaded. Reading region
+    /// file does not block other readers
+    /// @param x chunk x coord
+    /// @param z chunk z coord
+    /// @param srcSize [out] source chunk data length
+    /// @return nullptr if no saved chunk data found
+    [[nodiscard]] std::unique_ptr<ubyte[]> read(int x, int z, uint32_t& srcSize);
+
+    /// @brief Get chunk data as stored, without decompression. Chunks
+    /// data queued by the regions saver is not compressed yet
     /// @param x chunk x coord
     /// @param z chunk z coord
     /// @param size [out] compressed chunk data length
-    /// @param size [out] source chunk data length
+    /// @param srcSize [out] source chunk data length
+    /// @param method [out] chunk data compression method
     /// @return nullptr if no saved chunk data found
-    [[nodiscard]] ubyte* getData(int x, int z, uint32_t& size, uint32_t& srcSize);
+    [[nodiscard]] std::unique_ptr<ubyte[]> readCompressed(
+        int x,
+        int z,
+        uint32_t& size,
+        uint32_t& srcSize,
+        compression::Method& method
+    );
 
-    /// @brief Write or rewrite region file
+    /// @brief Write region chunks data to the file. Existing file of the
+    /// current format and compression is updated in place: chunks are
+    /// written to free sectors or appended, other files are rewritten.
+    /// Written chunks data is released
     /// @param x region X
     /// @param z region Z
-    void writeRegion(int x, int y, WorldRegion* entry);
+    /// @param lock dataMutex lock, released while waiting for the region
+    /// file readers
+    /// @return true if region file has enough free sectors to be compacted
+    bool writeRegion(
+        int x, int y, WorldRegion* entry, std::unique_lock<std::mutex>& lock
+    );
 
     /// @brief Write all unsaved regions to files
-    void writeAll();
+    /// @return coords of region files to be compacted
+    std::vector<glm::ivec2> writeAll();
+
+    /// @brief Rewrite region file without free sectors. File is written
+    /// without locks and replaces the original one if it was not modified
+    /// meanwhile
+    /// @param x region X
+    /// @param z region Z
+    void compactRegion(int x, int z);
+
+    /// @brief Convert chunk data read from region file to the layer
+    /// compression method
+    /// @param data chunk data compressed with region file method
+    /// @param size [in/out] compressed chunk data length
+    /// @param srcSize source chunk data length
+    /// @param rfile region file
+    /// @return chunk data compressed with layer method
+    [[nodiscard]] std::unique_ptr<ubyte[]> recompress(
+        std::unique_ptr<ubyte[]> data,
+        uint32_t& size,
+        uint32_t srcSize,
+        const regfile& rfile
+    ) const;
 
     /// @brief Read chunk data from region file
     /// @param x chunk x coord
@@ -173,11 +263,48 @@ struct RegionsLayer {
     );
 };
 
+struct RegionCompactJob {
+    RegionLayerIndex layer;
+    int x;
+    int z;
+};
+
 class WorldRegions {
     /// @brief World directory
     io::path directory;
 
     RegionsLayer layers[REGION_LAYERS_COUNT] {};
+
+    /// @brief Background region files compaction. Declared after layers
+    /// to be stopped before them. Jobs are enqueued by the thread writing
+    /// regions, results are collected by update() on the main thread
+    std::unique_ptr<util::ThreadPool<RegionCompactJob, int>> compactor;
+    std::mutex compactorMutex;
+
+    /// @brief Asynchronous chunks data saving. Declared after layers and
+    /// compactor to finish queued tasks before they are destroyed
+    std::unique_ptr<RegionsSaver> saver;
+
+    /// @brief Store compressed chunk data in the in-memory region
+    void store(
+        RegionsLayer& layer,
+        int x,
+        int z,
+        std::unique_ptr<ubyte[]> data,
+        uint32_t size,
+        uint32_t srcSize
+    );
+
+    /// @brief Compress and store queued chunk data (I/O thread)
+    void storePending(
+        RegionLayerIndex layerid,
+        int x,
+        int z,
+        const std::shared_ptr<PendingChunk>& entry
+    );
+
+    /// @brief Write all unsaved regions of all layers on the caller thread
+    void writeRegions();
 public:
     bool generatorTestMode = false;
     bool doWriteLights = true;
@@ -189,7 +316,9 @@ public:
     /// @brief Put all chunk data to regions
     void put(Chunk* chunk, std::vector<ubyte> entitiesData);
 
-    /// @brief Store data in specified region
+    /// @brief Store data in specified region. When asynchronous saving is
+    /// enabled data is compressed and stored by the I/O thread, but is
+    /// available for reading immediately
     /// @param x chunk.x
     /// @param z chunk.z
     /// @param layer regions layer
@@ -209,6 +338,18 @@ public:
     /// @return voxels data buffer or nullptr
     std::unique_ptr<ubyte[]> getVoxels(int x, int z);
 
+    /// @brief Get chunk data of the layer as stored in regions, to be
+    /// passed on without recompression
+    /// @see RegionsLayer::readCompressed
+    std::unique_ptr<ubyte[]> getCompressed(
+        int x,
+        int z,
+        RegionLayerIndex layerid,
+        uint32_t& size,
+        uint32_t& srcSize,
+        compression::Method& method
+    );
+
     /// @brief Get cached lights for chunk at x,z
     /// @return lights data or nullptr
     std::unique_ptr<light_t[]> getLights(int x, int z);
@@ -231,10 +372,26 @@ public:
     void processRegion(
         int x, int z, RegionLayerIndex layerid, const RegionProc& func);
 
+    /// @brief Rewrite region file with the current layer compression
+    /// method if it differs from the file one. Region is not kept in memory
+    /// @param x region X
+    /// @param z region Z
+    /// @param layerid regions layer index
+    /// @return false if region file is already compressed with the layer
+    /// method
+    bool recompressRegion(int x, int z, RegionLayerIndex layerid);
+
     void processInventories(int x, int z, const InventoryProc& func);
 
     void processBlocksData(int x, int z, const BlockDataProc& func);
 
+    /// @brief Set compression method used for chunks data of the layer.
+    /// Region files written with other methods are recompressed on read
+    /// @throws std::runtime_error if the layer has in-memory regions
+    void setCompression(RegionLayerIndex layerid, compression::Method method);
+
+    compression::Method getCompression(RegionLayerIndex layerid) const;
+
     /// @brief Get regions directory by layer index
     /// @param layerid layer index
     /// @return directory path
@@ -242,9 +399,29 @@ public:
 
     io::path getRegionFilePath(RegionLayerIndex layerid, int x, int z) const;
 
-    /// @brief Write all region layers
+    /// @brief Write all region layers. Waits for queued chunks data when
+    /// asynchronous saving is enabled
     void writeAll();
 
+    /// @brief Write all region layers on the I/O thread after queued chunks
+    /// data. Works as writeAll if asynchronous saving is disabled
+    /// @param onComplete callback called in update() when regions are
+    /// written (may be nullptr)
+    void writeAllAsync(runnable onComplete);
+
+    /// @brief Enable or disable compression and region files writes on
+    /// a dedicated I/O thread. Disabling waits for queued tasks
+    void setAsyncSave(bool enabled);
+
+    bool isAsyncSave() const;
+
+    /// @brief Call completion callbacks of asynchronous writes and collect
+    /// region files compaction results. Must be called by the main thread
+    void update();
+
+    /// @brief Get asynchronous saving statistics
+    RegionsSaveStats getSaveStats() const;
+
     void deleteRegion(RegionLayerIndex layerid, int x, int z);
 
     /// @brief Extract X and Z from 'X_Z.bin' region file name.
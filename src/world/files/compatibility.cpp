@@ -1,5 +1,6 @@
 #include "compatibility.hpp"
 
+#include <cstring>
 #include <stdexcept>
 
 #include "constants.hpp"
@@ -107,3 +108,52 @@ util::Buffer<ubyte> compatibility::convert_region_2to3(
     }
     return util::Buffer<ubyte>(builder.build().data(), builder.size());
 }
+
+util::Buffer<ubyte> compatibility::convert_region_3to4(
+    const util::Buffer<ubyte>& src
+) {
+    const size_t REGION_CHUNKS = 1024;
+    const size_t HEADER_SIZE = 10;
+    const size_t OFFSET_TABLE_SIZE = REGION_CHUNKS * sizeof(uint32_t);
+    const size_t SECTOR_SIZE = 4096;
+    const size_t TABLE_OFFSET = 16;
+    const size_t HEADER_SECTORS = 3;
+
+    if (src.size() < HEADER_SIZE + OFFSET_TABLE_SIZE) {
+        throw std::invalid_argument("incomplete region file");
+    }
+    const ubyte* const ptr = src.data();
+    const size_t tableOffset = src.size() - OFFSET_TABLE_SIZE;
+    auto read_uint32 = [ptr](size_t offset) {
+        uint32_t value;
+        std::memcpy(&value, ptr + offset, sizeof(value));
+        return dataio::le2h(value);
+    };
+
+    ByteBuilder builder(HEADER_SECTORS * SECTOR_SIZE);
+    builder.put(ptr, HEADER_SIZE);
+    builder.set(8, 4);
+    while (builder.size() < HEADER_SECTORS * SECTOR_SIZE) {
+        builder.put(0);
+    }
+    for (size_t i = 0; i < REGION_CHUNKS; i++) {
+        uint32_t offset = read_uint32(tableOffset + i * sizeof(uint32_t));
+        if (offset == 0) {
+            continue;
+        }
+        if (offset < HEADER_SIZE || offset + 8 > tableOffset ||
+            read_uint32(offset) > tableOffset - offset - 8) {
+            throw std::invalid_argument("chunk is out of region bounds");
+        }
+        size_t length = 8 + read_uint32(offset);
+        size_t sector = builder.size() / SECTOR_SIZE;
+        size_t sectors = (length + SECTOR_SIZE - 1) / SECTOR_SIZE;
+        builder.setInt32(TABLE_OFFSET + i * 8, sector);
+        builder.setInt32(TABLE_OFFSET + i * 8 + 4, sectors);
+        builder.put(ptr + offset, length);
+        while (builder.size() % SECTOR_SIZE) {
+            builder.put(0);
+        }
+    }
+    return util::Buffer<ubyte>(builder.build().data(), builder.size());
+}
@@ -11,4 +11,11 @@ namespace compatibility {
     /// @return new region file content
     util::Buffer<ubyte> convert_region_2to3(
         const util::Buffer<ubyte>& src, RegionLayerIndex layer);
+
+    /// @brief Convert region file from version 3 to 4 (sectors allocation,
+    /// chunks table moved to the file start)
+    /// @see /doc/specs/region_file_spec.md
+    /// @param src region file source content
+    /// @return new region file content
+    util::Buffer<ubyte> convert_region_3to4(const util::Buffer<ubyte>& src);
 }
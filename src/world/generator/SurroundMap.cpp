@@ -14,6 +14,16 @@ SurroundMap::SurroundMap(int maxLevelRadius, int8_t maxLevel)
 void SurroundMap::setLevelCallback(int8_t level, LevelCallback callback) {
     auto& wrapper = levelCallbacks.at(level - 1);
     wrapper.callback = callback;
+    wrapper.batchCallback = nullptr;
+    wrapper.active = callback != nullptr;
+}
+
+void SurroundMap::setLevelBatchCallback(
+    int8_t level, LevelBatchCallback callback
+) {
+    auto& wrapper = levelCallbacks.at(level - 1);
+    wrapper.callback = nullptr;
+    wrapper.batchCallback = callback;
     wrapper.active = callback != nullptr;
 }
 
@@ -21,8 +31,9 @@ void SurroundMap::setOutCallback(util::AreaMap2D<int8_t>::OutCallback callback)
     areaMap.setOutCallback(callback);
 }
 
-void SurroundMap::upgrade(int x, int y, int8_t level) {
-    auto& callback = levelCallbacks[level - 1];
+void SurroundMap::upgrade(
+    int x, int y, int8_t level, std::vector<glm::ivec2>& points
+) {
     int size = maxLevel - level + 1;
     for (int ly = -size+1; ly < size; ly++) {
         for (int lx = -size+1; lx < size; lx++) {
@@ -36,26 +47,52 @@ void SurroundMap::upgrade(int x, int y, int8_t level) {
                 continue;
             }
             areaMap.set(posX, posY, level);
-            if (callback.active) {
-                callback.callback(posX, posY);
-            }
+            points.emplace_back(posX, posY);
         }
     }
 }
 
 void SurroundMap::resize(int maxLevelRadius) {
-    areaMap.resize((maxLevelRadius + maxLevel) * 2 + 1,
-                   (maxLevelRadius + maxLevel) * 2 + 1);
+    int size = (maxLevelRadius + maxLevel) * 2 + 1;
+    if (areaMap.getWidth() == size && areaMap.getHeight() == size) {
+        return;
+    }
+    areaMap.resize(size, size);
+}
+
+bool SurroundMap::isCompletable(int x, int y) const {
+    return areaMap.isInside(x - maxLevel + 1, y - maxLevel + 1) &&
+           areaMap.isInside(x + maxLevel - 1, y + maxLevel - 1);
 }
 
 void SurroundMap::completeAt(int x, int y) {
-    if (!areaMap.isInside(x - maxLevel + 1, y - maxLevel + 1) ||
-        !areaMap.isInside(x + maxLevel - 1, y + maxLevel - 1)) {
-        throw std::invalid_argument(
-            "upgrade square is not fully inside of area");
+    completeAt(std::vector<glm::ivec2> {{x, y}});
+}
+
+void SurroundMap::completeAt(const std::vector<glm::ivec2>& targets) {
+    for (const auto& target : targets) {
+        if (!isCompletable(target.x, target.y)) {
+            throw std::invalid_argument(
+                "upgrade square is not fully inside of area");
+        }
     }
+    std::vector<glm::ivec2> points;
     for (int8_t level = 1; level <= maxLevel; level++) {
-        upgrade(x, y, level);
+        points.clear();
+        for (const auto& target : targets) {
+            upgrade(target.x, target.y, level, points);
+        }
+        const auto& callback = levelCallbacks[level - 1];
+        if (!callback.active || points.empty()) {
+            continue;
+        }
+        if (callback.batchCallback) {
+            callback.batchCallback(points);
+            continue;
+        }
+        for (const auto& point : points) {
+            callback.callback(point.x, point.y);
+        }
     }
 }
 
@@ -2,6 +2,7 @@
 
 #include <unordered_map>
 #include <functional>
+#include <vector>
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/hash.hpp>
@@ -12,8 +13,11 @@
 class SurroundMap {
 public:
     using LevelCallback = std::function<void(int, int)>;
+    using LevelBatchCallback =
+        std::function<void(const std::vector<glm::ivec2>&)>;
     struct LevelCallbackWrapper {
         LevelCallback callback;
+        LevelBatchCallback batchCallback;
         bool active = false;
     };
 private:
@@ -21,13 +25,19 @@ private:
     std::vector<LevelCallbackWrapper> levelCallbacks;
     int8_t maxLevel;
 
-    void upgrade(int x, int y, int8_t level);
+    /// @brief Upgrade points of the square to the level
+    /// @param points destination list of upgraded points
+    void upgrade(int x, int y, int8_t level, std::vector<glm::ivec2>& points);
 public:
     SurroundMap(int maxLevelRadius, int8_t maxLevel);
 
     /// @brief Callback called on point level increments
     void setLevelCallback(int8_t level, LevelCallback callback);
 
+    /// @brief Callback called once with all points upgraded to the level
+    /// by completeAt call. Replaces per-point level callback
+    void setLevelBatchCallback(int8_t level, LevelBatchCallback callback);
+
     /// @brief Callback called when non-zero value moves out of area
     void setOutCallback(util::AreaMap2D<int8_t>::OutCallback callback);   
     
@@ -35,6 +45,15 @@ public:
     /// @throws std::invalid_argument - upgrade square is not fully inside
     void completeAt(int x, int y);
 
+    /// @brief Upgrade points to maxLevel. Each level is completed for all
+    /// points before the next one, so level callbacks get larger batches
+    /// @throws std::invalid_argument - upgrade square of any point is not
+    /// fully inside
+    void completeAt(const std::vector<glm::ivec2>& points);
+
+    /// @brief Check if upgrade square of the point is fully inside of area
+    bool isCompletable(int x, int y) const;
+
     /// @brief Set map area center
     void setCenter(int x, int y);
 
@@ -1,6 +1,8 @@
 #include "WorldGenerator.hpp"
 
+#include <atomic>
 #include <cstring>
+#include <tuple>
 #include <algorithm>
 
 #include "maths/util.hpp"
@@ -11,6 +13,7 @@
 #include "VoxelFragment.hpp"
 #include "util/timeutil.hpp"
 #include "util/listutil.hpp"
+#include "util/ForkJoinPool.hpp"
 #include "maths/voxmaths.hpp"
 #include "maths/util.hpp"
 #include "debug/Logger.hpp"
@@ -24,14 +27,24 @@ static inline constexpr uint MAX_PARAMETERS = 4;
 static inline constexpr uint BASIC_PROTOTYPE_LAYERS = 5;
 
 WorldGenerator::WorldGenerator(
-    const GeneratorDef& def, const Content& content, uint64_t seed
+    const GeneratorDef& def,
+    const Content& content,
+    uint64_t seed,
+    uint workers
 )
     : def(def), 
       content(content), 
       seed(seed),
-      surroundMap(0, BASIC_PROTOTYPE_LAYERS + def.wideStructsChunksRadius * 2)
+      surroundMap(0, BASIC_PROTOTYPE_LAYERS + def.wideStructsChunksRadius * 2),
+      pool(std::make_unique<util::ForkJoinPool>(workers))
 {
     def.script->initialize(seed);
+    for (uint i = 1; i < pool->getThreadsCount(); i++) {
+        auto script = def.script->clone();
+        script->initialize(seed);
+        scripts.push_back(std::move(script));
+    }
+    logger.info() << "prototype stages workers: " << pool->getThreadsCount();
 
     uint levels = BASIC_PROTOTYPE_LAYERS + def.wideStructsChunksRadius * 2;
 
@@ -51,18 +64,18 @@ WorldGenerator::WorldGenerator(
         }
         prototypes[{x, z}] = generatePrototype(x, z);
     });
-    surroundMap.setLevelCallback(def.wideStructsChunksRadius + 1, 
-    [this](int const x, int const z) {
-        generateStructuresWide(requirePrototype(x, z), x, z);
+    surroundMap.setLevelBatchCallback(def.wideStructsChunksRadius + 1, 
+    [this](const auto& points) {
+        performStage(points, &WorldGenerator::generateStructuresWide);
     });
-    surroundMap.setLevelCallback(levels-3, [this](int const x, int const z) {
-        generateBiomes(requirePrototype(x, z), x, z);
+    surroundMap.setLevelBatchCallback(levels-3, [this](const auto& points) {
+        performStage(points, &WorldGenerator::generateBiomes);
     });
-    surroundMap.setLevelCallback(levels-2, [this](int const x, int const z) {
-        generateHeightmap(requirePrototype(x, z), x, z);
+    surroundMap.setLevelBatchCallback(levels-2, [this](const auto& points) {
+        performStage(points, &WorldGenerator::generateHeightmap);
     });
-    surroundMap.setLevelCallback(levels-1, [this](int const x, int const z) {
-        generateStructures(requirePrototype(x, z), x, z);
+    surroundMap.setLevelBatchCallback(levels-1, [this](const auto& points) {
+        performStage(points, &WorldGenerator::generateStructures);
     });
     for (int i = 0; i < def.structures.size(); i++) {
         // pre-calculate rotated structure variants
@@ -84,6 +97,44 @@ ChunkPrototype& WorldGenerator::requirePrototype(int x, int z) {
     return *found->second;
 }
 
+GeneratorScript& WorldGenerator::getScript(uint worker) {
+    if (worker == 0) {
+        return *def.script;
+    }
+    return *scripts.at(worker - 1);
+}
+
+void WorldGenerator::performStage(
+    const std::vector<glm::ivec2>& points, Stage stage
+) {
+    std::vector<std::vector<Placement>> placements(points.size());
+    std::atomic<size_t> next = 0;
+    auto work = [this, &points, &placements, &next, stage](
+        GeneratorScript& script
+    ) {
+        size_t index;
+        while ((index = next++) < points.size()) {
+            const auto& point = points[index];
+            auto& prototype = requirePrototype(point.x, point.y);
+            placements[index] =
+                (this->*stage)(script, prototype, point.x, point.y);
+        }
+    };
+    size_t workers = std::min<size_t>(pool->getThreadsCount(), points.size());
+    if (workers <= 1) {
+        work(*def.script);
+    } else {
+        std::vector<runnable> tasks;
+        for (uint i = 0; i < workers; i++) {
+            tasks.emplace_back([this, &work, i]() { work(getScript(i)); });
+        }
+        pool->run(tasks);
+    }
+    for (size_t i = 0; i < points.size(); i++) {
+        placeStructures(placements[i], points[i].x, points[i].y);
+    }
+}
+
 static inline void generate_pole(
     const BlocksLayers& layers,
     int top, int bottom,
@@ -205,10 +256,7 @@ void WorldGenerator::placeLine(const LinePlacement& line, int priority) {
 }
 
 void WorldGenerator::placeStructures(
-    const std::vector<Placement>& placements, 
-    ChunkPrototype& prototype, 
-    int chunkX, 
-    int chunkZ
+    const std::vector<Placement>& placements, int chunkX, int chunkZ
 ) {
     for (const auto& placement : placements) {
         if (auto sp = std::get_if<StructurePlacement>(&placement.placement)) {
@@ -224,34 +272,32 @@ void WorldGenerator::placeStructures(
     }
 }
 
-void WorldGenerator::generateStructuresWide(
-    ChunkPrototype& prototype, int chunkX, int chunkZ
+std::vector<Placement> WorldGenerator::generateStructuresWide(
+    GeneratorScript& script, ChunkPrototype& prototype, int chunkX, int chunkZ
 ) {
     if (prototype.level >= ChunkPrototypeLevel::WIDE_STRUCTS) {
-        return;
+        return {};
     }
-    auto placements = def.script->placeStructuresWide(
+    auto placements = script.placeStructuresWide(
         {chunkX * CHUNK_W, chunkZ * CHUNK_D}, {CHUNK_W, CHUNK_D}, CHUNK_H
     );
-    placeStructures(placements, prototype, chunkX, chunkZ);
-
     prototype.level = ChunkPrototypeLevel::WIDE_STRUCTS;
+    return placements;
 }
 
-void WorldGenerator::generateStructures(
-    ChunkPrototype& prototype, int chunkX, int chunkZ
+std::vector<Placement> WorldGenerator::generateStructures(
+    GeneratorScript& script, ChunkPrototype& prototype, int chunkX, int chunkZ
 ) {
     if (prototype.level >= ChunkPrototypeLevel::STRUCTURES) {
-        return;
+        return {};
     }
     const auto& biomes = prototype.biomes;
     const auto& heightmap = prototype.heightmap;
 
-    auto placements = def.script->placeStructures(
+    auto placements = script.placeStructures(
         {chunkX * CHUNK_W, chunkZ * CHUNK_D}, {CHUNK_W, CHUNK_D},
         heightmap, CHUNK_H
     );
-    placeStructures(placements, prototype, chunkX, chunkZ);
 
     util::PseudoRandom structsRand;
     structsRand.setSeed(chunkX, chunkZ);
@@ -276,29 +322,23 @@ void WorldGenerator::generateStructures(
             glm::ivec3 position {x, height-structure.meta.lowering, z};
             position.x -= fragment.getSize().x / 2;
             position.z -= fragment.getSize().z / 2;
-            placeStructure(
-                StructurePlacement {
-                    structureId,
-                    position,
-                    rotation
-                },
-                1,
-                chunkX, 
-                chunkZ
+            placements.emplace_back(
+                1, StructurePlacement {structureId, position, rotation}
             );
         }
     }
     prototype.level = ChunkPrototypeLevel::STRUCTURES;
+    return placements;
 }
 
-void WorldGenerator::generateBiomes(
-    ChunkPrototype& prototype, int chunkX, int chunkZ
+std::vector<Placement> WorldGenerator::generateBiomes(
+    GeneratorScript& script, ChunkPrototype& prototype, int chunkX, int chunkZ
 ) {
     if (prototype.level >= ChunkPrototypeLevel::BIOMES) {
-        return;
+        return {};
     }
     uint bpd = def.biomesBPD;
-    auto biomeParams = def.script->generateParameterMaps(
+    auto biomeParams = script.generateParameterMaps(
         {floordiv(chunkX * CHUNK_W, bpd), floordiv(chunkZ * CHUNK_D, bpd)},
         {floordiv(CHUNK_W, bpd)+1, floordiv(CHUNK_D, bpd)+1},
         bpd
@@ -330,16 +370,17 @@ void WorldGenerator::generateBiomes(
     }
     prototype.biomes = std::move(chunkBiomes);
     prototype.level = ChunkPrototypeLevel::BIOMES;
+    return {};
 }
 
-void WorldGenerator::generateHeightmap(
-    ChunkPrototype& prototype, int chunkX, int chunkZ
+std::vector<Placement> WorldGenerator::generateHeightmap(
+    GeneratorScript& script, ChunkPrototype& prototype, int chunkX, int chunkZ
 ) {
     if (prototype.level >= ChunkPrototypeLevel::HEIGHTMAP) {
-        return;
+        return {};
     }
     uint bpd = def.heightsBPD;
-    prototype.heightmap = def.script->generateHeightmap(
+    prototype.heightmap = script.generateHeightmap(
         {floordiv(chunkX * CHUNK_W, bpd), floordiv(chunkZ * CHUNK_D, bpd)},
         {floordiv(CHUNK_W, bpd)+1, floordiv(CHUNK_D, bpd)+1},
         bpd,
@@ -351,6 +392,7 @@ void WorldGenerator::generateHeightmap(
     );
     prototype.heightmap->crop(0, 0, CHUNK_W, CHUNK_D);
     prototype.level = ChunkPrototypeLevel::HEIGHTMAP;
+    return {};
 }
 
 void WorldGenerator::update(int centerX, int centerY, int loadDistance) {
@@ -366,7 +408,7 @@ void WorldGenerator::generatePlants(
     int chunkX,
     int chunkZ,
     const Biome** biomes
-) {
+) const {
     const auto& indices = content.getIndices()->blocks;
     util::PseudoRandom plantsRand;
     plantsRand.setSeed(chunkX, chunkZ);
@@ -408,7 +450,7 @@ void WorldGenerator::generateLand(
     int chunkX,
     int chunkZ,
     const Biome** biomes
-) {
+) const {
     uint seaLevel = def.seaLevel;
     for (uint z = 0; z < CHUNK_D; z++) {
         for (uint x = 0; x < CHUNK_W; x++) {
@@ -428,8 +470,57 @@ void WorldGenerator::generateLand(
 
 void WorldGenerator::generate(voxel* voxels, int chunkX, int chunkZ) {
     surroundMap.completeAt(chunkX, chunkZ);
+    generate(voxels, requirePrototype(chunkX, chunkZ), chunkX, chunkZ);
+}
 
-    const auto& prototype = requirePrototype(chunkX, chunkZ);
+static std::shared_ptr<const ChunkPrototype> make_snapshot(
+    const ChunkPrototype& prototype
+) {
+    auto snapshot = std::make_shared<ChunkPrototype>();
+    snapshot->level = prototype.level;
+    snapshot->heightmap = prototype.heightmap;
+    snapshot->placements = prototype.placements;
+    snapshot->biomes = std::make_unique<const Biome*[]>(CHUNK_W * CHUNK_D);
+    std::copy(
+        prototype.biomes.get(),
+        prototype.biomes.get() + CHUNK_W * CHUNK_D,
+        snapshot->biomes.get()
+    );
+    return snapshot;
+}
+
+std::shared_ptr<const ChunkPrototype> WorldGenerator::prepare(
+    int chunkX, int chunkZ
+) {
+    surroundMap.completeAt(chunkX, chunkZ);
+    return make_snapshot(requirePrototype(chunkX, chunkZ));
+}
+
+std::vector<std::shared_ptr<const ChunkPrototype>> WorldGenerator::prepare(
+    const std::vector<glm::ivec2>& positions
+) {
+    std::vector<glm::ivec2> targets;
+    for (const auto& pos : positions) {
+        if (surroundMap.isCompletable(pos.x, pos.y)) {
+            targets.push_back(pos);
+        }
+    }
+    surroundMap.completeAt(targets);
+
+    std::vector<std::shared_ptr<const ChunkPrototype>> snapshots;
+    for (const auto& pos : positions) {
+        if (surroundMap.isCompletable(pos.x, pos.y)) {
+            snapshots.push_back(make_snapshot(requirePrototype(pos.x, pos.y)));
+        } else {
+            snapshots.push_back(nullptr);
+        }
+    }
+    return snapshots;
+}
+
+void WorldGenerator::generate(
+    voxel* voxels, const ChunkPrototype& prototype, int chunkX, int chunkZ
+) const {
     const auto values = prototype.heightmap->getValues();
 
     uint seaLevel = def.seaLevel;
@@ -468,17 +559,36 @@ void WorldGenerator::generate(voxel* voxels, int chunkX, int chunkZ) {
     }
 }
 
+static bool placement_less(const Placement& a, const Placement& b) {
+    if (a.priority != b.priority) {
+        return a.priority < b.priority;
+    }
+    if (a.placement.index() != b.placement.index()) {
+        return a.placement.index() < b.placement.index();
+    }
+    auto vec_key = [](const glm::ivec3& v) {
+        return std::make_tuple(v.x, v.y, v.z);
+    };
+    if (auto sa = std::get_if<StructurePlacement>(&a.placement)) {
+        const auto& sb = std::get<StructurePlacement>(b.placement);
+        return std::make_tuple(
+                   sa->structure, vec_key(sa->position), sa->rotation
+               ) <
+               std::make_tuple(sb.structure, vec_key(sb.position), sb.rotation);
+    }
+    const auto& la = std::get<LinePlacement>(a.placement);
+    const auto& lb = std::get<LinePlacement>(b.placement);
+    return std::make_tuple(la.block, vec_key(la.a), vec_key(la.b), la.radius) <
+           std::make_tuple(lb.block, vec_key(lb.a), vec_key(lb.b), lb.radius);
+}
+
 void WorldGenerator::generatePlacements(
     const ChunkPrototype& prototype, voxel* voxels, int chunkX, int chunkZ
-) {
+) const {
     auto placements = prototype.placements;
-    std::stable_sort(
-        placements.begin(),
-        placements.end(), 
-        [](const auto& a, const auto& b) {
-            return a.priority < b.priority;
-        }
-    );
+    // placements order depends on stages scheduling, so placements with
+    // equal priority are ordered by value to keep the result deterministic
+    std::sort(placements.begin(), placements.end(), placement_less);
     for (const auto& placement : placements) {
         if (auto structure = std::get_if<StructurePlacement>(&placement.placement)) {
             generateStructure(prototype, *structure, voxels, chunkX, chunkZ);
@@ -494,7 +604,7 @@ void WorldGenerator::generateStructure(
     const StructurePlacement& placement,
     voxel* voxels, 
     int chunkX, int chunkZ
-) {
+) const {
     if (placement.structure < 0 || placement.structure >= def.structures.size()) {
         logger.error() << "invalid structure index " << placement.structure;
         return;
@@ -535,7 +645,7 @@ void WorldGenerator::generateLine(
     const LinePlacement& line,
     voxel* voxels, 
     int chunkX, int chunkZ
-) {
+) const {
     const auto& indices = content.getIndices()->blocks;
 
     int cgx = chunkX * CHUNK_W;
@@ -612,3 +722,7 @@ WorldGenDebugInfo WorldGenerator::createDebugInfo() const {
 uint64_t WorldGenerator::getSeed() const {
     return seed;
 }
+
+uint WorldGenerator::getWorkersCount() const {
+    return pool->getThreadsCount();
+}
@@ -14,10 +14,15 @@
 
 class Content;
 struct GeneratorDef;
+class GeneratorScript;
 class Heightmap;
 struct Biome;
 class VoxelFragment;
 
+namespace util {
+    class ForkJoinPool;
+}
+
 enum class ChunkPrototypeLevel {
     VOID=0, WIDE_STRUCTS, BIOMES, HEIGHTMAP, STRUCTURES
 };
@@ -45,8 +50,20 @@ struct WorldGenDebugInfo {
     std::unique_ptr<ubyte[]> areaLevels;
 };
 
-/// @brief High-level world generation controller
+/// @brief High-level world generation controller.
+///
+/// Prototype stages of all chunks reaching the same level are performed in
+/// parallel, each worker uses its own generator script instance. Stages
+/// modify their own prototype only, placements for other chunks are
+/// applied on the calling thread after the whole level is done, so the
+/// prototypes storage is never modified concurrently.
 class WorldGenerator {
+    /// @brief Prototype stage. Returns placements to apply after the stage
+    /// is done for all chunks of the level
+    using Stage = std::vector<Placement> (WorldGenerator::*)(
+        GeneratorScript& script, ChunkPrototype& prototype, int x, int z
+    );
+
     /// @param def generator definition
     const GeneratorDef& def;
     /// @param content world content
@@ -57,6 +74,11 @@ class WorldGenerator {
     std::unordered_map<glm::ivec2, std::unique_ptr<ChunkPrototype>> prototypes;
     /// @brief Chunk prototypes loading surround map
     SurroundMap surroundMap;
+    /// @brief Stages workers
+    std::unique_ptr<util::ForkJoinPool> pool;
+    /// @brief Script instances of workers except the first one which uses
+    /// the definition script
+    std::vector<std::unique_ptr<GeneratorScript>> scripts;
 
     /// @brief Generate chunk prototype (see ChunkPrototype)
     /// @param x chunk position X divided by CHUNK_W
@@ -65,13 +87,27 @@ class WorldGenerator {
 
     ChunkPrototype& requirePrototype(int x, int z);
 
-    void generateStructuresWide(ChunkPrototype& prototype, int x, int z);
+    GeneratorScript& getScript(uint worker);
+
+    /// @brief Perform the stage for all points and apply placements in
+    /// the points order
+    void performStage(const std::vector<glm::ivec2>& points, Stage stage);
+
+    std::vector<Placement> generateStructuresWide(
+        GeneratorScript& script, ChunkPrototype& prototype, int x, int z
+    );
 
-    void generateStructures(ChunkPrototype& prototype, int x, int z);
+    std::vector<Placement> generateStructures(
+        GeneratorScript& script, ChunkPrototype& prototype, int x, int z
+    );
 
-    void generateBiomes(ChunkPrototype& prototype, int x, int z);
+    std::vector<Placement> generateBiomes(
+        GeneratorScript& script, ChunkPrototype& prototype, int x, int z
+    );
 
-    void generateHeightmap(ChunkPrototype& prototype, int x, int z);
+    std::vector<Placement> generateHeightmap(
+        GeneratorScript& script, ChunkPrototype& prototype, int x, int z
+    );
 
     void placeStructure(
         const StructurePlacement& placement, int priority, 
@@ -82,19 +118,19 @@ class WorldGenerator {
 
     void generatePlacements(
         const ChunkPrototype& prototype, voxel* voxels, int x, int z
-    );
+    ) const;
     void generateLine(
         const ChunkPrototype& prototype, 
         const LinePlacement& placement,
         voxel* voxels, 
         int x, int z
-    );
+    ) const;
     void generateStructure(
         const ChunkPrototype& prototype, 
         const StructurePlacement& placement,
         voxel* voxels, 
         int x, int z
-    );
+    ) const;
     void generatePlants(
         const ChunkPrototype& prototype,
         float* values,
@@ -102,7 +138,7 @@ class WorldGenerator {
         int x,
         int z,
         const Biome** biomes
-    );
+    ) const;
     void generateLand(
         const ChunkPrototype& prototype,
         float* values,
@@ -110,18 +146,19 @@ class WorldGenerator {
         int x,
         int z,
         const Biome** biomes
-    );
+    ) const;
 
     void placeStructures(
-        const std::vector<Placement>& placements,
-        ChunkPrototype& prototype,
-        int x, int z
+        const std::vector<Placement>& placements, int x, int z
     );
 public:
+    /// @param workers number of threads performing prototype stages,
+    /// 0 is auto
     WorldGenerator(
         const GeneratorDef& def,
         const Content& content,
-        uint64_t seed
+        uint64_t seed,
+        uint workers = 1
     );
     ~WorldGenerator();
 
@@ -133,7 +170,37 @@ public:
     /// @param z chunk position Y divided by CHUNK_D
     void generate(voxel* voxels, int x, int z);
 
+    /// @brief Complete chunk prototype and make a snapshot of it that stays
+    /// valid after the prototype is removed from the storage
+    /// @param x chunk position X divided by CHUNK_W
+    /// @param z chunk position Y divided by CHUNK_D
+    /// @throws std::invalid_argument - chunk is out of generator area
+    std::shared_ptr<const ChunkPrototype> prepare(int x, int z);
+
+    /// @brief Complete chunk prototypes at once and make snapshots of them
+    /// (see prepare). Stages of different chunks are performed in parallel
+    /// @param positions chunks positions divided by CHUNK_W, CHUNK_D
+    /// @return snapshots in positions order, nullptr for chunks being out
+    /// of generator area
+    std::vector<std::shared_ptr<const ChunkPrototype>> prepare(
+        const std::vector<glm::ivec2>& positions
+    );
+
+    /// @brief Generate complete chunk voxels using prepared prototype.
+    /// Does not use generator script and prototypes storage, so may be
+    /// called from any thread.
+    /// @param voxels destinatiopn chunk voxels buffer
+    /// @param prototype prototype snapshot (see prepare)
+    /// @param x chunk position X divided by CHUNK_W
+    /// @param z chunk position Y divided by CHUNK_D
+    void generate(
+        voxel* voxels, const ChunkPrototype& prototype, int x, int z
+    ) const;
+
     WorldGenDebugInfo createDebugInfo() const;
 
     uint64_t getSeed() const;
+
+    /// @return number of threads performing prototype stages
+    uint getWorkersCount() const;
 };
@@ -34,3 +34,19 @@ TEST(GLSLExtension, processing) {
         throw;
     }
 }
+
+TEST(GLSLExtension, SourceDefines) {
+    GLSLExtension glsl;
+    const std::string source =
+        "#ifdef GREEDY_MESHING\n"
+        "flat in vec2 a_tileSize;\n"
+        "#endif\n";
+    auto processed =
+        glsl.process("test.glsl", source, false, {"GREEDY_MESHING"});
+    const auto& code = processed.code;
+    EXPECT_NE(code.find("#define GREEDY_MESHING\n"), std::string::npos);
+    EXPECT_NE(code.find("#ifdef GREEDY_MESHING\n"), std::string::npos);
+
+    processed = glsl.process("test.glsl", source);
+    EXPECT_EQ(processed.code.find("#define GREEDY_MESHING"), std::string::npos);
+}
@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "coders/compression.hpp"
+#include "coders/lz4.hpp"
+#include "util/timeutil.hpp"
+
+using namespace compression;
+
+static const Method METHODS[] {
+    Method::EXTRLE8, Method::EXTRLE16, Method::GZIP, Method::LZ4
+};
+
+/// @brief Generate voxels-like data: runs of 16-bit values with noise
+static std::vector<ubyte> generate_data(size_t size, int density) {
+    std::vector<ubyte> data(size);
+    uint16_t next = rand();
+    for (size_t i = 0; i + 1 < size; i += 2) {
+        data[i] = next & 0xFF;
+        data[i + 1] = next >> 8;
+        if (rand() % density == 0) {
+            next = rand() % 64;
+        }
+    }
+    return data;
+}
+
+static void test_round_trip(const std::vector<ubyte>& data, Method method) {
+    size_t length;
+    auto compressed = compress(data.data(), data.size(), length, method);
+    auto decompressed =
+        decompress(compressed.get(), length, data.size(), method);
+    EXPECT_EQ(std::memcmp(decompressed.get(), data.data(), data.size()), 0)
+        << to_string(method);
+}
+
+TEST(Compression, EncodeDecode) {
+    for (int density : {1, 13, 90123}) {
+        auto data = generate_data(65'536, density);
+        for (auto method : METHODS) {
+            test_round_trip(data, method);
+        }
+    }
+}
+
+TEST(Compression, MethodNames) {
+    for (auto method : METHODS) {
+        EXPECT_EQ(parse_method(to_string(method)), method);
+    }
+    EXPECT_THROW(parse_method("zip"), std::invalid_argument);
+    EXPECT_THROW(method_from_byte(200), std::invalid_argument);
+}
+
+TEST(LZ4, EncodeDecode) {
+    for (size_t size : {0, 1, 12, 13, 100, 70'000}) {
+        auto data = generate_data(size, 5);
+        std::vector<ubyte> encoded(lz4::compress_bound(size));
+        size_t encodedSize = lz4::encode(data.data(), size, encoded.data());
+        EXPECT_LE(encodedSize, encoded.size());
+
+        std::vector<ubyte> decoded(size);
+        size_t decodedSize = lz4::decode(
+            encoded.data(), encodedSize, decoded.data(), decoded.size()
+        );
+        EXPECT_EQ(decodedSize, size);
+        EXPECT_EQ(decoded, data);
+    }
+}
+
+TEST(LZ4, Malformed) {
+    auto data = generate_data(10'000, 13);
+    std::vector<ubyte> encoded(lz4::compress_bound(data.size()));
+    size_t encodedSize = lz4::encode(data.data(), data.size(), encoded.data());
+
+    std::vector<ubyte> decoded(data.size() / 2);
+    EXPECT_THROW(
+        lz4::decode(
+            encoded.data(), encodedSize, decoded.data(), decoded.size()
+        ),
+        std::runtime_error
+    );
+    const ubyte invalidOffset[] {0x00, 0x00, 0x00};
+    EXPECT_THROW(
+        lz4::decode(invalidOffset, 3, decoded.data(), decoded.size()),
+        std::runtime_error
+    );
+}
+
+/// @brief Read and decompress all chunks data of the region file
+static std::vector<std::vector<ubyte>> read_region(
+    const std::filesystem::path& file
+) {
+    const size_t headerSize = 10;
+    const size_t chunksCount = 1024;
+
+    std::ifstream stream(file, std::ios::binary);
+    std::vector<ubyte> bytes(
+        (std::istreambuf_iterator<char>(stream)),
+        std::istreambuf_iterator<char>()
+    );
+    std::vector<std::vector<ubyte>> chunks;
+    if (bytes.size() < headerSize + chunksCount * 4) {
+        return chunks;
+    }
+    auto method = method_from_byte(bytes[9]);
+    auto read32 = [&bytes](size_t offset) {
+        return bytes[offset] | (bytes[offset + 1] << 8) |
+               (bytes[offset + 2] << 16) |
+               (static_cast<uint32_t>(bytes[offset + 3]) << 24);
+    };
+    size_t table = bytes.size() - chunksCount * 4;
+    for (size_t i = 0; i < chunksCount; i++) {
+        uint32_t offset = read32(table + i * 4);
+        if (offset == 0) {
+            continue;
+        }
+        uint32_t size = read32(offset);
+        uint32_t srcSize = read32(offset + 4);
+        const ubyte* src = bytes.data() + offset + 8;
+        if (method == Method::NONE) {
+            chunks.emplace_back(src, src + size);
+            continue;
+        }
+        auto data = decompress(src, size, srcSize, method);
+        chunks.emplace_back(data.get(), data.get() + srcSize);
+    }
+    return chunks;
+}
+
+/// @brief Compares compression methods on chunks of the regions directory
+/// set by REGIONS_DIR environment variable (e.g. world/regions)
+TEST(Compression, DISABLED_RegionsBenchmark) {
+    const char* directory = std::getenv("REGIONS_DIR");
+    if (directory == nullptr) {
+        GTEST_SKIP() << "REGIONS_DIR is not set";
+    }
+    std::vector<std::vector<ubyte>> chunks;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        for (auto& chunk : read_region(entry.path())) {
+            chunks.push_back(std::move(chunk));
+        }
+    }
+    ASSERT_FALSE(chunks.empty());
+
+    size_t totalSize = 0;
+    for (const auto& chunk : chunks) {
+        totalSize += chunk.size();
+    }
+    std::cout << chunks.size() << " chunks, " << totalSize / 1024
+              << " KiB" << std::endl;
+
+    for (auto method : METHODS) {
+        std::vector<std::unique_ptr<ubyte[]>> compressed;
+        std::vector<size_t> lengths;
+        size_t compressedSize = 0;
+
+        timeutil::Timer timer;
+        for (const auto& chunk : chunks) {
+            size_t length;
+            compressed.push_back(
+                compress(chunk.data(), chunk.size(), length, method)
+            );
+            lengths.push_back(length);
+            compressedSize += length;
+        }
+        int64_t compressTime = timer.stop();
+
+        timer = {};
+        for (size_t i = 0; i < chunks.size(); i++) {
+            decompress(
+                compressed[i].get(), lengths[i], chunks[i].size(), method
+            );
+        }
+        int64_t decompressTime = timer.stop();
+
+        std::cout << to_string(method) << ": ratio "
+                  << static_cast<double>(totalSize) / compressedSize
+                  << ", compress "
+                  << totalSize / std::max<int64_t>(compressTime, 1)
+                  << " MB/s, decompress "
+                  << totalSize / std::max<int64_t>(decompressTime, 1)
+                  << " MB/s" << std::endl;
+    }
+}
@@ -0,0 +1,187 @@
+#include "graphics/render/BlocksRenderer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <iostream>
+
+#include "../test_content.hpp"
+#include "assets/Assets.hpp"
+#include "frontend/ContentGfxCache.hpp"
+#include "graphics/core/Atlas.hpp"
+#include "graphics/core/Mesh.hpp"
+#include "graphics/core/ImageData.hpp"
+#include "lighting/Lighting.hpp"
+#include "util/timeutil.hpp"
+#include "voxels/Chunks.hpp"
+
+/// @param ao blocks ambient occlusion
+static std::unique_ptr<Content> create_content(bool ao) {
+    return create_test_content(
+        {"test:stone", "test:grass"},
+        [ao](Block& block) {
+            block.ambientOcclusion = ao;
+            if (block.name == "test:stone") {
+                block.textureFaces.fill("stone");
+            } else {
+                block.textureFaces.fill("grass_side");
+                block.textureFaces[2] = "dirt";
+                block.textureFaces[3] = "grass_top";
+            }
+        }
+    );
+}
+
+static std::unique_ptr<Atlas> create_atlas() {
+    std::unordered_map<std::string, UVRegion> regions;
+    const char* names[] {"stone", "grass_side", "dirt", "grass_top"};
+    for (int i = 0; i < 4; i++) {
+        regions[names[i]] = UVRegion(i * 0.25f, 0.0f, (i + 1) * 0.25f, 0.25f);
+    }
+    return std::make_unique<Atlas>(
+        std::make_unique<ImageData>(ImageFormat::rgba8888, 64, 64),
+        std::move(regions),
+        false
+    );
+}
+
+/// @brief Generate gentle hills covered with grass
+static void generate(Chunk& chunk, const Content& content) {
+    blockid_t stone = content.blocks.require("test:stone").rt.id;
+    blockid_t grass = content.blocks.require("test:grass").rt.id;
+
+    for (int z = 0; z < CHUNK_D; z++) {
+        for (int x = 0; x < CHUNK_W; x++) {
+            int gx = x + chunk.x * CHUNK_W;
+            int gz = z + chunk.z * CHUNK_D;
+            int height =
+                60 + 2 * std::sin(gx * 0.05f) + 2 * std::cos(gz * 0.05f);
+            for (int y = 0; y < height; y++) {
+                chunk.voxels.edit(vox_index(x, y, z)).id =
+                    y == height - 1 ? grass : stone;
+            }
+        }
+    }
+}
+
+struct World {
+    std::unique_ptr<Content> content;
+    EngineSettings settings;
+    Assets assets;
+    std::unique_ptr<ContentGfxCache> cache;
+    std::unique_ptr<Chunks> chunks;
+    std::unique_ptr<Lighting> lighting;
+
+    World(int size, bool ao = true) : content(create_content(ao)) {
+        assets.store(create_atlas(), "blocks");
+        cache = std::make_unique<ContentGfxCache>(
+            *content, assets, settings.graphics
+        );
+        const auto& indices = *content->getIndices();
+        chunks =
+            std::make_unique<Chunks>(size, size, 0, 0, nullptr, indices);
+        lighting = std::make_unique<Lighting>(*content, *chunks);
+        int ox = chunks->getOffsetX();
+        int oz = chunks->getOffsetY();
+        for (int z = 0; z < size; z++) {
+            for (int x = 0; x < size; x++) {
+                auto chunk = std::make_shared<Chunk>(x + ox, z + oz);
+                generate(*chunk, *content);
+                chunk->updateHeights();
+                chunk->updateOccupancy(indices);
+                Lighting::prebuildSkyLight(*chunk, indices);
+                chunk->flags.loaded = true;
+                chunks->putChunk(chunk);
+            }
+        }
+        for (const auto& chunk : chunks->getChunks()) {
+            lighting->buildSkyLight(chunk->x, chunk->z);
+            lighting->onChunkLoaded(chunk->x, chunk->z, true);
+        }
+    }
+};
+
+struct MeshStats {
+    size_t vertices;
+    size_t quads;
+    double area;
+};
+
+static MeshStats mesh_stats(const ChunkMeshData& data) {
+    const auto& vertices = data.mesh.vertices;
+    const auto& indices = data.mesh.indices;
+    size_t vertexSize = 0;
+    for (size_t i = 0; i < data.mesh.attrs.size(); i++) {
+        vertexSize += data.mesh.attrs[i].size;
+    }
+    double area = 0.0;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        glm::vec3 points[3];
+        for (int j = 0; j < 3; j++) {
+            const float* vertex = &vertices[indices[i + j] * vertexSize];
+            points[j] = glm::vec3(vertex[0], vertex[1], vertex[2]);
+        }
+        area += glm::length(
+                    glm::cross(points[1] - points[0], points[2] - points[0])
+                ) * 0.5;
+    }
+    return MeshStats {vertices.size() / vertexSize, indices.size() / 6, area};
+}
+
+TEST(BlocksRenderer, GreedyMeshing) {
+    World world(3);
+    const Chunk* chunk = world.chunks->getChunk(
+        world.chunks->getOffsetX() + 1, world.chunks->getOffsetY() + 1
+    );
+    ASSERT_NE(chunk, nullptr);
+
+    EngineSettings settings;
+    BlocksRenderer renderer(800'000, *world.content, *world.cache, settings);
+    renderer.build(chunk, world.chunks.get());
+    auto simpleData = renderer.createMesh();
+    EXPECT_EQ(simpleData.mesh.attrs.size(), std::size(CHUNK_VATTRS));
+    auto simple = mesh_stats(simpleData);
+
+    settings.graphics.greedyMeshing.set(true);
+    renderer.build(chunk, world.chunks.get());
+    auto greedyData = renderer.createMesh();
+    EXPECT_EQ(greedyData.mesh.attrs.size(), std::size(GREEDY_CHUNK_VATTRS));
+    auto greedy = mesh_stats(greedyData);
+
+    EXPECT_GT(simple.quads, 0);
+    EXPECT_LT(greedy.quads * 2, simple.quads);
+    EXPECT_NEAR(greedy.area, simple.area, 1e-3);
+}
+
+/// @brief Compares meshes and build time with and without greedy meshing.
+/// Faces with ambient occlusion are merged only where their vertex lights
+/// are equal
+TEST(BlocksRenderer, DISABLED_GreedyMeshingBenchmark) {
+    for (bool ao : {true, false}) {
+        World world(8, ao);
+        EngineSettings settings;
+        BlocksRenderer renderer(
+            800'000, *world.content, *world.cache, settings
+        );
+        for (bool greedyMeshing : {false, true}) {
+            settings.graphics.greedyMeshing.set(greedyMeshing);
+            size_t quads = 0;
+            size_t vertices = 0;
+            size_t count = 0;
+            int64_t mcs = 0;
+            for (const auto& chunk : world.chunks->getChunks()) {
+                timeutil::Timer timer;
+                renderer.build(chunk.get(), world.chunks.get());
+                mcs += timer.stop();
+                auto stats = mesh_stats(renderer.createMesh());
+                quads += stats.quads;
+                vertices += stats.vertices;
+                count++;
+            }
+            std::cout << (greedyMeshing ? "greedy" : "simple")
+                      << (ao ? " (AO)" : "") << " per chunk: quads "
+                      << quads / count << ", vertices " << vertices / count
+                      << ", build " << mcs / count << " mcs" << std::endl;
+        }
+    }
+}
@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <iostream>
+
+#include "../test_content.hpp"
+#include "lighting/Lighting.hpp"
+#include "lighting/Lightmap.hpp"
+#include "util/timeutil.hpp"
+#include "voxels/Chunk.hpp"
+#include "voxels/Chunks.hpp"
+
+static std::unique_ptr<Content> create_content() {
+    return create_test_content(
+        {"test:stone", "test:glass", "test:lamp"},
+        [](Block& block) {
+            if (block.name == "test:glass") {
+                block.lightPassing = true;
+            } else if (block.name == "test:lamp") {
+                block.emission[0] = 15;
+                block.emission[1] = 9;
+                block.emission[2] = 4;
+            }
+        }
+    );
+}
+
+static uint hash(int x, int y, int z) {
+    uint h = x * 73856093U ^ y * 19349663U ^ z * 83492791U;
+    h ^= h >> 13;
+    h *= 0x5bd1e995U;
+    return h ^ (h >> 15);
+}
+
+/// @brief Generate terrain with caves, glass windows and lamps
+static void generate(Chunk& chunk, const Content& content) {
+    blockid_t stone = content.blocks.require("test:stone").rt.id;
+    blockid_t glass = content.blocks.require("test:glass").rt.id;
+    blockid_t lamp = content.blocks.require("test:lamp").rt.id;
+
+    for (int z = 0; z < CHUNK_D; z++) {
+        for (int x = 0; x < CHUNK_W; x++) {
+            int gx = x + chunk.x * CHUNK_W;
+            int gz = z + chunk.z * CHUNK_D;
+            int height = 60 + 12 * std::sin(gx * 0.07f) +
+                         10 * std::cos(gz * 0.05f);
+            for (int y = 0; y < height; y++) {
+                uint h = hash(gx / 3, y / 3, gz / 3);
+                blockid_t id = stone;
+                if (h % 5 == 0) {
+                    id = hash(gx, y, gz) % 300 == 0 ? lamp : 0;
+                } else if (y == height - 1 && h % 7 == 0) {
+                    id = glass;
+                }
+                chunk.voxels.edit(vox_index(x, y, z)).id = id;
+            }
+            if (hash(gx, height, gz) % 400 == 0) {
+                chunk.voxels.edit(vox_index(x, height, z)).id = lamp;
+            }
+        }
+    }
+}
+
+/// @brief Create chunks matrix with size x size chunks area to build
+/// lights for and one chunk padding around it
+static std::unique_ptr<Chunks> create_world(
+    const Content& content, int size, std::vector<Chunk*>& area
+) {
+    const auto& indices = *content.getIndices();
+    int width = size + 2;
+    auto chunks =
+        std::make_unique<Chunks>(width, width, 0, 0, nullptr, indices);
+    int ox = chunks->getOffsetX();
+    int oz = chunks->getOffsetY();
+    for (int z = 0; z < width; z++) {
+        for (int x = 0; x < width; x++) {
+            auto chunk = std::make_shared<Chunk>(x + ox, z + oz);
+            generate(*chunk, content);
+            chunk->updateHeights();
+            Lighting::prebuildSkyLight(*chunk, indices);
+            chunk->flags.loaded = true;
+            // emulate chunks with lights loaded from regions
+            chunk->flags.loadedLights = hash(x, 0, z) % 5 == 0;
+            chunks->putChunk(chunk);
+            if (x > 0 && z > 0 && x < width - 1 && z < width - 1) {
+                area.push_back(chunk.get());
+            }
+        }
+    }
+    return chunks;
+}
+
+static void build_serial(Lighting& lighting, const std::vector<Chunk*>& area) {
+    for (Chunk* chunk : area) {
+        bool lightsCache = chunk->flags.loadedLights;
+        if (!lightsCache) {
+            lighting.buildSkyLight(chunk->x, chunk->z);
+        }
+        lighting.onChunkLoaded(chunk->x, chunk->z, !lightsCache);
+    }
+}
+
+static uint64_t lights_checksum(const Chunk& chunk) {
+    uint64_t checksum = 14695981039346656037ULL;
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        checksum = (checksum ^ chunk.lightmap.get(i)) * 1099511628211ULL;
+    }
+    return checksum;
+}
+
+static std::vector<uint64_t> world_checksums(const Chunks& chunks) {
+    std::vector<uint64_t> checksums;
+    for (const auto& chunk : chunks.getChunks()) {
+        checksums.push_back(chunk ? lights_checksum(*chunk) : 0);
+    }
+    return checksums;
+}
+
+TEST(Lighting, BatchEqualsSerial) {
+    auto content = create_content();
+    std::vector<Chunk*> serialArea;
+    auto serialChunks = create_world(*content, 8, serialArea);
+    std::vector<Chunk*> batchArea;
+    auto batchChunks = create_world(*content, 8, batchArea);
+
+    Lighting serial(*content, *serialChunks);
+    build_serial(serial, serialArea);
+
+    Lighting batch(*content, *batchChunks, 4);
+    batch.onChunksLoaded(batchArea);
+
+    const auto& expected = serialChunks->getChunks();
+    const auto& actual = batchChunks->getChunks();
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        const auto& lightsA = expected[i]->lightmap;
+        const auto& lightsB = actual[i]->lightmap;
+        uint mismatches = 0;
+        for (uint j = 0; j < CHUNK_VOL; j++) {
+            mismatches += lightsA.get(j) != lightsB.get(j);
+        }
+        EXPECT_EQ(mismatches, 0) << "chunk " << expected[i]->x << "_"
+                                 << expected[i]->z;
+    }
+}
+
+/// @brief Compares serial lights solving with batches of loaded chunks.
+TEST(Lighting, DISABLED_BatchBenchmark) {
+    const int size = 32;
+    auto content = create_content();
+
+    std::vector<uint64_t> expected;
+    {
+        std::vector<Chunk*> area;
+        auto chunks = create_world(*content, size, area);
+        Lighting lighting(*content, *chunks);
+
+        timeutil::Timer timer;
+        build_serial(lighting, area);
+        int64_t mcs = timer.stop();
+        std::cout << "serial: " << mcs / 1000 << " ms, "
+                  << mcs / area.size() << " mcs per chunk" << std::endl;
+        expected = world_checksums(*chunks);
+    }
+    for (uint workers : {1, 2, 4, 0}) {
+        std::vector<Chunk*> area;
+        auto chunks = create_world(*content, size, area);
+        Lighting lighting(*content, *chunks, workers);
+
+        timeutil::Timer timer;
+        lighting.onChunksLoaded(area);
+        int64_t mcs = timer.stop();
+        std::cout << "batch (" << workers << " workers): " << mcs / 1000
+                  << " ms, " << mcs / area.size() << " mcs per chunk"
+                  << std::endl;
+        EXPECT_EQ(world_checksums(*chunks), expected);
+    }
+}
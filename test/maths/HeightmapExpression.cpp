@@ -0,0 +1,136 @@
+#include "maths/HeightmapExpression.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+
+#include "maths/Heightmap.hpp"
+
+using namespace heightmap_kernels;
+using Expr = HeightmapExpression;
+
+/// @brief Not a multiple of the block size to cover the last block
+inline constexpr uint WIDTH = 67;
+inline constexpr uint HEIGHT = 41;
+
+static std::shared_ptr<Heightmap> random_map(uint32_t seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+    auto map = std::make_shared<Heightmap>(WIDTH, HEIGHT);
+    float* values = map->getValues();
+    for (uint i = 0; i < WIDTH * HEIGHT; i++) {
+        values[i] = distribution(random);
+    }
+    return map;
+}
+
+/// @brief Noise applied to the whole map the way Heightmap:noise does
+static void apply_noise(
+    Heightmap& map,
+    const HeightmapNoiseParams& params,
+    const Heightmap* shiftMapX = nullptr
+) {
+    auto state = fnlCreateState();
+    state.seed = params.seed;
+    state.noise_type = params.type;
+    float* heights = map.getValues();
+    for (int c = 0; c < params.octaves; c++) {
+        float m = params.scale * (1 << c);
+        float octaveDivider = static_cast<float>(1 << c);
+        for (uint y = 0; y < HEIGHT; y++) {
+            for (uint x = 0; x < WIDTH; x++) {
+                uint i = y * WIDTH + x;
+                float u = (x + params.offset.x) * m;
+                float v = (y + params.offset.y) * m;
+                if (shiftMapX) {
+                    u += shiftMapX->getValues()[i];
+                }
+                heights[i] +=
+                    fnlGetNoise2D(&state, u, v) / octaveDivider *
+                    params.multiplier;
+            }
+        }
+    }
+}
+
+static bool equal_bits(const Heightmap& a, const Heightmap& b) {
+    return std::memcmp(
+               a.getValues(), b.getValues(), WIDTH * HEIGHT * sizeof(float)
+           ) == 0;
+}
+
+TEST(HeightmapExpression, MatchesSequentialOperations) {
+    auto source = random_map(1);
+    auto mixFactor = random_map(2);
+
+    HeightmapNoiseParams noise;
+    noise.seed = 42;
+    noise.offset = {-20.0f, 35.0f};
+    noise.scale = 0.05f;
+    noise.octaves = 3;
+    noise.multiplier = 25.0f;
+
+    HeightmapNoiseParams cellnoise = noise;
+    cellnoise.type = FNL_NOISE_CELLULAR;
+    cellnoise.octaves = 2;
+    cellnoise.multiplier = 0.3f;
+
+    Heightmap shift(WIDTH, HEIGHT);
+    apply_noise(shift, noise);
+
+    Heightmap expected(WIDTH, HEIGHT);
+    apply_noise(expected, cellnoise, &shift);
+    apply(BinaryOp::ADD, expected.getValues(), 0.7f, WIDTH * HEIGHT);
+    abs(expected.getValues(), WIDTH * HEIGHT);
+    apply(BinaryOp::POW, expected.getValues(), 0.15f, WIDTH * HEIGHT);
+    apply(
+        BinaryOp::MUL, expected.getValues(), source->getValues(), WIDTH * HEIGHT
+    );
+    mix(expected.getValues(), 0.5f, mixFactor->getValues(), WIDTH * HEIGHT);
+
+    auto shiftExpr = Expr::noise(Expr::value(0.0f), noise, nullptr, nullptr);
+    auto expr = Expr::noise(Expr::value(0.0f), cellnoise, shiftExpr, nullptr);
+    expr = Expr::binary(BinaryOp::ADD, expr, Expr::value(0.7f));
+    expr = Expr::abs(expr);
+    expr = Expr::binary(BinaryOp::POW, expr, Expr::value(0.15f));
+    expr = Expr::binary(BinaryOp::MUL, expr, Expr::map(source));
+    expr = Expr::mix(expr, Expr::value(0.5f), Expr::map(mixFactor));
+
+    Heightmap result(WIDTH, HEIGHT);
+    expr->evaluate(result);
+    EXPECT_TRUE(equal_bits(expected, result));
+}
+
+TEST(HeightmapExpression, SharedSubexpression) {
+    auto source = random_map(3);
+
+    Heightmap expected(WIDTH, HEIGHT);
+    std::memcpy(
+        expected.getValues(),
+        source->getValues(),
+        WIDTH * HEIGHT * sizeof(float)
+    );
+    apply(BinaryOp::SUB, expected.getValues(), 0.5f, WIDTH * HEIGHT);
+    // x * x
+    apply(
+        BinaryOp::MUL,
+        expected.getValues(),
+        expected.getValues(),
+        WIDTH * HEIGHT
+    );
+
+    auto centered =
+        Expr::binary(BinaryOp::SUB, Expr::map(source), Expr::value(0.5f));
+    auto expr = Expr::binary(BinaryOp::MUL, centered, centered);
+
+    Heightmap result(WIDTH, HEIGHT);
+    expr->evaluate(result);
+    EXPECT_TRUE(equal_bits(expected, result));
+}
+
+TEST(HeightmapExpression, SizeMismatch) {
+    auto expr = Expr::map(std::make_shared<Heightmap>(WIDTH, HEIGHT + 1));
+    Heightmap result(WIDTH, HEIGHT);
+    EXPECT_THROW(expr->evaluate(result), std::runtime_error);
+}
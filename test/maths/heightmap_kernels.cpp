@@ -0,0 +1,213 @@
+#include "maths/heightmap_kernels.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "maths/Heightmap.hpp"
+
+using namespace heightmap_kernels;
+
+/// @brief Not a multiple of vector sizes to cover tails
+inline constexpr size_t COUNT = 1027;
+
+static std::vector<float> random_values(size_t count, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> distribution(-2.0f, 2.0f);
+    std::vector<float> values(count);
+    for (auto& value : values) {
+        value = distribution(random);
+    }
+    values[0] = 0.0f;
+    values[1] = -0.0f;
+    values[2] = 1.0f;
+    return values;
+}
+
+static bool equal_bits(
+    const std::vector<float>& a, const std::vector<float>& b
+) {
+    return a.size() == b.size() &&
+           std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+
+/// @brief Run the operation using scalar and all supported vectorized
+/// kernels and check that results are bit-identical
+static void expect_identical(
+    const std::function<void(std::vector<float>&)>& operation
+) {
+    auto original = get_instruction_set();
+
+    ASSERT_TRUE(set_instruction_set(InstructionSet::SCALAR));
+    auto expected = random_values(COUNT, 1);
+    operation(expected);
+
+    for (auto set : {InstructionSet::SSE41, InstructionSet::AVX2}) {
+        if (!set_instruction_set(set)) {
+            continue;
+        }
+        auto values = random_values(COUNT, 1);
+        operation(values);
+        EXPECT_TRUE(equal_bits(expected, values)) << to_string(set);
+    }
+    set_instruction_set(original);
+}
+
+TEST(HeightmapKernels, BinaryOps) {
+    auto src = random_values(COUNT, 2);
+    for (int i = 0; i < static_cast<int>(BinaryOp::COUNT); i++) {
+        auto op = static_cast<BinaryOp>(i);
+        expect_identical([&](auto& values) {
+            apply(op, values.data(), src.data(), values.size());
+        });
+        expect_identical([&](auto& values) {
+            apply(op, values.data(), 0.25f, values.size());
+        });
+    }
+}
+
+TEST(HeightmapKernels, UnaryOpsAndMix) {
+    auto src = random_values(COUNT, 3);
+    auto t = random_values(COUNT, 4);
+    expect_identical([&](auto& values) {
+        abs(values.data(), values.size());
+    });
+    expect_identical([&](auto& values) {
+        mix(values.data(), src.data(), t.data(), values.size());
+    });
+    expect_identical([&](auto& values) {
+        mix(values.data(), src.data(), 0.3f, values.size());
+    });
+    expect_identical([&](auto& values) {
+        mix(values.data(), 0.7f, t.data(), values.size());
+    });
+    expect_identical([&](auto& values) {
+        mix(values.data(), 0.7f, 0.3f, values.size());
+    });
+}
+
+TEST(HeightmapKernels, Noise) {
+    auto xs = random_values(COUNT, 5);
+    auto ys = random_values(COUNT, 6);
+    for (size_t i = 0; i < COUNT; i++) {
+        xs[i] *= 5000.0f;
+        ys[i] *= 5000.0f;
+    }
+    std::vector<fnl_state> states;
+    auto state = fnlCreateState();
+    state.seed = 42;
+    states.push_back(state);
+
+    state.noise_type = FNL_NOISE_CELLULAR;
+    states.push_back(state);
+    state.cellular_distance_func = FNL_CELLULAR_DISTANCE_EUCLIDEAN;
+    for (auto returnType : {
+             FNL_CELLULAR_RETURN_VALUE_CELLVALUE,
+             FNL_CELLULAR_RETURN_VALUE_DISTANCE2ADD,
+             FNL_CELLULAR_RETURN_VALUE_DISTANCE2DIV,
+         }) {
+        state.cellular_return_type = returnType;
+        states.push_back(state);
+    }
+    for (auto& state : states) {
+        std::vector<float> expected(COUNT);
+        for (size_t i = 0; i < COUNT; i++) {
+            expected[i] = fnlGetNoise2D(&state, xs[i], ys[i]);
+        }
+        expect_identical([&](auto& values) {
+            noise(state, xs.data(), ys.data(), values.data(), values.size());
+            EXPECT_TRUE(equal_bits(expected, values));
+        });
+    }
+}
+
+TEST(HeightmapKernels, InterpolateCubic) {
+    auto a = random_values(COUNT, 7);
+    auto b = random_values(COUNT, 8);
+    auto c = random_values(COUNT, 9);
+    auto d = random_values(COUNT, 10);
+    const float* rows[4] {a.data(), b.data(), c.data(), d.data()};
+    expect_identical([&](auto& values) {
+        interpolate_cubic(rows, 0.37f, values.data(), values.size());
+    });
+}
+
+/// @brief Micro-benchmark of heightmap operations on 256x256 maps.
+TEST(HeightmapKernels, DISABLED_Benchmark) {
+    using namespace std::chrono;
+
+    constexpr uint SIZE = 256;
+    constexpr int ITERATIONS = 50;
+
+    auto original = get_instruction_set();
+    auto src = random_values(SIZE * SIZE, 11);
+    auto xs = random_values(SIZE * SIZE, 12);
+    auto ys = random_values(SIZE * SIZE, 13);
+    auto state = fnlCreateState();
+
+    std::vector<std::pair<std::string, std::function<void(float*)>>> ops {
+        {"add", [&](float* dst) {
+            apply(BinaryOp::ADD, dst, src.data(), src.size());
+        }},
+        {"mul", [&](float* dst) {
+            apply(BinaryOp::MUL, dst, 0.5f, src.size());
+        }},
+        {"min", [&](float* dst) {
+            apply(BinaryOp::MIN, dst, src.data(), src.size());
+        }},
+        {"max", [&](float* dst) {
+            apply(BinaryOp::MAX, dst, src.data(), src.size());
+        }},
+        {"pow", [&](float* dst) {
+            apply(BinaryOp::POW, dst, 2.0f, src.size());
+        }},
+        {"abs", [&](float* dst) {
+            abs(dst, src.size());
+        }},
+        {"mixin", [&](float* dst) {
+            mix(dst, src.data(), 0.5f, src.size());
+        }},
+        {"noise", [&](float* dst) {
+            state.noise_type = FNL_NOISE_OPENSIMPLEX2;
+            noise(state, xs.data(), ys.data(), dst, src.size());
+        }},
+        {"cellnoise", [&](float* dst) {
+            state.noise_type = FNL_NOISE_CELLULAR;
+            noise(state, xs.data(), ys.data(), dst, src.size());
+        }},
+        {"resize", [&](float*) {
+            Heightmap map(
+                SIZE / 4, SIZE / 4, random_values(SIZE * SIZE / 16, 14)
+            );
+            map.resize(SIZE, SIZE, InterpolationType::CUBIC);
+        }},
+    };
+    for (auto set : {
+             InstructionSet::SCALAR,
+             InstructionSet::SSE41,
+             InstructionSet::AVX2,
+         }) {
+        if (!set_instruction_set(set)) {
+            continue;
+        }
+        for (const auto& [name, op] : ops) {
+            auto values = random_values(SIZE * SIZE, 15);
+            auto begin = high_resolution_clock::now();
+            for (int i = 0; i < ITERATIONS; i++) {
+                op(values.data());
+            }
+            auto mcs = duration_cast<microseconds>(
+                high_resolution_clock::now() - begin
+            ).count();
+            std::cout << to_string(set) << " " << name << ": "
+                      << mcs / ITERATIONS << " mcs" << std::endl;
+        }
+    }
+    set_instruction_set(original);
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "network/Network.hpp"
+
+using namespace network;
+using namespace std::chrono;
+
+/// @brief Clients connected to a loopback server
+class Loopback {
+    std::mutex mutex;
+    std::vector<u64id_t> accepted;
+    std::atomic<size_t> connected = 0;
+public:
+    std::unique_ptr<Network> network;
+    u64id_t server;
+    std::vector<u64id_t> clients;
+
+    Loopback(int port, size_t count)
+        : network(Network::create(NetworkSettings {})) {
+        server = network->openServer(port, [this](u64id_t id) {
+            std::lock_guard lock(mutex);
+            accepted.push_back(id);
+        });
+        for (size_t i = 0; i < count; i++) {
+            clients.push_back(network->connect(
+                "127.0.0.1", port, [this](u64id_t) { connected++; }
+            ));
+        }
+        auto deadline = steady_clock::now() + seconds(10);
+        while (getAccepted().size() < count || connected < count) {
+            if (steady_clock::now() > deadline) {
+                throw std::runtime_error("connection timeout");
+            }
+            std::this_thread::sleep_for(milliseconds(1));
+        }
+    }
+
+    std::vector<u64id_t> getAccepted() {
+        std::lock_guard lock(mutex);
+        return accepted;
+    }
+
+    /// @brief Send all data received by server connections back
+    void echo(const std::vector<u64id_t>& connections) {
+        char buffer[16'384];
+        for (u64id_t id : connections) {
+            auto connection = network->getConnection(id);
+            int size = connection->recv(buffer, sizeof(buffer));
+            if (size > 0) {
+                connection->send(buffer, size);
+            }
+        }
+    }
+
+    /// @brief Send message from every client and wait for all echoes
+    void roundtrip(const std::string& message) {
+        auto accepted = getAccepted();
+        for (u64id_t id : clients) {
+            network->getConnection(id)->send(message.data(), message.size());
+        }
+        std::vector<std::string> received(clients.size());
+        size_t done = 0;
+        char buffer[16'384];
+        auto deadline = steady_clock::now() + seconds(30);
+        while (done < clients.size()) {
+            if (steady_clock::now() > deadline) {
+                throw std::runtime_error("echo timeout");
+            }
+            echo(accepted);
+            for (size_t i = 0; i < clients.size(); i++) {
+                auto connection = network->getConnection(clients[i]);
+                int size = connection->recv(buffer, sizeof(buffer));
+                if (size <= 0) {
+                    continue;
+                }
+                received[i].append(buffer, size);
+                if (received[i].size() == message.size()) {
+                    EXPECT_EQ(received[i], message);
+                    done++;
+                }
+            }
+        }
+    }
+};
+
+TEST(sockets, Loopback) {
+    Loopback loopback(47100, 4);
+    loopback.roundtrip("hello");
+
+    // larger than socket buffers, partially queued by the sender
+    std::string message(4 * 1024 * 1024, 0);
+    for (size_t i = 0; i < message.size(); i++) {
+        message[i] = static_cast<char>(i * 31 + i / 7);
+    }
+    loopback.roundtrip(message);
+
+    auto client = loopback.network->getConnection(loopback.clients[0]);
+    client->close();
+    EXPECT_EQ(client->getState(), ConnectionState::CLOSED);
+    loopback.network->getServer(loopback.server)->close();
+}
+
+/// @brief Measures round trip latency of small messages and echo throughput
+/// for different connections numbers.
+TEST(sockets, DISABLED_Benchmark) {
+#ifndef _WIN32
+    // each connection uses two descriptors
+    rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = std::min<rlim_t>(limit.rlim_max, 4096);
+    setrlimit(RLIMIT_NOFILE, &limit);
+#endif
+    int port = 47200;
+    for (size_t count : {1, 100, 1000}) {
+        Loopback loopback(port++, count);
+
+        const int rounds = 50;
+        std::string small(64, 'x');
+        auto begin = steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            loopback.roundtrip(small);
+        }
+        auto latency = (steady_clock::now() - begin) / rounds;
+
+        // 64 MiB in total
+        std::string large(64 * 1024 * 1024 / count, 'y');
+        begin = steady_clock::now();
+        loopback.roundtrip(large);
+        double time = duration<double>(steady_clock::now() - begin).count();
+
+        std::cout << count << " connections: round trip "
+                  << duration_cast<microseconds>(latency).count()
+                  << " mcs, echo "
+                  << large.size() * count / time / 1024 / 1024 << " MiB/s"
+                  << std::endl;
+        loopback.network->getServer(loopback.server)->close();
+    }
+}
@@ -0,0 +1,244 @@
+#include "physics/PhysicsSolver.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+inline constexpr float DELTA = 1.0f / 60.0f;
+inline constexpr uint SUBSTEPS = 2;
+static const glm::vec3 GRAVITY(0.0f, -22.6f, 0.0f);
+
+/// @brief Voxel boxes in absolute coordinates, one box per voxel
+class TestWorld {
+    std::unordered_map<glm::ivec3, AABB> voxels;
+public:
+    void fill(glm::ivec3 min, glm::ivec3 max, const AABB& box = AABB()) {
+        for (int y = min.y; y <= max.y; y++) {
+            for (int z = min.z; z <= max.z; z++) {
+                for (int x = min.x; x <= max.x; x++) {
+                    glm::vec3 pos(x, y, z);
+                    voxels[{x, y, z}] = AABB(pos + box.a, pos + box.b);
+                }
+            }
+        }
+    }
+
+    const AABB* obstacleAt(const glm::vec3& point) const {
+        const auto& found = voxels.find(glm::ivec3(glm::floor(point)));
+        if (found == voxels.end() || !found->second.contains(point)) {
+            return nullptr;
+        }
+        return &found->second;
+    }
+
+    /// @brief Collect boxes the way the solver does before every step
+    void collect(const Hitbox& hitbox, std::vector<AABB>& dst) const {
+        glm::vec3 travel =
+            (glm::abs(hitbox.velocity) + glm::abs(GRAVITY) * DELTA) * DELTA;
+        glm::ivec3 min = glm::floor(hitbox.getAABB().min() - travel - 1.0f);
+        glm::ivec3 max = glm::floor(hitbox.getAABB().max() + travel + 1.0f);
+        dst.clear();
+        for (int y = min.y; y <= max.y; y++) {
+            for (int z = min.z; z <= max.z; z++) {
+                for (int x = min.x; x <= max.x; x++) {
+                    const auto& found = voxels.find({x, y, z});
+                    if (found != voxels.end()) {
+                        dst.push_back(found->second);
+                    }
+                }
+            }
+        }
+    }
+};
+
+static void simulate(
+    const PhysicsSolver& solver,
+    const TestWorld& world,
+    Hitbox& hitbox,
+    int frames
+) {
+    std::vector<AABB> obstacles;
+    for (int i = 0; i < frames; i++) {
+        world.collect(hitbox, obstacles);
+        solver.step(obstacles, hitbox, DELTA, SUBSTEPS);
+        hitbox.linearDamping = hitbox.grounded * 24;
+    }
+}
+
+TEST(PhysicsSolver, Landing) {
+    PhysicsSolver solver(GRAVITY);
+    TestWorld world;
+    world.fill({-4, 0, -4}, {4, 0, 4});
+
+    Hitbox hitbox(BodyType::DYNAMIC, {0.5f, 10.0f, 0.5f}, {0.3f, 0.9f, 0.3f});
+    simulate(solver, world, hitbox, 120);
+    EXPECT_TRUE(hitbox.grounded);
+    EXPECT_NEAR(hitbox.position.y, 1.9f, 1e-4f);
+    EXPECT_EQ(hitbox.velocity.y, 0.0f);
+}
+
+TEST(PhysicsSolver, NoTunnelling) {
+    PhysicsSolver solver(GRAVITY);
+    TestWorld world;
+    // thin wall
+    world.fill({5, -2, -2}, {5, 2, 2}, AABB({0.0f}, {0.1f, 1.0f, 1.0f}));
+
+    Hitbox hitbox(BodyType::DYNAMIC, {0.0f, 0.5f, 0.5f}, {0.3f, 0.3f, 0.3f});
+    hitbox.gravityScale = 0.0f;
+    hitbox.velocity = {600.0f, 0.0f, 0.0f};
+    simulate(solver, world, hitbox, 2);
+    EXPECT_NEAR(hitbox.position.x, 4.7f, 1e-4f);
+    EXPECT_EQ(hitbox.velocity.x, 0.0f);
+}
+
+TEST(PhysicsSolver, Steps) {
+    PhysicsSolver solver(GRAVITY);
+    TestWorld world;
+    world.fill({-4, 0, -4}, {8, 0, 4});
+    // slabs may be walked on, walls may not
+    world.fill({2, 1, -4}, {4, 1, 4}, AABB({1.0f, 0.5f, 1.0f}));
+    world.fill({5, 1, -4}, {5, 2, 4});
+
+    Hitbox hitbox(BodyType::DYNAMIC, {0.5f, 1.9f, 0.5f}, {0.3f, 0.9f, 0.3f});
+    hitbox.grounded = true;
+    for (int i = 0; i < 240; i++) {
+        hitbox.velocity.x = 4.0f;
+        simulate(solver, world, hitbox, 1);
+    }
+    EXPECT_NEAR(hitbox.position.x, 4.7f, 1e-4f);
+    EXPECT_NEAR(hitbox.position.y, 2.4f, 1e-4f);
+}
+
+TEST(PhysicsSolver, Crouching) {
+    PhysicsSolver solver(GRAVITY);
+    TestWorld world;
+    world.fill({-4, 0, -4}, {0, 0, 4});
+
+    Hitbox hitbox(BodyType::DYNAMIC, {0.0f, 1.9f, 0.5f}, {0.3f, 0.9f, 0.3f});
+    hitbox.grounded = true;
+    hitbox.crouching = true;
+    for (int i = 0; i < 60; i++) {
+        hitbox.velocity.x = 4.0f;
+        simulate(solver, world, hitbox, 1);
+    }
+    EXPECT_TRUE(hitbox.grounded);
+    EXPECT_NEAR(hitbox.position.y, 1.9f, 1e-4f);
+    EXPECT_LT(hitbox.position.x, 1.3f);
+}
+
+/// @brief Point sampling solver used before swept collisions, without steps
+/// and crouching
+static void legacy_step(
+    const TestWorld& world, Hitbox& hitbox, float delta, uint substeps
+) {
+    constexpr float E = 0.03f;
+    constexpr float MAX_FIX = 0.1f;
+    constexpr float s = 2.0f / 16;
+    float dt = delta / static_cast<float>(substeps);
+    const glm::vec3& half = hitbox.halfsize;
+    glm::vec3& pos = hitbox.position;
+    glm::vec3& vel = hitbox.velocity;
+    hitbox.grounded = false;
+    for (uint i = 0; i < substeps; i++) {
+        vel += GRAVITY * dt * hitbox.gravityScale;
+        for (int nx = 0; nx < 3; nx++) {
+            int ny = nx == 1 ? 0 : 1;
+            int nz = nx == 2 ? 0 : 2;
+            if (vel[nx] == 0.0f) {
+                continue;
+            }
+            float side = vel[nx] < 0.0f ? -1.0f : 1.0f;
+            bool collided = false;
+            for (int iy = 0; iy <= (half[ny] - E) * 2 / s && !collided; iy++) {
+                for (int iz = 0; iz <= (half[nz] - E) * 2 / s; iz++) {
+                    glm::vec3 coord;
+                    coord[ny] = pos[ny] - half[ny] + E + iy * s;
+                    coord[nz] = pos[nz] - half[nz] + E + iz * s;
+                    coord[nx] = pos[nx] + side * (half[nx] + E);
+                    if (auto aabb = world.obstacleAt(coord)) {
+                        vel[nx] = 0.0f;
+                        float fixed = side < 0.0f ? aabb->b[nx] + half[nx] + E
+                                                  : aabb->a[nx] - half[nx] - E;
+                        if (std::abs(fixed - pos[nx]) <= MAX_FIX) {
+                            pos[nx] = fixed;
+                        }
+                        hitbox.grounded |= nx == 1 && side < 0.0f;
+                        collided = true;
+                        break;
+                    }
+                }
+            }
+        }
+        vel.x *= glm::max(0.0f, 1.0f - dt * hitbox.linearDamping);
+        vel.z *= glm::max(0.0f, 1.0f - dt * hitbox.linearDamping);
+        pos += vel * dt + GRAVITY * hitbox.gravityScale * dt * dt * 0.5f;
+    }
+}
+
+/// @brief Compares large and fast bodies thrown at a wall with the point
+/// sampling solver.
+TEST(PhysicsSolver, DISABLED_Benchmark) {
+    using namespace std::chrono;
+
+    PhysicsSolver solver(GRAVITY);
+    TestWorld world;
+    world.fill({-10, 0, -40}, {30, 0, 40});
+    world.fill({20, 1, -40}, {20, 12, 40});
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> size(0.2f, 2.0f);
+    std::uniform_real_distribution<float> speed(10.0f, 400.0f);
+    std::uniform_real_distribution<float> offset(-30.0f, 30.0f);
+    std::vector<Hitbox> bodies;
+    for (int i = 0; i < 1000; i++) {
+        glm::vec3 half(size(random), size(random), size(random));
+        bodies.emplace_back(
+            BodyType::DYNAMIC, glm::vec3(0.0f, 2.0f + half.y, offset(random)),
+            half
+        );
+        bodies.back().velocity = {speed(random), 0.0f, 0.0f};
+    }
+
+    auto count_tunnelled = [](const std::vector<Hitbox>& bodies) {
+        int count = 0;
+        for (const auto& body : bodies) {
+            count += body.position.x - body.halfsize.x > 20.5f ||
+                     body.position.y - body.halfsize.y < 0.5f;
+        }
+        return count;
+    };
+
+    auto legacyBodies = bodies;
+    auto begin = high_resolution_clock::now();
+    for (int frame = 0; frame < 60; frame++) {
+        for (auto& body : legacyBodies) {
+            float vel = glm::length(body.velocity);
+            int substeps = static_cast<int>(DELTA * vel * 20);
+            substeps = std::min(100, std::max(2, substeps));
+            legacy_step(world, body, DELTA, substeps);
+            body.linearDamping = body.grounded * 24;
+        }
+    }
+    auto legacyTime = high_resolution_clock::now() - begin;
+
+    auto sweptBodies = bodies;
+    begin = high_resolution_clock::now();
+    for (auto& body : sweptBodies) {
+        simulate(solver, world, body, 60);
+    }
+    auto sweptTime = high_resolution_clock::now() - begin;
+
+    int sweptTunnelled = count_tunnelled(sweptBodies);
+    EXPECT_EQ(sweptTunnelled, 0);
+    std::cout << bodies.size() << " bodies, 60 frames: point sampling "
+              << duration_cast<microseconds>(legacyTime).count() << " mcs, "
+              << count_tunnelled(legacyBodies) << " tunnelled; swept "
+              << duration_cast<microseconds>(sweptTime).count() << " mcs, "
+              << sweptTunnelled << " tunnelled" << std::endl;
+}
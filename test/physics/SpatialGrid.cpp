@@ -0,0 +1,150 @@
+#include "physics/SpatialGrid.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "maths/rays.hpp"
+
+static std::vector<AABB> random_boxes(size_t count, float range, int seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> position(-range, range);
+    std::uniform_real_distribution<float> size(0.2f, 3.0f);
+    std::vector<AABB> boxes;
+    for (size_t i = 0; i < count; i++) {
+        glm::vec3 pos(position(random), position(random), position(random));
+        glm::vec3 halfsize(size(random), size(random), size(random));
+        boxes.emplace_back(pos - halfsize, pos + halfsize);
+    }
+    return boxes;
+}
+
+static std::vector<size_t> query_sorted(
+    const SpatialGrid<size_t>& grid, const AABB& area
+) {
+    std::vector<size_t> found;
+    grid.query(area, [&found](size_t i) { found.push_back(i); });
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+TEST(SpatialGrid, Query) {
+    auto boxes = random_boxes(2000, 60.0f, 1);
+    SpatialGrid<size_t> grid(8.0f);
+    for (size_t i = 0; i < boxes.size(); i++) {
+        grid.set(i, boxes[i]);
+    }
+    // move half of the boxes and remove some
+    for (size_t i = 0; i < boxes.size(); i += 2) {
+        boxes[i] = boxes[i].translated(glm::vec3(13.0f, -7.0f, 2.5f));
+        grid.set(i, boxes[i]);
+    }
+    for (size_t i = 1; i < boxes.size(); i += 10) {
+        grid.remove(i);
+    }
+    EXPECT_EQ(grid.size(), boxes.size() - boxes.size() / 10);
+
+    auto areas = random_boxes(200, 70.0f, 2);
+    areas.emplace_back(glm::vec3(-500.0f), glm::vec3(500.0f));
+    for (auto& area : areas) {
+        std::vector<size_t> expected;
+        for (size_t i = 0; i < boxes.size(); i++) {
+            if (i % 10 != 1 && area.intersect(boxes[i])) {
+                expected.push_back(i);
+            }
+        }
+        auto found = query_sorted(grid, area);
+        // candidates must be unique and include all intersecting boxes
+        EXPECT_TRUE(std::adjacent_find(found.begin(), found.end()) ==
+                    found.end());
+        EXPECT_TRUE(std::includes(
+            found.begin(), found.end(), expected.begin(), expected.end()
+        ));
+    }
+}
+
+TEST(SpatialGrid, Raycast) {
+    auto boxes = random_boxes(3000, 80.0f, 3);
+    SpatialGrid<size_t> grid(8.0f);
+    for (size_t i = 0; i < boxes.size(); i++) {
+        grid.set(i, boxes[i]);
+    }
+    std::mt19937 random(4);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    for (int n = 0; n < 200; n++) {
+        glm::vec3 start(
+            distribution(random), distribution(random), distribution(random)
+        );
+        start *= 50.0f;
+        glm::vec3 dir = glm::normalize(glm::vec3(
+            distribution(random), distribution(random), distribution(random)
+        ));
+        if (n % 10 == 0) {
+            dir = glm::vec3(0.0f, 0.0f, 1.0f);
+        }
+        Ray ray(start, dir);
+        glm::ivec3 normal;
+        double distance;
+
+        float expected = 100.0f;
+        for (const auto& box : boxes) {
+            if (ray.intersectAABB({}, box, expected, normal, distance) >
+                RayRelation::None) {
+                expected = distance;
+            }
+        }
+        float found = 100.0f;
+        grid.raycast(start, dir, found, [&](size_t i) {
+            if (ray.intersectAABB({}, boxes[i], found, normal, distance) >
+                RayRelation::None) {
+                found = distance;
+            }
+            return found;
+        });
+        EXPECT_EQ(expected, found);
+    }
+}
+
+/// @brief Compares sensor-like queries of every box with brute force.
+TEST(SpatialGrid, DISABLED_Benchmark) {
+    using namespace std::chrono;
+
+    for (size_t count : {1000, 10000, 50000}) {
+        // keep density of entities
+        float range = 40.0f * std::cbrt(count / 1000.0f);
+        auto boxes = random_boxes(count, range, 5);
+        auto areas = random_boxes(1000, range, 6);
+
+        auto begin = high_resolution_clock::now();
+        SpatialGrid<size_t> grid(8.0f);
+        for (size_t i = 0; i < boxes.size(); i++) {
+            grid.set(i, boxes[i]);
+        }
+        size_t gridFound = 0;
+        for (auto& area : areas) {
+            grid.query(area, [&](size_t i) {
+                gridFound += area.intersect(boxes[i]);
+            });
+        }
+        auto gridTime = high_resolution_clock::now() - begin;
+
+        begin = high_resolution_clock::now();
+        size_t bruteFound = 0;
+        for (auto& area : areas) {
+            for (const auto& box : boxes) {
+                bruteFound += area.intersect(box);
+            }
+        }
+        auto bruteTime = high_resolution_clock::now() - begin;
+
+        EXPECT_EQ(gridFound, bruteFound);
+        std::cout << count << " boxes, 1000 queries: grid "
+                  << duration_cast<microseconds>(gridTime).count()
+                  << " mcs (including build), brute force "
+                  << duration_cast<microseconds>(bruteTime).count() << " mcs"
+                  << std::endl;
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "content/Content.hpp"
+#include "content/ContentBuilder.hpp"
+#include "core_defs.hpp"
+#include "items/ItemDef.hpp"
+#include "objects/rigging.hpp"
+#include "voxels/Block.hpp"
+
+/// @brief Build test content of core:air defined as the core content does
+/// and full cube blocks
+/// @param blocks names of blocks following core:air
+/// @param setup called for every created block except core:air
+inline std::unique_ptr<Content> create_test_content(
+    const std::vector<std::string>& blocks,
+    const std::function<void(Block&)>& setup = nullptr
+) {
+    ContentBuilder builder;
+    builder.items.create(CORE_EMPTY);
+    {
+        Block& block = builder.blocks.create(CORE_AIR);
+        block.replaceable = true;
+        block.drawGroup = 1;
+        block.lightPassing = true;
+        block.skyLightPassing = true;
+        block.obstacle = false;
+        block.selectable = false;
+        block.model = BlockModel::none;
+        block.pickingItem = CORE_EMPTY;
+    }
+    for (const auto& name : blocks) {
+        Block& block = builder.blocks.create(name);
+        block.pickingItem = CORE_EMPTY;
+        if (setup) {
+            setup(block);
+        }
+    }
+    return builder.build();
+}
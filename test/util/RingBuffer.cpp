@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <random>
+
+#include "util/RingBuffer.hpp"
+
+using namespace util;
+
+TEST(RingBuffer, MatchesDeque) {
+    RingBuffer<char> ring(8);
+    std::deque<char> expected;
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> sizes(0, 40);
+    char next = 0;
+    char buffer[64];
+    for (int i = 0; i < 2000; i++) {
+        int count = sizes(random);
+        if (random() % 2) {
+            for (int j = 0; j < count; j++) {
+                buffer[j] = next;
+                expected.push_back(next++);
+            }
+            ring.write(buffer, count);
+        } else {
+            size_t read = ring.read(buffer, count);
+            ASSERT_EQ(read, std::min<size_t>(count, expected.size()));
+            for (size_t j = 0; j < read; j++) {
+                EXPECT_EQ(buffer[j], expected.front());
+                expected.pop_front();
+            }
+        }
+        ASSERT_EQ(ring.size(), expected.size());
+    }
+}
+
+TEST(RingBuffer, Spans) {
+    RingBuffer<char> ring(8);
+    ring.write("abcdef", 6);
+    ring.consume(4);
+    // free space wraps around the end
+    auto [dst, free] = ring.writable();
+    EXPECT_EQ(free, 2);
+    std::memcpy(dst, "gh", 2);
+    ring.commit(2);
+    std::tie(dst, free) = ring.writable();
+    EXPECT_EQ(free, 4);
+    std::memcpy(dst, "ij", 2);
+    ring.commit(2);
+
+    auto [src, available] = ring.readable();
+    EXPECT_EQ(std::string(src, available), "efgh");
+    ring.consume(available);
+    std::tie(src, available) = ring.readable();
+    EXPECT_EQ(std::string(src, available), "ij");
+    EXPECT_EQ(ring.capacity(), 8);
+}
@@ -1,14 +1,29 @@
 #include <gtest/gtest.h>
 
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include "../test_content.hpp"
+#include "content/Content.hpp"
+#include "core_defs.hpp"
+#include "io/devices/StdfsDevice.hpp"
+#include "io/io.hpp"
+#include "voxels/Block.hpp"
 #include "voxels/Chunk.hpp"
+#include "world/files/WorldRegions.hpp"
 
 TEST(Chunk, EncodeDecode) {
     Chunk chunk1(0, 0);
     for (uint i = 0; i < CHUNK_VOL; i++) {
-        chunk1.voxels[i].id = rand();
-        chunk1.voxels[i].state.rotation = rand();
-        chunk1.voxels[i].state.segment = rand();
-        chunk1.voxels[i].state.userbits = rand();
+        voxel& vox = chunk1.voxels.edit(i);
+        vox.id = rand();
+        vox.state.rotation = rand();
+        vox.state.segment = rand();
+        vox.state.userbits = rand();
     }
     auto bytes = chunk1.encode();
 
@@ -18,8 +33,193 @@ TEST(Chunk, EncodeDecode) {
     for (uint i = 0; i < CHUNK_VOL; i++) {
         EXPECT_EQ(chunk1.voxels[i].id, chunk2.voxels[i].id);
         EXPECT_EQ(
-            blockstate2int(chunk1.voxels[i].state), 
+            blockstate2int(chunk1.voxels[i].state),
             blockstate2int(chunk2.voxels[i].state)
         );
     }
 }
+
+/// @brief Generate terrain with ores and sky lights
+static void generate(voxel* voxels, light_t* lights) {
+    for (int z = 0; z < CHUNK_D; z++) {
+        for (int x = 0; x < CHUNK_W; x++) {
+            int height =
+                60 + 8 * std::sin(x * 0.3f) + 5 * std::cos(z * 0.2f);
+            for (int y = 0; y < CHUNK_H; y++) {
+                uint index = vox_index(x, y, z);
+                voxel& vox = voxels[index];
+                vox = {};
+                if (y < height - 4) {
+                    vox.id = rand() % 40 == 0 ? 4 + rand() % 3 : 1;
+                } else if (y < height) {
+                    vox.id = 2;
+                    vox.state.rotation = rand() % 4;
+                }
+                lights[index] =
+                    y < height ? 0 : Lightmap::combine(0, 0, 0, 15);
+            }
+        }
+    }
+}
+
+static uint count_mismatches(const Chunk& chunk, const voxel* expected) {
+    uint mismatches = 0;
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        mismatches += chunk.voxels[i].id != expected[i].id ||
+                      blockstate2int(chunk.voxels[i].state) !=
+                          blockstate2int(expected[i].state);
+    }
+    return mismatches;
+}
+
+TEST(Chunk, CompactStorage) {
+    auto voxels = std::make_unique<voxel[]>(CHUNK_VOL);
+    auto lights = std::make_unique<light_t[]>(CHUNK_VOL);
+    generate(voxels.get(), lights.get());
+
+    Chunk chunk(0, 0);
+    chunk.voxels.assign(voxels.get());
+    chunk.lightmap.set(lights.get());
+    size_t denseSize = chunk.getMemoryUsage();
+    chunk.compact();
+    EXPECT_LT(chunk.getMemoryUsage() * 4, denseSize);
+    EXPECT_EQ(count_mismatches(chunk, voxels.get()), 0);
+
+    uint mismatches = 0;
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        mismatches += chunk.lightmap.get(i) != lights[i];
+    }
+    EXPECT_EQ(mismatches, 0);
+
+    // only edited section is expanded
+    uint index = vox_index(3, 40, 5);
+    chunk.voxels.edit(index).id = 7;
+    voxels[index].id = 7;
+    for (uint i = 0; i < CHUNK_SECTIONS; i++) {
+        EXPECT_EQ(chunk.voxels.isPacked(i), i != 40 / CHUNK_SECTION_H);
+    }
+    EXPECT_EQ(count_mismatches(chunk, voxels.get()), 0);
+
+    chunk.compact();
+    EXPECT_TRUE(chunk.voxels.isPacked(40 / CHUNK_SECTION_H));
+    EXPECT_EQ(count_mismatches(chunk, voxels.get()), 0);
+
+    auto copy = std::make_unique<voxel[]>(CHUNK_VOL);
+    chunk.voxels.copyTo(copy.get());
+    EXPECT_EQ(
+        std::memcmp(copy.get(), voxels.get(), CHUNK_VOL * sizeof(voxel)), 0
+    );
+}
+
+TEST(Chunk, ReleasePackedData) {
+    auto voxels = std::make_unique<voxel[]>(CHUNK_VOL);
+    auto lights = std::make_unique<light_t[]>(CHUNK_VOL);
+    generate(voxels.get(), lights.get());
+
+    Chunk chunk(0, 0);
+    chunk.voxels.assign(voxels.get());
+    chunk.compact();
+    size_t packedSize = chunk.voxels.getMemoryUsage();
+    size_t sectionSize = CHUNK_SECTION_VOL * sizeof(voxel);
+
+    // packed data is in use by reader
+    uint index = vox_index(3, 40, 5);
+    {
+        PalettedVoxels::ReadGuard guard(chunk.voxels);
+        chunk.voxels.edit(index).id = 7;
+        voxels[index].id = 7;
+        EXPECT_EQ(chunk.voxels.getMemoryUsage(), packedSize + sectionSize);
+    }
+    // released on the next expansion having no readers
+    index = vox_index(3, 50, 5);
+    chunk.voxels.edit(index).id = 7;
+    voxels[index].id = 7;
+    EXPECT_LT(chunk.voxels.getMemoryUsage(), packedSize + sectionSize * 2);
+    EXPECT_EQ(count_mismatches(chunk, voxels.get()), 0);
+
+    chunk.compact();
+    EXPECT_EQ(count_mismatches(chunk, voxels.get()), 0);
+}
+
+TEST(Chunk, SectionOccupancy) {
+    auto content = create_test_content(
+        {"test:stone", "test:grass"},
+        [](Block& block) {
+            if (block.name == "test:grass") {
+                block.model = BlockModel::xsprite;
+            }
+        }
+    );
+    const auto& stone = content->blocks.require("test:stone");
+    const auto& grass = content->blocks.require("test:grass");
+
+    Chunk chunk(0, 0);
+    for (uint i = 0; i < CHUNK_SECTION_VOL * 2; i++) {
+        chunk.voxels.edit(i).id = stone.rt.id;
+    }
+    chunk.voxels.edit(CHUNK_SECTION_VOL * 2 - 1).id = grass.rt.id;
+    chunk.updateOccupancy(*content->getIndices());
+
+    EXPECT_EQ(chunk.occupancy[0], SectionOccupancy::SOLID);
+    EXPECT_EQ(chunk.occupancy[1], SectionOccupancy::MIXED);
+    EXPECT_EQ(chunk.occupancy[2], SectionOccupancy::EMPTY);
+
+    chunk.updateOccupancy(5, stone);
+    EXPECT_EQ(chunk.occupancy[0], SectionOccupancy::SOLID);
+    chunk.updateOccupancy(CHUNK_SECTION_VOL * 2, content->blocks.require(CORE_AIR));
+    EXPECT_EQ(chunk.occupancy[2], SectionOccupancy::EMPTY);
+    chunk.updateOccupancy(CHUNK_SECTION_VOL * 3, grass);
+    EXPECT_EQ(chunk.occupancy[3], SectionOccupancy::MIXED);
+
+    chunk.decode(chunk.encode().get());
+    EXPECT_EQ(chunk.occupancy[0], SectionOccupancy::MIXED);
+}
+
+/// @brief Measures memory of chunks loaded from the saved world directory
+/// set by WORLD_DIR environment variable
+TEST(Chunk, DISABLED_MemoryBenchmark) {
+    const char* directory = std::getenv("WORLD_DIR");
+    if (directory == nullptr) {
+        GTEST_SKIP() << "WORLD_DIR is not set";
+    }
+    io::set_device("bench", std::make_shared<io::StdfsDevice>(directory));
+    WorldRegions regions(io::path("bench:"));
+
+    size_t chunksCount = 0;
+    size_t denseSize = 0;
+    size_t compactSize = 0;
+    auto regionsDir = std::filesystem::path(directory) / "regions";
+    for (const auto& entry :
+         std::filesystem::directory_iterator(regionsDir)) {
+        int regionX, regionZ;
+        if (std::sscanf(
+                entry.path().filename().u8string().c_str(),
+                "%d_%d.bin",
+                &regionX,
+                &regionZ
+            ) != 2) {
+            continue;
+        }
+        for (int i = 0; i < REGION_CHUNKS_COUNT; i++) {
+            int x = regionX * REGION_SIZE + i % REGION_SIZE;
+            int z = regionZ * REGION_SIZE + i / REGION_SIZE;
+            auto data = regions.getVoxels(x, z);
+            if (data == nullptr) {
+                continue;
+            }
+            Chunk chunk(x, z);
+            chunk.decode(data.get());
+            if (auto lights = regions.getLights(x, z)) {
+                chunk.lightmap.set(lights.get());
+            }
+            chunksCount++;
+            denseSize += CHUNK_VOL * (sizeof(voxel) + sizeof(light_t));
+            chunk.compact();
+            compactSize += chunk.getMemoryUsage();
+        }
+    }
+    ASSERT_GT(chunksCount, 0);
+    std::cout << chunksCount << " chunks, bytes per chunk: dense "
+              << denseSize / chunksCount << ", compact "
+              << compactSize / chunksCount << std::endl;
+}
@@ -0,0 +1,135 @@
+#include "voxels/ChunksLoadQueue.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+
+static int distance(int index, int width, int height) {
+    int lx = index % width - width / 2;
+    int lz = index / width - height / 2;
+    return lx * lx + lz * lz;
+}
+
+TEST(ChunksLoadQueue, Order) {
+    const int width = 20;
+    const int height = 16;
+    const uint padding = 2;
+    ChunksLoadQueue queue;
+    queue.configure(width, height, padding);
+
+    std::vector<bool> visited(width * height);
+    int prevDistance = 0;
+    int count = 0;
+    for (int index = queue.current(); index != -1;
+         queue.next(), index = queue.current()) {
+        int x = index % width;
+        int z = index / width;
+        EXPECT_TRUE(x >= 2 && z >= 2 && x < width - 2 && z < height - 2);
+        EXPECT_FALSE(visited[index]);
+        EXPECT_GE(distance(index, width, height), prevDistance);
+        prevDistance = distance(index, width, height);
+        visited[index] = true;
+        count++;
+    }
+    EXPECT_EQ(count, (width - 4) * (height - 4));
+}
+
+TEST(ChunksLoadQueue, Rewind) {
+    const int width = 16;
+    ChunksLoadQueue queue;
+    queue.configure(width, width, 1);
+    while (queue.current() != -1) {
+        queue.next();
+    }
+    // neighbour closest to the center is processed first
+    queue.onChanged(12, 8);
+    EXPECT_EQ(queue.current(), 8 * width + 11);
+    queue.next();
+    // slots farther than the cursor are not rewound
+    int current = queue.current();
+    queue.onChanged(1, 1);
+    EXPECT_EQ(queue.current(), current);
+
+    queue.reset();
+    EXPECT_EQ(queue.current(), 8 * width + 8);
+}
+
+/// @brief Compares per tick scheduling overhead with the matrix scan
+/// performed for every processed chunk.
+TEST(ChunksLoadQueue, DISABLED_Benchmark) {
+    using namespace std::chrono;
+    // see ChunksController
+    const uint workPerTick = 128;
+    const uint padding = 2;
+
+    for (int loadDistance : {8, 16, 32, 64}) {
+        int size = (loadDistance + padding) * 2;
+        int maxDistance = loadDistance * loadDistance;
+
+        // nearest slot to load or -1
+        auto scan = [&](const std::vector<bool>& loaded) {
+            int nearest = -1;
+            int minDistance = maxDistance;
+            for (int z = padding; z < size - padding; z++) {
+                for (int x = padding; x < size - padding; x++) {
+                    int index = z * size + x;
+                    if (loaded[index]) {
+                        continue;
+                    }
+                    int d = distance(index, size, size);
+                    if (d < minDistance) {
+                        minDistance = d;
+                        nearest = index;
+                    }
+                }
+            }
+            return nearest;
+        };
+        std::vector<bool> loaded(size * size);
+        int ticks = 0;
+        auto begin = high_resolution_clock::now();
+        for (bool done = false; !done; ticks++) {
+            for (uint i = 0; i < workPerTick; i++) {
+                int index = scan(loaded);
+                if (index == -1) {
+                    done = true;
+                    break;
+                }
+                loaded[index] = true;
+            }
+        }
+        auto scanTime = high_resolution_clock::now() - begin;
+
+        ChunksLoadQueue queue;
+        std::vector<bool> queueLoaded(size * size);
+        begin = high_resolution_clock::now();
+        for (bool done = false; !done;) {
+            queue.configure(size, size, padding);
+            for (uint i = 0; i < workPerTick; i++) {
+                int index = queue.current();
+                for (; index != -1; queue.next(), index = queue.current()) {
+                    if (!queueLoaded[index] &&
+                        distance(index, size, size) < maxDistance) {
+                        break;
+                    }
+                }
+                if (index == -1) {
+                    done = true;
+                    break;
+                }
+                queueLoaded[index] = true;
+                queue.onChanged(index % size, index / size);
+            }
+        }
+        auto queueTime = high_resolution_clock::now() - begin;
+
+        EXPECT_EQ(loaded, queueLoaded);
+        std::cout << "load distance " << loadDistance << ", " << ticks
+                  << " ticks: scan "
+                  << duration_cast<microseconds>(scanTime).count() / ticks
+                  << " mcs/tick, queue "
+                  << duration_cast<microseconds>(queueTime).count() / ticks
+                  << " mcs/tick" << std::endl;
+    }
+}
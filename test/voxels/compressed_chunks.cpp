@@ -0,0 +1,290 @@
+#include "voxels/compressed_chunks.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include "../test_content.hpp"
+#include "io/devices/StdfsDevice.hpp"
+#include "io/io.hpp"
+#include "world/files/WorldRegions.hpp"
+
+namespace fs = std::filesystem;
+
+/// @brief Generate terrain with ores and sky lights
+static void generate(Chunk& chunk, int seed) {
+    std::mt19937 random(seed);
+    for (int z = 0; z < CHUNK_D; z++) {
+        for (int x = 0; x < CHUNK_W; x++) {
+            int height = 60 + 8 * std::sin((x + seed) * 0.3f) +
+                         5 * std::cos((z + seed) * 0.2f);
+            for (int y = 0; y < CHUNK_H; y++) {
+                voxel& vox = chunk.voxels.edit(vox_index(x, y, z));
+                vox = {};
+                if (y < height - 4) {
+                    vox.id = random() % 40 == 0 ? 4 + random() % 3 : 1;
+                } else if (y < height) {
+                    vox.id = 2;
+                    vox.state.rotation = random() % 4;
+                }
+                chunk.lightmap.set(x, y, z, 3, y < height ? 0 : 15);
+            }
+        }
+    }
+    chunk.lightmap.set(vox_index(3, 70, 3), Lightmap::combine(7, 3, 1, 15));
+}
+
+/// @param lights compare sky lights passed with packets
+static bool equals(const Chunk& a, const Chunk& b, bool lights = false) {
+    for (uint i = 0; i < CHUNK_VOL; i++) {
+        if (a.voxels[i].id != b.voxels[i].id ||
+            blockstate2int(a.voxels[i].state) !=
+                blockstate2int(b.voxels[i].state) ||
+            (lights && Lightmap::extract(a.lightmap.get(i), 3) !=
+                           Lightmap::extract(b.lightmap.get(i), 3))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static const ContentIndices& get_indices() {
+    static auto content = create_test_content(
+        {"test:block1", "test:block2", "test:block3", "test:block4",
+         "test:block5", "test:block6", "test:block7"}
+    );
+    return *content->getIndices();
+}
+
+static void decode(Chunk& chunk, const std::vector<ubyte>& bytes) {
+    compressed_chunks::decode(
+        chunk, bytes.data(), bytes.size(), get_indices()
+    );
+}
+
+static WorldRegions& create_regions() {
+    auto root = fs::temp_directory_path() / "voxelengine_packets_test";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    io::set_device("packets", std::make_shared<io::StdfsDevice>(root));
+    static std::unique_ptr<WorldRegions> regions;
+    regions = std::make_unique<WorldRegions>(io::path("packets:world"));
+    return *regions;
+}
+
+/// @return true if packet voxels are passed on as stored in regions
+static bool is_stored(const std::vector<ubyte>& bytes) {
+    return bytes.at(0) & 0x10;
+}
+
+TEST(compressed_chunks, EncodeDecode) {
+    Chunk chunk(0, 0);
+    generate(chunk, 1);
+    auto bytes = compressed_chunks::encode(chunk);
+
+    Chunk decoded(0, 0);
+    decoded.flags.loadedLights = true;
+    decode(decoded, bytes);
+    EXPECT_TRUE(equals(chunk, decoded));
+    EXPECT_FALSE(decoded.flags.loadedLights);
+
+    bytes = compressed_chunks::encode(chunk, true);
+    decode(decoded, bytes);
+    EXPECT_TRUE(equals(chunk, decoded, true));
+    EXPECT_TRUE(decoded.flags.loadedLights);
+}
+
+TEST(compressed_chunks, StoredData) {
+    auto& regions = create_regions();
+    Chunk chunk(2, 3);
+    generate(chunk, 2);
+    chunk.flags.lighted = true;
+    chunk.setModifiedAndUnsaved();
+    regions.put(&chunk, {});
+
+    // unloaded chunk
+    auto bytes = compressed_chunks::encode(2, 3, nullptr, regions, true);
+    EXPECT_FALSE(is_stored(bytes));
+    Chunk decoded(2, 3);
+    decode(decoded, bytes);
+    EXPECT_TRUE(equals(chunk, decoded, true));
+    bytes = compressed_chunks::encode(2, 3, nullptr, regions, true, true);
+    EXPECT_TRUE(is_stored(bytes));
+    decode(decoded, bytes);
+    EXPECT_TRUE(equals(chunk, decoded, true));
+    EXPECT_TRUE(compressed_chunks::encode(5, 5, nullptr, regions, true)
+                    .empty());
+
+    // loaded chunk passes stored voxels on until modified if requested
+    chunk.flags.loaded = true;
+    chunk.flags.unsaved = false;
+    EXPECT_EQ(
+        compressed_chunks::encode(2, 3, &chunk, regions, false),
+        compressed_chunks::encode(chunk)
+    );
+    EXPECT_EQ(
+        compressed_chunks::encode(2, 3, &chunk, regions, false, true),
+        compressed_chunks::encode(2, 3, nullptr, regions, false, true)
+    );
+    chunk.voxels.edit(vox_index(1, 100, 1)).id = 3;
+    chunk.setModifiedAndUnsaved();
+    bytes = compressed_chunks::encode(2, 3, &chunk, regions, false, true);
+    EXPECT_FALSE(is_stored(bytes));
+    decode(decoded, bytes);
+    EXPECT_TRUE(equals(chunk, decoded));
+}
+
+TEST(compressed_chunks, Changes) {
+    Chunk chunk(0, 0);
+    generate(chunk, 3);
+    Chunk client(0, 0);
+    decode(client, compressed_chunks::encode(chunk));
+
+    std::vector<uint> changed;
+    for (int i = 0; i < 20; i++) {
+        uint index = vox_index(i % CHUNK_W, 50 + i, i / 3);
+        chunk.voxels.edit(index) = {static_cast<blockid_t>(i % 8), {}};
+        chunk.voxels.edit(index).state.userbits = i;
+        changed.push_back(index);
+    }
+    auto bytes = compressed_chunks::encode_changes(chunk, changed);
+    EXPECT_TRUE(compressed_chunks::is_changes(bytes.data(), bytes.size()));
+    auto changes =
+        compressed_chunks::decode_changes(bytes.data(), bytes.size());
+    EXPECT_EQ(changes.size(), changed.size());
+    EXPECT_FALSE(equals(chunk, client));
+    for (const auto& change : changes) {
+        client.voxels.edit(change.index) = change.vox;
+    }
+    EXPECT_TRUE(equals(chunk, client));
+    EXPECT_THROW(decode(client, bytes), std::runtime_error);
+
+    bytes.resize(bytes.size() - 1);
+    EXPECT_THROW(
+        compressed_chunks::decode_changes(bytes.data(), bytes.size()),
+        std::runtime_error
+    );
+}
+
+TEST(compressed_chunks, SaveChanges) {
+    auto& regions = create_regions();
+    Chunk chunk(0, 0);
+    generate(chunk, 4);
+    chunk.flags.lighted = true;
+    chunk.setModifiedAndUnsaved();
+    regions.put(&chunk, {});
+
+    uint index = vox_index(1, 90, 1);
+    chunk.voxels.edit(index).id = 5;
+    auto bytes = compressed_chunks::encode_changes(chunk, {index});
+    compressed_chunks::save(0, 0, bytes, regions, get_indices());
+
+    Chunk stored(0, 0);
+    stored.decode(regions.getVoxels(0, 0).get());
+    EXPECT_TRUE(equals(chunk, stored));
+
+    // batch having unknown block is not applied
+    uint unknown = vox_index(2, 90, 2);
+    chunk.voxels.edit(index).id = 6;
+    chunk.voxels.edit(unknown).id = 200;
+    bytes = compressed_chunks::encode_changes(chunk, {index, unknown});
+    EXPECT_THROW(
+        compressed_chunks::save(0, 0, bytes, regions, get_indices()),
+        std::runtime_error
+    );
+    stored.decode(regions.getVoxels(0, 0).get());
+    EXPECT_EQ(stored.voxels[index].id, 5);
+
+    std::vector<compressed_chunks::VoxelChange> changes {
+        {CHUNK_VOL, voxel {1, {}}}};
+    EXPECT_THROW(
+        compressed_chunks::check_changes(changes, get_indices()),
+        std::runtime_error
+    );
+}
+
+/// @brief Measures chunks encoding speed and packets size.
+TEST(compressed_chunks, DISABLED_Benchmark) {
+    using namespace std::chrono;
+
+    const int count = 256;
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    auto& regions = create_regions();
+    for (int i = 0; i < count; i++) {
+        chunks.push_back(std::make_unique<Chunk>(i % 16, i / 16));
+        generate(*chunks.back(), i);
+        chunks.back()->flags.lighted = true;
+        chunks.back()->setModifiedAndUnsaved();
+        regions.put(chunks.back().get(), {});
+        chunks.back()->flags.loaded = true;
+        chunks.back()->flags.unsaved = false;
+    }
+
+    auto report = [count](const char* name, auto time, size_t bytes) {
+        double seconds = duration<double>(time).count();
+        std::cout << name << ": " << static_cast<int>(count / seconds)
+                  << " chunks/s, " << bytes / count << " bytes per chunk"
+                  << std::endl;
+    };
+
+    auto begin = high_resolution_clock::now();
+    size_t bytes = 0;
+    for (const auto& chunk : chunks) {
+        bytes += compressed_chunks::encode(*chunk).size();
+    }
+    report("encode", high_resolution_clock::now() - begin, bytes);
+
+    begin = high_resolution_clock::now();
+    bytes = 0;
+    for (const auto& chunk : chunks) {
+        bytes += compressed_chunks::encode(*chunk, true).size();
+    }
+    report("encode with lights", high_resolution_clock::now() - begin, bytes);
+
+    const int threads = 4;
+    std::atomic<size_t> threadsBytes = 0;
+    std::vector<std::thread> workers;
+    begin = high_resolution_clock::now();
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            for (int i = t; i < count; i += threads) {
+                threadsBytes += compressed_chunks::encode(*chunks[i]).size();
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    report(
+        "encode (4 threads)", high_resolution_clock::now() - begin,
+        threadsBytes
+    );
+
+    begin = high_resolution_clock::now();
+    bytes = 0;
+    for (const auto& chunk : chunks) {
+        bytes += compressed_chunks::encode(
+            chunk->x, chunk->z, chunk.get(), regions, false, true
+        ).size();
+    }
+    report("stored voxels", high_resolution_clock::now() - begin, bytes);
+
+    std::vector<uint> changed;
+    for (uint i = 0; i < 64; i++) {
+        changed.push_back(i * 997 % CHUNK_VOL);
+    }
+    begin = high_resolution_clock::now();
+    bytes = 0;
+    for (const auto& chunk : chunks) {
+        bytes += compressed_chunks::encode_changes(*chunk, changed).size();
+    }
+    report(
+        "64 block changes", high_resolution_clock::now() - begin, bytes
+    );
+}
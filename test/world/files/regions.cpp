@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <atomic>
+#include <filesystem>
+#include <thread>
+
+#include "coders/byte_utils.hpp"
+#include "io/devices/StdfsDevice.hpp"
+#include "io/io.hpp"
+#include "world/files/WorldRegions.hpp"
+#include "world/files/compatibility.hpp"
+
+namespace fs = std::filesystem;
+
+static fs::path setup_world() {
+    auto root = fs::temp_directory_path() / "voxelengine_regions_test";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    io::set_device("regtest", std::make_shared<io::StdfsDevice>(root));
+    return root;
+}
+
+static std::unique_ptr<ubyte[]> generate_voxels(int seed) {
+    auto data = std::make_unique<ubyte[]>(CHUNK_DATA_LEN);
+    for (size_t i = 0; i < CHUNK_DATA_LEN; i++) {
+        data[i] = (i / 64 * 31 + seed) % 7;
+    }
+    return data;
+}
+
+static void put_voxels(WorldRegions& regions, int x, int z, int seed) {
+    regions.put(
+        x, z, REGION_LAYER_VOXELS, generate_voxels(seed), CHUNK_DATA_LEN
+    );
+}
+
+static bool check_voxels(WorldRegions& regions, int x, int z, int seed) {
+    auto data = regions.getVoxels(x, z);
+    auto expected = generate_voxels(seed);
+    return data &&
+           std::memcmp(data.get(), expected.get(), CHUNK_DATA_LEN) == 0;
+}
+
+TEST(Regions, InPlaceUpdate) {
+    auto root = setup_world();
+    auto file = root / "world/regions/0_0.bin";
+
+    WorldRegions regions(io::path("regtest:world"));
+    for (uint i = 0; i < REGION_SIZE; i++) {
+        put_voxels(regions, i, 0, i);
+    }
+    regions.writeAll();
+    size_t size = fs::file_size(file);
+    EXPECT_EQ(size % REGION_SECTOR_SIZE, 0);
+
+    // replaced chunk sectors are reused by the next writes
+    for (int i = 0; i < 10; i++) {
+        put_voxels(regions, 3, 0, 100 + i);
+        regions.writeAll();
+    }
+    EXPECT_LE(fs::file_size(file), size * 2);
+
+    WorldRegions reader(io::path("regtest:world"));
+    EXPECT_TRUE(check_voxels(reader, 3, 0, 109));
+    for (uint i = 0; i < REGION_SIZE; i++) {
+        if (i != 3) {
+            EXPECT_TRUE(check_voxels(reader, i, 0, i)) << i;
+        }
+    }
+    EXPECT_FALSE(reader.getVoxels(0, 1));
+}
+
+TEST(Regions, ReadWhileWriting) {
+    auto root = setup_world();
+
+    WorldRegions regions(io::path("regtest:world"));
+    for (uint i = 0; i < REGION_SIZE; i++) {
+        put_voxels(regions, i, 0, i);
+    }
+    regions.writeAll();
+
+    // readers keep region file mapped while it is being rewritten
+    std::atomic<bool> running = true;
+    std::atomic<int> failures = 0;
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 2; t++) {
+        readers.emplace_back([&, t]() {
+            while (running) {
+                for (uint i = t + 1; i < REGION_SIZE; i += 2) {
+                    if (!check_voxels(regions, i, 0, i)) {
+                        failures++;
+                    }
+                }
+            }
+        });
+    }
+    for (int i = 0; i < 20; i++) {
+        put_voxels(regions, 0, 0, 100 + i);
+        regions.writeAll();
+    }
+    running = false;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(failures, 0);
+    EXPECT_TRUE(check_voxels(regions, 0, 0, 119));
+}
+
+TEST(Regions, Convert3to4) {
+    auto root = setup_world();
+
+    // version 3: chunks data followed by the offsets table
+    ByteBuilder builder;
+    builder.putCStr(".VOXREG");
+    builder.put(3);
+    builder.put(static_cast<ubyte>(compression::Method::NONE));
+    uint32_t offsets[REGION_CHUNKS_COUNT] {};
+    for (int i = 0; i < 10; i++) {
+        offsets[i * 3] = builder.size();
+        uint32_t size = 100 + i * 1000;
+        builder.putInt32(size);
+        builder.putInt32(size);
+        for (uint32_t j = 0; j < size; j++) {
+            builder.put((j + i) % 256);
+        }
+    }
+    for (uint32_t offset : offsets) {
+        builder.putInt32(offset);
+    }
+    auto src = builder.build();
+    auto dst = compatibility::convert_region_3to4(
+        util::Buffer<ubyte>(src.data(), src.size())
+    );
+    EXPECT_EQ(dst.size() % REGION_SECTOR_SIZE, 0);
+
+    io::path filename("regtest:0_0.bin");
+    io::write_bytes(filename, dst.data(), dst.size());
+    regfile file(filename);
+    EXPECT_EQ(file.version, REGION_FORMAT_VERSION);
+    for (uint i = 0; i < REGION_CHUNKS_COUNT; i++) {
+        uint32_t size, srcSize;
+        const ubyte* data = file.read(i, size, srcSize);
+        if (i % 3 || i >= 30) {
+            EXPECT_EQ(data, nullptr);
+            continue;
+        }
+        ASSERT_NE(data, nullptr);
+        uint32_t index = i / 3;
+        ASSERT_EQ(size, 100 + index * 1000);
+        for (uint32_t j = 0; j < size; j++) {
+            ASSERT_EQ(data[j], (j + index) % 256);
+        }
+    }
+}
+
+TEST(Regions, AsyncSave) {
+    auto root = setup_world();
+
+    WorldRegions regions(io::path("regtest:world"));
+    regions.setAsyncSave(true);
+    for (int i = 0; i < 100; i++) {
+        put_voxels(regions, i % 40, i / 40, i);
+        // queued data is available before it is stored
+        EXPECT_TRUE(check_voxels(regions, i % 40, i / 40, i));
+    }
+    bool saved = false;
+    regions.writeAllAsync([&saved]() { saved = true; });
+    put_voxels(regions, 1, 0, 1000);
+    regions.writeAll();
+    regions.update();
+    EXPECT_TRUE(saved);
+
+    auto stats = regions.getSaveStats();
+    EXPECT_EQ(stats.chunksWritten, 101);
+    EXPECT_EQ(stats.queuedTasks, 0);
+
+    WorldRegions reader(io::path("regtest:world"));
+    EXPECT_TRUE(check_voxels(reader, 1, 0, 1000));
+    for (int i = 2; i < 100; i++) {
+        EXPECT_TRUE(check_voxels(reader, i % 40, i / 40, i)) << i;
+    }
+}
+
+TEST(Regions, RecompressAsync) {
+    auto root = setup_world();
+    {
+        WorldRegions regions(io::path("regtest:world"));
+        for (uint i = 0; i < REGION_SIZE; i++) {
+            put_voxels(regions, i, 0, i);
+        }
+        regions.writeAll();
+    }
+    WorldRegions regions(io::path("regtest:world"));
+    regions.setAsyncSave(true);
+    regions.setCompression(REGION_LAYER_VOXELS, compression::Method::GZIP);
+    EXPECT_TRUE(regions.recompressRegion(0, 0, REGION_LAYER_VOXELS));
+    EXPECT_FALSE(regions.recompressRegion(0, 0, REGION_LAYER_VOXELS));
+    regions.writeAll();
+
+    WorldRegions reader(io::path("regtest:world"));
+    for (uint i = 0; i < REGION_SIZE; i++) {
+        EXPECT_TRUE(check_voxels(reader, i, 0, i)) << i;
+    }
+}
@@ -0,0 +1,160 @@
+#include "world/generator/WorldGenerator.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+
+#include "../../test_content.hpp"
+#include "world/generator/GeneratorDef.hpp"
+
+/// @brief Stateless script placing overlapping lines of different blocks
+/// with equal priority, so the result depends on placements order
+class TestGeneratorScript : public GeneratorScript {
+    blockid_t stone;
+    blockid_t ore;
+public:
+    TestGeneratorScript(blockid_t stone, blockid_t ore)
+        : stone(stone), ore(ore) {
+    }
+
+    void initialize(uint64_t seed) override {
+    }
+
+    std::unique_ptr<GeneratorScript> clone() const override {
+        return std::make_unique<TestGeneratorScript>(stone, ore);
+    }
+
+    std::shared_ptr<Heightmap> generateHeightmap(
+        const glm::ivec2& offset,
+        const glm::ivec2& size,
+        uint bpd,
+        const std::vector<std::shared_ptr<Heightmap>>& inputs
+    ) override {
+        auto map = std::make_shared<Heightmap>(size.x, size.y);
+        for (int z = 0; z < size.y; z++) {
+            for (int x = 0; x < size.x; x++) {
+                float gx = (offset.x + x) * bpd;
+                float gz = (offset.y + z) * bpd;
+                map->getValues()[z * size.x + x] =
+                    0.3f + 0.05f * std::sin(gx * 0.1f) * std::cos(gz * 0.07f);
+            }
+        }
+        return map;
+    }
+
+    std::vector<std::shared_ptr<Heightmap>> generateParameterMaps(
+        const glm::ivec2& offset, const glm::ivec2& size, uint bpd
+    ) override {
+        auto map = std::make_shared<Heightmap>(size.x, size.y);
+        for (int z = 0; z < size.y; z++) {
+            for (int x = 0; x < size.x; x++) {
+                map->getValues()[z * size.x + x] =
+                    std::sin((offset.x + x) * bpd * 0.05f) * 0.5f + 0.5f;
+            }
+        }
+        return {map};
+    }
+
+    std::vector<Placement> placeStructuresWide(
+        const glm::ivec2& offset, const glm::ivec2& size, uint chunkHeight
+    ) override {
+        glm::ivec3 center(offset.x + size.x / 2, 40, offset.y + size.y / 2);
+        glm::ivec3 diagonal(20, 0, 20);
+        return {
+            Placement(0, LinePlacement {stone, center, center + diagonal, 3}),
+            Placement(0, LinePlacement {ore, center, center - diagonal, 2}),
+        };
+    }
+
+    std::vector<Placement> placeStructures(
+        const glm::ivec2& offset,
+        const glm::ivec2& size,
+        const std::shared_ptr<Heightmap>& heightmap,
+        uint chunkHeight
+    ) override {
+        int height = heightmap->getValues()[0] * chunkHeight;
+        glm::ivec3 a(offset.x, height, offset.y);
+        return {Placement(1, LinePlacement {BLOCK_AIR, a, a + 12, 2})};
+    }
+};
+
+static BlocksLayer create_layer(const std::string& block, int height) {
+    return BlocksLayer {block, height, true, {0}};
+}
+
+static std::unique_ptr<GeneratorDef> create_generator(const Content& content) {
+    auto def = std::make_unique<GeneratorDef>("test:generator");
+    def->script = std::make_unique<TestGeneratorScript>(
+        content.blocks.require("test:stone").rt.id,
+        content.blocks.require("test:ore").rt.id
+    );
+    def->biomeParameters = 1;
+    def->wideStructsChunksRadius = 2;
+    for (float value : {0.0f, 1.0f}) {
+        Biome biome {};
+        biome.parameters = {BiomeParameter {value, 1.0f}};
+        biome.groundLayers.layers = {
+            create_layer(value > 0.5f ? "test:stone" : "test:ore", 2),
+            create_layer("test:stone", -1),
+        };
+        biome.groundLayers.lastLayersHeight = 0;
+        def->biomes.push_back(std::move(biome));
+    }
+    def->prepare(&content);
+    return def;
+}
+
+inline constexpr int AREA_RADIUS = 3;
+
+/// @brief Generate chunks of the area
+/// @param batch prepare all prototypes at once instead of one by one in
+/// reversed order
+static std::vector<voxel> generate_area(
+    const GeneratorDef& def, const Content& content, uint workers, bool batch
+) {
+    WorldGenerator generator(def, content, 42, workers);
+    generator.update(0, 0, AREA_RADIUS);
+
+    std::vector<glm::ivec2> positions;
+    for (int z = -AREA_RADIUS; z <= AREA_RADIUS; z++) {
+        for (int x = -AREA_RADIUS; x <= AREA_RADIUS; x++) {
+            positions.emplace_back(x, z);
+        }
+    }
+    std::vector<std::shared_ptr<const ChunkPrototype>> prototypes;
+    if (batch) {
+        prototypes = generator.prepare(positions);
+    } else {
+        prototypes.resize(positions.size());
+        for (int i = positions.size() - 1; i >= 0; i--) {
+            prototypes[i] = generator.prepare(positions[i].x, positions[i].y);
+        }
+    }
+    std::vector<voxel> voxels(positions.size() * CHUNK_VOL);
+    for (size_t i = 0; i < positions.size(); i++) {
+        EXPECT_NE(prototypes[i], nullptr);
+        generator.generate(
+            voxels.data() + i * CHUNK_VOL,
+            *prototypes[i],
+            positions[i].x,
+            positions[i].y
+        );
+    }
+    return voxels;
+}
+
+TEST(WorldGenerator, ParallelStagesDeterministic) {
+    auto content = create_test_content({"test:stone", "test:ore"});
+    auto def = create_generator(*content);
+
+    auto serial = generate_area(*def, *content, 1, false);
+    auto parallel = generate_area(*def, *content, 4, true);
+    ASSERT_EQ(serial.size(), parallel.size());
+    EXPECT_EQ(
+        std::memcmp(
+            serial.data(), parallel.data(), serial.size() * sizeof(voxel)
+        ),
+        0
+    );
+}